@@ -0,0 +1,53 @@
+#include <cctype>
+#include <iostream>
+#include "clcommands.hpp"
+#include "clparser.hpp"
+
+// Each handler builds its parser and help text only when its command runs
+
+int run_connect(int argc, char **argv) {
+    CLInfo info;
+    CLParser parser(1, "hp:");
+    parser.parse(argc, argv, info);
+    if (!info.success || parser.get_opt("-h")) {
+        std::cout << info.info << "Usage: CLICommandsExample connect <ip_address> [-p <port_number>]." << std::endl;
+        return info.success ? 0 : -1;
+    }
+    std::cout << "Connecting to " << parser.get_arg<std::string>(0) << ":" << parser.get_kwarg<int>("-p", 5050) << std::endl;
+    return 0;
+}
+
+int run_echo(int argc, char **argv) {
+    CLInfo info;
+    CLParser parser(1, "u");
+    parser.parse(argc, argv, info);
+    if (!info.success) {
+        std::cout << info.info << "Usage: CLICommandsExample echo <text> [-u]." << std::endl;
+        return -1;
+    }
+    std::string text = parser.get_arg<std::string>(0);
+    if (parser.get_opt("-u")) {
+        for (char &c: text) {c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));}
+    }
+    std::cout << text << std::endl;
+    return 0;
+}
+
+constexpr CLCommandTable commands({
+    {"echo", run_echo, "Print a text."},
+    {"connect", run_connect, "Connect to a server."}
+});
+static_assert(commands.valid(), "Invalid command table");
+
+int main(int argc, char *argv[]) {
+    CLInfo info;
+    int result = commands.dispatch(argc, argv, info);
+    if (!info.success) {
+        std::cout << info.info << "Usage: CLICommandsExample <command> [args].\n";
+        for (const CLCommand &command: commands) {
+            std::cout << "    " << command.name << ": " << command.summary << "\n";
+        }
+        std::cout << std::endl;
+    }
+    return result;
+}
@@ -0,0 +1,51 @@
+#include <iostream>
+#include <string>
+#include "static_clparser.hpp"
+
+static constexpr CLSpec spec(1, "hap:b");
+
+void print_help() {
+    std::string str = "";
+    str += "Usage: StaticCLIExample <ip_address> [opts].\n";
+    str += "    -h: Display this message.\n";
+    str += "    -a: Some flag option.\n";
+    str += "    -b: Some inverted flag option.\n";
+    str += "    -p <port_number>: Port number.\n";
+    std::cout << str << std::endl;
+
+}
+
+int main(int argc, char *argv[]) {
+    // Configure parser, the flags are fixed at compile time
+    StaticCLParser<spec> parser;
+    CLResult result = parser.parse(argc, argv);
+
+    // Check if successfull parse
+    if (!result) {
+        std::cout << parser.message(result, argv) << std::endl;
+        print_help();
+        return -1;
+    }
+
+    // Check if help option is specified
+    if (parser.get_opt<'h'>()) {
+        print_help();
+        return 0;
+    }
+
+    // Extract values
+    std::string_view file = parser.get_file();
+    std::string_view ip = parser.get_arg(0);
+    bool some_flag = parser.get_opt<'a'>();
+    bool some_flag_inverted = parser.get_opt<'b'>(true);
+    int port = parser.get_kwarg<'p', int>(5050);
+
+    // Report values
+    std::cout << "Filepath: " << file << std::endl;
+    std::cout << "IP <arg 0>: " << ip << std::endl;
+    std::cout << "Port [-p]: " << port << std::endl;
+    std::cout << "Some flag [-a]: " << some_flag << std::endl;
+    std::cout << "Some inverted flag [-b]: " << some_flag_inverted << std::endl;
+
+    return 0;
+}
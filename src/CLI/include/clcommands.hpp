@@ -0,0 +1,151 @@
+#ifndef APPTOOLS_COMMAND_LINE_COMMANDS
+#define APPTOOLS_COMMAND_LINE_COMMANDS
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "clparser.hpp"
+
+/**
+ * A subcommand of a multi-tool binary.
+ * "run" receives the arguments from the command name on, argv[0] is the command name.
+ * The handler constructs its parser and help text itself, so they are only built if the command runs.
+*/
+struct CLCommand {
+    std::string_view name;
+    int (*run)(int argc, char **argv) = nullptr;
+    std::string_view summary;
+};
+
+/**
+ * Subcommand dispatch table sorted by name at compile time.
+ *
+ * --------------------------------------------
+ * Usage description:
+ * --------------------------------------------
+ * Declare the table constexpr, with a handler per command:
+ *     constexpr CLCommandTable commands({
+ *         {"get", run_get, "Read a value."},
+ *         {"set", run_set, "Write a value."}
+ *     });
+ *     static_assert(commands.valid(), "Duplicate command name");
+ *
+ * Call "dispatch" from main, it looks up argv[1] and runs the matching handler.
+ * Iterate the table to list the commands, in sorted order.
+ *
+ * --------------------------------------------
+ * Notes:
+ * --------------------------------------------
+ * Lookup is a binary search over string_views, nothing is constructed or allocated before the handler runs,
+ * except the error message of a failed dispatch.
+*/
+template <size_t N>
+class CLCommandTable {
+    public:
+        /**
+         * Constructor.
+         *
+         * @param commands: the commands, in any order
+        */
+        constexpr CLCommandTable(const CLCommand (&commands)[N]) :
+        _commands()
+        {
+            // Insertion sort, N is small and this runs at compile time
+            for (size_t i = 0; i < N; i++) {
+                size_t j = i;
+                CLCommand command = commands[i];
+                while (j > 0 && command.name < this->_commands[j-1].name) {
+                    this->_commands[j] = this->_commands[j-1];
+                    j -= 1;
+                }
+                this->_commands[j] = command;
+            }
+        }
+
+        /**
+         * @return false if a command name is declared twice, is empty or a command has no handler
+        */
+        constexpr bool valid() const {
+            for (size_t i = 0; i < N; i++) {
+                if (this->_commands[i].name.empty() || this->_commands[i].run == nullptr) {
+                    return false;
+                }
+                if (i > 0 && this->_commands[i].name == this->_commands[i-1].name) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /**
+         * Find a command
+         *
+         * @param name: the command name
+         *
+         * @return the command, nullptr if no command has the name
+        */
+        constexpr const CLCommand* find(std::string_view name) const {
+            size_t low = 0;
+            size_t high = N;
+            while (low < high) {
+                size_t middle = low + (high - low) / 2;
+                int order = name.compare(this->_commands[middle].name);
+                if (order == 0) {
+                    return &this->_commands[middle];
+                } else if (order < 0) {
+                    high = middle;
+                } else {
+                    low = middle + 1;
+                }
+            }
+            return nullptr;
+        }
+
+        /**
+         * Run the command named by argv[1]
+         * Supply argc and argv from main(int argc, char **argv) call
+         *
+         * @param argc: argument count from main function
+         * @param argv: argument vector from main function
+         * @param info: CLInfo struct for dispatch details, fails if no or an unknown command is supplied
+         *
+         * @return the return value of the handler, -1 if no handler ran
+        */
+        int dispatch(int argc, char **argv, CLInfo &info) const {
+            info.success = false;
+            if (argc < 2) {
+                info.info = "Error: No command supplied.\n";
+                return -1;
+            }
+            const CLCommand *command = this->find(argv[1]);
+            if (command == nullptr) {
+                info.info = "Error: Unknown command: \"" + std::string(argv[1]) + "\".\n";
+                return -1;
+            }
+            info.success = true;
+            info.info.clear();
+            return command->run(argc - 1, argv + 1);
+        }
+
+        constexpr size_t size() const {
+            return N;
+        }
+
+        constexpr const CLCommand* begin() const {
+            return this->_commands.data();
+        }
+
+        constexpr const CLCommand* end() const {
+            return this->_commands.data() + N;
+        }
+
+    private:
+        std::array<CLCommand, N> _commands;
+};
+
+template <size_t N>
+CLCommandTable(const CLCommand (&)[N]) -> CLCommandTable<N>;
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef APPTOOLS_COMMAND_LINE_CONVERT
+#define APPTOOLS_COMMAND_LINE_CONVERT
+
+#include <charconv>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+
+/**
+ * Convert a command line value to a type.
+ *
+ * Integral and floating-point types are parsed with std::from_chars, without locale or allocation.
+ * The whole value must be consumed, a leading '+' is accepted.
+ * bool accepts "1", "0", "true" and "false", character types a single character.
+ * std::string and std::string_view return the value unchanged, a std::string_view views "str".
+ * Other types are read with operator>> from a std::istringstream.
+ *
+ * @tparam T: the type to interpret the value as
+ *
+ * @param str: the value
+ *
+ * @return the converted value, std::nullopt if "str" is malformed or out of range for T
+*/
+template <typename T>
+std::optional<T> cl_convert(std::string_view str) {
+    if constexpr (std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view>) {
+        return T(str);
+    } else if constexpr (std::is_same_v<T, bool>) {
+        if (str == "1" || str == "true") {
+            return true;
+        } else if (str == "0" || str == "false") {
+            return false;
+        }
+        return std::nullopt;
+    } else if constexpr (std::is_same_v<T, char> || std::is_same_v<T, signed char> || std::is_same_v<T, unsigned char>) {
+        if (str.size() != 1) {
+            return std::nullopt;
+        }
+        return static_cast<T>(str[0]);
+    } else if constexpr (std::is_arithmetic_v<T>) {
+        if (str.size() > 1 && str[0] == '+' && str[1] != '-') {
+            str.remove_prefix(1);
+        }
+        T value;
+        auto [end, error] = std::from_chars(str.data(), str.data() + str.size(), value);
+        if (error != std::errc() || end != str.data() + str.size() || str.empty()) {
+            return std::nullopt;
+        }
+        return value;
+    } else {
+        std::istringstream ss{std::string(str)};
+        T value;
+        ss >> value;
+        if (ss.fail()) {
+            return std::nullopt;
+        }
+        return value;
+    }
+}
+
+#endif
@@ -1,9 +1,26 @@
 #ifndef APPTOOLS_COMMAND_LINE_PARSER
 #define APPTOOLS_COMMAND_LINE_PARSER
 
-#include <sstream>
+#include <cctype>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <optional>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "clconvert.hpp"
+
+// Spans of the parser, only with APPTOOLS_TRACE (see trace.hpp), the parser needs nothing else otherwise
+#ifdef APPTOOLS_TRACE
+#include "trace.hpp"
+#define CL_TRACE_SPAN(name) TRC_SPAN("cli", name)
+#else
+#define CL_TRACE_SPAN(name) static_cast<void>(0)
+#endif
 
 /**
  * Struct containing information about the success or failure of parsing command line arguments.
@@ -14,6 +31,123 @@ struct CLInfo {
     std::string info;
 };
 
+/**
+ * Immutable result of a CLParser parse, see "CLParser::results".
+ * Holds copies of all values. The getters are const and do not cache,
+ * so one result may be shared across threads, for instance as std::shared_ptr<const CLArguments>.
+*/
+class CLArguments {
+    public:
+        CLArguments(std::string file, std::vector<std::string> args,
+                    std::map<std::string, bool, std::less<>> flags,
+                    std::map<std::string, std::string, std::less<>> kwargs) :
+        _file(std::move(file)), _args(std::move(args)), _flags(std::move(flags)), _kwargs(std::move(kwargs))
+        {
+        }
+
+        /**
+         * Get option flag value
+         * 
+         * @param flag: option flag
+         * @param invert: invert output (optional)
+         * 
+         * @return inverted or uninverted value of the supplied flag
+        */
+        bool get_opt(std::string_view flag, bool invert=false) const {
+            auto value = this->_flags.find(flag);
+            return (value != this->_flags.end() && value->second) ^ invert;
+        }
+
+        /**
+         * Get mandatory argument value
+         * 
+         * @tparam T: the type to interpret argument as.
+         * 
+         * @param index: the argument index number
+         * 
+         * @return value of the argument, a value initialized T if the argument is malformed
+        */
+        template <typename T>
+        T get_arg(int index) const {
+            return this->try_get_arg<T>(index).value_or(T());
+        }
+
+        /**
+         * Get mandatory argument value
+         * 
+         * @tparam T: the type to interpret argument as.
+         * 
+         * @param index: the argument index number
+         * 
+         * @return value of the argument, std::nullopt if the argument is malformed
+        */
+        template <typename T>
+        std::optional<T> try_get_arg(int index) const {
+            return cl_convert<T>(this->_args[index]);
+        }
+
+        /**
+         * Get optional argument value
+         * 
+         * @tparam T: the type to interpret argument as.
+         * 
+         * @param flag: the flag
+         * @param default_value: The value to return if this option has not been supplied or is malformed.
+         * 
+         * @return value of the argument
+        */
+        template <typename T>
+        T get_kwarg(std::string_view flag, T default_value) const {
+            std::optional<T> value = this->try_get_kwarg<T>(flag);
+            return value ? *value : default_value;
+        }
+
+        /**
+         * Get optional argument value
+         * 
+         * @tparam T: the type to interpret argument as.
+         * 
+         * @param flag: the flag
+         * 
+         * @return value of the argument, std::nullopt if this option has not been supplied or is malformed
+        */
+        template <typename T>
+        std::optional<T> try_get_kwarg(std::string_view flag) const {
+            auto value = this->_kwargs.find(flag);
+            if (value == this->_kwargs.end() || value->second.empty()) {
+                return std::nullopt;
+            }
+            return cl_convert<T>(value->second);
+        }
+
+        /**
+         * Check if a keyword argument has been supplied
+         * 
+         * @param flag: the flag
+         * 
+         * @return true if the keyword was supplied with a non-empty value
+        */
+        bool has_kwarg(std::string_view flag) const {
+            auto value = this->_kwargs.find(flag);
+            return value != this->_kwargs.end() && !value->second.empty();
+        }
+
+        /**
+         * Get the application file path
+         * 
+         * @return the application file path
+        */
+        const std::string& get_file() const {
+            return this->_file;
+        }
+
+    private:
+        std::string _file;
+        std::vector<std::string> _args;
+        std::map<std::string, bool, std::less<>> _flags;
+        std::map<std::string, std::string, std::less<>> _kwargs;
+};
+
 /**
  * Command line argument parser.
  * 
@@ -23,14 +157,20 @@ struct CLInfo {
  * Keyword arguments (flags with an argument) are declared as a single character followed by a ":" character.
  * Example: The flag string "abc:d" declares "-a", "-b", "-d" as options and "-c <value>" as keyword argument.
  * 
- * Parse the command line arguments by calling the method "parse".
+ * Parse the command line arguments by calling the method "parse", with argc and argv or a command line string.
  * The supplied CLInfo struct will provide information about the success or failure of the parse operation.
+ * Every parse starts from a cleared state, so one parser can parse many command lines.
+ * Call "reset" to clear the values without parsing, the capacity of the stored values is kept.
  * 
  * Retrieve boolean flags (options) by calling the method "get_opt".
  * Retrieve optional aruments (keyword arguments) by calling the method "get_kwarg".
  * Retrieve mandatory arguments by calling the method "get_arg".
+ * Values are converted with "cl_convert", see clconvert.hpp.
+ * Use "try_get_arg" and "try_get_kwarg" to detect malformed values.
+ * Converted arithmetic values are cached, repeated calls with the same type do not parse the value again.
  * 
- * TODO: Multi word string kwargs are broken. 
+ * A parser is not safe to use from several threads at once, also not for reading, as conversions update the cache.
+ * Call "results" for an immutable copy of the values that may be shared across threads.
  * 
 */
 class CLParser {
@@ -43,7 +183,7 @@ class CLParser {
         _flags(), _kwargs()
         {
             this->_num_args = 0;
-            this->_args = new std::string[1];
+            this->_args = new _Value[1];
         }
 
         /**
@@ -58,7 +198,7 @@ class CLParser {
         _flags(), _kwargs() 
         {
             this->_num_args = num_args;
-            this->_args = new std::string[num_args];
+            this->_args = new _Value[num_args];
             this->add_flags(flags);
         }
 
@@ -79,7 +219,7 @@ class CLParser {
             if (num_args < 1) {
                 num_args = 1;
             }
-            this->_args = new std::string[num_args];
+            this->_args = new _Value[num_args];
         }
 
         /**
@@ -88,13 +228,13 @@ class CLParser {
          * 
          * @param options: formatted option string         
         */
-        void add_flags(std::string options) {
+        void add_flags(std::string_view options) {
             std::string flag;
             for (int i = 0; i < options.size(); i++) {
                 flag = "-";
                 flag += options[i];
                 if (i < options.size() - 1 && options[i+1] == ':') {
-                    this->_kwargs.emplace(flag, "");
+                    this->_kwargs.emplace(flag, _Value());
                     i += 1;
                 } else {
                     this->_flags.emplace(flag, false);
@@ -110,8 +250,9 @@ class CLParser {
          * 
          * @return inverted or uninverted value of the supplied flag
         */
-        bool get_opt(std::string flag, bool invert=false) {
-            return this->_flags[flag] ^ invert;
+        bool get_opt(std::string_view flag, bool invert=false) {
+            auto value = this->_flags.find(flag);
+            return (value != this->_flags.end() && value->second) ^ invert;
         }
 
         /**
@@ -121,11 +262,25 @@ class CLParser {
          * 
          * @param index: the argument index number
          * 
-         * @return value of the argument
+         * @return value of the argument, a value initialized T if the argument is malformed
         */
         template <typename T>
         T get_arg(int index) {
-            return this->_convert_to<T>(this->_args[index]);
+            return this->try_get_arg<T>(index).value_or(T());
+        }
+
+        /**
+         * Get mandatory argument value
+         * 
+         * @tparam T: the type to interpret argument as.
+         * 
+         * @param index: the argument index number
+         * 
+         * @return value of the argument, std::nullopt if the argument is malformed
+        */
+        template <typename T>
+        std::optional<T> try_get_arg(int index) {
+            return this->_convert<T>(this->_args[index]);
         }
 
         /**
@@ -134,22 +289,44 @@ class CLParser {
          * @tparam T: the type to interpret argument as.
          * 
          * @param flag: the flag
-         * @param default_value: The value to return if this option has not been supplied.
+         * @param default_value: The value to return if this option has not been supplied or is malformed.
          * 
          * @return value of the argument
         */
         template <typename T>
-        T get_kwarg(std::string flag, T default_value) {
-            std::string str;
-            T value;
+        T get_kwarg(std::string_view flag, T default_value) {
+            std::optional<T> value = this->try_get_kwarg<T>(flag);
+            return value ? *value : default_value;
+        }
 
-            str = this->_kwargs[flag];
-            if (str != "") {
-                value = this->_convert_to<T>(str);
-            } else {
-                value = default_value;
+        /**
+         * Get optional argument value
+         * 
+         * @tparam T: the type to interpret argument as.
+         * 
+         * @param flag: the flag
+         * 
+         * @return value of the argument, std::nullopt if this option has not been supplied or is malformed
+        */
+        template <typename T>
+        std::optional<T> try_get_kwarg(std::string_view flag) {
+            auto value = this->_kwargs.find(flag);
+            if (value == this->_kwargs.end() || value->second.text.empty()) {
+                return std::nullopt;
             }
-            return value;
+            return this->_convert<T>(value->second);
+        }
+
+        /**
+         * Check if a keyword argument has been supplied
+         * 
+         * @param flag: the flag
+         * 
+         * @return true if the keyword was supplied with a non-empty value
+        */
+        bool has_kwarg(std::string_view flag) {
+            auto value = this->_kwargs.find(flag);
+            return value != this->_kwargs.end() && !value->second.text.empty();
         }
 
         /**
@@ -157,7 +334,7 @@ class CLParser {
          * 
          * @return the application file path
         */
-        std::string get_file() {
+        const std::string& get_file() {
             return this->_file;
         }
 
@@ -170,20 +347,120 @@ class CLParser {
          * @param info: CLInfo struct for parse details
         */
         void parse(int argc, char **argv, CLInfo &info) {
+            CL_TRACE_SPAN("CLParser::parse");
+            this->_parse(argc, [argv](int index) {return std::string_view(argv[index]);}, info);
+        }
+
+        /**
+         * Parse a command line string, without building an argument vector.
+         * The first token is the application file path, like argv[0].
+         * Tokens are separated by whitespace.
+         * Single or double quotes group words into one token, "-m 'multi word value'" passes "multi word value" to "-m".
+         * A backslash outside single quotes takes the next character literally.
+         * Token buffers are reused, parsing similar command lines does not allocate once their capacity is reached.
+         * 
+         * @param command_line: the command line
+         * @param info: CLInfo struct for parse details
+        */
+        void parse(std::string_view command_line, CLInfo &info) {
+            CL_TRACE_SPAN("CLParser::parse");
+            if (!this->_tokenize(command_line)) {
+                this->reset();
+                info.success = false;
+                info.info = "Error: Unterminated quote in command line.\n";
+                return;
+            }
+            this->_parse(static_cast<int>(this->_num_tokens), [this](int index) {return std::string_view(this->_tokens[index]);}, info);
+        }
+
+        /**
+         * Clear all parsed values.
+         * Options are unset, keyword arguments and mandatory arguments empty.
+         * The capacity of the stored values is kept.
+        */
+        void reset() {
+            this->_file.clear();
+            for (int index = 0; index < this->_num_args; index++) {
+                this->_args[index].set("");
+            }
+            for (auto &flag: this->_flags) {
+                flag.second = false;
+            }
+            for (auto &keyword: this->_kwargs) {
+                keyword.second.set("");
+            }
+        }
+
+        /**
+         * Copy the parsed values
+         * 
+         * @return an immutable copy of the values, safe to share across threads
+        */
+        CLArguments results() const {
+            std::vector<std::string> args;
+            std::map<std::string, std::string, std::less<>> kwargs;
+            args.reserve(this->_num_args);
+            for (int index = 0; index < this->_num_args; index++) {
+                args.push_back(this->_args[index].text);
+            }
+            for (const auto &keyword: this->_kwargs) {
+                kwargs.emplace(keyword.first, keyword.second.text);
+            }
+            return CLArguments(this->_file, std::move(args), this->_flags, std::move(kwargs));
+        }
+
+
+    private:
+        /**
+         * Argument value with the last arithmetic conversion cached
+        */
+        struct _Value {
+            std::string text;
+            const void *cached_type = nullptr;
+            bool cached_valid = false;
+            alignas(16) unsigned char cached[16];
+
+            void set(std::string_view str) {
+                this->text = str;
+                this->cached_type = nullptr;
+            }
+        };
+
+        // One distinct address per type, identifies the type of a cached conversion
+        template <typename T>
+        static constexpr char _type_tag = 0;
+
+        std::string _file;
+        _Value *_args;
+        std::map<std::string, bool, std::less<>> _flags;
+        std::map<std::string, _Value, std::less<>> _kwargs;
+        int _num_args;
+        std::vector<std::string> _tokens;
+        size_t _num_tokens = 0;
+
+        bool _is_flag(std::string_view str) {
+            return this->_flags.find(str) != this->_flags.end() || this->_kwargs.find(str) != this->_kwargs.end();
+        }
+
+        /**
+         * Parse tokens, "token(index)" returns the token at an argv style index
+        */
+        template <typename Token>
+        void _parse(int argc, const Token &token, CLInfo &info) {
             int index, supplied_arguments;
-            bool is_opt, is_kwarg;
-            std::string str, kwarg;
+            std::string_view str, kwarg;
 
-            this->_file = argv[0];
+            this->reset();
             info.success = false;
+            if (argc > 0) {
+                this->_file = token(0);
+            }
 
             // Check number of supplied arguments
             supplied_arguments = 0;
             for (index = 1; index < argc; index++) {
-                str = argv[index];
-                is_opt = this->_flags.count(str) > 0;
-                is_kwarg = this->_kwargs.count(str) > 0;
-                if (is_opt || is_kwarg) {
+                str = token(index);
+                if (this->_is_flag(str)) {
                     break;  
                 } else if (str.size() == 2 && str[0] == '-') {
                     break;             
@@ -204,39 +481,39 @@ class CLParser {
 
             // Parse arguments
             for (index = 0; index < this->_num_args; index++) {
-                str = argv[index+1];
-                this->_args[index] = str;
+                str = token(index+1);
+                this->_args[index].set(str);
             } 
 
             // Parse options and keyword arguments
             for (index = this->_num_args+1; index < argc; index++) {
-                str = argv[index];
-                if (this->_flags.count(str) > 0) {
-                    this->_flags[str] = true;
-                } else if (this->_kwargs.count(str) > 0) {
+                str = token(index);
+                auto flag = this->_flags.find(str);
+                auto keyword = flag == this->_flags.end() ? this->_kwargs.find(str) : this->_kwargs.end();
+                if (flag != this->_flags.end()) {
+                    flag->second = true;
+                } else if (keyword != this->_kwargs.end()) {
                     if (index < argc -1) {
                         index += 1;
-                        kwarg = argv[index];
-                        is_opt = this->_flags.count(kwarg) > 0;
-                        is_kwarg = this->_kwargs.count(kwarg) > 0;
-                        if (is_opt || is_kwarg) {
+                        kwarg = token(index);
+                        if (this->_is_flag(kwarg)) {
                             // Known option in keyword argument
-                            info.info = "Error: Received option as argument to keyword \"" + str + "\".\n";
+                            info.info = "Error: Received option as argument to keyword \"" + std::string(str) + "\".\n";
                             return;
                         } else if (kwarg.size() == 2 && kwarg[0] == '-') {
                             // Unknown option in keyword argument
-                            info.info = "Error: Received unknown option as argument to keyword \"" + str + "\".\n";
+                            info.info = "Error: Received unknown option as argument to keyword \"" + std::string(str) + "\".\n";
                             return;
                         } else {
-                            this->_kwargs[str] = kwarg; 
+                            keyword->second.set(kwarg);
                         }
                     } else {
                         // No argument error
-                        info.info = "Error: No argument given for keyword \"" + str + "\".\n";
+                        info.info = "Error: No argument given for keyword \"" + std::string(str) + "\".\n";
                         return;
                     }
                 } else {
-                    info.info = "Error: Unknown option: \"" + str + "\".\n";
+                    info.info = "Error: Unknown option: \"" + std::string(str) + "\".\n";
                     return;
                 }
             }
@@ -244,27 +521,73 @@ class CLParser {
             info.info = "Parse successful.";
         }
 
+        /**
+         * Split a command line into "_tokens", see "parse(std::string_view, CLInfo&)"
+         * 
+         * @return false if a quote is not terminated
+        */
+        bool _tokenize(std::string_view line) {
+            size_t index = 0;
+            this->_num_tokens = 0;
+            while (true) {
+                while (index < line.size() && std::isspace(static_cast<unsigned char>(line[index]))) {
+                    index += 1;
+                }
+                if (index == line.size()) {
+                    return true;
+                }
+                if (this->_num_tokens == this->_tokens.size()) {
+                    this->_tokens.emplace_back();
+                }
+                std::string &token = this->_tokens[this->_num_tokens++];
+                token.clear();
+                char quote = 0;
+                for (; index < line.size(); index++) {
+                    char c = line[index];
+                    if (quote == '\'') {
+                        if (c == '\'') {quote = 0;} else {token += c;}
+                    } else if (c == '\\' && index < line.size() - 1) {
+                        index += 1;
+                        token += line[index];
+                    } else if (quote == '"') {
+                        if (c == '"') {quote = 0;} else {token += c;}
+                    } else if (c == '"' || c == '\'') {
+                        quote = c;
+                    } else if (std::isspace(static_cast<unsigned char>(c))) {
+                        break;
+                    } else {
+                        token += c;
+                    }
+                }
+                if (quote != 0) {
+                    return false;
+                }
+            }
+        }
 
-    private:
-        std::string _file;
-        std::string *_args;
-        std::unordered_map<std::string, bool> _flags;
-        std::unordered_map<std::string, std::string> _kwargs;
-        int _num_args;
-
-        template <typename T> 
-        T _convert_to(const std::string &str) {
-            std::istringstream ss(str);
-            T num;
-            ss >> num;
-            return num;
+        template <typename T>
+        std::optional<T> _convert(_Value &value) {
+            if constexpr (std::is_arithmetic_v<T>) {
+                static_assert(sizeof(T) <= sizeof(value.cached), "Type is too large to be cached");
+                T result;
+                if (value.cached_type != &_type_tag<T>) {
+                    std::optional<T> converted = cl_convert<T>(value.text);
+                    value.cached_type = &_type_tag<T>;
+                    value.cached_valid = converted.has_value();
+                    if (converted) {
+                        std::memcpy(value.cached, &*converted, sizeof(T));
+                    }
+                }
+                if (!value.cached_valid) {
+                    return std::nullopt;
+                }
+                std::memcpy(&result, value.cached, sizeof(T));
+                return result;
+            } else {
+                return cl_convert<T>(value.text);
+            }
         }
 
 };
 
-template <>
-std::string CLParser::_convert_to<std::string>(const std::string &str) {
-    return str;
-}
-
 #endif
\ No newline at end of file
@@ -0,0 +1,378 @@
+#ifndef APPTOOLS_STATIC_COMMAND_LINE_PARSER
+#define APPTOOLS_STATIC_COMMAND_LINE_PARSER
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "clconvert.hpp"
+#include "clparser.hpp"
+
+/**
+ * Cause of a failed StaticCLParser parse.
+ * "StaticCLParser::message" formats the messages CLParser reports.
+*/
+enum class CLError {
+    None,
+    TooFewArguments,
+    TooManyArguments,
+    OptionAsKeywordArgument,
+    UnknownOptionAsKeywordArgument,
+    MissingKeywordArgument,
+    UnknownOption
+};
+
+/**
+ * Result of a StaticCLParser parse.
+ * "index" is the argv index of the offending token, 0 on success or argument count errors.
+*/
+struct CLResult {
+    CLError error;
+    int index;
+
+    /**
+     * @return true if the parse succeeded
+    */
+    explicit operator bool() const {
+        return this->error == CLError::None;
+    }
+};
+
+/**
+ * Compile-time flag specification for StaticCLParser.
+ * Uses the same flag string format as CLParser: "abc:d" declares "-a", "-b", "-d" as options and "-c <value>" as keyword argument.
+ *
+ * The flag string is turned into a table indexed by character, mapping each flag to a slot of the option or keyword table of the parser.
+ * Flags must be ASCII characters other than ':' and '-', and may only be declared once, see "valid".
+*/
+class CLSpec {
+    public:
+        static constexpr int MAX_FLAGS = 128;
+
+        /**
+         * Constructor.
+         *
+         * @param num_args: Number of mandatory arguments
+         * @param flags: formatted option string
+        */
+        constexpr CLSpec(int num_args, std::string_view flags) :
+        _slots(), _keyword(), _num_args(num_args), _num_options(0), _num_keywords(0), _valid(num_args >= 0)
+        {
+            for (int i = 0; i < MAX_FLAGS; i++) {
+                this->_slots[i] = -1;
+                this->_keyword[i] = false;
+            }
+            for (size_t i = 0; i < flags.size(); i++) {
+                unsigned char c = static_cast<unsigned char>(flags[i]);
+                bool keyword = i < flags.size() - 1 && flags[i+1] == ':';
+                if (c >= MAX_FLAGS || c == ':' || c == '-' || this->_slots[c] >= 0) {
+                    this->_valid = false;
+                    continue;
+                }
+                this->_keyword[c] = keyword;
+                this->_slots[c] = static_cast<int8_t>(keyword ? this->_num_keywords++ : this->_num_options++);
+                if (keyword) {
+                    i += 1;
+                }
+            }
+        }
+
+        /**
+         * @return false if the flag string declares a flag twice or contains an invalid character, or "num_args" is negative
+        */
+        constexpr bool valid() const {
+            return this->_valid;
+        }
+
+        constexpr int num_args() const {
+            return this->_num_args;
+        }
+
+        constexpr int num_options() const {
+            return this->_num_options;
+        }
+
+        constexpr int num_keywords() const {
+            return this->_num_keywords;
+        }
+
+        /**
+         * @param c: flag character
+         *
+         * @return true if "-c" is an option
+        */
+        constexpr bool is_option(char c) const {
+            return this->slot(c) >= 0 && !this->_keyword[static_cast<unsigned char>(c)];
+        }
+
+        /**
+         * @param c: flag character
+         *
+         * @return true if "-c <value>" is a keyword argument
+        */
+        constexpr bool is_keyword(char c) const {
+            return this->slot(c) >= 0 && this->_keyword[static_cast<unsigned char>(c)];
+        }
+
+        /**
+         * @param c: flag character
+         *
+         * @return index into the option or keyword table, -1 if "-c" is not declared
+        */
+        constexpr int slot(char c) const {
+            unsigned char index = static_cast<unsigned char>(c);
+            return index < MAX_FLAGS ? this->_slots[index] : -1;
+        }
+
+    private:
+        int8_t _slots[MAX_FLAGS];
+        bool _keyword[MAX_FLAGS];
+        int _num_args;
+        int _num_options;
+        int _num_keywords;
+        bool _valid;
+};
+
+/**
+ * Command line argument parser with a compile-time flag specification.
+ *
+ * Behaves like CLParser, but the flags and number of mandatory arguments are fixed by a constexpr CLSpec.
+ * Parsing is a single pass over argv without heap allocation,
+ * and flag lookups are array accesses resolved at compile time.
+ * Undeclared flags passed to "get_opt" or "get_kwarg" fail to compile.
+ *
+ * Example:
+ *     static constexpr CLSpec spec(1, "hap:b");
+ *     StaticCLParser<spec> parser;
+ *     if (!parser.parse(argc, argv)) {...}
+ *     bool help = parser.get_opt<'h'>();
+ *     int port = parser.get_kwarg<'p', int>(5050);
+ *
+ * Arguments and keyword values are views into argv, which must outlive their use.
+ * A parser may be reused, every parse starts from a cleared state.
+*/
+template <const CLSpec &Spec>
+class StaticCLParser {
+    static_assert(Spec.valid(), "Invalid CLSpec flag string");
+
+    public:
+        StaticCLParser() :
+        _file(), _args(), _options(), _kwargs()
+        {
+        }
+
+        /**
+         * Get option flag value
+         *
+         * @tparam C: option character, 'a' for "-a"
+         *
+         * @param invert: invert output (optional)
+         *
+         * @return inverted or uninverted value of the flag
+        */
+        template <char C>
+        bool get_opt(bool invert=false) const {
+            static_assert(Spec.is_option(C), "Flag is not declared as option");
+            return this->_options[Spec.slot(C)] ^ invert;
+        }
+
+        /**
+         * Check if a keyword argument was supplied
+         *
+         * @tparam C: keyword character, 'p' for "-p <value>"
+         *
+         * @return true if the keyword was supplied with a non-empty value
+        */
+        template <char C>
+        bool has_kwarg() const {
+            static_assert(Spec.is_keyword(C), "Flag is not declared as keyword argument");
+            return !this->_kwargs[Spec.slot(C)].empty();
+        }
+
+        /**
+         * Get optional argument value
+         * "default_value" does not take part in deducing T, get_kwarg<'p'>("5050") returns a std::string_view.
+         *
+         * @tparam C: keyword character, 'p' for "-p <value>"
+         * @tparam T: the type to interpret argument as, see "cl_convert"
+         *
+         * @param default_value: The value to return if this option has not been supplied or is malformed.
+         *
+         * @return value of the argument
+        */
+        template <char C, typename T=std::string_view>
+        T get_kwarg(std::common_type_t<T> default_value=T()) const {
+            std::optional<T> value = this->try_get_kwarg<C, T>();
+            return value ? *value : default_value;
+        }
+
+        /**
+         * Get optional argument value
+         *
+         * @tparam C: keyword character, 'p' for "-p <value>"
+         * @tparam T: the type to interpret argument as, see "cl_convert"
+         *
+         * @return value of the argument, std::nullopt if this option has not been supplied or is malformed
+        */
+        template <char C, typename T=std::string_view>
+        std::optional<T> try_get_kwarg() const {
+            static_assert(Spec.is_keyword(C), "Flag is not declared as keyword argument");
+            std::string_view value = this->_kwargs[Spec.slot(C)];
+            if (value.empty()) {
+                return std::nullopt;
+            }
+            return cl_convert<T>(value);
+        }
+
+        /**
+         * Get mandatory argument value
+         *
+         * @tparam T: the type to interpret argument as, see "cl_convert"
+         *
+         * @param index: the argument index number
+         *
+         * @return value of the argument, a value initialized T if the argument is malformed
+        */
+        template <typename T=std::string_view>
+        T get_arg(int index) const {
+            return this->try_get_arg<T>(index).value_or(T());
+        }
+
+        /**
+         * Get mandatory argument value
+         *
+         * @tparam T: the type to interpret argument as, see "cl_convert"
+         *
+         * @param index: the argument index number
+         *
+         * @return value of the argument, std::nullopt if the argument is malformed
+        */
+        template <typename T=std::string_view>
+        std::optional<T> try_get_arg(int index) const {
+            return cl_convert<T>(this->_args[index]);
+        }
+
+        /**
+         * Get the application file path
+         *
+         * @return the application file path
+        */
+        std::string_view get_file() const {
+            return this->_file;
+        }
+
+        /**
+         * Parse the command line arguments
+         * Supply argc and argv from main(int argc, char **argv) call
+         *
+         * @param argc: argument count from main function
+         * @param argv: argument vector from main function
+         *
+         * @return the result, converts to true on success
+        */
+        CLResult parse(int argc, const char *const *argv) {
+            int index, supplied_arguments;
+            std::string_view str, kwarg;
+
+            this->_file = argc > 0 ? argv[0] : "";
+            this->_options.fill(false);
+            this->_kwargs.fill(std::string_view());
+
+            // Mandatory arguments, up to the first flag-like token
+            supplied_arguments = 0;
+            for (index = 1; index < argc; index++) {
+                str = argv[index];
+                if (_is_flag_like(str)) {
+                    break;
+                }
+                if (supplied_arguments < Spec.num_args()) {
+                    this->_args[supplied_arguments] = str;
+                }
+                supplied_arguments += 1;
+            }
+            if (supplied_arguments < Spec.num_args()) {
+                return {CLError::TooFewArguments, 0};
+            } else if (supplied_arguments > Spec.num_args()) {
+                return {CLError::TooManyArguments, 0};
+            }
+
+            // Options and keyword arguments
+            for (; index < argc; index++) {
+                str = argv[index];
+                int slot = _is_flag_like(str) ? Spec.slot(str[1]) : -1;
+                if (slot < 0) {
+                    return {CLError::UnknownOption, index};
+                } else if (Spec.is_option(str[1])) {
+                    this->_options[slot] = true;
+                } else if (index < argc - 1) {
+                    kwarg = argv[index+1];
+                    if (_is_flag_like(kwarg)) {
+                        bool known = Spec.slot(kwarg[1]) >= 0;
+                        return {known ? CLError::OptionAsKeywordArgument : CLError::UnknownOptionAsKeywordArgument, index};
+                    }
+                    this->_kwargs[slot] = kwarg;
+                    index += 1;
+                } else {
+                    return {CLError::MissingKeywordArgument, index};
+                }
+            }
+            return {CLError::None, 0};
+        }
+
+        /**
+         * Parse the command line arguments, reporting like CLParser.
+         * Formats "info.info", use the overload returning a CLResult to avoid allocating.
+         *
+         * @param argc: argument count from main function
+         * @param argv: argument vector from main function
+         * @param info: CLInfo struct for parse details
+        */
+        void parse(int argc, const char *const *argv, CLInfo &info) {
+            CLResult result = this->parse(argc, argv);
+            info.success = static_cast<bool>(result);
+            info.info = message(result, argv);
+        }
+
+        /**
+         * Format the message CLParser reports for a parse result
+         *
+         * @param result: the parse result
+         * @param argv: the argument vector passed to "parse"
+         *
+         * @return the message
+        */
+        static std::string message(const CLResult &result, const char *const *argv) {
+            std::string flag = result.index > 0 ? argv[result.index] : "";
+            switch (result.error) {
+                case CLError::None: return "Parse successful.";
+                case CLError::TooFewArguments: return "Error: Too few arguments supplied.\n";
+                case CLError::TooManyArguments: return "Error: Too many arguments supplied.\n";
+                case CLError::OptionAsKeywordArgument: return "Error: Received option as argument to keyword \"" + flag + "\".\n";
+                case CLError::UnknownOptionAsKeywordArgument: return "Error: Received unknown option as argument to keyword \"" + flag + "\".\n";
+                case CLError::MissingKeywordArgument: return "Error: No argument given for keyword \"" + flag + "\".\n";
+                case CLError::UnknownOption: return "Error: Unknown option: \"" + flag + "\".\n";
+            }
+            return "";
+        }
+
+    private:
+        // Zero sized tables are avoided so that empty specifications still compile
+        static constexpr size_t NUM_ARGS = Spec.num_args() > 0 ? Spec.num_args() : 1;
+        static constexpr size_t NUM_OPTIONS = Spec.num_options() > 0 ? Spec.num_options() : 1;
+        static constexpr size_t NUM_KEYWORDS = Spec.num_keywords() > 0 ? Spec.num_keywords() : 1;
+
+        std::string_view _file;
+        std::array<std::string_view, NUM_ARGS> _args;
+        std::array<bool, NUM_OPTIONS> _options;
+        std::array<std::string_view, NUM_KEYWORDS> _kwargs;
+
+        static bool _is_flag_like(std::string_view str) {
+            return str.size() == 2 && str[0] == '-';
+        }
+};
+
+#endif
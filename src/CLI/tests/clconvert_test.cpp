@@ -0,0 +1,124 @@
+#include <limits>
+#include <string>
+
+#include "clparser.hpp"
+#include "test_util.hpp"
+
+// cl_convert: from_chars conversion of arithmetic types with error reporting,
+// and the CLParser cache of converted values
+
+// A type without a from_chars overload, read with operator>>
+struct Point {
+    int x = 0;
+    int y = 0;
+};
+
+std::istream& operator>>(std::istream &stream, Point &point) {
+    char comma = 0;
+    stream >> point.x >> comma >> point.y;
+    if (comma != ',') {stream.setstate(std::ios::failbit);}
+    return stream;
+}
+
+// Parse an argument vector
+template <size_t N>
+bool parse(CLParser &parser, const char *const (&argv)[N]) {
+    CLInfo info;
+    parser.parse(static_cast<int>(N), const_cast<char**>(argv), info);
+    return info.success;
+}
+
+bool test_integral() {
+    CHECK(cl_convert<int>("42") == 42);
+    CHECK(cl_convert<int>("+42") == 42);
+    CHECK(cl_convert<int>("-17") == -17);
+    CHECK(cl_convert<int64_t>("-9223372036854775808") == std::numeric_limits<int64_t>::min());
+    CHECK(cl_convert<uint16_t>("65535") == uint16_t(65535));
+
+    // Malformed or out of range
+    for (const char *value: {"", "+", "+-1", "42a", " 42", "4 2", "0x10", "1.5"}) {CHECK(!cl_convert<int>(value));}
+    CHECK(!cl_convert<uint16_t>("65536"));
+    CHECK(!cl_convert<unsigned>("-1"));
+    CHECK(!cl_convert<int32_t>("2147483648"));
+    return true;
+}
+
+bool test_floating_point() {
+    CHECK(cl_convert<double>("0.75") == 0.75);
+    CHECK(cl_convert<double>("+1e3") == 1000.0);
+    CHECK(cl_convert<float>("-2.5") == -2.5f);
+    CHECK(!cl_convert<double>("1.5x"));
+    CHECK(!cl_convert<double>(""));
+    CHECK(!cl_convert<double>("1e999"));
+    return true;
+}
+
+bool test_other_types() {
+    CHECK(cl_convert<bool>("true") == true);
+    CHECK(cl_convert<bool>("1") == true);
+    CHECK(cl_convert<bool>("false") == false);
+    CHECK(cl_convert<bool>("0") == false);
+    CHECK(!cl_convert<bool>("yes"));
+    CHECK(cl_convert<char>("x") == 'x');
+    CHECK(!cl_convert<char>("xy"));
+    CHECK(cl_convert<uint8_t>("7") == uint8_t('7'));
+    CHECK(cl_convert<std::string>("multi word") == std::string("multi word"));
+
+    std::string text = "value";
+    std::optional<std::string_view> view = cl_convert<std::string_view>(text);
+    CHECK(view && view->data() == text.data());
+
+    std::optional<Point> point = cl_convert<Point>("3,4");
+    CHECK(point && point->x == 3 && point->y == 4);
+    CHECK(!cl_convert<Point>("3;4"));
+    return true;
+}
+
+bool test_parser_values() {
+    CLParser parser(2, "p:g:v");
+    const char *argv[] = {"app", "12", "abc", "-p", "8080", "-g", "0.5"};
+    CHECK(parse(parser, argv));
+    CHECK(parser.get_arg<int>(0) == 12);
+    CHECK(parser.get_arg<int>(1) == 0);
+    CHECK(!parser.try_get_arg<int>(1));
+    CHECK(parser.get_arg<std::string>(1) == "abc");
+    CHECK(parser.get_kwarg<int>("-p", 5050) == 8080);
+    CHECK(parser.get_kwarg<double>("-g", 1.0) == 0.5);
+    CHECK(parser.get_kwarg<int>("-g", 7) == 7);
+    CHECK(!parser.try_get_kwarg<int>("-g"));
+    CHECK(!parser.try_get_kwarg<int>("-x"));
+    return true;
+}
+
+bool test_cache() {
+    CLParser parser(1, "p:");
+    const char *argv[] = {"app", "70000", "-p", "8080"};
+    CHECK(parse(parser, argv));
+
+    // Repeated conversions return the cached value, a conversion to another type replaces it
+    for (int repeat = 0; repeat < 3; repeat++) {CHECK(parser.get_kwarg<int>("-p", 0) == 8080);}
+    CHECK(parser.get_kwarg<double>("-p", 0.0) == 8080.0);
+    CHECK(parser.get_kwarg<int>("-p", 0) == 8080);
+
+    // Failed conversions are cached as failures
+    CHECK(!parser.try_get_arg<uint16_t>(0));
+    CHECK(!parser.try_get_arg<uint16_t>(0));
+    CHECK(parser.get_arg<int32_t>(0) == 70000);
+
+    // A new parse drops the cached values
+    const char *next[] = {"app", "7", "-p", "9090"};
+    CHECK(parse(parser, next));
+    CHECK(parser.get_kwarg<int>("-p", 0) == 9090);
+    CHECK(parser.try_get_arg<uint16_t>(0) == uint16_t(7));
+    return true;
+}
+
+int main() {
+    return run_tests({
+        {"integral", test_integral},
+        {"floating_point", test_floating_point},
+        {"other_types", test_other_types},
+        {"parser_values", test_parser_values},
+        {"cache", test_cache},
+    });
+}
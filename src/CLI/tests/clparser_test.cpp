@@ -0,0 +1,129 @@
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "clparser.hpp"
+#include "test_util.hpp"
+
+// CLParser reuse: every parse starts from a cleared state, command line strings are tokenized with quotes
+// and escapes, and results are immutable copies that may be shared across threads
+
+bool test_reuse() {
+    CLParser parser(1, "ab:");
+    CLInfo info;
+    parser.parse("app first -a -b value", info);
+    CHECK(info.success);
+    CHECK(parser.get_opt("-a") && parser.has_kwarg("-b"));
+
+    // The second parse does not inherit the options and keyword arguments of the first
+    parser.parse("app second", info);
+    CHECK(info.success);
+    CHECK(parser.get_arg<std::string>(0) == "second");
+    CHECK(!parser.get_opt("-a") && !parser.has_kwarg("-b"));
+
+    // A failed parse leaves no values behind
+    parser.parse("app third -a -x", info);
+    CHECK(!info.success);
+    CHECK(info.info == "Error: Unknown option: \"-x\".\n");
+    parser.parse("app fourth -b", info);
+    CHECK(!info.success);
+    CHECK(!parser.has_kwarg("-b"));
+
+    parser.parse("app fifth -a", info);
+    CHECK(info.success && parser.get_opt("-a"));
+    parser.reset();
+    CHECK(parser.get_file().empty() && parser.get_arg<std::string>(0).empty() && !parser.get_opt("-a"));
+    return true;
+}
+
+bool test_tokenize() {
+    CLParser parser(2, "m:v");
+    CLInfo info;
+    parser.parse("  app\t'one arg'  \"two \\\"quoted\\\" words\" -m 'multi word value' -v ", info);
+    CHECK(info.success);
+    CHECK(parser.get_file() == "app");
+    CHECK(parser.get_arg<std::string>(0) == "one arg");
+    CHECK(parser.get_arg<std::string>(1) == "two \"quoted\" words");
+    CHECK(parser.get_kwarg<std::string>("-m", "") == "multi word value");
+    CHECK(parser.get_opt("-v"));
+
+    // Backslashes escape outside single quotes, quotes join with adjacent characters
+    parser.parse("app a\\ b 'c\\d'e -m x", info);
+    CHECK(info.success);
+    CHECK(parser.get_arg<std::string>(0) == "a b");
+    CHECK(parser.get_arg<std::string>(1) == "c\\de");
+
+    // An empty quoted token is still a token
+    parser.parse("app '' second", info);
+    CHECK(info.success);
+    CHECK(parser.get_arg<std::string>(0).empty());
+
+    parser.parse("app one 'two", info);
+    CHECK(!info.success);
+    CHECK(info.info == "Error: Unterminated quote in command line.\n");
+    CHECK(parser.get_file().empty());
+
+    parser.parse("", info);
+    CHECK(!info.success);
+    CHECK(info.info == "Error: Too few arguments supplied.\n");
+    return true;
+}
+
+bool test_same_as_argv() {
+    // A command line string and the argument vector it stands for give the same values and messages
+    const char *lines[] = {"app host -p 8080 -a", "app host -p -a", "app", "app host extra"};
+    const std::vector<std::vector<const char*>> vectors = {
+        {"app", "host", "-p", "8080", "-a"}, {"app", "host", "-p", "-a"}, {"app"}, {"app", "host", "extra"}};
+    for (size_t i = 0; i < vectors.size(); i++) {
+        CLParser from_line(1, "ap:");
+        CLParser from_argv(1, "ap:");
+        CLInfo line_info;
+        CLInfo argv_info;
+        from_line.parse(lines[i], line_info);
+        from_argv.parse(static_cast<int>(vectors[i].size()), const_cast<char**>(vectors[i].data()), argv_info);
+        CHECK(line_info.success == argv_info.success && line_info.info == argv_info.info);
+        CHECK(from_line.get_opt("-a") == from_argv.get_opt("-a"));
+        CHECK(from_line.get_kwarg<int>("-p", 0) == from_argv.get_kwarg<int>("-p", 0));
+    }
+    return true;
+}
+
+bool test_results() {
+    CLParser parser(1, "ap:");
+    CLInfo info;
+    parser.parse("app host -a -p 8080", info);
+    CHECK(info.success);
+    auto results = std::make_shared<const CLArguments>(parser.results());
+
+    // The copy keeps its values when the parser is reused
+    parser.parse("app other", info);
+    CHECK(info.success);
+    CHECK(results->get_file() == "app");
+    CHECK(results->get_arg<std::string>(0) == "host");
+    CHECK(results->get_opt("-a") && !results->get_opt("-a", true));
+    CHECK(results->has_kwarg("-p") && !results->has_kwarg("-x"));
+    CHECK(results->get_kwarg<int>("-p", 0) == 8080);
+    CHECK(!results->try_get_arg<int>(0));
+
+    // Readers on several threads share one result
+    std::vector<std::thread> readers;
+    std::vector<int> ports(4, 0);
+    for (size_t i = 0; i < ports.size(); i++) {
+        readers.emplace_back([&results, &ports, i]() {
+            for (int read = 0; read < 1000; read++) {ports[i] = results->get_kwarg<int>("-p", 0);}
+        });
+    }
+    for (std::thread &reader: readers) {reader.join();}
+    for (int port: ports) {CHECK(port == 8080);}
+    return true;
+}
+
+int main() {
+    return run_tests({
+        {"reuse", test_reuse},
+        {"tokenize", test_tokenize},
+        {"same_as_argv", test_same_as_argv},
+        {"results", test_results},
+    });
+}
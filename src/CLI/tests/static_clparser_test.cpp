@@ -0,0 +1,104 @@
+#include <string>
+
+#include "static_clparser.hpp"
+#include "test_util.hpp"
+
+// StaticCLParser: the compile-time flag table, parsing argv in one pass and the errors CLParser reports
+
+static constexpr CLSpec spec(1, "hap:b");
+static constexpr CLSpec no_flags(0, "");
+
+static_assert(spec.valid() && spec.num_args() == 1 && spec.num_options() == 3 && spec.num_keywords() == 1);
+static_assert(spec.is_option('h') && spec.is_option('a') && spec.is_option('b'));
+static_assert(spec.is_keyword('p') && !spec.is_option('p'));
+static_assert(spec.slot('x') == -1 && !spec.is_option('x') && !spec.is_keyword('x'));
+static_assert(!CLSpec(0, "aa").valid() && !CLSpec(0, "a-").valid() && !CLSpec(-1, "a").valid());
+static_assert(no_flags.valid());
+
+template <size_t N>
+CLResult parse(StaticCLParser<spec> &parser, const char *const (&argv)[N]) {
+    return parser.parse(static_cast<int>(N), argv);
+}
+
+bool test_parse() {
+    StaticCLParser<spec> parser;
+    const char *argv[] = {"app", "10.0.0.1", "-a", "-p", "8080", "-b"};
+    CHECK(parse(parser, argv));
+    CHECK(parser.get_file() == "app");
+    CHECK(parser.get_arg(0) == "10.0.0.1");
+    CHECK(parser.get_opt<'a'>() && parser.get_opt<'b'>() && !parser.get_opt<'h'>());
+    CHECK(!parser.get_opt<'b'>(true));
+    CHECK(parser.has_kwarg<'p'>());
+    CHECK(parser.get_kwarg<'p'>() == "8080");
+    CHECK((parser.get_kwarg<'p', int>(5050) == 8080));
+    CHECK((parser.try_get_kwarg<'p', uint16_t>() == uint16_t(8080)));
+    CHECK((!parser.try_get_kwarg<'p', int8_t>()));
+
+    // Every parse starts from a cleared state
+    const char *plain[] = {"app", "host"};
+    CHECK(parse(parser, plain));
+    CHECK(parser.get_arg(0) == "host");
+    CHECK(!parser.get_opt<'a'>() && !parser.get_opt<'b'>());
+    CHECK(!parser.has_kwarg<'p'>());
+    CHECK((parser.get_kwarg<'p', int>(5050) == 5050));
+    CHECK(!parser.try_get_arg<int>(0));
+
+    StaticCLParser<no_flags> empty;
+    const char *none[] = {"app"};
+    CHECK(empty.parse(1, none));
+    return true;
+}
+
+bool test_errors() {
+    StaticCLParser<spec> parser;
+    const char *few[] = {"app"};
+    CHECK(parse(parser, few).error == CLError::TooFewArguments);
+    const char *many[] = {"app", "one", "two", "-a"};
+    CHECK(parse(parser, many).error == CLError::TooManyArguments);
+    const char *unknown[] = {"app", "host", "-a", "-x"};
+    CLResult result = parse(parser, unknown);
+    CHECK(result.error == CLError::UnknownOption && result.index == 3);
+    const char *option[] = {"app", "host", "-p", "-a"};
+    result = parse(parser, option);
+    CHECK(result.error == CLError::OptionAsKeywordArgument && result.index == 2);
+    const char *unknown_option[] = {"app", "host", "-p", "-x"};
+    CHECK(parse(parser, unknown_option).error == CLError::UnknownOptionAsKeywordArgument);
+    const char *missing[] = {"app", "host", "-p"};
+    result = parse(parser, missing);
+    CHECK(result.error == CLError::MissingKeywordArgument && result.index == 2);
+    CHECK(!result);
+    return true;
+}
+
+bool test_messages() {
+    // The messages are the ones CLParser reports for the same command line
+    const char *command_lines[][4] = {
+        {"app", "host", "-p", "8080"},
+        {"app", "host", "-p", "-a"},
+        {"app", "host", "-p", "-x"},
+        {"app", "host", "-a", "-x"},
+        {"app", "one", "two", "-a"},
+    };
+    for (const auto &argv: command_lines) {
+        StaticCLParser<spec> parser;
+        CLInfo info;
+        parser.parse(4, argv, info);
+        CLParser dynamic(1, "hap:b");
+        CLInfo dynamic_info;
+        dynamic.parse(4, const_cast<char**>(argv), dynamic_info);
+        CHECK(info.success == dynamic_info.success);
+        CHECK(info.info == dynamic_info.info);
+    }
+    StaticCLParser<spec> parser;
+    const char *missing[] = {"app", "host", "-p"};
+    CHECK(parser.message(parse(parser, missing), missing) == "Error: No argument given for keyword \"-p\".\n");
+    return true;
+}
+
+int main() {
+    return run_tests({
+        {"parse", test_parse},
+        {"errors", test_errors},
+        {"messages", test_messages},
+    });
+}
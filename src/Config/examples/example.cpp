@@ -0,0 +1,44 @@
+#include <filesystem>
+#include <iostream>
+#include "clparser.hpp"
+#include "layered_config.hpp"
+#include "recipe.hpp"
+
+int main(int argc, char *argv[]) {
+    // Declare the values once, with their default and name in each layer
+    cfg::LayeredConfig config;
+    cfg::Key<std::string> host = config.add<std::string>("host", "localhost", {"-h", "APP_HOST", "host"});
+    cfg::Key<int64_t> port = config.add<int64_t>("port", 5050, {"-p", "APP_PORT", "port"});
+    cfg::Key<double> timeout = config.add<double>("timeout", 1.5, {"-t", "APP_TIMEOUT", "timeout"});
+    cfg::Key<bool> verbose = config.add<bool>("verbose", false, {"-v", "APP_VERBOSE", ""});
+
+    // Command line layer
+    CLInfo info;
+    CLParser parser(0, "h:p:t:v:");
+    parser.parse(argc, argv, info);
+    if (!info.success) {
+        std::cout << info.info << "Usage: ConfigExample [-h <host>] [-p <port>] [-t <timeout>] [-v <0|1>]." << std::endl;
+        return -1;
+    }
+    CLArguments arguments = parser.results();
+
+    // Recipe layer, used only for configuration
+    std::filesystem::path path(argv[0]);
+    rcp::Recipe recipe("config");
+    recipe.set_folder(path.parent_path().string() + "/example_output/recipes");
+    recipe.init();
+
+    cfg::Snapshot snapshot = config.build(&arguments, &recipe);
+    for (const std::string &error: snapshot.errors()) {
+        std::cout << "Warning: " << error << std::endl;
+    }
+
+    // Report values and the layer that supplied them
+    const char *layers[] = {"default", "recipe", "environment", "command line"};
+    std::cout << "host: " << snapshot.get(host) << " (" << layers[static_cast<int>(snapshot.layer(host))] << ")" << std::endl;
+    std::cout << "port: " << snapshot.get(port) << " (" << layers[static_cast<int>(snapshot.layer(port))] << ")" << std::endl;
+    std::cout << "timeout: " << snapshot.get(timeout) << " (" << layers[static_cast<int>(snapshot.layer(timeout))] << ")" << std::endl;
+    std::cout << "verbose: " << snapshot.get(verbose) << " (" << layers[static_cast<int>(snapshot.layer(verbose))] << ")" << std::endl;
+
+    return 0;
+}
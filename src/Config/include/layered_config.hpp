@@ -0,0 +1,177 @@
+#ifndef CFG_LAYERED_CONFIG_HPP
+#define CFG_LAYERED_CONFIG_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "clparser.hpp"
+#include "recipe.hpp"
+
+namespace cfg {
+
+/**
+ * Layered configuration from the command line, the environment and a recipe.
+ *
+ * --------------------------------------------
+ * Usage description:
+ * --------------------------------------------
+ * Declare every value once with "LayeredConfig::add", with its default and where to look for it in each layer:
+ *     cfg::LayeredConfig config;
+ *     cfg::Key<int64_t> port = config.add<int64_t>("port", 5050, {"-p", "APP_PORT", "port"});
+ *
+ * Call "build" with the parsed command line (see "CLParser::results") and a recipe to merge the layers into a Snapshot.
+ * Layers take precedence in the order command line, environment, recipe, default.
+ * A layer is only consulted for values the layers above it did not supply,
+ * the recipe file is read once, and only if some value is still missing after the command line and the environment.
+ *
+ * Read values from the snapshot with "Snapshot::get", an array read at the index precomputed in the key.
+ * A snapshot is immutable and may be shared across threads.
+ *
+ * --------------------------------------------
+ * Notes:
+ * --------------------------------------------
+ * Values have one of the types bool, int64_t, double or std::string.
+ * Command line and environment values are converted with "cl_convert" (see clconvert.hpp),
+ * malformed values are skipped, reported in "Snapshot::errors", and the next layer is consulted.
+ * "build" registers the recipe ids of missing values as stream variables of the recipe, loads it and removes them again.
+ * If the recipe fails to load, no value is taken from it and the missing values keep their default.
+ * Pass a recipe used only for configuration: loading also assigns every variable the application registered in it.
+ * Raw stored bytes are interpreted by the type of the value: integers of 1, 2, 4 or 8 bytes as signed,
+ * floating-point values of 4 or 8 bytes, bool as a single byte and strings as their bytes.
+*/
+
+/**
+ * The configuration layers, from lowest to highest precedence
+*/
+enum class Layer {
+    Default,
+    Recipe,
+    Environment,
+    CommandLine
+};
+
+/**
+ * Where a value is looked up in each layer, an empty name skips the layer.
+ * "kwarg" is a CLParser keyword flag, for instance "-p",
+ * "env" the name of an environment variable and "recipe" the id of a recipe variable.
+*/
+struct Sources {
+    std::string kwarg;
+    std::string env;
+    std::string recipe;
+};
+
+/**
+ * Handle of a value, returned by "LayeredConfig::add".
+ * "index" is the position in the array of values of type T, "slot" the position among all values.
+*/
+template <typename T>
+struct Key {
+    uint32_t index;
+    uint32_t slot;
+};
+
+/**
+ * Immutable merged configuration, see "LayeredConfig::build"
+*/
+class Snapshot {
+    public:
+        bool get(Key<bool> key) const {return this->_bools[key.index] != 0;}
+        int64_t get(Key<int64_t> key) const {return this->_integers[key.index];}
+        double get(Key<double> key) const {return this->_doubles[key.index];}
+        const std::string& get(Key<std::string> key) const {return this->_strings[key.index];}
+
+        /**
+         * Get the layer that supplied a value
+         *
+         * @param key the value
+         *
+         * @return the layer, Layer::Default if no layer supplied the value
+        */
+        template <typename T>
+        Layer layer(Key<T> key) const {return this->_layers[key.slot];}
+
+        const std::vector<std::string>& errors() const;
+    private:
+        friend class LayeredConfig;
+
+        std::vector<uint8_t> _bools;
+        std::vector<int64_t> _integers;
+        std::vector<double> _doubles;
+        std::vector<std::string> _strings;
+        std::vector<Layer> _layers;
+        std::vector<std::string> _errors;
+};
+
+/**
+ * Declares configuration values and merges the layers into snapshots
+*/
+class LayeredConfig {
+    public:
+        template <typename T>
+        Key<T> add(std::string_view name, T default_value, Sources sources);
+
+        Snapshot build(const CLArguments *arguments, rcp::Recipe *recipe) const;
+        size_t size() const;
+    private:
+        enum class Type {Bool, Integer, Double, String};
+
+        struct Entry {
+            std::string name;
+            Sources sources;
+            Type type;
+            uint32_t index;
+        };
+
+        std::vector<Entry> _entries;
+        Snapshot _defaults;
+
+        bool _assign(Snapshot &snapshot, const Entry &entry, std::string_view value) const;
+        bool _assign_stored(Snapshot &snapshot, const Entry &entry, const std::string &stored) const;
+};
+
+/**
+ * Declare a value.
+ * Names are only used in error messages, they need not be unique.
+ *
+ * @tparam T bool, int64_t, double or std::string
+ *
+ * @param name the name of the value
+ * @param default_value the value if no layer supplies one
+ * @param sources where to look up the value in each layer
+ *
+ * @return the key of the value, valid for every snapshot built by this LayeredConfig
+*/
+template <typename T>
+Key<T> LayeredConfig::add(std::string_view name, T default_value, Sources sources) {
+    static_assert(std::is_same_v<T, bool> || std::is_same_v<T, int64_t> || std::is_same_v<T, double> || std::is_same_v<T, std::string>,
+                  "Configuration values are bool, int64_t, double or std::string");
+    Entry entry{std::string(name), std::move(sources), Type::Bool, 0};
+    if constexpr (std::is_same_v<T, bool>) {
+        entry.index = static_cast<uint32_t>(this->_defaults._bools.size());
+        this->_defaults._bools.push_back(default_value ? 1 : 0);
+    } else if constexpr (std::is_same_v<T, int64_t>) {
+        entry.type = Type::Integer;
+        entry.index = static_cast<uint32_t>(this->_defaults._integers.size());
+        this->_defaults._integers.push_back(default_value);
+    } else if constexpr (std::is_same_v<T, double>) {
+        entry.type = Type::Double;
+        entry.index = static_cast<uint32_t>(this->_defaults._doubles.size());
+        this->_defaults._doubles.push_back(default_value);
+    } else {
+        entry.type = Type::String;
+        entry.index = static_cast<uint32_t>(this->_defaults._strings.size());
+        this->_defaults._strings.push_back(std::move(default_value));
+    }
+    Key<T> key{entry.index, static_cast<uint32_t>(this->_entries.size())};
+    this->_entries.push_back(std::move(entry));
+    this->_defaults._layers.push_back(Layer::Default);
+    return key;
+}
+
+}
+
+#endif
@@ -0,0 +1,196 @@
+#include "layered_config.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace cfg {
+
+namespace {
+
+/**
+ * Read a signed integer of 1, 2, 4 or 8 bytes in host byte order
+*/
+bool decode_integer(const std::string &stored, int64_t &value) {
+    switch (stored.size()) {
+        case 1: {int8_t v; std::memcpy(&v, stored.data(), 1); value = v; return true;}
+        case 2: {int16_t v; std::memcpy(&v, stored.data(), 2); value = v; return true;}
+        case 4: {int32_t v; std::memcpy(&v, stored.data(), 4); value = v; return true;}
+        case 8: {int64_t v; std::memcpy(&v, stored.data(), 8); value = v; return true;}
+    }
+    return false;
+}
+
+bool decode_double(const std::string &stored, double &value) {
+    if (stored.size() == sizeof(float)) {
+        float v;
+        std::memcpy(&v, stored.data(), sizeof(v));
+        value = v;
+        return true;
+    } else if (stored.size() == sizeof(double)) {
+        std::memcpy(&value, stored.data(), sizeof(value));
+        return true;
+    }
+    return false;
+}
+
+}
+
+/**
+ * Get the problems found while building the snapshot
+ *
+ * @return one message per malformed value or failed recipe operation, empty if there were none
+*/
+const std::vector<std::string>& Snapshot::errors() const {
+    return this->_errors;
+}
+
+/**
+ * Get the number of declared values
+ *
+ * @return the number of values
+*/
+size_t LayeredConfig::size() const {
+    return this->_entries.size();
+}
+
+/**
+ * Merge the layers into a snapshot.
+ * The recipe must be initialized (see "Recipe::init"),
+ * the ids of values still missing after the command line and environment must not be registered in it.
+ *
+ * @param arguments the parsed command line, nullptr to skip the layer
+ * @param recipe the recipe, nullptr to skip the layer
+ *
+ * @return the snapshot, with the problems found reported in "Snapshot::errors"
+*/
+Snapshot LayeredConfig::build(const CLArguments *arguments, rcp::Recipe *recipe) const {
+    Snapshot snapshot = this->_defaults;
+    std::vector<size_t> missing;
+
+    // Command line and environment, highest layer first
+    for (size_t slot = 0; slot < this->_entries.size(); slot++) {
+        const Entry &entry = this->_entries[slot];
+        if (arguments != nullptr && !entry.sources.kwarg.empty() && arguments->has_kwarg(entry.sources.kwarg)) {
+            std::string value = arguments->get_kwarg<std::string>(entry.sources.kwarg, "");
+            if (this->_assign(snapshot, entry, value)) {
+                snapshot._layers[slot] = Layer::CommandLine;
+                continue;
+            }
+            snapshot._errors.push_back("Malformed value for \"" + entry.name + "\" in keyword \"" + entry.sources.kwarg + "\".");
+        }
+        const char *env = entry.sources.env.empty() ? nullptr : std::getenv(entry.sources.env.c_str());
+        if (env != nullptr && *env != '\0') {
+            if (this->_assign(snapshot, entry, env)) {
+                snapshot._layers[slot] = Layer::Environment;
+                continue;
+            }
+            snapshot._errors.push_back("Malformed value for \"" + entry.name + "\" in environment variable \"" + entry.sources.env + "\".");
+        }
+        if (recipe != nullptr && !entry.sources.recipe.empty()) {
+            missing.push_back(slot);
+        }
+    }
+    if (missing.empty()) {return snapshot;}
+
+    // Recipe, loaded once for all missing values
+    std::vector<std::string> stored(missing.size());
+    std::vector<uint8_t> present(missing.size(), 0);
+    std::vector<size_t> registered;
+    for (size_t i = 0; i < missing.size(); i++) {
+        const Entry &entry = this->_entries[missing[i]];
+        bool added = recipe->add_stream_variable(entry.sources.recipe,
+            [&stored, &present, i](const char *data, size_t size, uint64_t offset, uint64_t total) {
+                if (offset == 0) {stored[i].reserve(total);}
+                stored[i].append(data, size);
+                present[i] = 1;
+                return true;
+            },
+            [](const rcp::StreamSink&) {return false;});
+        if (added) {
+            registered.push_back(i);
+        } else {
+            snapshot._errors.push_back("Recipe id \"" + entry.sources.recipe + "\" of \"" + entry.name + "\" is already registered.");
+        }
+    }
+    bool loaded = registered.empty() || recipe->load_recipe();
+    if (!loaded) {
+        snapshot._errors.push_back("Failed to load recipe \"" + recipe->get_path() + "\".");
+    }
+    for (size_t i: registered) {
+        recipe->remove_variable(this->_entries[missing[i]].sources.recipe);
+    }
+    // Values streamed in before a failed check of the file are not trusted, they keep their default
+    if (!loaded) {return snapshot;}
+    for (size_t i: registered) {
+        size_t slot = missing[i];
+        const Entry &entry = this->_entries[slot];
+        if (!present[i]) {continue;}
+        if (this->_assign_stored(snapshot, entry, stored[i])) {
+            snapshot._layers[slot] = Layer::Recipe;
+        } else {
+            snapshot._errors.push_back("Malformed value for \"" + entry.name + "\" in recipe id \"" + entry.sources.recipe + "\".");
+        }
+    }
+    return snapshot;
+}
+
+/**
+ * Convert a command line or environment value
+ *
+ * @param snapshot receives the value
+ * @param entry the declared value
+ * @param value the text
+ *
+ * @return false if the text is malformed
+*/
+bool LayeredConfig::_assign(Snapshot &snapshot, const Entry &entry, std::string_view value) const {
+    switch (entry.type) {
+        case Type::Bool: {
+            std::optional<bool> converted = cl_convert<bool>(value);
+            if (converted) {snapshot._bools[entry.index] = *converted ? 1 : 0;}
+            return converted.has_value();
+        }
+        case Type::Integer: {
+            std::optional<int64_t> converted = cl_convert<int64_t>(value);
+            if (converted) {snapshot._integers[entry.index] = *converted;}
+            return converted.has_value();
+        }
+        case Type::Double: {
+            std::optional<double> converted = cl_convert<double>(value);
+            if (converted) {snapshot._doubles[entry.index] = *converted;}
+            return converted.has_value();
+        }
+        case Type::String:
+            snapshot._strings[entry.index] = value;
+            return true;
+    }
+    return false;
+}
+
+/**
+ * Interpret the stored bytes of a recipe value
+ *
+ * @param snapshot receives the value
+ * @param entry the declared value
+ * @param stored the bytes
+ *
+ * @return false if the size does not fit the type of the value
+*/
+bool LayeredConfig::_assign_stored(Snapshot &snapshot, const Entry &entry, const std::string &stored) const {
+    switch (entry.type) {
+        case Type::Bool:
+            if (stored.size() != 1) {return false;}
+            snapshot._bools[entry.index] = stored[0] != 0 ? 1 : 0;
+            return true;
+        case Type::Integer:
+            return decode_integer(stored, snapshot._integers[entry.index]);
+        case Type::Double:
+            return decode_double(stored, snapshot._doubles[entry.index]);
+        case Type::String:
+            snapshot._strings[entry.index] = stored;
+            return true;
+    }
+    return false;
+}
+
+}
@@ -0,0 +1,169 @@
+#include <array>
+#include <cstdlib>
+#include <string>
+
+#include "layered_config.hpp"
+#include "test_util.hpp"
+
+// LayeredConfig: precedence of command line, environment, recipe and default,
+// malformed values falling through to the next layer, and recipes that fail to load
+
+// Declared values of the tests, environment variables are prefixed "CFG_TEST_"
+struct Fixture {
+    cfg::LayeredConfig config;
+    cfg::Key<std::string> host = config.add<std::string>("host", "localhost", {"-h", "CFG_TEST_HOST", "host"});
+    cfg::Key<int64_t> port = config.add<int64_t>("port", 5050, {"-p", "CFG_TEST_PORT", "port"});
+    cfg::Key<double> timeout = config.add<double>("timeout", 1.5, {"-t", "CFG_TEST_TIMEOUT", "timeout"});
+    cfg::Key<bool> verbose = config.add<bool>("verbose", false, {"-v", "CFG_TEST_VERBOSE", "verbose"});
+    cfg::Key<int64_t> retries = config.add<int64_t>("retries", 3, {"", "", "retries"});
+    cfg::Key<double> ratio = config.add<double>("ratio", 0.0, {"", "", "ratio"});
+
+    Fixture() {
+        for (const char *name: {"CFG_TEST_HOST", "CFG_TEST_PORT", "CFG_TEST_TIMEOUT", "CFG_TEST_VERBOSE"}) {::unsetenv(name);}
+    }
+};
+
+// Values stored in the recipe file, in the sizes an application would register them with
+struct Stored {
+    std::array<char, 8> host = {'d', 'b', '.', 'l', 'o', 'c', 'a', 'l'};
+    int32_t port = 6060;
+    double timeout = 2.5;
+    bool verbose = true;
+    int16_t retries = -7;
+    float ratio = 0.25f;
+};
+
+bool save_stored(const std::string &folder, rcp::FileFormat format=rcp::FileFormat::V1) {
+    Stored stored;
+    rcp::Recipe recipe("config", folder);
+    recipe.set_file_format(format);
+    recipe.add_variable("host", stored.host);
+    recipe.add_variable("port", stored.port);
+    recipe.add_variable("timeout", stored.timeout);
+    recipe.add_variable("verbose", stored.verbose);
+    recipe.add_variable("retries", stored.retries);
+    recipe.add_variable("ratio", stored.ratio);
+    return recipe.init() && recipe.save_recipe();
+}
+
+CLArguments parse(const std::string &command_line) {
+    CLParser parser(0, "h:p:t:v:");
+    CLInfo info;
+    parser.parse(command_line, info);
+    return parser.results();
+}
+
+bool test_precedence() {
+    std::string folder = test_folder("config_precedence");
+    CHECK(save_stored(folder));
+    Fixture fixture;
+    ::setenv("CFG_TEST_PORT", "7070", 1);
+    ::setenv("CFG_TEST_TIMEOUT", "4.5", 1);
+    CLArguments arguments = parse("app -p 8080");
+    rcp::Recipe recipe("config", folder);
+    CHECK(recipe.init());
+
+    cfg::Snapshot snapshot = fixture.config.build(&arguments, &recipe);
+    CHECK(snapshot.errors().empty());
+    CHECK(snapshot.get(fixture.port) == 8080 && snapshot.layer(fixture.port) == cfg::Layer::CommandLine);
+    CHECK(snapshot.get(fixture.timeout) == 4.5 && snapshot.layer(fixture.timeout) == cfg::Layer::Environment);
+    CHECK(snapshot.get(fixture.host) == "db.local" && snapshot.layer(fixture.host) == cfg::Layer::Recipe);
+    CHECK(snapshot.get(fixture.verbose) && snapshot.layer(fixture.verbose) == cfg::Layer::Recipe);
+    CHECK(snapshot.get(fixture.retries) == -7);
+    CHECK(snapshot.get(fixture.ratio) == 0.25);
+
+    // Without the recipe and the command line, the environment and the defaults are left
+    snapshot = fixture.config.build(nullptr, nullptr);
+    CHECK(snapshot.get(fixture.port) == 7070 && snapshot.layer(fixture.port) == cfg::Layer::Environment);
+    CHECK(snapshot.get(fixture.host) == "localhost" && snapshot.layer(fixture.host) == cfg::Layer::Default);
+    CHECK(snapshot.get(fixture.retries) == 3);
+    CHECK(fixture.config.size() == 6);
+
+    // The stream variables of a build are removed again, the recipe can be used for the next one
+    snapshot = fixture.config.build(&arguments, &recipe);
+    CHECK(snapshot.errors().empty() && snapshot.get(fixture.retries) == -7);
+    return true;
+}
+
+bool test_recipe_only_when_missing() {
+    // Every value with a recipe id is supplied above it, so the damaged recipe file is never read
+    std::string folder = test_folder("config_only_missing");
+    CHECK(write_file(folder + "config.rcp", {'b', 'r', 'o', 'k', 'e', 'n'}));
+    cfg::LayeredConfig config;
+    cfg::Key<int64_t> port = config.add<int64_t>("port", 5050, {"-p", "", "port"});
+    cfg::Key<bool> verbose = config.add<bool>("verbose", false, {"-v", "", ""});
+    CLArguments arguments = parse("app -p 9000");
+    rcp::Recipe recipe("config", folder);
+    CHECK(recipe.init());
+    cfg::Snapshot snapshot = config.build(&arguments, &recipe);
+    CHECK(snapshot.errors().empty());
+    CHECK(snapshot.get(port) == 9000 && !snapshot.get(verbose));
+    return true;
+}
+
+bool test_malformed() {
+    std::string folder = test_folder("config_malformed");
+    CHECK(save_stored(folder));
+    Fixture fixture;
+    ::setenv("CFG_TEST_PORT", "seventy", 1);
+    ::setenv("CFG_TEST_VERBOSE", "yes", 1);
+    CLArguments arguments = parse("app -p 80x -t 3.25 -v 1");
+    rcp::Recipe recipe("config", folder);
+    CHECK(recipe.init());
+
+    // Both malformed port values fall through to the recipe, a valid command line value hides the malformed environment
+    cfg::Snapshot snapshot = fixture.config.build(&arguments, &recipe);
+    CHECK(snapshot.errors().size() == 2);
+    CHECK(snapshot.get(fixture.port) == 6060 && snapshot.layer(fixture.port) == cfg::Layer::Recipe);
+    CHECK(snapshot.get(fixture.timeout) == 3.25 && snapshot.get(fixture.verbose));
+
+    // A stored value whose size does not fit the type keeps its default
+    cfg::LayeredConfig config;
+    cfg::Key<bool> host = config.add<bool>("host as bool", false, {"", "", "host"});
+    cfg::Key<double> retries = config.add<double>("retries as double", 9.0, {"", "", "retries"});
+    snapshot = config.build(nullptr, &recipe);
+    CHECK(snapshot.errors().size() == 2);
+    CHECK(!snapshot.get(host) && snapshot.layer(host) == cfg::Layer::Default);
+    CHECK(snapshot.get(retries) == 9.0 && snapshot.layer(retries) == cfg::Layer::Default);
+    return true;
+}
+
+bool test_failed_load() {
+    std::string folder = test_folder("config_failed_load");
+    CHECK(save_stored(folder, rcp::FileFormat::V2));
+    Stored stored;
+    CHECK(flip_byte(folder + "config.rcp", find_value(folder + "config.rcp", stored.timeout)));
+    Fixture fixture;
+    rcp::Recipe recipe("config", folder);
+    CHECK(recipe.init());
+
+    // No value is taken from a recipe that fails its checks, also not the ones streamed before the damaged entry
+    cfg::Snapshot snapshot = fixture.config.build(nullptr, &recipe);
+    CHECK(snapshot.errors().size() == 1);
+    CHECK(snapshot.get(fixture.host) == "localhost" && snapshot.layer(fixture.host) == cfg::Layer::Default);
+    CHECK(snapshot.get(fixture.port) == 5050 && snapshot.get(fixture.retries) == 3);
+
+    // Once the file is repaired the same recipe supplies the values
+    CHECK(save_stored(folder, rcp::FileFormat::V2));
+    snapshot = fixture.config.build(nullptr, &recipe);
+    CHECK(snapshot.errors().empty());
+    CHECK(snapshot.get(fixture.host) == "db.local" && snapshot.get(fixture.port) == 6060);
+
+    // Ids the application registered itself are reported and keep their default
+    int32_t port = 0;
+    CHECK(recipe.add_variable("port", port));
+    snapshot = fixture.config.build(nullptr, &recipe);
+    CHECK(snapshot.errors().size() == 1);
+    CHECK(snapshot.get(fixture.port) == 5050 && snapshot.get(fixture.host) == "db.local");
+    CHECK(port == 6060);
+    return true;
+}
+
+int main() {
+    return run_tests({
+        {"precedence", test_precedence},
+        {"recipe_only_when_missing", test_recipe_only_when_missing},
+        {"malformed", test_malformed},
+        {"failed_load", test_failed_load},
+    });
+}
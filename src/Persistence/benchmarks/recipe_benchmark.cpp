@@ -0,0 +1,264 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "checksum.hpp"
+#include "recipe.hpp"
+
+// add_variable, save_recipe and load_recipe across variable counts, payload sizes, id lengths and modes.
+//
+// Byte rates count variable payload only, item rates count variables.
+// The payload is a constant byte pattern, so the lz4 cases measure the best case of compression.
+// Runs larger than RCP_BENCH_MAX_BYTES (default 256 MiB) of payload are skipped,
+// set it to 2147483648 or more to include the 1 GiB payload.
+// Cold runs evict the recipe file from the page cache before every load (Linux only, warm elsewhere).
+// BM_Crc32c compares the checksum selected for the CPU with the lookup table implementation.
+
+namespace {
+
+enum SaveCase {SAVE_V1, SAVE_V2, SAVE_ATOMIC, SAVE_ASYNC, SAVE_INCREMENTAL, SAVE_LZ4};
+enum LoadCase {LOAD_STREAM_V1, LOAD_MAPPED_V1, LOAD_STREAM_V2, LOAD_MAPPED_V2, LOAD_PARALLEL_V2, LOAD_LZ4};
+
+const char *SAVE_NAMES[] = {"v1", "v2", "atomic", "async", "incremental", "lz4"};
+const char *LOAD_NAMES[] = {"stream_v1", "mapped_v1", "stream_v2", "mapped_v2", "parallel_v2", "mapped_lz4"};
+
+std::string folder() {
+    return (std::filesystem::temp_directory_path() / "rcp_benchmarks" / "").string();
+}
+
+uint64_t max_bytes() {
+    const char *value = std::getenv("RCP_BENCH_MAX_BYTES");
+    return value != nullptr ? std::strtoull(value, nullptr, 10) : 256ULL << 20;
+}
+
+std::string make_id(size_t index, size_t length) {
+    std::string id = "var_" + std::to_string(index);
+    if (id.length() < length) {id.resize(length, '_');}
+    return id;
+}
+
+// Evict a file from the page cache
+void drop_cache(const std::string &path) {
+#ifdef __linux__
+    int descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) {return;}
+    ::fdatasync(descriptor);
+    ::posix_fadvise(descriptor, 0, 0, POSIX_FADV_DONTNEED);
+    ::close(descriptor);
+#else
+    (void)path;
+#endif
+}
+
+// A recipe with "count" variables of "payload" bytes each, backed by one buffer
+struct Fixture {
+    std::vector<char> data;
+    rcp::Recipe recipe;
+
+    Fixture(const std::string &name, size_t count, size_t payload, size_t id_length=32):
+        data(count * payload, 1), recipe(name, folder())
+    {
+        for (size_t i = 0; i < count; i++) {
+            this->recipe.add_variable(make_id(i, id_length), this->data.data() + i * payload, payload);
+        }
+        this->recipe.init();
+    }
+};
+
+bool too_large(benchmark::State &state, uint64_t bytes) {
+    if (bytes <= max_bytes()) {return false;}
+    state.SkipWithError("payload exceeds RCP_BENCH_MAX_BYTES");
+    return true;
+}
+
+// Args: count, id length
+void BM_AddVariable(benchmark::State &state) {
+    size_t count = state.range(0);
+    size_t id_length = state.range(1);
+    std::vector<std::string> ids;
+    ids.reserve(count);
+    for (size_t i = 0; i < count; i++) {ids.push_back(make_id(i, id_length));}
+    std::vector<int> values(count);
+
+    for (auto _: state) {
+        rcp::Recipe recipe("add_variable", folder());
+        for (size_t i = 0; i < count; i++) {
+            recipe.add_variable(ids[i], values[i]);
+        }
+        benchmark::DoNotOptimize(recipe);
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+// Args: save case, count, payload
+void BM_SaveRecipe(benchmark::State &state) {
+    SaveCase mode = static_cast<SaveCase>(state.range(0));
+    size_t count = state.range(1);
+    size_t payload = state.range(2);
+    if (too_large(state, uint64_t(count) * payload)) {return;}
+    state.SetLabel(SAVE_NAMES[mode]);
+
+    Fixture fixture(std::string("save_") + SAVE_NAMES[mode], count, payload);
+    rcp::Recipe &recipe = fixture.recipe;
+    recipe.set_file_format(mode == SAVE_V1 ? rcp::FileFormat::V1 : rcp::FileFormat::V2);
+    if (mode == SAVE_ATOMIC) {recipe.set_save_mode(rcp::SaveMode::Atomic);}
+    if (mode == SAVE_LZ4) {recipe.set_compression(rcp::Codec::LZ4);}
+    if (mode == SAVE_INCREMENTAL) {
+        recipe.set_dirty_tracking(rcp::DirtyTracking::Explicit);
+        recipe.save_recipe();
+    }
+    std::string first = make_id(0, 32);
+
+    for (auto _: state) {
+        bool success;
+        if (mode == SAVE_ASYNC) {
+            success = recipe.save_recipe_async().get();
+        } else if (mode == SAVE_INCREMENTAL) {
+            // One changed variable
+            fixture.data[0]++;
+            recipe.mark_dirty(first);
+            success = recipe.save_recipe();
+        } else {
+            success = recipe.save_recipe();
+        }
+        if (!success) {
+            state.SkipWithError("save_recipe failed");
+            break;
+        }
+    }
+
+    size_t written = mode == SAVE_INCREMENTAL ? 1 : count;
+    state.SetItemsProcessed(state.iterations() * written);
+    state.SetBytesProcessed(state.iterations() * written * payload);
+}
+
+// Args: load case, cold cache, count, payload
+void BM_LoadRecipe(benchmark::State &state) {
+    LoadCase mode = static_cast<LoadCase>(state.range(0));
+    bool cold = state.range(1) != 0;
+    size_t count = state.range(2);
+    size_t payload = state.range(3);
+    if (too_large(state, uint64_t(count) * payload)) {return;}
+    state.SetLabel(std::string(LOAD_NAMES[mode]) + (cold ? "/cold" : "/warm"));
+
+    Fixture fixture(std::string("load_") + LOAD_NAMES[mode], count, payload);
+    rcp::Recipe &recipe = fixture.recipe;
+    bool v1 = mode == LOAD_STREAM_V1 || mode == LOAD_MAPPED_V1;
+    recipe.set_file_format(v1 ? rcp::FileFormat::V1 : rcp::FileFormat::V2);
+    recipe.set_load_mode(mode == LOAD_STREAM_V1 || mode == LOAD_STREAM_V2 ? rcp::LoadMode::Stream : rcp::LoadMode::Mapped);
+    if (mode == LOAD_LZ4) {recipe.set_compression(rcp::Codec::LZ4);}
+    if (!recipe.save_recipe()) {
+        state.SkipWithError("save_recipe failed");
+        return;
+    }
+
+    for (auto _: state) {
+        if (cold) {
+            state.PauseTiming();
+            drop_cache(recipe.get_path());
+            state.ResumeTiming();
+        }
+        bool success = mode == LOAD_PARALLEL_V2 ? recipe.load_recipe(rcp::ParallelPolicy{}) : recipe.load_recipe();
+        if (!success) {
+            state.SkipWithError("load_recipe failed");
+            break;
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * count);
+    state.SetBytesProcessed(state.iterations() * count * payload);
+}
+
+// Args: mapped, count
+void BM_LoadVariable(benchmark::State &state) {
+    bool mapped = state.range(0) != 0;
+    size_t count = state.range(1);
+    state.SetLabel(mapped ? "mapped" : "stream");
+
+    Fixture fixture("load_variable", count, sizeof(int));
+    rcp::Recipe &recipe = fixture.recipe;
+    recipe.set_file_format(rcp::FileFormat::V2);
+    recipe.set_load_mode(mapped ? rcp::LoadMode::Mapped : rcp::LoadMode::Stream);
+    if (!recipe.save_recipe()) {
+        state.SkipWithError("save_recipe failed");
+        return;
+    }
+    std::vector<std::string> ids;
+    for (size_t i = 0; i < 64; i++) {ids.push_back(make_id((i * 7919) % count, 32));}
+
+    size_t next = 0;
+    for (auto _: state) {
+        if (!recipe.load_variable(ids[next])) {
+            state.SkipWithError("load_variable failed");
+            break;
+        }
+        next = (next + 1) % ids.size();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Many small variables, then one variable of growing size
+void recipe_shapes(benchmark::internal::Benchmark *benchmark, const std::vector<std::vector<int64_t>> &prefixes) {
+    for (const std::vector<int64_t> &prefix: prefixes) {
+        for (int64_t count: {10, 1000, 100000, 1000000}) {
+            std::vector<int64_t> args = prefix;
+            args.insert(args.end(), {count, 8});
+            benchmark->Args(args);
+        }
+        for (int64_t payload: {int64_t(1), int64_t(1) << 10, int64_t(1) << 20, int64_t(64) << 20, int64_t(1) << 30}) {
+            std::vector<int64_t> args = prefix;
+            args.insert(args.end(), {1, payload});
+            benchmark->Args(args);
+        }
+    }
+}
+
+void save_args(benchmark::internal::Benchmark *benchmark) {
+    benchmark->ArgNames({"mode", "count", "payload"});
+    recipe_shapes(benchmark, {{SAVE_V1}, {SAVE_V2}, {SAVE_ATOMIC}, {SAVE_ASYNC}, {SAVE_INCREMENTAL}, {SAVE_LZ4}});
+}
+
+void BM_Crc32c(benchmark::State &state) {
+    bool portable = state.range(0) != 0;
+    size_t size = state.range(1);
+    state.SetLabel(portable ? "portable" : rcp::crc32c_implementation());
+    std::vector<char> data(size, 'x');
+
+    for (auto _: state) {
+        uint32_t crc = portable ? rcp::crc32c_portable(0, data.data(), size) : rcp::crc32c(0, data.data(), size);
+        benchmark::DoNotOptimize(crc);
+    }
+    state.SetBytesProcessed(state.iterations() * size);
+}
+
+void load_args(benchmark::internal::Benchmark *benchmark) {
+    benchmark->ArgNames({"mode", "cold", "count", "payload"});
+    std::vector<std::vector<int64_t>> prefixes;
+    for (int64_t mode: {LOAD_STREAM_V1, LOAD_MAPPED_V1, LOAD_STREAM_V2, LOAD_MAPPED_V2, LOAD_PARALLEL_V2, LOAD_LZ4}) {
+        prefixes.push_back({mode, 0});
+        prefixes.push_back({mode, 1});
+    }
+    recipe_shapes(benchmark, prefixes);
+}
+
+}
+
+BENCHMARK(BM_AddVariable)->ArgNames({"count", "id_length"})
+    ->ArgsProduct({{10, 1000, 100000, 1000000}, {8, 32, 128}})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SaveRecipe)->Apply(save_args)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_LoadRecipe)->Apply(load_args)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_LoadVariable)->ArgNames({"mapped", "count"})
+    ->ArgsProduct({{0, 1}, {1000, 1000000}})->Unit(benchmark::kMicrosecond)->UseRealTime();
+BENCHMARK(BM_Crc32c)->ArgNames({"portable", "size"})
+    ->ArgsProduct({{0, 1}, {64, 4096, 1 << 20, 64 << 20}});
+
+BENCHMARK_MAIN();
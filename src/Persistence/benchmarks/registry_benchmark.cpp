@@ -0,0 +1,143 @@
+#include <benchmark/benchmark.h>
+
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "recipe_registry.hpp"
+
+// Registration and load lookups of the flat RecipeRegistry against the
+// std::unordered_map<std::string, RecipeItem*> registry it replaced.
+
+namespace {
+
+struct MapItem {
+    char *ptr;
+    size_t size;
+};
+
+std::vector<std::string> make_ids(size_t count) {
+    std::vector<std::string> ids;
+    ids.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        ids.push_back("controller/axis_" + std::to_string(i % 64) + "/parameter_" + std::to_string(i));
+    }
+    return ids;
+}
+
+void BM_MapRegister(benchmark::State &state) {
+    std::vector<std::string> ids = make_ids(state.range(0));
+    std::vector<int> values(ids.size());
+    for (auto _: state) {
+        std::unordered_map<std::string, MapItem*> map;
+        for (size_t i = 0; i < ids.size(); i++) {
+            if (map.count(ids[i]) > 0) {continue;}
+            MapItem *item = new MapItem;
+            item->ptr = (char*)&values[i];
+            item->size = sizeof(int);
+            map.emplace(ids[i], item);
+        }
+        benchmark::DoNotOptimize(map);
+        for (auto p: map) {delete p.second;}
+    }
+    state.SetItemsProcessed(state.iterations() * ids.size());
+}
+
+void BM_RegistryRegister(benchmark::State &state) {
+    std::vector<std::string> ids = make_ids(state.range(0));
+    std::vector<int> values(ids.size());
+    for (auto _: state) {
+        rcp::RecipeRegistry registry;
+        for (size_t i = 0; i < ids.size(); i++) {
+            registry.insert(ids[i], (char*)&values[i], sizeof(int));
+        }
+        benchmark::DoNotOptimize(registry);
+    }
+    state.SetItemsProcessed(state.iterations() * ids.size());
+}
+
+// Load: look up every id and copy its value, as load_recipe does per record
+void BM_MapLoad(benchmark::State &state) {
+    std::vector<std::string> ids = make_ids(state.range(0));
+    std::vector<int> values(ids.size());
+    std::unordered_map<std::string, MapItem*> map;
+    for (size_t i = 0; i < ids.size(); i++) {
+        map.emplace(ids[i], new MapItem{(char*)&values[i], sizeof(int)});
+    }
+    int source = 42;
+    std::string id;
+    for (auto _: state) {
+        for (const std::string &file_id: ids) {
+            id = file_id;
+            if (map.count(id) == 0) {continue;}
+            MapItem *item = map[id];
+            std::memcpy(item->ptr, &source, item->size);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * ids.size());
+    for (auto p: map) {delete p.second;}
+}
+
+void BM_RegistryLoad(benchmark::State &state) {
+    std::vector<std::string> ids = make_ids(state.range(0));
+    std::vector<int> values(ids.size());
+    rcp::RecipeRegistry registry;
+    for (size_t i = 0; i < ids.size(); i++) {
+        registry.insert(ids[i], (char*)&values[i], sizeof(int));
+    }
+    int source = 42;
+    for (auto _: state) {
+        for (const std::string &file_id: ids) {
+            rcp::RecipeItem *item = registry.find(file_id);
+            if (item == nullptr) {continue;}
+            std::memcpy(item->ptr, &source, item->size);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * ids.size());
+}
+
+// Save: iterate every item
+void BM_MapIterate(benchmark::State &state) {
+    std::vector<std::string> ids = make_ids(state.range(0));
+    std::vector<int> values(ids.size());
+    std::unordered_map<std::string, MapItem*> map;
+    for (size_t i = 0; i < ids.size(); i++) {
+        map.emplace(ids[i], new MapItem{(char*)&values[i], sizeof(int)});
+    }
+    for (auto _: state) {
+        size_t bytes = 0;
+        for (auto &var: map) {bytes += var.first.length() + var.second->size;}
+        benchmark::DoNotOptimize(bytes);
+    }
+    state.SetItemsProcessed(state.iterations() * ids.size());
+    for (auto p: map) {delete p.second;}
+}
+
+void BM_RegistryIterate(benchmark::State &state) {
+    std::vector<std::string> ids = make_ids(state.range(0));
+    std::vector<int> values(ids.size());
+    rcp::RecipeRegistry registry;
+    for (size_t i = 0; i < ids.size(); i++) {
+        registry.insert(ids[i], (char*)&values[i], sizeof(int));
+    }
+    for (auto _: state) {
+        size_t bytes = 0;
+        for (rcp::RecipeItem &item: registry) {bytes += item.id_length + item.size;}
+        benchmark::DoNotOptimize(bytes);
+    }
+    state.SetItemsProcessed(state.iterations() * ids.size());
+}
+
+}
+
+BENCHMARK(BM_MapRegister)->Arg(100000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_RegistryRegister)->Arg(100000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_MapLoad)->Arg(100000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_RegistryLoad)->Arg(100000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_MapIterate)->Arg(100000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_RegistryIterate)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
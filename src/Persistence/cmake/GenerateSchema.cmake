@@ -0,0 +1,69 @@
+# Generate a schema header from a schema file, run by rcp_add_schema (see RecipeSchema.cmake).
+# Usage: cmake -DINPUT=<schema file> -DOUTPUT=<header> -P GenerateSchema.cmake
+
+file(STRINGS ${INPUT} lines)
+get_filename_component(schema_name ${INPUT} NAME_WE)
+string(MAKE_C_IDENTIFIER ${schema_name} guard)
+string(TOUPPER ${guard} guard)
+
+set(name "")
+set(members "")
+set(fields "")
+set(line_number 0)
+foreach(line IN LISTS lines)
+    math(EXPR line_number "${line_number} + 1")
+    string(REGEX REPLACE "#.*$" "" line "${line}")
+    string(STRIP "${line}" line)
+    if(line STREQUAL "")
+        continue()
+    endif()
+
+    if(line MATCHES "^schema[ \t]+([A-Za-z_][A-Za-z0-9_]*)$")
+        set(name ${CMAKE_MATCH_1})
+    elseif(line MATCHES "^(.+[^ \t])[ \t]+([A-Za-z_][A-Za-z0-9_]*)(\\[[0-9]+\\])?([ \t]+\"([^\"]*)\")?$")
+        set(member ${CMAKE_MATCH_2})
+        string(APPEND members "    ${CMAKE_MATCH_1} ${member}${CMAKE_MATCH_3};\n")
+        if(CMAKE_MATCH_4)
+            list(APPEND fields "RCP_SCHEMA_FIELD_ID(${member}, \"${CMAKE_MATCH_5}\")")
+        else()
+            list(APPEND fields "RCP_SCHEMA_FIELD(${member})")
+        endif()
+    else()
+        message(FATAL_ERROR "${INPUT}:${line_number}: invalid schema declaration \"${line}\"")
+    endif()
+endforeach()
+
+if(name STREQUAL "")
+    message(FATAL_ERROR "${INPUT}: missing \"schema <name>\" declaration")
+endif()
+if(fields STREQUAL "")
+    message(FATAL_ERROR "${INPUT}: schema ${name} has no fields")
+endif()
+list(JOIN fields ",\n    " field_list)
+
+set(content "// Generated from ${schema_name}.schema by rcp_add_schema, do not edit
+#ifndef RCP_SCHEMA_${guard}_HPP
+#define RCP_SCHEMA_${guard}_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include \"static_recipe.hpp\"
+
+struct ${name} {
+${members}};
+
+RCP_SCHEMA(${name},
+    ${field_list})
+
+#endif
+")
+
+# Keep the timestamp of an unchanged header, so dependents are not rebuilt
+if(EXISTS ${OUTPUT})
+    file(READ ${OUTPUT} previous)
+    if(previous STREQUAL content)
+        return()
+    endif()
+endif()
+file(WRITE ${OUTPUT} "${content}")
@@ -0,0 +1,33 @@
+# Recipe schemas generated at build time.
+#
+# rcp_add_schema(<target> <schema file>)
+#
+# Generates <schema name>.hpp from a schema file and adds it to the include path of <target>.
+# The header declares the schema struct and its RCP_SCHEMA field list, see static_recipe.hpp.
+#
+# Schema file format, one declaration per line, "#" starts a comment:
+#     schema MotorConfig
+#     int32_t speed
+#     double gain
+#     float pid[3]
+#     bool enabled "motor enabled"
+# Each field is a trivially copyable type followed by the member name, an optional array extent
+# and an optional quoted id, the member name is the id otherwise.
+
+set(RCP_SCHEMA_GENERATOR ${CMAKE_CURRENT_LIST_DIR}/GenerateSchema.cmake CACHE INTERNAL "")
+
+function(rcp_add_schema target schema)
+    get_filename_component(schema_path ${schema} ABSOLUTE)
+    get_filename_component(schema_name ${schema} NAME_WE)
+    set(output_dir ${CMAKE_CURRENT_BINARY_DIR}/rcp_schemas)
+    set(output ${output_dir}/${schema_name}.hpp)
+    add_custom_command(
+        OUTPUT ${output}
+        COMMAND ${CMAKE_COMMAND} -DINPUT=${schema_path} -DOUTPUT=${output} -P ${RCP_SCHEMA_GENERATOR}
+        DEPENDS ${schema_path} ${RCP_SCHEMA_GENERATOR}
+        COMMENT "Generating recipe schema ${schema_name}.hpp"
+        VERBATIM
+    )
+    target_sources(${target} PRIVATE ${output})
+    target_include_directories(${target} PRIVATE ${output_dir})
+endfunction()
@@ -13,6 +13,12 @@ struct TestStruct {
     float float2;
 };
 
+RCP_DESCRIBE(TestStruct,
+    RCP_FIELD(bool1), RCP_FIELD(bool2),
+    RCP_FIELD(int1), RCP_FIELD(int2), RCP_FIELD(int3),
+    RCP_FIELD(long1), RCP_FIELD(long2),
+    RCP_FIELD(float1), RCP_FIELD(float2))
+
 int main(int argc, char** argv) {
     for (int i = 0; i < argc; i++) {
         std::cout << i << ": " << argv[i] << std::endl;
@@ -27,10 +33,11 @@ int main(int argc, char** argv) {
     rcp::Recipe test_recipe("test_recipe");
     test_recipe.set_folder(path.parent_path().string() + "/example_output/recipes");
     test_recipe.set_extension("rcp");
+    test_recipe.set_load_mode(rcp::LoadMode::Mapped);
 
     test_recipe.add_variable("integer", (char*)&i, sizeof(i));
     test_recipe.add_variable("long thing", (char*)&l, sizeof(l));
-    test_recipe.add_variable("test_struct", (char*)&test, sizeof(test));
+    test_recipe.add_variable("test_struct", test);
     test_recipe.init();
 
     bool success = test_recipe.load_recipe();
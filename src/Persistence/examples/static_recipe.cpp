@@ -0,0 +1,36 @@
+#include <filesystem>
+#include <iostream>
+#include "motor.hpp"
+#include "recipe.hpp"
+
+int main(int argc, char** argv) {
+    std::filesystem::path path(argc > 0 ? argv[0] : "");
+    std::string folder = path.parent_path().string() + "/example_output/recipes/";
+
+    MotorConfig config{};
+    rcp::StaticRecipe<MotorConfig> motor_recipe(config, "motor", folder);
+    motor_recipe.init();
+
+    bool success = motor_recipe.load_recipe();
+    std::cout << "Load \"" << motor_recipe.get_path() << "\": " << success << std::endl;
+    std::cout << "speed: " << config.speed << std::endl;
+
+    config.speed = 1500;
+    config.gain = 0.75;
+    config.pid[0] = 1.0f;
+    config.pid[1] = 0.1f;
+    config.pid[2] = 0.01f;
+    config.enabled = true;
+    success = motor_recipe.save_recipe();
+    std::cout << "Save \"" << motor_recipe.get_path() << "\": " << success << std::endl;
+
+    // The file is the one a dynamic Recipe with the same variables writes
+    int32_t speed = 0;
+    rcp::Recipe dynamic_recipe("motor", folder);
+    dynamic_recipe.add_variable("speed", speed);
+    dynamic_recipe.init();
+    success = dynamic_recipe.load_recipe();
+    std::cout << "Load with Recipe: " << success << ", speed: " << speed << std::endl;
+
+    return 0;
+}
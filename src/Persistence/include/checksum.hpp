@@ -0,0 +1,35 @@
+#ifndef RCP_CHECKSUM_HPP
+#define RCP_CHECKSUM_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace rcp {
+
+/**
+ * CRC-32C (Castagnoli) checksum, used by the recipe file format to detect torn and corrupted files.
+*/
+uint32_t crc32c(uint32_t crc, const char *data, size_t size);
+uint32_t crc32c_combine(uint32_t crc1, uint32_t crc2, size_t size2);
+uint32_t crc32c_portable(uint32_t crc, const char *data, size_t size);
+const char* crc32c_implementation();
+
+/**
+ * "crc32c_combine" for a second block of a fixed size.
+ * The operator is computed once by the constructor, every "combine" then costs one 32x32 GF(2) matrix product
+ * instead of a matrix power.
+*/
+class Crc32cCombiner {
+    public:
+        explicit Crc32cCombiner(size_t size2);
+
+        uint32_t combine(uint32_t crc1, uint32_t crc2) const;
+        size_t size() const;
+    private:
+        uint32_t _matrix[32];
+        size_t _size;
+};
+
+}
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef RCP_COMPRESSION_HPP
+#define RCP_COMPRESSION_HPP
+
+#include <cstddef>
+#include <memory_resource>
+
+#include "recipe_options.hpp"
+
+namespace rcp {
+
+/**
+ * Entry compression for the recipe file format.
+ * Decompression writes into a caller provided buffer of the exact decoded size,
+ * the application variable itself when loading a recipe.
+ * A value is only stored compressed if that makes it smaller.
+ * The LZ4 match table is allocated from the given memory resource, zlib uses its own allocator.
+*/
+bool codec_available(Codec codec);
+size_t compress(Codec codec, const char *source, size_t size, char *destination, size_t capacity,
+                std::pmr::memory_resource *resource=std::pmr::get_default_resource());
+bool decompress(Codec codec, const char *source, size_t size, char *destination, size_t destination_size);
+
+}
+
+#endif
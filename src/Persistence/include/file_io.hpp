@@ -0,0 +1,70 @@
+#ifndef RCP_FILE_IO_HPP
+#define RCP_FILE_IO_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+namespace rcp {
+
+/**
+ * A thin wrapper around a POSIX file descriptor.
+ * Used by the Recipe class for positioned writes and durable (fsync) saves, and by FileSource for positioned reads.
+ *
+ * The descriptor is closed when the object is destroyed or "close" is called.
+*/
+class File {
+    public:
+        File();
+        ~File();
+        File(const File&) = delete;
+        File& operator=(const File&) = delete;
+
+        bool open(const std::string &path, bool create=false, bool truncate=false);
+        bool open(const char *path, bool create=false, bool truncate=false);
+        bool open_shared(const std::string &name, bool create=false);
+        bool open_read(const std::string &path);
+        void close();
+
+        bool is_open() const;
+        int descriptor() const;
+        bool size(uint64_t &size) const;
+        bool resize(uint64_t size);
+        bool write_at(uint64_t offset, const char *data, size_t size);
+        bool read_at(uint64_t offset, char *data, size_t size);
+        bool sync();
+    private:
+        int _fd;
+};
+
+/**
+ * Sequential writer that batches small writes into few large positioned writes.
+ * Writes larger than the buffer capacity are passed straight through.
+ * Call "flush" before the File is synced or closed, it reports any failure since the writer was constructed.
+*/
+class BufferedWriter {
+    public:
+        BufferedWriter(File &file, uint64_t offset, size_t capacity=1 << 20,
+                       std::pmr::memory_resource *resource=std::pmr::get_default_resource());
+
+        bool write(const char *data, size_t size);
+        bool pad(size_t size);
+        bool flush();
+        uint64_t offset() const;
+    private:
+        File &_file;
+        uint64_t _offset;
+        std::pmr::vector<char> _buffer;
+        size_t _used;
+        bool _failed;
+};
+
+bool rename_file(const std::string &from, const std::string &to);
+bool rename_file(const char *from, const char *to);
+bool sync_directory(const std::string &path);
+
+}
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef RCP_FILE_WATCHER_HPP
+#define RCP_FILE_WATCHER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace rcp {
+
+/**
+ * Watches one file for changes on a background thread.
+ * Used by the Recipe class to implement "start_watch".
+ *
+ * Backed by inotify on Linux and kqueue on macOS and the BSDs, other platforms poll the file modification time.
+ * If waiting for inotify or kqueue events fails while the watcher runs, it falls back to polling.
+ * The directory of the file is watched, so a file replaced by a rename (SaveMode::Atomic) or created later is detected.
+ * Events are debounced: the callback runs once the file has been quiet for the debounce interval.
+ * The callback runs on the watcher thread and must not call "stop".
+*/
+class FileWatcher {
+    public:
+        using Callback = std::function<void()>;
+
+        FileWatcher();
+        ~FileWatcher();
+        FileWatcher(const FileWatcher&) = delete;
+        FileWatcher& operator=(const FileWatcher&) = delete;
+
+        bool start(const std::string &path, Callback callback, std::chrono::milliseconds debounce=std::chrono::milliseconds(50));
+        void stop();
+        bool is_running() const;
+    private:
+        std::string _path;
+        Callback _callback;
+        std::chrono::milliseconds _debounce;
+        std::thread _thread;
+        std::atomic<bool> _stop;
+        int _descriptor;
+        int _wake[2];
+        std::mutex _mutex;
+        std::condition_variable _condition;
+
+        void _run();
+        void _poll(bool changed);
+};
+
+}
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef RCP_MAPPED_FILE_HPP
+#define RCP_MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <string>
+
+namespace rcp {
+
+/**
+ * A read-only memory mapping of a file.
+ * Used by the Recipe class to load recipe files without intermediate buffers.
+ *
+ * The mapping is released when the object is destroyed or "close" is called.
+ * An empty file is a valid mapping with a null data pointer and a size of 0.
+*/
+class MappedFile {
+    public:
+        MappedFile();
+        ~MappedFile();
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool open(const std::string &path);
+        void close();
+
+        bool is_open() const;
+        const char* data() const;
+        size_t size() const;
+    private:
+        const char *_data;
+        size_t _size;
+        bool _open;
+};
+
+}
+
+#endif
@@ -1,21 +1,36 @@
 #ifndef RCP_RECIPE_HPP
 #define RCP_RECIPE_HPP
 
-#include <unordered_map>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <filesystem>
 #include <fstream>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <string_view>
+#include <vector>
 
-namespace rcp {
+#include "recipe_options.hpp"
+#include "recipe_registry.hpp"
+#include "recipe_stats.hpp"
+#include "recipe_type.hpp"
+#include "seqlock.hpp"
 
-/**
- * A container for application variables.
- * Used by the Recipe class
-*/
-struct RecipeItem {
-    char *ptr;
-    size_t size;
-};
+namespace rcp {
 
+class AsyncWriter;
+class File;
+class FileWatcher;
+class RecipeHistory;
+class RecipeSource;
+class RecipeStore;
+struct SaveTarget;
+namespace format {struct TocEntry;}
 
 /**
  * The Recipe class represents a set of variables linked to a file for persistent storage.
@@ -29,6 +44,9 @@ struct RecipeItem {
  * 
  * Add variables through the "add_variable" method.
  * Provide a unique identifier for the variable, a char pointer to the variable and the variable size in number of bytes.
+ * Or provide a unique identifier and a reference to a trivially copyable variable,
+ * this also records the type fingerprint of the variable (see "type_fingerprint" in recipe_type.hpp).
+ * Data that is not stored contiguously in memory is added through "add_stream_variable" with a reader and writer callback.
  * 
  * Call the "init" method to enable the recipe.
  * This creates the file at the specified folder if it does not exists.
@@ -37,42 +55,257 @@ struct RecipeItem {
  * "load_recipe" reads the recipe file and transfers values from the recipe file to the application variables.
  * "save_recipe" overwrites the recipe file and transfers values from the application variables to the recipe file.
  * 
+ * Optional: select how the recipe file is read by calling "set_load_mode" (default: LoadMode::Stream).
+ * LoadMode::Mapped avoids per-variable heap allocations and is preferred for large recipes.
+ * Optional: select the file format written by "save_recipe" by calling "set_file_format" (default: FileFormat::V1).
+ * "load_recipe" reads both formats, "load_variable" reads a single variable from a V2 file.
+ * FileFormat::V1 keeps the files readable by library versions that predate V2.
+ * Checksums, "load_variable", compression, in-place saves, parallel loads and reloads on change need V2 files.
+ * Optional: enable dirty tracking by calling "set_dirty_tracking" (default: DirtyTracking::None).
+ * With dirty tracking and the V2 format, "save_recipe" rewrites only the changed variables in place,
+ * as long as no variables were added or removed since the previous save.
+ * Optional: select how the recipe file is replaced by calling "set_save_mode" (default: SaveMode::Direct)
+ * and when it is flushed to the storage device by calling "set_sync_mode" (default: SyncMode::Never).
+ * V2 files carry checksums, "load_recipe" rejects torn or corrupted files.
+ * Every load checks a stored value before it is written to its variable, so a value failing its checksum
+ * leaves the variable untouched. Values assigned before the failing entry are kept, V1 files carry no checksums.
+ * "load_recipe" bounds every length read from a file by the rest of the file and reports the failing offset,
+ * see "get_load_error".
+ * "save_recipe_async" snapshots the variables and writes them on a background thread.
+ * "load_recipe(ParallelPolicy)" loads a V2 file on several threads.
+ * Optional: bound the size of a single read by calling "set_chunk_size" (default: 4 MiB).
+ * Optional: compress large V2 entries by calling "set_compression" (default: Codec::None),
+ * or per variable by calling "set_variable_compression".
+ * Optional: share the recipe between threads by calling "set_concurrency" (default: Concurrency::None).
+ * With Concurrency::Concurrent, saves work on an immutable snapshot of the registered variables and never block
+ * "add_variable" or "remove_variable" while writing the file.
+ * Register variables written by other threads with a SeqLock, or as Guarded<T>, so saves copy them consistently.
+ * Optional: reload a V2 file when it changes on disk by calling "start_watch" (requires Concurrency::Concurrent).
+ * Only entries whose stored content changed are reloaded, see "reload_changed" and "set_change_callback".
+ * Optional: persist frequent updates of single variables by calling "set_journal_mode" (default: JournalMode::None).
+ * With JournalMode::Append, "journal_variable" appends the value of one variable to a journal next to the recipe file,
+ * "load_recipe" replays the journal on top of the recipe file and every save compacts the journal into the recipe file.
+ * Optional: observe bytes, entry counts and phase durations of every load and save by calling "set_observer",
+ * see recipe_stats.hpp.
+ * Optional: build with APPTOOLS_TRACE to record "init", loads and saves as spans of a Chrome trace, see trace.hpp.
+ * Optional: share a loaded recipe with other processes of the host through shared memory, see shared_recipe.hpp.
+ * Optional: load the recipe file from other storage, for instance an object store over HTTP,
+ * by calling "set_source" (see recipe_source.hpp). Only the data blocks of registered variables are fetched.
+ * Optional: keep versions of the recipe by calling "save_version", which appends the changed values to a history
+ * next to the recipe file, and restore any of them with "load_version" (see "get_versions").
+ * Optional: provide a std::pmr::memory_resource in the constructor to allocate the variable registry
+ * and the buffers of loads and saves from a preallocated arena instead of the global heap,
+ * and call "reserve" to size the registry up front.
+ * 
  * --------------------------------------------
  * Notes:
  * --------------------------------------------
- * Be careful with loading a recipe if a variable has changed its type.
+ * Be careful with loading a recipe if an untyped variable (added by char pointer and size) has changed its type.
  * Adding and removing variables from the recipe is not a problem, but a changed type will cause undefined behaviour.
  * If the size of a variable changes, for instance changing an int to a long type, the value will not be assigned to the variable when loading a recipe.
- * If the size of a variable is the same but the datastructure is different, for instance a struct where the fields have changed their order or changing from uint32_t to float, the struct will be updated with values from the recipe. 
+ * If the size of an untyped variable is the same but the datastructure is different, for instance a struct where the fields have changed their order or changing from uint32_t to float, the struct will be updated with values from the recipe. 
+ * Typed variables in a V2 file are only assigned if the stored type fingerprint matches,
+ * describe struct fields with RCP_DESCRIBE or bump RCP_TYPE_VERSION to detect layout changes of the same size.
+ * Register a converter with "set_converter" to migrate mismatching stored values instead of skipping them.
+ * With a memory resource, registering variables up to the reserved count, "load_recipe" and "load_variable"
+ * with LoadMode::Mapped and "save_recipe" do not allocate from the global heap once the reused buffers have grown
+ * to size (the first full save). Every full save allocates a 1 MiB write buffer from the resource,
+ * use a resource that reuses freed blocks of that size, for instance std::pmr::unsynchronized_pool_resource.
+ * The file name and path strings, callbacks stored in std::function, the journal, file watchers, background writers,
+ * the threads of the parallel load, zlib (Codec::Deflate) and std::ifstream in LoadMode::Stream
+ * still allocate from the global heap.
 */
 class Recipe {
     public:
-        Recipe();
-        Recipe(std::string name, std::string file="", std::string extension=".rcp");
+        using Converter = std::function<bool(const char *data, size_t size, uint64_t type)>;
+        using ChangeCallback = std::function<void(std::string_view id)>;
+
+        explicit Recipe(std::pmr::memory_resource *resource=std::pmr::get_default_resource());
+        Recipe(std::string name, std::string file="", std::string extension=".rcp",
+               std::pmr::memory_resource *resource=std::pmr::get_default_resource());
         ~Recipe();
 
         bool init();
         void stop();
-        bool add_variable(std::string, char*, size_t);
-        bool remove_variable(std::string);
+        bool add_variable(std::string_view, char*, size_t);
+        template <typename T>
+        bool add_variable(std::string_view, T&);
+        bool add_variable(std::string_view, char*, size_t, SeqLock&);
+        template <typename T>
+        bool add_variable(std::string_view, Guarded<T>&);
+        bool add_stream_variable(std::string_view, StreamReader, StreamWriter);
+        bool set_converter(std::string_view, Converter);
+        bool set_change_callback(std::string_view, ChangeCallback);
+        bool remove_variable(std::string_view);
+        void reserve(size_t count, size_t id_bytes=0);
+        bool mark_dirty(std::string_view);
         bool load_recipe();
+        bool load_recipe(const ParallelPolicy&);
+        bool load_variable(std::string_view);
+        bool reload_changed();
+        bool start_watch(std::chrono::milliseconds debounce=std::chrono::milliseconds(50));
+        void stop_watch();
+        bool is_watching();
         bool save_recipe();
+        std::shared_future<bool> save_recipe_async();
+        bool journal_variable(std::string_view);
+        uint64_t save_version();
+        bool load_version(uint64_t);
+        std::vector<VersionInfo> get_versions();
+        uint64_t get_version();
 
         bool is_init();
-        std::string get_path();
+        const std::string& get_path();
+        std::string get_name();
         void set_name(std::string);
         void set_folder(std::string);
         void set_extension(std::string);
+        LoadMode get_load_mode();
+        void set_load_mode(LoadMode);
+        FileFormat get_file_format();
+        void set_file_format(FileFormat);
+        DirtyTracking get_dirty_tracking();
+        void set_dirty_tracking(DirtyTracking);
+        SaveMode get_save_mode();
+        void set_save_mode(SaveMode);
+        SyncMode get_sync_mode();
+        void set_sync_mode(SyncMode, uint64_t parameter=0);
+        size_t get_chunk_size();
+        void set_chunk_size(size_t);
+        Codec get_compression();
+        bool set_compression(Codec, size_t threshold=4096);
+        bool set_variable_compression(std::string_view, Codec);
+        Concurrency get_concurrency();
+        void set_concurrency(Concurrency);
+        JournalMode get_journal_mode();
+        void set_journal_mode(JournalMode, uint64_t compaction_size=16 << 20);
+        size_t get_snapshot_interval();
+        void set_snapshot_interval(size_t);
+        LoadError get_load_error();
+        std::pmr::memory_resource* get_memory_resource();
+        RecipeObserver* get_observer();
+        void set_observer(RecipeObserver*);
+        RecipeSource* get_source();
+        void set_source(RecipeSource*);
     protected:
     private:
+        friend class RecipeStore;
+        friend class SharedRecipe;
+
         std::string _folder;
         std::string _extension;
         std::string _name;
-        std::unordered_map<std::string, RecipeItem*> _map;
+        std::string _path;
+        std::string _journal_file;
+        std::string _history_file;
+        std::pmr::memory_resource *_resource;
+        RecipeRegistry _registry;
         bool _init;
+        LoadMode _load_mode;
+        FileFormat _file_format;
+        DirtyTracking _dirty_tracking;
+        bool _layout_valid;
+        uint64_t _layout_size;
+        std::pmr::vector<char> _layout_index;
+        std::pmr::vector<char> _shadow;
+        SaveMode _save_mode;
+        SyncMode _sync_mode;
+        uint64_t _sync_parameter;
+        uint64_t _saves_since_sync;
+        std::chrono::steady_clock::time_point _last_sync;
+        std::unique_ptr<AsyncWriter> _writer;
+        std::pmr::map<std::pmr::string, Converter, std::less<>> _converters;
+        size_t _chunk_size;
+        Codec _codec;
+        size_t _compression_threshold;
+        Concurrency _concurrency;
+        std::mutex _mutex;
+        std::mutex _save_mutex;
+        std::shared_ptr<const RecipeRegistry> _published;
+        RecipeRegistry _staged;
+        std::pmr::vector<char> _staged_data;
+        std::pmr::map<std::pmr::string, ChangeCallback, std::less<>> _change_callbacks;
+        std::pmr::map<std::pmr::string, uint64_t, std::less<>> _loaded;
+        std::atomic<bool> _watching;
+        std::unique_ptr<FileWatcher> _watcher;
+        JournalMode _journal_mode;
+        uint64_t _journal_limit;
+        uint64_t _journal_size;
+        std::unique_ptr<File> _journal;
+        std::pmr::vector<char> _journal_buffer;
+        std::unique_ptr<RecipeHistory> _history;
+        uint64_t _version;
+        size_t _snapshot_interval;
+        RecipeObserver *_observer;
+        RecipeSource *_source;
+        LoadError _load_error;
 
+        bool _add_variable(std::string_view, char*, size_t, uint64_t, SeqLock *lock=nullptr);
+        std::unique_lock<std::mutex> _lock();
+        void _registry_changed();
+        std::shared_ptr<const RecipeRegistry> _acquire_registry();
+        bool _load();
+        bool _load_parallel(const ParallelPolicy&);
+        bool _load_variable(RecipeItem*, std::string_view);
+        void _remember_index(const std::pmr::vector<char>&);
+        std::unique_ptr<AsyncWriter> _make_writer();
+        bool _write_image(File&, uint64_t, uint64_t, uint64_t&);
+        bool _load_image(const char*, size_t);
+        bool _convert(std::string_view, const char*, size_t, uint64_t);
+        bool _apply_entry(RecipeItem&, const format::TocEntry&, const char*, bool *assigned=nullptr);
+        bool _load_stream();
+        bool _load_stream_v2(std::ifstream&);
+        bool _load_mapped();
+        bool _load_mapped_v1(const char*, size_t);
+        bool _load_mapped_v2(const char*, size_t);
+        bool _load_source(const RecipeItem *only=nullptr);
+        SaveTarget _save_target();
+        bool _save_dirty();
+        bool _save_concurrent();
+        void _update_snapshot(RecipeItem*);
+        bool _sync_due();
+        void _update_path();
+        const std::string& _journal_path();
+        bool _open_journal();
+        bool _reset_journal();
+        bool _replay_journal(const RecipeItem *only=nullptr);
+        bool _open_history();
+        bool _fail(LoadStatus, uint64_t);
 
 };
+
+/**
+ * Adds a typed variable to the recipe.
+ * The variable will only be added if the identifier "id" is not yet registered in the recipe.
+ * The type fingerprint is computed at compile time and stored with the variable in V2 recipe files.
+ * 
+ * @param id a unique identifier for the variable linked to this recipe
+ * @param var the variable, must be trivially copyable
+ * 
+ * @return true if the variable was added to the recipe
+*/
+template <typename T>
+bool Recipe::add_variable(std::string_view id, T &var) {
+    constexpr uint64_t type = type_fingerprint<T>();
+    return this->_add_variable(id, reinterpret_cast<char*>(&var), sizeof(T), type);
+}
+
+/**
+ * Adds a typed variable guarded by its own SeqLock to the recipe.
+ * The variable will only be added if the identifier "id" is not yet registered in the recipe.
+ * Loads assign the variable under its lock, saves in Concurrency::Concurrent mode and asynchronous saves copy it under its lock.
+ * 
+ * @param id a unique identifier for the variable linked to this recipe
+ * @param var the guarded variable
+ * 
+ * @return true if the variable was added to the recipe
+*/
+template <typename T>
+bool Recipe::add_variable(std::string_view id, Guarded<T> &var) {
+    constexpr uint64_t type = type_fingerprint<T>();
+    return this->_add_variable(id, reinterpret_cast<char*>(var.data()), sizeof(T), type, &var.lock());
+}
+
 }
 
 #endif
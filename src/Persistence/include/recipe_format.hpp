@@ -0,0 +1,321 @@
+#ifndef RCP_RECIPE_FORMAT_HPP
+#define RCP_RECIPE_FORMAT_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace rcp {
+
+/**
+ * On-disk layout of the indexed (v2) recipe file.
+ *
+ * --------------------------------------------
+ * Layout:
+ * --------------------------------------------
+ * [Header]       fixed size, see HEADER_SIZE
+ * [TOC]          "entry_count" entries of TOC_ENTRY_SIZE bytes, sorted by (hash, id)
+ * [String table] all ids back to back, referenced by (id_offset, id_length)
+ * [Data blocks]  one block per entry, each starting at a multiple of DATA_ALIGNMENT
+ * [Trailer]      optional, present if the header has HEADER_HAS_TRAILER set
+ *
+ * The trailer holds a checksum of everything in front of the data blocks.
+ * A file that is shorter than "file_size" or lacks the trailer magic is rejected without reading the data blocks.
+ * Entries flagged ENTRY_HAS_CHECKSUM carry a checksum of their stored data block.
+ * An entry with a codec other than CODEC_RAW stores "stored_size" compressed bytes that decode to "size" bytes.
+ *
+ * All integers are stored little-endian regardless of the host.
+ * A v1 file starts with the 8 byte length of its first id, which never matches MAGIC.
+*/
+namespace format {
+
+constexpr char MAGIC[8] = {'R', 'C', 'P', 'I', 'N', 'D', 'E', 'X'};
+constexpr uint32_t VERSION = 2;
+constexpr size_t HEADER_SIZE = 64;
+constexpr size_t TOC_ENTRY_SIZE = 56;
+constexpr size_t DATA_ALIGNMENT = 16;
+constexpr size_t TRAILER_SIZE = 16;
+constexpr char TRAILER_MAGIC[8] = {'R', 'C', 'P', 'T', 'R', 'A', 'I', 'L'};
+
+constexpr uint32_t HEADER_HAS_TRAILER = 1 << 0;
+constexpr uint8_t ENTRY_HAS_CHECKSUM = 1 << 0;
+
+// Entry codecs, the value of "Codec" (see recipe_options.hpp)
+constexpr uint8_t CODEC_RAW = 0;
+constexpr uint8_t CODEC_LZ4 = 1;
+constexpr uint8_t CODEC_DEFLATE = 2;
+
+/**
+ * File header
+*/
+struct Header {
+    uint32_t version;
+    uint32_t flags;
+    uint64_t entry_count;
+    uint64_t toc_offset;
+    uint64_t strings_offset;
+    uint64_t strings_size;
+    uint64_t data_offset;
+    uint64_t file_size;
+};
+
+/**
+ * Table of contents entry, one per variable.
+ * "type" is a type tag for the variable layout, 0 if unknown.
+ * "codec" and "stored_size" describe how the data block is encoded, codec 0 is raw bytes with stored_size == size.
+ * "checksum" is 0 when the entry carries no checksum.
+*/
+struct TocEntry {
+    uint64_t hash;
+    uint64_t type;
+    uint64_t offset;
+    uint64_t size;
+    uint64_t stored_size;
+    uint32_t id_offset;
+    uint16_t id_length;
+    uint8_t codec;
+    uint8_t flags;
+    uint32_t checksum;
+};
+
+/**
+ * File trailer
+*/
+struct Trailer {
+    uint32_t index_checksum;
+};
+
+uint64_t hash_id(const char *id, size_t length);
+uint64_t align_up(uint64_t value, uint64_t alignment=DATA_ALIGNMENT);
+
+bool has_magic(const char *buffer, size_t size);
+void encode_header(const Header &header, char *buffer);
+bool decode_header(const char *buffer, size_t size, Header &header);
+bool validate_header(const Header &header, uint64_t file_size);
+void encode_entry(const TocEntry &entry, char *buffer);
+void decode_entry(const char *buffer, TocEntry &entry);
+bool validate_entry(const TocEntry &entry, const Header &header);
+void encode_trailer(const Trailer &trailer, char *buffer);
+bool decode_trailer(const char *buffer, Trailer &trailer);
+uint64_t data_end(const Header &header);
+
+int compare_entry(uint64_t hash, const char *id, size_t length, const TocEntry &entry, const char *strings);
+
+/**
+ * On-disk layout of the sequential (v1) recipe file.
+ *
+ * --------------------------------------------
+ * Layout:
+ * --------------------------------------------
+ * [Records] back to back, each:
+ *           [id length]  V1_LENGTH_SIZE bytes
+ *           [id]         at most V1_MAX_ID_LENGTH characters
+ *           [size]       V1_LENGTH_SIZE bytes
+ *           [value]      "size" bytes
+ *           [padding]    one byte if id length + size is odd, may be missing after the last record
+ *
+ * Lengths are 8 byte little-endian on every host, the size_t layout of the 64-bit little-endian hosts writing v1 files,
+ * so files are exchanged between 32 and 64-bit hosts of either byte order.
+*/
+constexpr size_t V1_LENGTH_SIZE = 8;
+constexpr uint64_t V1_MAX_ID_LENGTH = UINT16_MAX;
+
+void encode_v1_length(uint64_t length, char *buffer);
+uint64_t decode_v1_length(const char *buffer);
+
+/**
+ * On-disk layout of a recipe store, many recipes in one file (see RecipeStore).
+ *
+ * --------------------------------------------
+ * Layout:
+ * --------------------------------------------
+ * [StoreHeader] fixed size, see STORE_HEADER_SIZE
+ * [Directory]   "recipe_count" entries of STORE_ENTRY_SIZE bytes, sorted by name
+ * [Name table]  all recipe names back to back, referenced by (name_offset, name_length)
+ * [Images]      one v2 recipe file per entry, each starting at a multiple of DATA_ALIGNMENT
+ *               and followed by unused space up to its "capacity"
+ * [Trailer]     as in a v2 file, the checksum covers everything in front of the images
+ *
+ * All integers are stored little-endian regardless of the host.
+*/
+constexpr char STORE_MAGIC[8] = {'R', 'C', 'P', 'S', 'T', 'O', 'R', 'E'};
+constexpr uint32_t STORE_VERSION = 1;
+constexpr size_t STORE_HEADER_SIZE = 64;
+constexpr size_t STORE_ENTRY_SIZE = 32;
+
+/**
+ * Store header
+*/
+struct StoreHeader {
+    uint32_t version;
+    uint32_t flags;
+    uint64_t recipe_count;
+    uint64_t directory_offset;
+    uint64_t names_offset;
+    uint64_t names_size;
+    uint64_t data_offset;
+    uint64_t file_size;
+};
+
+/**
+ * Directory entry, one per recipe.
+ * "size" is the size of the recipe image, "capacity" the space reserved for it.
+*/
+struct StoreEntry {
+    uint64_t offset;
+    uint64_t size;
+    uint64_t capacity;
+    uint32_t name_offset;
+    uint32_t name_length;
+};
+
+bool has_store_magic(const char *buffer, size_t size);
+void encode_store_header(const StoreHeader &header, char *buffer);
+bool decode_store_header(const char *buffer, size_t size, StoreHeader &header);
+bool validate_store_header(const StoreHeader &header, uint64_t file_size);
+void encode_store_entry(const StoreEntry &entry, char *buffer);
+void decode_store_entry(const char *buffer, StoreEntry &entry);
+bool validate_store_entry(const StoreEntry &entry, const StoreHeader &header);
+
+/**
+ * On-disk layout of a recipe journal, updates appended next to a recipe file (see JournalMode).
+ *
+ * --------------------------------------------
+ * Layout:
+ * --------------------------------------------
+ * [JournalHeader] fixed size, see JOURNAL_HEADER_SIZE
+ * [Records]       back to back in update order, each a JOURNAL_RECORD_SIZE record header
+ *                 followed by "size" bytes of value data, no alignment
+ *
+ * A record checksum covers its header fields and its data.
+ * The journal ends at the first record that is cut short or fails its checksum (a torn append).
+ *
+ * All integers are stored little-endian regardless of the host.
+*/
+constexpr char JOURNAL_MAGIC[8] = {'R', 'C', 'P', 'J', 'O', 'U', 'R', 'N'};
+constexpr uint32_t JOURNAL_VERSION = 1;
+constexpr size_t JOURNAL_HEADER_SIZE = 16;
+constexpr size_t JOURNAL_RECORD_SIZE = 24;
+
+/**
+ * Journal record header, one per update.
+ * "hash" is the id hash of the variable, see "hash_id".
+*/
+struct JournalRecord {
+    uint64_t hash;
+    uint64_t size;
+    uint32_t checksum;
+};
+
+void encode_journal_header(char *buffer);
+bool decode_journal_header(const char *buffer, size_t size);
+uint32_t journal_checksum(const JournalRecord &record, const char *data);
+void encode_journal_record(const JournalRecord &record, char *buffer);
+bool decode_journal_record(const char *buffer, size_t size, JournalRecord &record);
+
+/**
+ * Layout of a shared memory recipe segment, one v2 image shared by the processes of a host (see SharedRecipe).
+ *
+ * --------------------------------------------
+ * Layout:
+ * --------------------------------------------
+ * [SharedHeader] fixed size, see SHARED_HEADER_SIZE
+ *                [magic]         8 bytes, SHARED_MAGIC
+ *                [version]       4 bytes, then 4 bytes reserved
+ *                [slot capacity] 8 bytes at SHARED_CAPACITY_OFFSET
+ *                [begin]         8 bytes at SHARED_BEGIN_OFFSET, generation of the image being written
+ *                [generation]    8 bytes at SHARED_GENERATION_OFFSET, generation of the published image, 0 if none
+ *                [image sizes]   8 bytes per slot at SHARED_SIZE_OFFSET
+ * [Slots]        SHARED_SLOT_COUNT slots of "slot capacity" bytes, each starting at a multiple of DATA_ALIGNMENT.
+ *                Generation g is the v2 image in slot g % SHARED_SLOT_COUNT.
+ *
+ * The segment never leaves the host, integers are in host byte order and begin and generation are accessed atomically.
+*/
+constexpr char SHARED_MAGIC[8] = {'R', 'C', 'P', 'S', 'H', 'A', 'R', 'E'};
+constexpr uint32_t SHARED_VERSION = 1;
+constexpr size_t SHARED_HEADER_SIZE = 64;
+constexpr size_t SHARED_SLOT_COUNT = 2;
+constexpr size_t SHARED_CAPACITY_OFFSET = 16;
+constexpr size_t SHARED_BEGIN_OFFSET = 24;
+constexpr size_t SHARED_GENERATION_OFFSET = 32;
+constexpr size_t SHARED_SIZE_OFFSET = 40;
+
+/**
+ * On-disk layout of a recipe history, versions of a recipe appended next to the recipe file (see "Recipe::save_version").
+ *
+ * --------------------------------------------
+ * Layout:
+ * --------------------------------------------
+ * [HistoryHeader] fixed size, see HISTORY_HEADER_SIZE
+ * [Records]       back to back in append order, each a HISTORY_RECORD_SIZE record header
+ *                 followed by "size" bytes of record data, no alignment:
+ *                 HISTORY_KIND_BLOB     one stored value, shared by every version storing the same bytes
+ *                 HISTORY_KIND_VERSION  a VersionHeader of HISTORY_VERSION_HEADER_SIZE bytes,
+ *                                       then "entry_count" entries of HISTORY_ENTRY_SIZE bytes, each followed by its id
+ *
+ * A version lists the entries that changed since its parent and, flagged HISTORY_ENTRY_REMOVED, those removed since.
+ * A version flagged HISTORY_SNAPSHOT lists every entry and ends the chain of parents.
+ * "blob" is the file offset of the data of the blob record holding the value, blobs precede the versions using them.
+ * The record header checksum covers the header fields, the record "checksum" the record data.
+ * The history ends at the first record that is cut short or fails its header checksum (a torn append).
+ *
+ * All integers are stored little-endian regardless of the host.
+*/
+constexpr char HISTORY_MAGIC[8] = {'R', 'C', 'P', 'H', 'I', 'S', 'T', 'O'};
+constexpr uint32_t HISTORY_VERSION = 1;
+constexpr size_t HISTORY_HEADER_SIZE = 16;
+constexpr size_t HISTORY_RECORD_SIZE = 24;
+constexpr size_t HISTORY_VERSION_HEADER_SIZE = 32;
+constexpr size_t HISTORY_ENTRY_SIZE = 32;
+
+constexpr uint32_t HISTORY_KIND_BLOB = 1;
+constexpr uint32_t HISTORY_KIND_VERSION = 2;
+constexpr uint32_t HISTORY_SNAPSHOT = 1 << 0;
+constexpr uint8_t HISTORY_ENTRY_REMOVED = 1 << 0;
+
+/**
+ * History record header, one per blob or version
+*/
+struct HistoryRecord {
+    uint32_t kind;
+    uint32_t flags;
+    uint64_t size;
+    uint32_t checksum;
+};
+
+/**
+ * Header of a version record.
+ * "parent" is 0 for the first version, "time" the save time in nanoseconds since the system clock epoch.
+*/
+struct VersionHeader {
+    uint64_t version;
+    uint64_t parent;
+    int64_t time;
+    uint64_t entry_count;
+};
+
+/**
+ * Entry of a version record, one per changed or removed variable.
+ * "checksum" is the checksum of the value, "type" its type fingerprint, 0 if unknown.
+*/
+struct HistoryEntry {
+    uint64_t blob;
+    uint64_t size;
+    uint64_t type;
+    uint32_t checksum;
+    uint16_t id_length;
+    uint8_t flags;
+};
+
+void encode_history_header(char *buffer);
+bool decode_history_header(const char *buffer, size_t size);
+void encode_history_record(const HistoryRecord &record, char *buffer);
+bool decode_history_record(const char *buffer, size_t size, HistoryRecord &record);
+void encode_version_header(const VersionHeader &header, char *buffer);
+void decode_version_header(const char *buffer, VersionHeader &header);
+void encode_history_entry(const HistoryEntry &entry, char *buffer);
+void decode_history_entry(const char *buffer, HistoryEntry &entry);
+
+}
+}
+
+#endif
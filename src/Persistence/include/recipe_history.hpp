@@ -0,0 +1,76 @@
+#ifndef RCP_RECIPE_HISTORY_HPP
+#define RCP_RECIPE_HISTORY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "file_io.hpp"
+#include "mapped_file.hpp"
+#include "recipe_format.hpp"
+#include "recipe_options.hpp"
+#include "recipe_registry.hpp"
+
+namespace rcp {
+
+/**
+ * Append-only store of recipe versions (see the history layout in recipe_format.hpp).
+ * Used by the Recipe class to implement "save_version" and "load_version".
+ *
+ * Values are content addressed: a value is stored once as a blob, identified by its size and checksum
+ * and confirmed by comparing the bytes, and every version storing the same bytes refers to that blob.
+ * A version stores only the entries that differ from its parent,
+ * every "snapshot_interval"-th version in a chain stores all entries, so resolving a version reads a bounded chain.
+ *
+ * "open" scans the record headers once to index versions and blobs, the file is mapped for reading.
+ * A torn append at the end of the file is cut off by "open".
+*/
+class RecipeHistory {
+    public:
+        // id -> entry of the newest version in a chain listing the id, removed entries included
+        using Manifest = std::pmr::map<std::pmr::string, format::HistoryEntry, std::less<>>;
+
+        explicit RecipeHistory(std::pmr::memory_resource *resource=std::pmr::get_default_resource());
+
+        bool open(const std::string &path);
+        bool is_open() const;
+        uint64_t latest() const;
+        bool contains(uint64_t version) const;
+        std::vector<VersionInfo> versions() const;
+        bool resolve(uint64_t version, Manifest &manifest) const;
+        const char* blob(const format::HistoryEntry &entry) const;
+        uint64_t append(RecipeRegistry &staged, uint64_t parent, size_t snapshot_interval, bool sync);
+    private:
+        struct Version {
+            uint64_t offset;
+            uint64_t size;
+            uint64_t parent;
+            int64_t time;
+            uint64_t entry_count;
+            uint32_t depth;
+            bool snapshot;
+        };
+
+        std::pmr::memory_resource *_resource;
+        std::string _path;
+        File _file;
+        MappedFile _map;
+        uint64_t _end;
+        std::pmr::map<uint64_t, Version> _versions;
+        std::pmr::unordered_multimap<uint32_t, uint64_t> _blobs;
+
+        void _close();
+        uint64_t _scan(const char *data, size_t size);
+        uint64_t _find_blob(const char *data, uint64_t size, uint32_t checksum) const;
+        bool _same(const format::HistoryEntry &entry, const char *data) const;
+};
+
+}
+
+#endif
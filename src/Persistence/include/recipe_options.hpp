@@ -0,0 +1,153 @@
+#ifndef RCP_RECIPE_OPTIONS_HPP
+#define RCP_RECIPE_OPTIONS_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace rcp {
+
+/**
+ * Strategy used by "load_recipe" to read the recipe file.
+ * Stream: read the file through std::ifstream.
+ * Mapped: memory-map the file and copy values straight from the mapping into the application variables.
+*/
+enum class LoadMode {
+    Stream,
+    Mapped
+};
+
+/**
+ * Recipe file format written by "save_recipe".
+ * V1: sequential records, must be read from start to finish. The default, readable by every version of the library.
+ * V2: indexed, a header table of contents locates each variable (see recipe_format.hpp).
+*/
+enum class FileFormat {
+    V1,
+    V2
+};
+
+/**
+ * Change detection used by "save_recipe".
+ * None: every save rewrites the whole recipe file.
+ * Explicit: only variables flagged through "mark_dirty" are rewritten.
+ * Snapshot: variables whose bytes differ from the previous save are rewritten, in addition to flagged variables.
+ *           Keeps a copy of every variable.
+*/
+enum class DirtyTracking {
+    None,
+    Explicit,
+    Snapshot
+};
+
+/**
+ * Strategy used by "save_recipe" to replace the recipe file.
+ * Direct: truncate and rewrite the recipe file.
+ * Atomic: write a temporary file next to the recipe file and rename it over the recipe file.
+*/
+enum class SaveMode {
+    Direct,
+    Atomic
+};
+
+/**
+ * Saves after which "save_recipe" flushes the recipe file to the storage device (fsync).
+ * Never: leave flushing to the operating system.
+ * EverySave: flush on every save.
+ * EveryN: flush on every N-th save.
+ * Interval: flush on the first save after at least T milliseconds since the previous flush.
+*/
+enum class SyncMode {
+    Never,
+    EverySave,
+    EveryN,
+    Interval
+};
+
+/**
+ * Compression of V2 recipe entries.
+ * None: store raw bytes.
+ * LZ4: fast compression in the LZ4 block format.
+ * Deflate: better compression ratio through zlib, only available if the library was built with zlib.
+*/
+enum class Codec {
+    None,
+    LZ4,
+    Deflate
+};
+
+/**
+ * Thread safety of a Recipe.
+ * None: a recipe is used from one thread at a time.
+ * Concurrent: variables may be added, removed, loaded and saved from different threads.
+ *             Saves copy the variables from a registry snapshot, reading variables registered with a SeqLock
+ *             consistently while the application keeps writing them (see seqlock.hpp).
+*/
+enum class Concurrency {
+    None,
+    Concurrent
+};
+
+/**
+ * Persistence of single variable updates, see "Recipe::journal_variable".
+ * None: updates are only persisted by saving the recipe.
+ * Append: updates are appended to a journal next to the recipe file and replayed on load.
+ *         The journal is compacted into the recipe file by every save.
+*/
+enum class JournalMode {
+    None,
+    Append
+};
+
+/**
+ * Settings for the parallel "load_recipe" overload.
+ * threads: number of threads including the caller, 0 selects std::thread::hardware_concurrency.
+ * chunk_size: entries larger than this are split into chunks of this many bytes, copied by different threads.
+*/
+struct ParallelPolicy {
+    unsigned threads = 0;
+    size_t chunk_size = 4 << 20;
+};
+
+/**
+ * Outcome of the last "load_recipe", see "Recipe::get_load_error".
+ * Ok: the recipe file was loaded.
+ * OpenFailed: the recipe file could not be opened or mapped.
+ * Truncated: a length or record reaches beyond the end of the file.
+ * Corrupt: a length exceeds its limit, or the index or a value fails its check.
+ * Rejected: the file is intact, but a converter, stream reader or decompression failed.
+*/
+enum class LoadStatus {
+    Ok,
+    OpenFailed,
+    Truncated,
+    Corrupt,
+    Rejected
+};
+
+/**
+ * Why the last load failed.
+ * "offset" is the file offset of the record or field that failed.
+*/
+struct LoadError {
+    LoadStatus status = LoadStatus::Ok;
+    uint64_t offset = 0;
+};
+
+/**
+ * A saved version of a recipe, see "Recipe::get_versions".
+ * "parent" is the version it was saved on top of, 0 for the first version.
+ * "entries" counts the entries stored in the version, the changed and removed variables unless "snapshot" is set,
+ * in which case the version lists every variable and is resolved without its parents.
+*/
+struct VersionInfo {
+    uint64_t version = 0;
+    uint64_t parent = 0;
+    std::chrono::system_clock::time_point time;
+    uint64_t entries = 0;
+    bool snapshot = false;
+};
+
+}
+
+#endif
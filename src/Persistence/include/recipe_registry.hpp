@@ -0,0 +1,127 @@
+#ifndef RCP_RECIPE_REGISTRY_HPP
+#define RCP_RECIPE_REGISTRY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+namespace rcp {
+
+class SeqLock;
+
+/**
+ * Receives the bytes of a streamed value, see "StreamWriter"
+*/
+using StreamSink = std::function<bool(const char *data, size_t size)>;
+
+/**
+ * Produces a streamed value on save by passing it to the sink in pieces of any size.
+ * Returns false to abort the save.
+*/
+using StreamWriter = std::function<bool(const StreamSink &sink)>;
+
+/**
+ * Consumes a stored value on load, called once per chunk in file order.
+ * "offset" is the position of the chunk within the value, "total" the size of the whole value.
+ * Returns false to abort the load.
+*/
+using StreamReader = std::function<bool(const char *data, size_t size, uint64_t offset, uint64_t total)>;
+
+/**
+ * Callbacks of a streamed variable.
+ * Used by the Recipe class
+*/
+struct RecipeStream {
+    StreamReader reader;
+    StreamWriter writer;
+};
+
+/**
+ * A container for application variables.
+ * Used by the Recipe class
+ *
+ * The id is stored in the string arena of the owning RecipeRegistry, see "RecipeRegistry::id".
+ * The type is the fingerprint of a typed variable, see "type_fingerprint", or 0 for untyped variables.
+ * Streamed variables have no pointer and size, see "RecipeRegistry::stream".
+ * The codec is the Codec selected for the variable, or -1 for the recipe default.
+ * The lock guards writes to the variable, or is nullptr for unguarded variables.
+*/
+struct RecipeItem {
+    char *ptr;
+    size_t size;
+    SeqLock *lock;
+    uint64_t hash;
+    uint64_t type;
+    uint32_t id_offset;
+    uint32_t id_length;
+    uint64_t offset;
+    uint64_t toc_index;
+    uint64_t shadow_offset;
+    uint32_t stream;
+    int8_t codec;
+    bool dirty;
+};
+
+/**
+ * Flat registry of recipe variables.
+ * Used by the Recipe class
+ *
+ * Items are stored by value in one contiguous array, ids in one contiguous string arena.
+ * Lookup goes through an open addressing (linear probing) index holding item positions and hash tags.
+ * Iteration touches only the item array.
+ *
+ * Removing an item moves the last item into its place.
+ * Pointers and iterators into the registry are invalidated by "insert", "erase", "reserve" and "clear".
+ *
+ * All storage comes from the memory resource given to the constructor, copies share the resource of their source.
+ * Assigning a registry keeps the resource of the assigned registry.
+*/
+class RecipeRegistry {
+    public:
+        explicit RecipeRegistry(std::pmr::memory_resource *resource=std::pmr::get_default_resource());
+        RecipeRegistry(const RecipeRegistry &other);
+        RecipeRegistry& operator=(const RecipeRegistry &other) = default;
+
+        RecipeItem* insert(std::string_view id, char *ptr, size_t size, uint64_t type=0);
+        RecipeItem* insert_stream(std::string_view id, StreamReader reader, StreamWriter writer);
+        bool erase(std::string_view id);
+        RecipeItem* find(std::string_view id);
+        RecipeItem* find(std::string_view id, uint64_t hash);
+        RecipeItem* find_hash(uint64_t hash);
+        void reserve(size_t count, size_t id_bytes=0);
+        void clear();
+
+        std::string_view id(const RecipeItem &item) const;
+        const RecipeStream* stream(const RecipeItem &item) const;
+        size_t stream_count() const;
+        size_t size() const;
+        bool empty() const;
+        std::pmr::memory_resource* resource() const;
+
+        RecipeItem* begin();
+        RecipeItem* end();
+        const RecipeItem* begin() const;
+        const RecipeItem* end() const;
+    private:
+        struct Slot {
+            uint32_t index;
+            uint32_t tag;
+        };
+
+        std::pmr::vector<RecipeItem> _items;
+        std::pmr::vector<Slot> _slots;
+        std::pmr::vector<char> _ids;
+        std::pmr::vector<RecipeStream> _streams;
+        size_t _garbage;
+
+        size_t _probe(std::string_view id, uint64_t hash) const;
+        void _rehash(size_t capacity);
+        void _compact();
+};
+
+}
+
+#endif
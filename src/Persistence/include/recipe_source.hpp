@@ -0,0 +1,145 @@
+#ifndef RCP_RECIPE_SOURCE_HPP
+#define RCP_RECIPE_SOURCE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "file_io.hpp"
+#include "mapped_file.hpp"
+
+namespace rcp {
+
+/**
+ * One byte range of a read, see "RecipeSource::read"
+*/
+struct ReadRange {
+    uint64_t offset;
+    uint64_t size;
+    char *destination;
+};
+
+/**
+ * Storage a recipe file is loaded from, see "Recipe::set_source".
+ *
+ * --------------------------------------------
+ * Usage description:
+ * --------------------------------------------
+ * Without a source a Recipe reads the local file at "get_path".
+ * Set a source to read the recipe file from elsewhere, for instance an object store over HTTP.
+ * "load_recipe" then reads the header and index of a V2 file first
+ * and fetches only the data blocks of registered variables, through one "read" call per batch of ranges.
+ *
+ * --------------------------------------------
+ * Notes:
+ * --------------------------------------------
+ * Implementations may serve the ranges of one "read" call in any order and in parallel.
+ * Sources are read-only, "save_recipe" keeps writing the local file at "get_path".
+*/
+class RecipeSource {
+    public:
+        virtual ~RecipeSource() = default;
+
+        /**
+         * Get the size of the recipe file
+         *
+         * @param size receives the size in number of bytes
+         *
+         * @return false if the file is missing or the source unreachable
+        */
+        virtual bool size(uint64_t &size) = 0;
+
+        /**
+         * Read byte ranges of the recipe file, ranges do not overlap
+         *
+         * @param ranges the ranges, each read into its destination
+         * @param count number of ranges
+         *
+         * @return true if every range was read completely
+        */
+        virtual bool read(const ReadRange *ranges, size_t count) = 0;
+
+        /**
+         * Get the whole recipe file, if the source holds it in memory
+         *
+         * @return the file contents valid until the next call, nullptr to read ranges through "read"
+        */
+        virtual const char* data() {return nullptr;}
+
+        /**
+         * Get the largest gap between two ranges worth reading over to save a request
+         *
+         * @return the gap in number of bytes
+        */
+        virtual uint64_t gap() const {return 0;}
+};
+
+/**
+ * Local recipe file read through positioned reads
+*/
+class FileSource : public RecipeSource {
+    public:
+        FileSource(std::string path);
+
+        bool size(uint64_t &size) override;
+        bool read(const ReadRange *ranges, size_t count) override;
+    private:
+        std::string _path;
+        File _file;
+
+        bool _open();
+};
+
+/**
+ * Local recipe file read through a memory mapping, the Recipe copies values straight from the mapping
+*/
+class MappedSource : public RecipeSource {
+    public:
+        MappedSource(std::string path);
+
+        bool size(uint64_t &size) override;
+        bool read(const ReadRange *ranges, size_t count) override;
+        const char* data() override;
+    private:
+        std::string _path;
+        MappedFile _map;
+};
+
+/**
+ * Recipe file on an HTTP server or object store, read through range requests, for instance
+ * a presigned S3 URL: HttpSource source("https://bucket.s3.amazonaws.com/motor.rcp?X-Amz-Signature=...");
+ *
+ * The ranges of one "read" are requested in parallel over at most "connections" connections,
+ * multiplexed over HTTP/2 where the server supports it.
+ * Ranges closer than "gap" bytes are merged into one request by the Recipe.
+ * Only available if the library was built with libcurl.
+*/
+class HttpSource : public RecipeSource {
+    public:
+        HttpSource(std::string url, unsigned connections=8);
+        ~HttpSource();
+        HttpSource(const HttpSource&) = delete;
+        HttpSource& operator=(const HttpSource&) = delete;
+
+        void add_header(std::string header);
+        void set_timeout(long milliseconds);
+        void set_gap(uint64_t gap);
+
+        bool size(uint64_t &size) override;
+        bool read(const ReadRange *ranges, size_t count) override;
+        uint64_t gap() const override;
+    private:
+        std::string _url;
+        unsigned _connections;
+        std::vector<std::string> _headers;
+        long _timeout;
+        uint64_t _gap;
+        void *_multi;
+
+        bool _perform(const ReadRange *ranges, size_t count, uint64_t *total);
+};
+
+}
+
+#endif
@@ -0,0 +1,157 @@
+#ifndef RCP_RECIPE_STATS_HPP
+#define RCP_RECIPE_STATS_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace rcp {
+
+/**
+ * Recipe I/O statistics.
+ *
+ * --------------------------------------------
+ * Usage description:
+ * --------------------------------------------
+ * Register an observer with "Recipe::set_observer".
+ * Every load and save of the recipe then reports one RecipeStats to "RecipeObserver::record",
+ * on the thread that ran the operation, after the operation finished.
+ * RecipeMetrics is an observer that sums the statistics per recipe and operation and exports them,
+ * as Prometheus text (see "RecipeMetrics::prometheus") or through a callback per value for other systems,
+ * for instance OpenTelemetry counters (see "RecipeMetrics::export_metrics").
+ *
+ * --------------------------------------------
+ * Notes:
+ * --------------------------------------------
+ * Statistics are collected if the library is built with RCP_STATS (CMake option RCP_STATS, default ON).
+ * Without it, observers are never called and the load and save paths carry no instrumentation at all.
+ * With it, a recipe without observer pays one thread-local pointer check per instrumented step.
+ * Asynchronous saves report copying the snapshot, the write on the background thread is not reported.
+*/
+
+/**
+ * The recipe operation a RecipeStats describes
+*/
+enum class RecipeOperation {
+    Load,
+    LoadVariable,
+    Reload,
+    Save,
+    SaveAsync,
+    Journal
+};
+
+/**
+ * Phases of a recipe operation.
+ * Open: opening or mapping the file.
+ * Parse: reading and checking the header, table of contents and checksums of the index.
+ * Copy: copying, decompressing or encoding values, including writes through the write buffer.
+ * Flush: the final write of the index, syncing and replacing the file.
+*/
+enum class RecipePhase {
+    Open,
+    Parse,
+    Copy,
+    Flush
+};
+
+constexpr size_t RECIPE_PHASE_COUNT = 4;
+
+/**
+ * Statistics of one recipe operation.
+ * "entries" counts the values assigned or written,
+ * "skipped_unknown" stored values without a registered variable,
+ * "skipped_mismatch" stored values whose size or type fingerprint did not match the variable and were not converted.
+ * "allocations" counts the buffers the library allocated for the operation,
+ * for instance for converted, compressed or staged values and the file index.
+*/
+struct RecipeStats {
+    RecipeOperation operation = RecipeOperation::Load;
+    bool success = false;
+    uint64_t bytes_read = 0;
+    uint64_t bytes_written = 0;
+    uint64_t entries = 0;
+    uint64_t skipped_unknown = 0;
+    uint64_t skipped_mismatch = 0;
+    uint64_t allocations = 0;
+    std::chrono::nanoseconds durations[RECIPE_PHASE_COUNT] = {};
+    std::chrono::nanoseconds total = std::chrono::nanoseconds(0);
+
+    std::chrono::nanoseconds duration(RecipePhase phase) const;
+};
+
+/**
+ * Receives the statistics of recipe operations, see "Recipe::set_observer"
+*/
+class RecipeObserver {
+    public:
+        virtual ~RecipeObserver() = default;
+
+        /**
+         * Called once per finished operation
+         *
+         * @param recipe the name of the recipe
+         * @param stats the statistics of the operation
+        */
+        virtual void record(std::string_view recipe, const RecipeStats &stats) = 0;
+};
+
+/**
+ * Observer summing the statistics of the recipes it observes, per recipe name and operation.
+ * May observe several recipes used from different threads.
+*/
+class RecipeMetrics : public RecipeObserver {
+    public:
+        /**
+         * Receives one exported value.
+         * "name" is the metric name without prefix, for instance "bytes_read" or "duration_seconds",
+         * "recipe" the recipe label, "operation" the operation label, "phase" the phase label of durations or empty.
+        */
+        using Exporter = std::function<void(std::string_view name, std::string_view recipe, std::string_view operation,
+                                            std::string_view phase, double value)>;
+
+        RecipeMetrics();
+
+        void record(std::string_view recipe, const RecipeStats &stats) override;
+        std::vector<std::string> recipes() const;
+        RecipeStats get_totals(RecipeOperation operation) const;
+        RecipeStats get_totals(std::string_view recipe, RecipeOperation operation) const;
+        uint64_t get_count(RecipeOperation operation) const;
+        uint64_t get_count(std::string_view recipe, RecipeOperation operation) const;
+        uint64_t get_failures(RecipeOperation operation) const;
+        uint64_t get_failures(std::string_view recipe, RecipeOperation operation) const;
+        void reset();
+
+        void export_metrics(const Exporter &exporter) const;
+        std::string prometheus(std::string_view prefix="rcp") const;
+    private:
+        static constexpr size_t OPERATION_COUNT = 6;
+
+        // Sums of one recipe
+        struct Totals {
+            RecipeStats stats[OPERATION_COUNT];
+            uint64_t counts[OPERATION_COUNT] = {};
+            uint64_t failures[OPERATION_COUNT] = {};
+
+            Totals();
+            void add(const Totals &other);
+        };
+
+        mutable std::mutex _mutex;
+        std::map<std::string, Totals, std::less<>> _recipes;
+
+        Totals _sum(std::string_view recipe, bool all) const;
+};
+
+const char* operation_name(RecipeOperation operation);
+const char* phase_name(RecipePhase phase);
+
+}
+
+#endif
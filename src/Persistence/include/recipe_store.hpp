@@ -0,0 +1,75 @@
+#ifndef RCP_RECIPE_STORE_HPP
+#define RCP_RECIPE_STORE_HPP
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "recipe.hpp"
+#include "recipe_options.hpp"
+
+namespace rcp {
+
+/**
+ * The RecipeStore class keeps many recipes in one file (see the store layout in recipe_format.hpp).
+ *
+ * --------------------------------------------
+ * Usage description:
+ * --------------------------------------------
+ * Provide the path of the store file in the constructor or by calling "set_path".
+ * Add recipes through the "add_recipe" method, they are identified by their name at the time they are added.
+ * The recipes do not need to be initialized, their own files are never touched by the store.
+ *
+ * Call the "init" method to enable the store.
+ * This creates the store file and its directory if they do not exist, once for all recipes.
+ *
+ * "load_recipes" opens and maps the store file once and loads every added recipe found in it.
+ * "load_recipe" loads a single recipe, the directory is binary searched.
+ * "save_recipes" rewrites the store with every added recipe, recipes that are no longer added are dropped.
+ * "save_recipe" rewrites a single recipe in place, or the whole store if the recipe might not fit its slot.
+ * Each recipe is stored as a V2 image with its own checksums, with the codec settings of the recipe.
+ * Optional: select how the store file is replaced by calling "set_save_mode" (default: SaveMode::Direct),
+ * with SaveMode::Atomic every save rewrites the whole store.
+ *
+ * --------------------------------------------
+ * Notes:
+ * --------------------------------------------
+ * A store is used from one thread at a time, recipes in Concurrency::Concurrent mode are saved from their snapshot.
+ * Recipes with streamed variables or compressed entries are saved by rewriting the store,
+ * as their image size is not known in advance.
+*/
+class RecipeStore {
+    public:
+        RecipeStore();
+        RecipeStore(std::string path);
+
+        bool init();
+        void stop();
+        bool add_recipe(Recipe&);
+        bool remove_recipe(std::string);
+        bool load_recipes();
+        bool load_recipe(std::string);
+        bool save_recipes();
+        bool save_recipe(std::string);
+
+        bool is_init();
+        std::string get_path();
+        void set_path(std::string);
+        SaveMode get_save_mode();
+        void set_save_mode(SaveMode);
+    protected:
+    private:
+        std::string _path;
+        std::map<std::string, Recipe*> _recipes;
+        bool _init;
+        SaveMode _save_mode;
+        std::vector<char> _index;
+        uint64_t _file_size;
+
+        void _forget();
+};
+
+}
+
+#endif
@@ -0,0 +1,137 @@
+#ifndef RCP_RECIPE_TYPE_HPP
+#define RCP_RECIPE_TYPE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace rcp {
+
+/**
+ * Compile-time type fingerprints for typed recipe variables.
+ *
+ * --------------------------------------------
+ * Usage description:
+ * --------------------------------------------
+ * "type_fingerprint<T>()" combines the size and alignment of T with an optional user version and field list.
+ * The fingerprint is stored with every typed variable in a V2 recipe file,
+ * "load_recipe" only copies a stored value if its fingerprint matches the registered variable.
+ *
+ * Optional: bump the version of a type when its meaning changes without changing its layout:
+ *     RCP_TYPE_VERSION(MyStruct, 2)
+ * Optional: describe the fields of a struct, so reordered or retyped fields of the same total size are detected:
+ *     RCP_DESCRIBE(MyStruct, RCP_FIELD(a), RCP_FIELD(b))
+ * Both macros must be used at global namespace scope.
+*/
+
+/**
+ * Describes one field of a struct, see RCP_FIELD
+*/
+struct FieldDescriptor {
+    const char *name;
+    size_t offset;
+    size_t size;
+};
+
+/**
+ * Field list of a type, specialized by RCP_DESCRIBE
+*/
+template <typename T>
+struct TypeDescription {
+    static constexpr bool described = false;
+};
+
+/**
+ * User version of a type, specialized by RCP_TYPE_VERSION
+*/
+template <typename T>
+struct TypeVersion {
+    static constexpr uint32_t value = 0;
+};
+
+namespace detail {
+
+constexpr uint64_t FNV_OFFSET = 14695981039346656037ULL;
+constexpr uint64_t FNV_PRIME = 1099511628211ULL;
+
+constexpr uint64_t mix(uint64_t hash, uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        hash ^= (value >> (8 * i)) & 0xFF;
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+constexpr uint64_t mix(uint64_t hash, const char *text) {
+    for (; *text != '\0'; text++) {
+        hash ^= static_cast<unsigned char>(*text);
+        hash *= FNV_PRIME;
+    }
+    return mix(hash, static_cast<uint64_t>(0));
+}
+
+// Distinguish types of the same size, for instance int32_t, uint32_t and float
+template <typename T>
+constexpr uint64_t kind_of() {
+    if constexpr (std::is_same<T, bool>::value) {return 1;}
+    else if constexpr (std::is_integral<T>::value) {return std::is_signed<T>::value ? 2 : 3;}
+    else if constexpr (std::is_floating_point<T>::value) {return 4;}
+    else if constexpr (std::is_enum<T>::value) {return 5;}
+    else if constexpr (std::is_pointer<T>::value) {return 6;}
+    else if constexpr (std::is_array<T>::value) {return 7;}
+    else {return 8;}
+}
+
+}
+
+/**
+ * Get the fingerprint of a trivially copyable type.
+ * Arrays include the fingerprint of their element type.
+ * Never 0, which marks untyped variables in the recipe file.
+ *
+ * @tparam T the variable type
+ *
+ * @return the type fingerprint
+*/
+template <typename T>
+constexpr uint64_t type_fingerprint() {
+    static_assert(std::is_trivially_copyable<T>::value, "Recipe variables must be trivially copyable");
+    uint64_t hash = detail::FNV_OFFSET;
+    hash = detail::mix(hash, sizeof(T));
+    hash = detail::mix(hash, alignof(T));
+    hash = detail::mix(hash, TypeVersion<T>::value);
+    hash = detail::mix(hash, detail::kind_of<T>());
+    if constexpr (std::is_array<T>::value) {
+        hash = detail::mix(hash, type_fingerprint<std::remove_extent_t<T>>());
+    }
+    if constexpr (TypeDescription<T>::described) {
+        for (const FieldDescriptor &field: TypeDescription<T>::fields) {
+            hash = detail::mix(hash, field.name);
+            hash = detail::mix(hash, field.offset);
+            hash = detail::mix(hash, field.size);
+        }
+    }
+    return hash == 0 ? 1 : hash;
+}
+
+}
+
+#define RCP_FIELD(field) ::rcp::FieldDescriptor{#field, offsetof(described_type, field), sizeof(described_type::field)}
+
+#define RCP_DESCRIBE(type, ...)                                                     \
+    namespace rcp {                                                                 \
+    template <> struct TypeDescription<type> {                                      \
+        using described_type = type;                                                \
+        static constexpr bool described = true;                                     \
+        static constexpr FieldDescriptor fields[] = {__VA_ARGS__};                  \
+    };                                                                              \
+    }
+
+#define RCP_TYPE_VERSION(type, version)                                             \
+    namespace rcp {                                                                 \
+    template <> struct TypeVersion<type> {                                          \
+        static constexpr uint32_t value = version;                                  \
+    };                                                                              \
+    }
+
+#endif
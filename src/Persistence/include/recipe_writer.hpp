@@ -0,0 +1,92 @@
+#ifndef RCP_RECIPE_WRITER_HPP
+#define RCP_RECIPE_WRITER_HPP
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory_resource>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "recipe_options.hpp"
+#include "recipe_registry.hpp"
+
+namespace rcp {
+
+class File;
+
+/**
+ * Where and how a recipe file is written.
+ * Used by the Recipe class
+ *
+ * V2 entries of at least "compression_threshold" bytes are compressed with "codec", unless their item selects a codec.
+ * The buffers of the write are allocated from "resource".
+*/
+struct SaveTarget {
+    std::pmr::string path;
+    FileFormat format = FileFormat::V2;
+    SaveMode mode = SaveMode::Direct;
+    bool sync = false;
+    Codec codec = Codec::None;
+    size_t compression_threshold = 0;
+    std::pmr::memory_resource *resource = std::pmr::get_default_resource();
+};
+
+bool write_recipe(RecipeRegistry &registry, const SaveTarget &target, std::pmr::vector<char> &index);
+bool write_image(File &file, uint64_t offset, RecipeRegistry &registry, const SaveTarget &target, std::pmr::vector<char> &index);
+uint64_t image_bound(const RecipeRegistry &registry);
+bool stage_values(const RecipeRegistry &registry, RecipeRegistry &staged, std::pmr::vector<char> &data);
+
+/**
+ * Background writer for recipe files.
+ * Used by the Recipe class to implement "save_recipe_async".
+ *
+ * "submit" copies the registered variables into a staging area on the calling thread,
+ * the staging area is serialized and written on a dedicated writer thread.
+ * Two staging areas are used: one being written, one waiting.
+ * A submit while a snapshot is still waiting replaces that snapshot, and both callers receive the result of the one write.
+ * Streamed variables are collected into the staging area by calling their writer on the calling thread,
+ * variables with a SeqLock are copied under their lock (see "stage_values").
+ *
+ * The writer thread is started by the first "submit" and stopped by the destructor, after all pending writes.
+ * The optional written callback receives the index of every V2 file written, on the writer thread.
+*/
+class AsyncWriter {
+    public:
+        using WrittenCallback = std::function<void(const std::pmr::vector<char> &index)>;
+
+        AsyncWriter(WrittenCallback written=nullptr);
+        ~AsyncWriter();
+        AsyncWriter(const AsyncWriter&) = delete;
+        AsyncWriter& operator=(const AsyncWriter&) = delete;
+
+        std::shared_future<bool> submit(const RecipeRegistry &registry, const SaveTarget &target);
+        void wait();
+    private:
+        struct Staging {
+            RecipeRegistry registry;
+            std::pmr::vector<char> data;
+            bool valid;
+            SaveTarget target;
+            std::promise<bool> promise;
+            std::shared_future<bool> future;
+        };
+
+        Staging _buffers[2];
+        Staging *_pending;
+        Staging *_active;
+        std::pmr::vector<char> _index;
+        std::mutex _mutex;
+        std::condition_variable _condition;
+        std::thread _thread;
+        bool _stop;
+        WrittenCallback _written;
+
+        void _run();
+};
+
+}
+
+#endif
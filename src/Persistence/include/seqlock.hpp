@@ -0,0 +1,130 @@
+#ifndef RCP_SEQLOCK_HPP
+#define RCP_SEQLOCK_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+namespace rcp {
+
+/**
+ * Sequence lock guarding one recipe variable.
+ * Used by the Recipe class in Concurrency::Concurrent mode.
+ *
+ * --------------------------------------------
+ * Usage description:
+ * --------------------------------------------
+ * The application wraps every write to the variable in "write_begin" / "write_end" (or a SeqLockGuard).
+ * Writers exclude each other, readers never block writers:
+ * a save copies the variable and retries the copy if a write overlapped it.
+ * Writes should be short, a reader spins while a write is in progress.
+*/
+class SeqLock {
+    public:
+        SeqLock(): _sequence(0) {}
+        SeqLock(const SeqLock&) = delete;
+        SeqLock& operator=(const SeqLock&) = delete;
+
+        void write_begin() {
+            uint32_t sequence = this->_sequence.load(std::memory_order_relaxed);
+            while ((sequence & 1) || !this->_sequence.compare_exchange_weak(sequence, sequence + 1, std::memory_order_acquire)) {
+                if (sequence & 1) {
+                    std::this_thread::yield();
+                    sequence = this->_sequence.load(std::memory_order_relaxed);
+                }
+            }
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+
+        void write_end() {
+            this->_sequence.fetch_add(1, std::memory_order_release);
+        }
+
+        uint32_t read_begin() const {
+            uint32_t sequence = this->_sequence.load(std::memory_order_acquire);
+            while (sequence & 1) {
+                std::this_thread::yield();
+                sequence = this->_sequence.load(std::memory_order_acquire);
+            }
+            return sequence;
+        }
+
+        bool read_retry(uint32_t sequence) const {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return this->_sequence.load(std::memory_order_relaxed) != sequence;
+        }
+
+        /**
+         * Copy a guarded value, retrying until no write overlapped the copy
+         *
+         * @param destination receives the value
+         * @param source the guarded value
+         * @param size the value size
+        */
+        void read(void *destination, const void *source, size_t size) const {
+            uint32_t sequence;
+            do {
+                sequence = this->read_begin();
+                std::memcpy(destination, source, size);
+            } while (this->read_retry(sequence));
+        }
+    private:
+        std::atomic<uint32_t> _sequence;
+};
+
+/**
+ * Holds the write side of a SeqLock for its lifetime, does nothing for a nullptr lock
+*/
+class SeqLockGuard {
+    public:
+        explicit SeqLockGuard(SeqLock *lock): _lock(lock) {
+            if (this->_lock != nullptr) {this->_lock->write_begin();}
+        }
+        ~SeqLockGuard() {
+            if (this->_lock != nullptr) {this->_lock->write_end();}
+        }
+        SeqLockGuard(const SeqLockGuard&) = delete;
+        SeqLockGuard& operator=(const SeqLockGuard&) = delete;
+    private:
+        SeqLock *_lock;
+};
+
+/**
+ * A trivially copyable value with its own SeqLock, see "Recipe::add_variable".
+*/
+template <typename T>
+class Guarded {
+    static_assert(std::is_trivially_copyable<T>::value, "Guarded values must be trivially copyable");
+    public:
+        Guarded(): _value() {}
+        explicit Guarded(const T &value): _value(value) {}
+
+        T load() const {
+            T value;
+            this->_lock.read(&value, &this->_value, sizeof(T));
+            return value;
+        }
+
+        void store(const T &value) {
+            SeqLockGuard guard(&this->_lock);
+            this->_value = value;
+        }
+
+        template <typename Function>
+        void update(Function function) {
+            SeqLockGuard guard(&this->_lock);
+            function(this->_value);
+        }
+
+        T* data() {return &this->_value;}
+        SeqLock& lock() {return this->_lock;}
+    private:
+        T _value;
+        mutable SeqLock _lock;
+};
+
+}
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef RCP_SHARED_RECIPE_HPP
+#define RCP_SHARED_RECIPE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "file_io.hpp"
+#include "recipe.hpp"
+#include "recipe_type.hpp"
+
+namespace rcp {
+
+/**
+ * A stored value inside a shared segment, see "SharedRecipe::find".
+ * "data" points into the segment and stays valid as long as "SharedRecipe::valid" returns true.
+*/
+struct SharedView {
+    const char *data = nullptr;
+    size_t size = 0;
+    uint64_t type = 0;
+    uint64_t generation = 0;
+};
+
+/**
+ * The SharedRecipe class shares a recipe between the processes of a host through a POSIX shared memory segment
+ * (see the shared segment layout in recipe_format.hpp).
+ *
+ * --------------------------------------------
+ * Usage description:
+ * --------------------------------------------
+ * Provide the name of the segment in the constructor or by calling "set_name", for instance "/motor_recipe".
+ *
+ * One process publishes: it calls "create" with the capacity of one image, loads its recipe as usual
+ * and calls "publish" to copy the recipe into the segment as a V2 image.
+ * Every "publish" increments the generation of the segment.
+ *
+ * The other processes call "attach" to map the segment read-only.
+ * "find" looks an id up in the published image and returns a view into the segment, without copying the value.
+ * "read" copies a value, "load" copies every value into the variables of a Recipe, both consistent with one generation.
+ * "generation" is a single atomic load, readers poll it to detect new images without any system call.
+ *
+ * --------------------------------------------
+ * Notes:
+ * --------------------------------------------
+ * The segment holds two image slots. "publish" writes the slot not holding the published image,
+ * so a view of generation g stays intact while generation g + 1 is written
+ * and "valid" only fails once generation g + 2 starts. Check "valid" after using a view.
+ * Values are found by binary search over the table of contents in the segment, no index is built per process.
+ * Compressed entries cannot be viewed in place, "find" skips them and "load" decompresses them,
+ * publish recipes with Codec::None to view every value.
+ * Only one process may publish to a segment. The segment outlives its processes until "remove" is called.
+ * Only available on POSIX systems.
+*/
+class SharedRecipe {
+    public:
+        SharedRecipe();
+        SharedRecipe(std::string name);
+        ~SharedRecipe();
+        SharedRecipe(const SharedRecipe&) = delete;
+        SharedRecipe& operator=(const SharedRecipe&) = delete;
+
+        bool create(uint64_t capacity);
+        bool attach();
+        void detach();
+        bool remove();
+
+        bool publish(Recipe &recipe);
+
+        uint64_t generation() const;
+        SharedView find(std::string_view id) const;
+        bool valid(const SharedView &view) const;
+        template <typename T>
+        bool read(std::string_view id, T &value) const;
+        bool load(Recipe &recipe) const;
+
+        bool is_attached() const;
+        bool is_publisher() const;
+        uint64_t get_capacity() const;
+        const std::string& get_name() const;
+        void set_name(std::string);
+    private:
+        std::string _name;
+        File _file;
+        char *_data;
+        size_t _size;
+        bool _publisher;
+
+        SharedView _find(uint64_t generation, std::string_view id) const;
+        uint64_t _begin() const;
+};
+
+/**
+ * Copy a stored value consistently with one generation.
+ * The value is only copied if its size and, for typed values, its type fingerprint match T (see recipe_type.hpp).
+ *
+ * @tparam T a trivially copyable type
+ *
+ * @param id the identifier of the value
+ * @param value receives the value
+ *
+ * @return true if the value was copied
+*/
+template <typename T>
+bool SharedRecipe::read(std::string_view id, T &value) const {
+    static_assert(std::is_trivially_copyable<T>::value, "Shared values are copied bytewise");
+    while (true) {
+        SharedView view = this->find(id);
+        if (view.data == nullptr || view.size != sizeof(T)) {return false;}
+        if (view.type != 0 && view.type != type_fingerprint<T>()) {return false;}
+        T copy;
+        std::memcpy(&copy, view.data, sizeof(T));
+        if (this->valid(view)) {
+            value = copy;
+            return true;
+        }
+    }
+}
+
+}
+
+#endif
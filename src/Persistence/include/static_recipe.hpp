@@ -0,0 +1,527 @@
+#ifndef RCP_STATIC_RECIPE_HPP
+#define RCP_STATIC_RECIPE_HPP
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "recipe_format.hpp"
+#include "recipe_options.hpp"
+#include "recipe_type.hpp"
+
+namespace rcp {
+
+/**
+ * One variable of a static schema, see RCP_SCHEMA_FIELD
+*/
+struct SchemaField {
+    const char *id;
+    size_t offset;
+    size_t size;
+    uint64_t type;
+};
+
+/**
+ * Field list of a schema struct, specialized by RCP_SCHEMA
+*/
+template <typename S>
+struct Schema;
+
+namespace detail {
+
+/**
+ * A schema field in TOC order, with its position in the V2 file
+*/
+struct StaticEntry {
+    size_t field = 0;
+    uint64_t hash = 0;
+    uint64_t offset = 0;
+    uint32_t id_offset = 0;
+    uint16_t id_length = 0;
+};
+
+/**
+ * File layout of a schema, see "static_plan"
+*/
+template <size_t N>
+struct StaticPlan {
+    StaticEntry entries[N] = {};
+    uint64_t strings_offset = 0;
+    uint64_t strings_size = 0;
+    uint64_t data_offset = 0;
+    uint64_t file_size = 0;
+    bool valid = true;
+};
+
+/**
+ * Perfect hash of the ids of a schema, see "static_table"
+ * "slots" holds the field position plus one, 0 marks an empty slot.
+*/
+template <size_t N, unsigned Bits>
+struct StaticTable {
+    uint32_t displacement[N] = {};
+    uint32_t slots[size_t(1) << Bits] = {};
+    bool valid = true;
+};
+
+/**
+ * A schema layout without its template parameter, used by "load_static" and "save_static"
+*/
+struct StaticView {
+    const char *index;
+    uint64_t data_offset;
+    uint64_t file_size;
+    const StaticEntry *entries;
+    const SchemaField *fields;
+    size_t count;
+    size_t (*find)(std::string_view id, uint64_t hash);
+};
+
+// Same as format::hash_id, usable at compile time
+constexpr uint64_t static_hash(std::string_view id) {
+    uint64_t hash = FNV_OFFSET;
+    for (char character: id) {
+        hash ^= static_cast<unsigned char>(character);
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+constexpr uint64_t static_align(uint64_t value) {
+    return (value + format::DATA_ALIGNMENT - 1) & ~static_cast<uint64_t>(format::DATA_ALIGNMENT - 1);
+}
+
+// Write the low "bytes" bytes of value little-endian
+template <size_t Size>
+constexpr void static_store(std::array<char, Size> &buffer, uint64_t offset, uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; i++) {
+        buffer[offset + i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+    }
+}
+
+constexpr uint64_t static_slot(uint64_t hash, uint64_t displacement, unsigned bits) {
+    return ((hash ^ (displacement * 0x9E3779B97F4A7C15ULL)) * 0xBF58476D1CE4E5B9ULL) >> (64 - bits);
+}
+
+constexpr size_t static_bucket(uint64_t hash, size_t count) {
+    return static_cast<size_t>((hash >> 32) % count);
+}
+
+// Smallest table with at least two slots per field
+template <size_t N>
+constexpr unsigned static_bits() {
+    unsigned bits = 1;
+    while ((size_t(1) << bits) < 2 * N) {bits++;}
+    return bits;
+}
+
+/**
+ * Compute the V2 file layout of a schema, as written by a Recipe with the same variables:
+ * entries sorted by (hash, id), ids back to back and data blocks aligned to DATA_ALIGNMENT.
+ * The plan is invalid if two fields share an id.
+*/
+template <typename S>
+constexpr auto static_plan() {
+    constexpr size_t count = std::size(Schema<S>::fields);
+    StaticPlan<count> plan;
+    for (size_t i = 0; i < count; i++) {
+        std::string_view id = Schema<S>::fields[i].id;
+        plan.entries[i].field = i;
+        plan.entries[i].hash = static_hash(id);
+        plan.entries[i].id_length = static_cast<uint16_t>(id.length());
+        if (id.length() > UINT16_MAX) {plan.valid = false;}
+    }
+
+    // Insertion sort by (hash, id)
+    auto less = [](const StaticEntry &a, const StaticEntry &b) {
+        if (a.hash != b.hash) {return a.hash < b.hash;}
+        return std::string_view(Schema<S>::fields[a.field].id) < std::string_view(Schema<S>::fields[b.field].id);
+    };
+    for (size_t i = 1; i < count; i++) {
+        StaticEntry entry = plan.entries[i];
+        size_t j = i;
+        for (; j > 0 && less(entry, plan.entries[j - 1]); j--) {plan.entries[j] = plan.entries[j - 1];}
+        plan.entries[j] = entry;
+    }
+    for (size_t i = 1; i < count; i++) {
+        if (!less(plan.entries[i - 1], plan.entries[i])) {plan.valid = false;}
+    }
+
+    plan.strings_offset = format::HEADER_SIZE + count * format::TOC_ENTRY_SIZE;
+    for (size_t i = 0; i < count; i++) {
+        plan.entries[i].id_offset = static_cast<uint32_t>(plan.strings_size);
+        plan.strings_size += plan.entries[i].id_length;
+    }
+    plan.data_offset = static_align(plan.strings_offset + plan.strings_size);
+    uint64_t offset = plan.data_offset;
+    for (size_t i = 0; i < count; i++) {
+        plan.entries[i].offset = offset;
+        offset += static_align(Schema<S>::fields[plan.entries[i].field].size);
+    }
+    plan.file_size = offset + format::TRAILER_SIZE;
+    return plan;
+}
+
+/**
+ * Encode the header, TOC and string table of a schema file.
+ * Entry checksums are left 0, they are filled in by "save_static".
+ * Mirrors format::encode_header and format::encode_entry.
+*/
+template <typename S, const auto &Plan>
+constexpr auto static_index() {
+    constexpr size_t count = std::size(Schema<S>::fields);
+    std::array<char, Plan.data_offset> index{};
+    for (size_t i = 0; i < sizeof(format::MAGIC); i++) {index[i] = format::MAGIC[i];}
+    static_store(index, 8, format::VERSION, 4);
+    static_store(index, 12, format::HEADER_HAS_TRAILER, 4);
+    static_store(index, 16, count, 8);
+    static_store(index, 24, format::HEADER_SIZE, 8);
+    static_store(index, 32, Plan.strings_offset, 8);
+    static_store(index, 40, Plan.strings_size, 8);
+    static_store(index, 48, Plan.data_offset, 8);
+    static_store(index, 56, Plan.file_size, 8);
+    for (size_t i = 0; i < count; i++) {
+        const StaticEntry &entry = Plan.entries[i];
+        const SchemaField &field = Schema<S>::fields[entry.field];
+        uint64_t offset = format::HEADER_SIZE + i * format::TOC_ENTRY_SIZE;
+        static_store(index, offset, entry.hash, 8);
+        static_store(index, offset + 8, field.type, 8);
+        static_store(index, offset + 16, entry.offset, 8);
+        static_store(index, offset + 24, field.size, 8);
+        static_store(index, offset + 32, field.size, 8);
+        static_store(index, offset + 40, entry.id_offset, 4);
+        static_store(index, offset + 44, entry.id_length, 2);
+        static_store(index, offset + 46, format::CODEC_RAW, 1);
+        static_store(index, offset + 47, format::ENTRY_HAS_CHECKSUM, 1);
+        for (size_t c = 0; c < entry.id_length; c++) {
+            index[Plan.strings_offset + entry.id_offset + c] = field.id[c];
+        }
+    }
+    return index;
+}
+
+/**
+ * Build a perfect hash of the ids of a schema (hash and displace).
+ * Fields are grouped into buckets by their hash, buckets are placed largest first,
+ * each with the smallest displacement that moves all its fields into free slots.
+ * The table is invalid if a bucket cannot be placed.
+*/
+template <typename S, unsigned Bits, const auto &Plan>
+constexpr auto static_table() {
+    constexpr size_t count = std::size(Schema<S>::fields);
+    StaticTable<count, Bits> table;
+
+    // Counting sort of the fields by bucket
+    size_t start[count + 1] = {};
+    size_t order[count] = {};
+    for (size_t i = 0; i < count; i++) {start[static_bucket(Plan.entries[i].hash, count) + 1]++;}
+    size_t largest = 0;
+    for (size_t b = 0; b < count; b++) {
+        if (start[b + 1] > largest) {largest = start[b + 1];}
+        start[b + 1] += start[b];
+    }
+    size_t fill[count] = {};
+    for (size_t i = 0; i < count; i++) {
+        size_t bucket = static_bucket(Plan.entries[i].hash, count);
+        order[start[bucket] + fill[bucket]++] = i;
+    }
+
+    for (size_t size = largest; size > 0; size--) {
+        for (size_t b = 0; b < count; b++) {
+            if (start[b + 1] - start[b] != size) {continue;}
+            bool placed = false;
+            for (uint32_t displacement = 0; displacement < 65536 && !placed; displacement++) {
+                placed = true;
+                for (size_t k = start[b]; k < start[b + 1] && placed; k++) {
+                    uint64_t slot = static_slot(Plan.entries[order[k]].hash, displacement, Bits);
+                    if (table.slots[slot] != 0) {placed = false;}
+                    for (size_t o = start[b]; o < k && placed; o++) {
+                        if (static_slot(Plan.entries[order[o]].hash, displacement, Bits) == slot) {placed = false;}
+                    }
+                }
+                if (!placed) {continue;}
+                table.displacement[b] = displacement;
+                for (size_t k = start[b]; k < start[b + 1]; k++) {
+                    const StaticEntry &entry = Plan.entries[order[k]];
+                    table.slots[static_slot(entry.hash, displacement, Bits)] = static_cast<uint32_t>(entry.field + 1);
+                }
+            }
+            if (!placed) {table.valid = false;}
+        }
+    }
+    return table;
+}
+
+bool load_static(const StaticView &view, char *values, const std::string &path);
+bool save_static(const StaticView &view, const char *values, std::vector<char> &image, const std::string &path,
+                 SaveMode mode, bool sync);
+bool static_sync_due(SyncMode mode, uint64_t parameter, uint64_t &saves, std::chrono::steady_clock::time_point &last_sync);
+bool create_static(const std::string &path);
+
+}
+
+/**
+ * Compile-time layout of a schema struct in a V2 recipe file.
+ *
+ * "plan" holds the TOC order and fixed file offset of every field, "index" the encoded header, TOC and string table.
+ * "index_of" finds a field by id through a perfect hash, at compile time for constant ids.
+*/
+template <typename S>
+struct StaticLayout {
+    static constexpr size_t count = std::size(Schema<S>::fields);
+    static constexpr detail::StaticPlan<count> plan = detail::static_plan<S>();
+    static_assert(plan.valid, "Schema ids must be unique and at most 65535 characters long");
+    static constexpr std::array<char, plan.data_offset> index = detail::static_index<S, plan>();
+    static constexpr unsigned bits = detail::static_bits<count>();
+    static constexpr detail::StaticTable<count, bits> table = detail::static_table<S, bits, plan>();
+    static_assert(table.valid, "No perfect hash found for the schema ids");
+
+    /**
+     * Find a field by its id and id hash
+     *
+     * @param id the field id
+     * @param hash the id hash, see "format::hash_id"
+     *
+     * @return the position of the field in the schema, "count" if there is no field with this id
+    */
+    static constexpr size_t find(std::string_view id, uint64_t hash) {
+        uint32_t displacement = table.displacement[detail::static_bucket(hash, count)];
+        uint32_t slot = table.slots[detail::static_slot(hash, displacement, bits)];
+        if (slot == 0 || std::string_view(Schema<S>::fields[slot - 1].id) != id) {return count;}
+        return slot - 1;
+    }
+
+    /**
+     * Find a field by its id
+     *
+     * @param id the field id
+     *
+     * @return the position of the field in the schema, "count" if there is no field with this id
+    */
+    static constexpr size_t index_of(std::string_view id) {
+        return find(id, detail::static_hash(id));
+    }
+
+    static detail::StaticView view() {
+        return {index.data(), plan.data_offset, plan.file_size, plan.entries, Schema<S>::fields, count, &find};
+    }
+};
+
+/**
+ * The StaticRecipe class links a schema struct, fixed at compile time, to a recipe file.
+ *
+ * --------------------------------------------
+ * Usage description:
+ * --------------------------------------------
+ * Declare the schema struct and its fields at global namespace scope:
+ *     struct MotorConfig {int32_t speed; double gain;};
+ *     RCP_SCHEMA(MotorConfig, RCP_SCHEMA_FIELD(speed), RCP_SCHEMA_FIELD(gain))
+ * Or generate both from a schema file with the "rcp_add_schema" CMake function (see cmake/RecipeSchema.cmake).
+ * RCP_SCHEMA_FIELD uses the member name as id, RCP_SCHEMA_FIELD_ID takes any id.
+ *
+ * Provide the struct instance and a file name in the constructor, call "init", then "load_recipe" and "save_recipe".
+ * The file is the V2 file a Recipe with the same variables writes, add_variable(id, values.field) for every field
+ * and set_file_format(FileFormat::V2), so both classes read each other's files.
+ *
+ * The file layout, including the encoded header, TOC and string table, is computed at compile time (see StaticLayout).
+ * "save_recipe" copies the values to their fixed offsets in a reused file image, checksums them and writes the image.
+ * "load_recipe" compares the index of the file to the expected one and copies every value from its fixed offset.
+ * Files with a different layout, for instance written by a Recipe with more or fewer variables, or with compressed entries,
+ * are loaded entry by entry, looking up each id in a perfect hash of the schema ids.
+ * Values whose size or type fingerprint does not match the schema field are skipped.
+ * Every value is checked against its checksum before the first one is written to the schema struct.
+ * Like Recipe, "set_save_mode" selects how the file is replaced and "set_sync_mode" when it is flushed to the storage device.
+ *
+ * --------------------------------------------
+ * Notes:
+ * --------------------------------------------
+ * A static recipe is used from one thread at a time, it does not read v1 files or journals.
+*/
+template <typename S>
+class StaticRecipe {
+    public:
+        using Layout = StaticLayout<S>;
+
+        StaticRecipe(S &values, std::string name, std::string folder="", std::string extension=".rcp");
+
+        bool init();
+        void stop();
+        bool load_recipe();
+        bool save_recipe();
+
+        bool is_init();
+        const std::string& get_path();
+        SaveMode get_save_mode();
+        void set_save_mode(SaveMode);
+        SyncMode get_sync_mode();
+        void set_sync_mode(SyncMode, uint64_t parameter=0);
+    protected:
+    private:
+        S &_values;
+        std::string _path;
+        bool _init;
+        SaveMode _save_mode;
+        SyncMode _sync_mode;
+        uint64_t _sync_parameter;
+        uint64_t _saves_since_sync;
+        std::chrono::steady_clock::time_point _last_sync;
+        std::vector<char> _image;
+};
+
+/**
+ * Construct a StaticRecipe
+ *
+ * @param values the schema struct linked to the recipe file, must outlive the recipe
+ * @param name the recipe file name
+ * @param folder the directory to store the recipe file
+ * @param extension the recipe file extension
+*/
+template <typename S>
+StaticRecipe<S>::StaticRecipe(S &values, std::string name, std::string folder, std::string extension):
+    _values(values)
+{
+    if (folder != "" && folder.back() != '/') {folder += "/";}
+    if (extension != "" && extension.front() != '.') {extension = "." + extension;}
+    this->_path = folder + name + extension;
+    this->_init = false;
+    this->_save_mode = SaveMode::Direct;
+    this->_sync_mode = SyncMode::Never;
+    this->_sync_parameter = 0;
+    this->_saves_since_sync = 0;
+    this->_last_sync = std::chrono::steady_clock::time_point();
+}
+
+/**
+ * Initialize the recipe.
+ * Creates the recipe file and its directory if they do not exist.
+ *
+ * @return true if the initialization was successfull.
+*/
+template <typename S>
+bool StaticRecipe<S>::init() {
+    this->_init = detail::create_static(this->_path);
+    return this->_init;
+}
+
+/**
+ * Reset the initialized flag.
+ * Will block the "load_recipe" and "save_recipe" methods until "init" is called again.
+*/
+template <typename S>
+void StaticRecipe<S>::stop() {
+    this->_init = false;
+}
+
+/**
+ * Load the recipe file into the schema struct.
+ * Fields not present in the recipe file are not modified, no field is modified if a value fails its checksum.
+ *
+ * @return true if the recipe values were written to the schema struct
+*/
+template <typename S>
+bool StaticRecipe<S>::load_recipe() {
+    if (!this->_init) {return false;}
+    return detail::load_static(Layout::view(), reinterpret_cast<char*>(&this->_values), this->_path);
+}
+
+/**
+ * Save the schema struct to the recipe file.
+ * With SaveMode::Atomic the file is written next to the recipe file and renamed over it.
+ * Saves selected by the sync mode are flushed to the storage device before "save_recipe" returns.
+ *
+ * @return true if the recipe was successfully saved.
+*/
+template <typename S>
+bool StaticRecipe<S>::save_recipe() {
+    if (!this->_init) {return false;}
+    bool sync = detail::static_sync_due(this->_sync_mode, this->_sync_parameter, this->_saves_since_sync, this->_last_sync);
+    return detail::save_static(Layout::view(), reinterpret_cast<const char*>(&this->_values), this->_image, this->_path,
+                               this->_save_mode, sync);
+}
+
+/**
+ * Check if the recipe is initialized
+ *
+ * @return true if the recipe is initialized
+*/
+template <typename S>
+bool StaticRecipe<S>::is_init() {
+    return this->_init;
+}
+
+/**
+ * Check the recipe path
+ *
+ * @return the recipe path
+*/
+template <typename S>
+const std::string& StaticRecipe<S>::get_path() {
+    return this->_path;
+}
+
+/**
+ * Check how the recipe file is replaced
+ *
+ * @return the current save mode
+*/
+template <typename S>
+SaveMode StaticRecipe<S>::get_save_mode() {
+    return this->_save_mode;
+}
+
+/**
+ * Set how "save_recipe" replaces the recipe file (see SaveMode)
+ *
+ * @param save_mode the new save mode
+*/
+template <typename S>
+void StaticRecipe<S>::set_save_mode(SaveMode save_mode) {
+    this->_save_mode = save_mode;
+}
+
+/**
+ * Check when the recipe file is flushed to the storage device
+ *
+ * @return the current sync mode
+*/
+template <typename S>
+SyncMode StaticRecipe<S>::get_sync_mode() {
+    return this->_sync_mode;
+}
+
+/**
+ * Set when "save_recipe" flushes the recipe file to the storage device (see SyncMode)
+ *
+ * @param sync_mode the new sync mode
+ * @param parameter number of saves for SyncMode::EveryN, milliseconds for SyncMode::Interval, ignored otherwise
+*/
+template <typename S>
+void StaticRecipe<S>::set_sync_mode(SyncMode sync_mode, uint64_t parameter) {
+    this->_sync_mode = sync_mode;
+    this->_sync_parameter = parameter;
+    this->_saves_since_sync = 0;
+    this->_last_sync = std::chrono::steady_clock::time_point();
+}
+
+}
+
+#define RCP_SCHEMA_FIELD_ID(field, id)                                                                     \
+    ::rcp::SchemaField{id, offsetof(schema_type, field), sizeof(schema_type::field),                    \
+                       ::rcp::type_fingerprint<decltype(schema_type::field)>()}
+
+#define RCP_SCHEMA_FIELD(field) RCP_SCHEMA_FIELD_ID(field, #field)
+
+#define RCP_SCHEMA(type, ...)                                                       \
+    namespace rcp {                                                                 \
+    template <> struct Schema<type> {                                               \
+        using schema_type = type;                                                   \
+        static constexpr SchemaField fields[] = {__VA_ARGS__};                      \
+    };                                                                              \
+    }
+
+#endif
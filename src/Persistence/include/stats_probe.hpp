@@ -0,0 +1,92 @@
+#ifndef RCP_STATS_PROBE_HPP
+#define RCP_STATS_PROBE_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+
+#include "recipe_stats.hpp"
+
+namespace rcp {
+
+/**
+ * Instrumentation points of the recipe load and save paths, see recipe_stats.hpp.
+ * Used by the library sources only.
+ *
+ * A StatsScope collects the statistics of one operation on the current thread and reports them when it is destroyed.
+ * The "stats_*" functions add to the innermost scope of the current thread, and do nothing outside of a scope.
+ * Without RCP_STATS the scope is empty and the functions compile to nothing.
+*/
+#ifdef RCP_STATS
+
+class StatsScope {
+    public:
+        StatsScope(RecipeObserver *observer, std::string_view recipe, RecipeOperation operation);
+        ~StatsScope();
+        StatsScope(const StatsScope&) = delete;
+        StatsScope& operator=(const StatsScope&) = delete;
+
+        bool finish(bool success);
+
+        static StatsScope* current();
+        RecipeStats& stats();
+        void phase(RecipePhase phase);
+    private:
+        RecipeObserver *_observer;
+        std::string_view _recipe;
+        RecipeStats _stats;
+        StatsScope *_previous;
+        RecipePhase _phase;
+        std::chrono::steady_clock::time_point _start;
+        std::chrono::steady_clock::time_point _phase_start;
+};
+
+inline void stats_phase(RecipePhase phase) {
+    if (StatsScope *scope = StatsScope::current()) {scope->phase(phase);}
+}
+
+inline void stats_read(uint64_t bytes) {
+    if (StatsScope *scope = StatsScope::current()) {scope->stats().bytes_read += bytes;}
+}
+
+inline void stats_written(uint64_t bytes) {
+    if (StatsScope *scope = StatsScope::current()) {scope->stats().bytes_written += bytes;}
+}
+
+inline void stats_entry(uint64_t count=1) {
+    if (StatsScope *scope = StatsScope::current()) {scope->stats().entries += count;}
+}
+
+inline void stats_skipped_unknown() {
+    if (StatsScope *scope = StatsScope::current()) {scope->stats().skipped_unknown += 1;}
+}
+
+inline void stats_skipped_mismatch() {
+    if (StatsScope *scope = StatsScope::current()) {scope->stats().skipped_mismatch += 1;}
+}
+
+inline void stats_allocation() {
+    if (StatsScope *scope = StatsScope::current()) {scope->stats().allocations += 1;}
+}
+
+#else
+
+class StatsScope {
+    public:
+        StatsScope(RecipeObserver*, std::string_view, RecipeOperation) {}
+        bool finish(bool success) {return success;}
+};
+
+inline void stats_phase(RecipePhase) {}
+inline void stats_read(uint64_t) {}
+inline void stats_written(uint64_t) {}
+inline void stats_entry(uint64_t=1) {}
+inline void stats_skipped_unknown() {}
+inline void stats_skipped_mismatch() {}
+inline void stats_allocation() {}
+
+#endif
+
+}
+
+#endif
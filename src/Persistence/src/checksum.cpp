@@ -0,0 +1,299 @@
+#include "checksum.hpp"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+#define RCP_CRC32C_X86
+#elif defined(__aarch64__) && defined(__linux__)
+#include <arm_acle.h>
+#include <asm/hwcap.h>
+#include <sys/auxv.h>
+#define RCP_CRC32C_ARM
+#endif
+
+namespace rcp {
+
+namespace {
+
+constexpr uint32_t POLYNOMIAL = 0x82F63B78;
+
+// Inputs of at least LANE_COUNT * LANE_SIZE bytes are checksummed as independent lanes, then combined
+constexpr size_t LANE_COUNT = 3;
+constexpr size_t LANE_SIZE = 4096;
+
+// Computes the CRC register over "size" bytes, without the initial and final inversion
+using Kernel = uint32_t (*)(uint32_t crc, const unsigned char *bytes, size_t size);
+
+// Slice-by-8 lookup tables
+struct Tables {
+    uint32_t table[8][256];
+
+    Tables() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc >> 1) ^ ((crc & 1) ? POLYNOMIAL : 0);
+            }
+            this->table[0][i] = crc;
+        }
+        for (uint32_t i = 0; i < 256; i++) {
+            for (int slice = 1; slice < 8; slice++) {
+                uint32_t previous = this->table[slice - 1][i];
+                this->table[slice][i] = (previous >> 8) ^ this->table[0][previous & 0xFF];
+            }
+        }
+    }
+};
+
+const Tables& tables() {
+    static const Tables instance;
+    return instance;
+}
+
+// Multiply a vector by a 32x32 matrix over GF(2)
+uint32_t gf2_matrix_times(const uint32_t *matrix, uint32_t vector) {
+    uint32_t sum = 0;
+    while (vector) {
+        if (vector & 1) {sum ^= *matrix;}
+        vector >>= 1;
+        matrix++;
+    }
+    return sum;
+}
+
+void gf2_matrix_square(uint32_t *square, const uint32_t *matrix) {
+    for (int n = 0; n < 32; n++) {
+        square[n] = gf2_matrix_times(matrix, matrix[n]);
+    }
+}
+
+uint32_t portable_kernel(uint32_t crc, const unsigned char *bytes, size_t size) {
+    const Tables &t = tables();
+    while (size >= 8) {
+        uint32_t low = crc ^ (static_cast<uint32_t>(bytes[0]) | static_cast<uint32_t>(bytes[1]) << 8 |
+                              static_cast<uint32_t>(bytes[2]) << 16 | static_cast<uint32_t>(bytes[3]) << 24);
+        crc = t.table[7][low & 0xFF] ^ t.table[6][(low >> 8) & 0xFF] ^
+              t.table[5][(low >> 16) & 0xFF] ^ t.table[4][low >> 24] ^
+              t.table[3][bytes[4]] ^ t.table[2][bytes[5]] ^
+              t.table[1][bytes[6]] ^ t.table[0][bytes[7]];
+        bytes += 8;
+        size -= 8;
+    }
+    while (size > 0) {
+        crc = (crc >> 8) ^ t.table[0][(crc ^ *bytes) & 0xFF];
+        bytes++;
+        size--;
+    }
+    return crc;
+}
+
+#if defined(RCP_CRC32C_X86) || defined(RCP_CRC32C_ARM)
+
+// Appends LANE_SIZE zero bytes to a CRC register
+const Crc32cCombiner& lane_shift() {
+    static const Crc32cCombiner instance(LANE_SIZE);
+    return instance;
+}
+
+#endif
+
+#if defined(RCP_CRC32C_X86) && defined(__x86_64__)
+#define RCP_CRC32C_TARGET __attribute__((target("sse4.2")))
+RCP_CRC32C_TARGET inline uint32_t crc_word(uint32_t crc, uint64_t word) {return static_cast<uint32_t>(_mm_crc32_u64(crc, word));}
+RCP_CRC32C_TARGET inline uint32_t crc_byte(uint32_t crc, unsigned char byte) {return _mm_crc32_u8(crc, byte);}
+#elif defined(RCP_CRC32C_X86)
+#define RCP_CRC32C_TARGET __attribute__((target("sse4.2")))
+RCP_CRC32C_TARGET inline uint32_t crc_word(uint32_t crc, uint64_t word) {
+    crc = _mm_crc32_u32(crc, static_cast<uint32_t>(word));
+    return _mm_crc32_u32(crc, static_cast<uint32_t>(word >> 32));
+}
+RCP_CRC32C_TARGET inline uint32_t crc_byte(uint32_t crc, unsigned char byte) {return _mm_crc32_u8(crc, byte);}
+#elif defined(RCP_CRC32C_ARM)
+#define RCP_CRC32C_TARGET __attribute__((target("+crc")))
+RCP_CRC32C_TARGET inline uint32_t crc_word(uint32_t crc, uint64_t word) {return __crc32cd(crc, word);}
+RCP_CRC32C_TARGET inline uint32_t crc_byte(uint32_t crc, unsigned char byte) {return __crc32cb(crc, byte);}
+#endif
+
+#if defined(RCP_CRC32C_TARGET)
+
+// Little-endian load, the CRC instructions consume the low byte first
+inline uint64_t load_word(const unsigned char *bytes) {
+    uint64_t word;
+    std::memcpy(&word, bytes, sizeof(word));
+    return word;
+}
+
+// The CRC instruction has a latency of several cycles but issues every cycle,
+// so large inputs are split into independent lanes that keep it busy and are combined afterwards
+RCP_CRC32C_TARGET uint32_t hardware_kernel(uint32_t crc, const unsigned char *bytes, size_t size) {
+    static_assert(LANE_COUNT == 3, "The lane loop is unrolled for three lanes");
+    const Crc32cCombiner &shift = lane_shift();
+    while (size >= LANE_COUNT * LANE_SIZE) {
+        uint32_t crc0 = crc;
+        uint32_t crc1 = 0;
+        uint32_t crc2 = 0;
+        for (size_t offset = 0; offset < LANE_SIZE; offset += 8) {
+            crc0 = crc_word(crc0, load_word(bytes + offset));
+            crc1 = crc_word(crc1, load_word(bytes + LANE_SIZE + offset));
+            crc2 = crc_word(crc2, load_word(bytes + 2 * LANE_SIZE + offset));
+        }
+        crc = shift.combine(shift.combine(crc0, crc1), crc2);
+        bytes += LANE_COUNT * LANE_SIZE;
+        size -= LANE_COUNT * LANE_SIZE;
+    }
+    while (size >= 8) {
+        crc = crc_word(crc, load_word(bytes));
+        bytes += 8;
+        size -= 8;
+    }
+    while (size > 0) {
+        crc = crc_byte(crc, *bytes);
+        bytes++;
+        size--;
+    }
+    return crc;
+}
+
+bool hardware_supported() {
+#if defined(RCP_CRC32C_X86)
+    return __builtin_cpu_supports("sse4.2");
+#else
+    return (::getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+#endif
+}
+
+#endif
+
+Kernel select_kernel() {
+#if defined(RCP_CRC32C_TARGET)
+    if (hardware_supported()) {return hardware_kernel;}
+#endif
+    return portable_kernel;
+}
+
+Kernel kernel() {
+    static const Kernel instance = select_kernel();
+    return instance;
+}
+
+}
+
+/**
+ * Compute a CRC-32C checksum.
+ * Checksums can be computed incrementally by passing the previous result as "crc".
+ * Uses the CRC instructions of the CPU if available (SSE4.2 on x86, the CRC extension on ARMv8),
+ * selected at runtime on the first call.
+ *
+ * @param crc the checksum of the preceding bytes, 0 for the first block
+ * @param data the bytes to checksum
+ * @param size number of bytes
+ *
+ * @return the checksum of all bytes seen so far
+*/
+uint32_t crc32c(uint32_t crc, const char *data, size_t size) {
+    return ~kernel()(~crc, reinterpret_cast<const unsigned char*>(data), size);
+}
+
+/**
+ * Compute a CRC-32C checksum with lookup tables only.
+ * Gives the same result as "crc32c", which uses this implementation on CPUs without CRC instructions.
+ *
+ * @param crc the checksum of the preceding bytes, 0 for the first block
+ * @param data the bytes to checksum
+ * @param size number of bytes
+ *
+ * @return the checksum of all bytes seen so far
+*/
+uint32_t crc32c_portable(uint32_t crc, const char *data, size_t size) {
+    return ~portable_kernel(~crc, reinterpret_cast<const unsigned char*>(data), size);
+}
+
+/**
+ * Get the implementation "crc32c" selected for this CPU
+ *
+ * @return "sse4.2", "armv8" or "portable"
+*/
+const char* crc32c_implementation() {
+#if defined(RCP_CRC32C_X86)
+    if (kernel() != portable_kernel) {return "sse4.2";}
+#elif defined(RCP_CRC32C_ARM)
+    if (kernel() != portable_kernel) {return "armv8";}
+#endif
+    return "portable";
+}
+
+/**
+ * Combine the checksums of two adjacent blocks.
+ * Lets blocks of one buffer be checksummed independently, for instance on different threads.
+ *
+ * @param crc1 the checksum of the first block
+ * @param crc2 the checksum of the second block
+ * @param size2 number of bytes in the second block
+ *
+ * @return the checksum of both blocks back to back
+*/
+uint32_t crc32c_combine(uint32_t crc1, uint32_t crc2, size_t size2) {
+    if (size2 == 0) {return crc1;}
+
+    // Operator for one zero bit, then two and four zero bits
+    uint32_t even[32];
+    uint32_t odd[32];
+    odd[0] = POLYNOMIAL;
+    uint32_t row = 1;
+    for (int n = 1; n < 32; n++) {
+        odd[n] = row;
+        row <<= 1;
+    }
+    gf2_matrix_square(even, odd);
+    gf2_matrix_square(odd, even);
+
+    // Apply size2 zero bytes to crc1
+    do {
+        gf2_matrix_square(even, odd);
+        if (size2 & 1) {crc1 = gf2_matrix_times(even, crc1);}
+        size2 >>= 1;
+        if (size2 == 0) {break;}
+
+        gf2_matrix_square(odd, even);
+        if (size2 & 1) {crc1 = gf2_matrix_times(odd, crc1);}
+        size2 >>= 1;
+    } while (size2 != 0);
+
+    return crc1 ^ crc2;
+}
+
+/**
+ * Precompute the operator of "crc32c_combine" for a second block of "size2" bytes
+ *
+ * @param size2 number of bytes in the second block
+*/
+Crc32cCombiner::Crc32cCombiner(size_t size2) {
+    this->_size = size2;
+    for (int n = 0; n < 32; n++) {
+        this->_matrix[n] = crc32c_combine(static_cast<uint32_t>(1) << n, 0, size2);
+    }
+}
+
+/**
+ * Combine the checksums of two adjacent blocks, see "crc32c_combine"
+ *
+ * @param crc1 the checksum of the first block
+ * @param crc2 the checksum of the second block, of "size" bytes
+ *
+ * @return the checksum of both blocks back to back
+*/
+uint32_t Crc32cCombiner::combine(uint32_t crc1, uint32_t crc2) const {
+    return gf2_matrix_times(this->_matrix, crc1) ^ crc2;
+}
+
+/**
+ * Get the size of the second block
+ *
+ * @return number of bytes
+*/
+size_t Crc32cCombiner::size() const {
+    return this->_size;
+}
+
+}
@@ -0,0 +1,290 @@
+#include "compression.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#ifdef RCP_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace rcp {
+
+namespace {
+
+// LZ4 block format: sequences of [token][literal length][literals][offset][match length]
+constexpr size_t MIN_MATCH = 4;
+constexpr size_t LAST_LITERALS = 5;
+constexpr size_t MATCH_LIMIT = 12;
+constexpr size_t MAX_OFFSET = 65535;
+constexpr int MIN_HASH_BITS = 10;
+constexpr int MAX_HASH_BITS = 16;
+
+uint32_t read32(const uint8_t *data) {
+    uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+uint32_t hash32(uint32_t sequence, int bits) {
+    return (sequence * 2654435761U) >> (32 - bits);
+}
+
+// Write a length continuation (bytes of 255 followed by the remainder)
+uint8_t* write_length(uint8_t *output, size_t length) {
+    for (; length >= 255; length -= 255) {*output++ = 255;}
+    *output++ = static_cast<uint8_t>(length);
+    return output;
+}
+
+/**
+ * Compress into the LZ4 block format.
+ * Greedy matching through a hash table of recent positions, positions are stored modulo 2^32.
+ * The table grows with the input up to 2^MAX_HASH_BITS entries, so small values are cheap to compress.
+ *
+ * @return the compressed size, 0 if it does not fit "capacity"
+*/
+size_t lz4_compress(const uint8_t *source, size_t size, uint8_t *destination, size_t capacity, std::pmr::memory_resource *resource) {
+    int bits = MIN_HASH_BITS;
+    while (bits < MAX_HASH_BITS && (static_cast<size_t>(1) << bits) < size) {bits++;}
+    std::pmr::vector<uint32_t> table(static_cast<size_t>(1) << bits, 0, resource);
+    uint8_t *output = destination;
+    uint8_t *output_end = destination + capacity;
+    size_t anchor = 0;
+    size_t position = 0;
+
+    auto emit = [&](size_t literals_end, size_t offset, size_t match_length) {
+        size_t literals = literals_end - anchor;
+        if (static_cast<size_t>(output_end - output) < literals + literals / 255 + 16) {return false;}
+        uint8_t *token = output++;
+        *token = static_cast<uint8_t>(std::min<size_t>(literals, 15) << 4);
+        if (literals >= 15) {output = write_length(output, literals - 15);}
+        std::memcpy(output, source + anchor, literals);
+        output += literals;
+        if (match_length == 0) {return true;}
+
+        *output++ = static_cast<uint8_t>(offset);
+        *output++ = static_cast<uint8_t>(offset >> 8);
+        size_t length = match_length - MIN_MATCH;
+        *token |= static_cast<uint8_t>(std::min<size_t>(length, 15));
+        if (length >= 15) {
+            if (static_cast<size_t>(output_end - output) < length / 255 + 1) {return false;}
+            output = write_length(output, length - 15);
+        }
+        return true;
+    };
+
+    while (size >= MATCH_LIMIT && position <= size - MATCH_LIMIT) {
+        uint32_t sequence = read32(source + position);
+        uint32_t &slot = table[hash32(sequence, bits)];
+        uint32_t distance = static_cast<uint32_t>(position) - slot;
+        slot = static_cast<uint32_t>(position);
+        if (distance == 0 || distance > MAX_OFFSET || distance > position || read32(source + position - distance) != sequence) {
+            // Step faster through incompressible data
+            position += 1 + ((position - anchor) >> 6);
+            continue;
+        }
+
+        size_t match = position - distance;
+        while (position > anchor && match > 0 && source[position - 1] == source[match - 1]) {
+            position--;
+            match--;
+        }
+        size_t length = MIN_MATCH;
+        while (position + length < size - LAST_LITERALS && source[position + length] == source[match + length]) {length++;}
+
+        if (!emit(position, distance, length)) {return 0;}
+        position += length;
+        anchor = position;
+    }
+    if (!emit(size, 0, 0)) {return 0;}
+    return output - destination;
+}
+
+/**
+ * Decompress an LZ4 block, every read and write is bounds checked.
+ *
+ * @return true if the block decodes to exactly "destination_size" bytes
+*/
+bool lz4_decompress(const uint8_t *source, size_t size, uint8_t *destination, size_t destination_size) {
+    size_t input = 0;
+    size_t output = 0;
+    auto read_length = [&](size_t &length) {
+        uint8_t byte;
+        do {
+            if (input >= size) {return false;}
+            byte = source[input++];
+            length += byte;
+        } while (byte == 255);
+        return true;
+    };
+
+    while (true) {
+        if (input >= size) {return false;}
+        uint8_t token = source[input++];
+
+        size_t literals = token >> 4;
+        if (literals == 15 && !read_length(literals)) {return false;}
+        if (literals > size - input || literals > destination_size - output) {return false;}
+        std::memcpy(destination + output, source + input, literals);
+        input += literals;
+        output += literals;
+        if (input == size) {break;}
+
+        if (size - input < 2) {return false;}
+        size_t offset = source[input] | (static_cast<size_t>(source[input + 1]) << 8);
+        input += 2;
+        if (offset == 0 || offset > output) {return false;}
+
+        size_t length = token & 15;
+        if (length == 15 && !read_length(length)) {return false;}
+        length += MIN_MATCH;
+        if (length > destination_size - output) {return false;}
+        if (offset >= length) {
+            std::memcpy(destination + output, destination + output - offset, length);
+        } else {
+            for (size_t i = 0; i < length; i++) {destination[output + i] = destination[output + i - offset];}
+        }
+        output += length;
+    }
+    return output == destination_size;
+}
+
+#ifdef RCP_HAVE_ZLIB
+// Pass at most UINT_MAX bytes at a time to zlib
+uInt next_piece(size_t &remaining) {
+    uInt piece = static_cast<uInt>(std::min<size_t>(remaining, UINT_MAX));
+    remaining -= piece;
+    return piece;
+}
+
+size_t deflate_compress(const char *source, size_t size, char *destination, size_t capacity) {
+    z_stream stream{};
+    if (deflateInit(&stream, Z_DEFAULT_COMPRESSION) != Z_OK) {return 0;}
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(source));
+    stream.next_out = reinterpret_cast<Bytef*>(destination);
+    size_t input = size;
+    size_t output = capacity;
+    int status = Z_OK;
+    while (status == Z_OK || status == Z_BUF_ERROR) {
+        if (stream.avail_in == 0) {stream.avail_in = next_piece(input);}
+        if (stream.avail_out == 0) {
+            if (output == 0) {break;}
+            stream.avail_out = next_piece(output);
+        }
+        status = deflate(&stream, input == 0 ? Z_FINISH : Z_NO_FLUSH);
+    }
+    size_t written = status == Z_STREAM_END ? static_cast<size_t>(stream.total_out) : 0;
+    deflateEnd(&stream);
+    return written;
+}
+
+bool deflate_decompress(const char *source, size_t size, char *destination, size_t destination_size) {
+    z_stream stream{};
+    if (inflateInit(&stream) != Z_OK) {return false;}
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(source));
+    stream.next_out = reinterpret_cast<Bytef*>(destination);
+    size_t input = size;
+    size_t output = destination_size;
+    int status = Z_OK;
+    while (status == Z_OK || status == Z_BUF_ERROR) {
+        bool progress = false;
+        if (stream.avail_in == 0 && input > 0) {
+            stream.avail_in = next_piece(input);
+            progress = true;
+        }
+        if (stream.avail_out == 0 && output > 0) {
+            stream.avail_out = next_piece(output);
+            progress = true;
+        }
+        if (status == Z_BUF_ERROR && !progress) {break;}
+        status = inflate(&stream, Z_NO_FLUSH);
+    }
+    bool success = status == Z_STREAM_END && stream.total_out == destination_size &&
+                   stream.avail_in == 0 && input == 0;
+    inflateEnd(&stream);
+    return success;
+}
+#endif
+
+}
+
+/**
+ * Check if a codec is compiled in
+ *
+ * @param codec the codec
+ *
+ * @return true if "compress" and "decompress" support the codec
+*/
+bool codec_available(Codec codec) {
+    switch (codec) {
+        case Codec::None:
+        case Codec::LZ4:
+            return true;
+        case Codec::Deflate:
+#ifdef RCP_HAVE_ZLIB
+            return true;
+#else
+            return false;
+#endif
+        default:
+            return false;
+    }
+}
+
+/**
+ * Compress a value
+ *
+ * @param codec the codec, must be available
+ * @param source the value
+ * @param size the value size
+ * @param destination receives the compressed value
+ * @param capacity the size of "destination"
+ * @param resource the memory resource of the LZ4 match table
+ *
+ * @return the compressed size, 0 if the value does not compress into "capacity" bytes
+*/
+size_t compress(Codec codec, const char *source, size_t size, char *destination, size_t capacity, std::pmr::memory_resource *resource) {
+    switch (codec) {
+        case Codec::LZ4:
+            return lz4_compress(reinterpret_cast<const uint8_t*>(source), size, reinterpret_cast<uint8_t*>(destination), capacity, resource);
+#ifdef RCP_HAVE_ZLIB
+        case Codec::Deflate:
+            return deflate_compress(source, size, destination, capacity);
+#endif
+        default:
+            return 0;
+    }
+}
+
+/**
+ * Decompress a value
+ *
+ * @param codec the codec of the compressed value
+ * @param source the compressed value
+ * @param size the compressed size
+ * @param destination receives the value
+ * @param destination_size the exact size of the value
+ *
+ * @return true if the value was decompressed, false if the codec is unavailable or the compressed value is corrupted
+*/
+bool decompress(Codec codec, const char *source, size_t size, char *destination, size_t destination_size) {
+    switch (codec) {
+        case Codec::None:
+            if (size != destination_size) {return false;}
+            if (size > 0) {std::memcpy(destination, source, size);}
+            return true;
+        case Codec::LZ4:
+            return lz4_decompress(reinterpret_cast<const uint8_t*>(source), size, reinterpret_cast<uint8_t*>(destination), destination_size);
+#ifdef RCP_HAVE_ZLIB
+        case Codec::Deflate:
+            return deflate_decompress(source, size, destination, destination_size);
+#endif
+        default:
+            return false;
+    }
+}
+
+}
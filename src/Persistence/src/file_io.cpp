@@ -0,0 +1,320 @@
+#include "file_io.hpp"
+#include "stats_probe.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace rcp {
+
+/**
+ * Construct a closed file
+*/
+File::File() {
+    this->_fd = -1;
+}
+
+/**
+ * Destruct the file
+ * Closes the descriptor if it is open
+*/
+File::~File() {
+    this->close();
+}
+
+/**
+ * Open a file for reading and writing.
+ *
+ * @param path the file to open
+ * @param create create the file if it does not exist
+ * @param truncate discard the contents of an existing file
+ *
+ * @return true if the file was opened
+*/
+bool File::open(const std::string &path, bool create, bool truncate) {
+    return this->open(path.c_str(), create, truncate);
+}
+
+/**
+ * Open a file for reading and writing.
+ *
+ * @param path the file to open, null terminated
+ * @param create create the file if it does not exist
+ * @param truncate discard the contents of an existing file
+ *
+ * @return true if the file was opened
+*/
+bool File::open(const char *path, bool create, bool truncate) {
+    this->close();
+    int flags = O_RDWR | (create ? O_CREAT : 0) | (truncate ? O_TRUNC : 0);
+    this->_fd = ::open(path, flags, 0644);
+    return this->_fd >= 0;
+}
+
+/**
+ * Open a POSIX shared memory object for reading and writing, see shm_open.
+ *
+ * @param name the name of the object, for instance "/recipe"
+ * @param create create the object if it does not exist
+ *
+ * @return true if the object was opened
+*/
+bool File::open_shared(const std::string &name, bool create) {
+    this->close();
+    int flags = O_RDWR | (create ? O_CREAT : 0);
+    this->_fd = ::shm_open(name.c_str(), flags, 0644);
+    return this->_fd >= 0;
+}
+
+/**
+ * Open a file for reading only
+ *
+ * @param path the file to open
+ *
+ * @return true if the file was opened
+*/
+bool File::open_read(const std::string &path) {
+    this->close();
+    this->_fd = ::open(path.c_str(), O_RDONLY);
+    return this->_fd >= 0;
+}
+
+/**
+ * Close the file
+*/
+void File::close() {
+    if (this->_fd >= 0) {::close(this->_fd);}
+    this->_fd = -1;
+}
+
+/**
+ * Check if the file is open
+ *
+ * @return true if the file is open
+*/
+bool File::is_open() const {
+    return this->_fd >= 0;
+}
+
+/**
+ * Get the file descriptor
+ *
+ * @return the descriptor, -1 if the file is closed
+*/
+int File::descriptor() const {
+    return this->_fd;
+}
+
+/**
+ * Get the current file size
+ *
+ * @param size destination for the file size in number of bytes
+ *
+ * @return true if the size was read
+*/
+bool File::size(uint64_t &size) const {
+    struct stat st;
+    if (this->_fd < 0 || ::fstat(this->_fd, &st) != 0) {return false;}
+    size = static_cast<uint64_t>(st.st_size);
+    return true;
+}
+
+/**
+ * Truncate or extend the file
+ *
+ * @param size the new file size in bytes
+ *
+ * @return true if the size was changed
+*/
+bool File::resize(uint64_t size) {
+    return this->_fd >= 0 && ::ftruncate(this->_fd, static_cast<off_t>(size)) == 0;
+}
+
+/**
+ * Write bytes at a fixed file offset without moving the file position
+ *
+ * @param offset the file offset of the first byte
+ * @param data the bytes to write
+ * @param size number of bytes to write
+ *
+ * @return true if all bytes were written
+*/
+bool File::write_at(uint64_t offset, const char *data, size_t size) {
+    while (size > 0) {
+        ssize_t written = ::pwrite(this->_fd, data, size, static_cast<off_t>(offset));
+        if (written < 0) {
+            if (errno == EINTR) {continue;}
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+        offset += static_cast<uint64_t>(written);
+        stats_written(static_cast<uint64_t>(written));
+    }
+    return true;
+}
+
+/**
+ * Read bytes at a fixed file offset without moving the file position
+ *
+ * @param offset the file offset of the first byte
+ * @param data destination for the bytes
+ * @param size number of bytes to read
+ *
+ * @return true if all bytes were read, false on an error or if the file ends first
+*/
+bool File::read_at(uint64_t offset, char *data, size_t size) {
+    while (size > 0) {
+        ssize_t count = ::pread(this->_fd, data, size, static_cast<off_t>(offset));
+        if (count < 0) {
+            if (errno == EINTR) {continue;}
+            return false;
+        }
+        if (count == 0) {return false;}
+        data += count;
+        size -= static_cast<size_t>(count);
+        offset += static_cast<uint64_t>(count);
+    }
+    return true;
+}
+
+/**
+ * Flush file contents and metadata to the storage device
+ *
+ * @return true if the file was synced
+*/
+bool File::sync() {
+    if (this->_fd < 0) {return false;}
+#if defined(__APPLE__)
+    return ::fcntl(this->_fd, F_FULLFSYNC) == 0 || ::fsync(this->_fd) == 0;
+#else
+    return ::fsync(this->_fd) == 0;
+#endif
+}
+
+/**
+ * Construct a writer appending at a fixed offset of an open file
+ *
+ * @param file the destination file
+ * @param offset file offset of the first byte written
+ * @param capacity buffer size in number of bytes
+ * @param resource the memory resource of the buffer
+*/
+BufferedWriter::BufferedWriter(File &file, uint64_t offset, size_t capacity, std::pmr::memory_resource *resource):
+    _file(file), _buffer(capacity, resource)
+{
+    this->_offset = offset;
+    this->_used = 0;
+    this->_failed = false;
+}
+
+/**
+ * Append bytes
+ *
+ * @param data the bytes to write
+ * @param size number of bytes
+ *
+ * @return true if the bytes were buffered or written
+*/
+bool BufferedWriter::write(const char *data, size_t size) {
+    if (size == 0) {return true;}
+    if (this->_used + size > this->_buffer.size()) {
+        if (!this->flush()) {return false;}
+        if (size >= this->_buffer.size()) {
+            if (!this->_file.write_at(this->_offset, data, size)) {
+                this->_failed = true;
+                return false;
+            }
+            this->_offset += size;
+            return true;
+        }
+    }
+    std::memcpy(this->_buffer.data() + this->_used, data, size);
+    this->_used += size;
+    return true;
+}
+
+/**
+ * Append zero bytes
+ *
+ * @param size number of zero bytes, at most the buffer capacity
+ *
+ * @return true if the bytes were buffered or written
+*/
+bool BufferedWriter::pad(size_t size) {
+    if (this->_used + size > this->_buffer.size() && !this->flush()) {return false;}
+    std::memset(this->_buffer.data() + this->_used, 0, size);
+    this->_used += size;
+    return true;
+}
+
+/**
+ * Write buffered bytes to the file
+ *
+ * @return true if all bytes passed to this writer were written
+*/
+bool BufferedWriter::flush() {
+    if (this->_used > 0) {
+        if (!this->_file.write_at(this->_offset, this->_buffer.data(), this->_used)) {
+            this->_failed = true;
+            return false;
+        }
+        this->_offset += this->_used;
+        this->_used = 0;
+    }
+    return !this->_failed;
+}
+
+/**
+ * Get the file offset of the next byte written
+ *
+ * @return the file offset
+*/
+uint64_t BufferedWriter::offset() const {
+    return this->_offset + this->_used;
+}
+
+/**
+ * Atomically replace a file
+ *
+ * @param from the file to move
+ * @param to the destination path, replaced if it exists
+ *
+ * @return true if the file was renamed
+*/
+bool rename_file(const std::string &from, const std::string &to) {
+    return rename_file(from.c_str(), to.c_str());
+}
+
+/**
+ * Atomically replace a file
+ *
+ * @param from the file to move, null terminated
+ * @param to the destination path, null terminated, replaced if it exists
+ *
+ * @return true if the file was renamed
+*/
+bool rename_file(const char *from, const char *to) {
+    return std::rename(from, to) == 0;
+}
+
+/**
+ * Flush a directory entry to the storage device, making a preceding rename durable
+ *
+ * @param path the directory
+ *
+ * @return true if the directory was synced
+*/
+bool sync_directory(const std::string &path) {
+    int fd = ::open(path.empty() ? "." : path.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) {return false;}
+    bool success = ::fsync(fd) == 0;
+    ::close(fd);
+    return success;
+}
+
+}
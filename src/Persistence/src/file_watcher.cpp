@@ -0,0 +1,275 @@
+#include "file_watcher.hpp"
+
+#include <filesystem>
+
+#if defined(__linux__)
+#define RCP_WATCH_INOTIFY
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__) || defined(__DragonFly__)
+#define RCP_WATCH_KQUEUE
+#endif
+
+#if defined(RCP_WATCH_INOTIFY) || defined(RCP_WATCH_KQUEUE)
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#if defined(RCP_WATCH_INOTIFY)
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+#if defined(RCP_WATCH_KQUEUE)
+#include <sys/event.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#endif
+
+namespace rcp {
+
+namespace {
+
+std::string directory_of(const std::string &path) {
+    std::string directory = std::filesystem::path(path).parent_path().string();
+    return directory.empty() ? "." : directory;
+}
+
+#if defined(RCP_WATCH_KQUEUE)
+// Watch a file descriptor for changes of its vnode
+bool add_vnode(int queue, int descriptor, unsigned flags) {
+    struct kevent change;
+    EV_SET(&change, descriptor, EVFILT_VNODE, EV_ADD | EV_CLEAR, flags, 0, nullptr);
+    return ::kevent(queue, &change, 1, nullptr, 0, nullptr) == 0;
+}
+
+int open_event_only(const std::string &path) {
+#if defined(O_EVTONLY)
+    return ::open(path.c_str(), O_EVTONLY | O_CLOEXEC);
+#else
+    return ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+#endif
+}
+#endif
+
+}
+
+/**
+ * Construct an idle watcher
+*/
+FileWatcher::FileWatcher() {
+    this->_debounce = std::chrono::milliseconds(50);
+    this->_stop = false;
+    this->_descriptor = -1;
+    this->_wake[0] = -1;
+    this->_wake[1] = -1;
+}
+
+/**
+ * Destruct the watcher
+ * Stops the watcher thread
+*/
+FileWatcher::~FileWatcher() {
+    this->stop();
+}
+
+/**
+ * Start watching a file.
+ *
+ * @param path the file to watch, its directory must exist
+ * @param callback called on the watcher thread after the file changed
+ * @param debounce how long the file must be quiet after a change before the callback runs
+ *
+ * @return true if the watcher was started, false if it is already running or the platform watch failed
+*/
+bool FileWatcher::start(const std::string &path, Callback callback, std::chrono::milliseconds debounce) {
+    if (this->is_running() || !callback) {return false;}
+    this->_path = path;
+    this->_callback = std::move(callback);
+    this->_debounce = debounce;
+    this->_stop = false;
+
+#if defined(RCP_WATCH_INOTIFY) || defined(RCP_WATCH_KQUEUE)
+#if defined(RCP_WATCH_INOTIFY)
+    this->_descriptor = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    uint32_t mask = IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO | IN_CREATE;
+    bool watched = this->_descriptor >= 0 && ::inotify_add_watch(this->_descriptor, directory_of(path).c_str(), mask) >= 0;
+#else
+    this->_descriptor = ::kqueue();
+    bool watched = this->_descriptor >= 0;
+#endif
+    if (!watched || ::pipe(this->_wake) != 0) {
+        if (this->_descriptor >= 0) {::close(this->_descriptor);}
+        this->_descriptor = -1;
+        return false;
+    }
+#endif
+
+    this->_thread = std::thread(&FileWatcher::_run, this);
+    return true;
+}
+
+/**
+ * Stop watching, blocks until the watcher thread has finished a running callback
+*/
+void FileWatcher::stop() {
+    if (!this->_thread.joinable()) {return;}
+    {
+        std::lock_guard<std::mutex> lock(this->_mutex);
+        this->_stop = true;
+    }
+    this->_condition.notify_all();
+#if defined(RCP_WATCH_INOTIFY) || defined(RCP_WATCH_KQUEUE)
+    char byte = 0;
+    if (::write(this->_wake[1], &byte, 1) < 0) {}
+#endif
+    this->_thread.join();
+
+#if defined(RCP_WATCH_INOTIFY) || defined(RCP_WATCH_KQUEUE)
+    ::close(this->_descriptor);
+    ::close(this->_wake[0]);
+    ::close(this->_wake[1]);
+    this->_descriptor = -1;
+    this->_wake[0] = -1;
+    this->_wake[1] = -1;
+#endif
+}
+
+/**
+ * Check if the watcher thread is running
+ *
+ * @return true if the watcher was started and not stopped
+*/
+bool FileWatcher::is_running() const {
+    return this->_thread.joinable();
+}
+
+#if defined(RCP_WATCH_INOTIFY)
+/**
+ * Watcher thread, inotify on the directory of the file
+ * Continues with "_poll" if waiting for events fails
+*/
+void FileWatcher::_run() {
+    std::string name = std::filesystem::path(this->_path).filename().string();
+    alignas(struct inotify_event) char buffer[4096];
+    bool changed = false;
+
+    while (!this->_stop) {
+        struct pollfd descriptors[2] = {{this->_descriptor, POLLIN, 0}, {this->_wake[0], POLLIN, 0}};
+        int ready = ::poll(descriptors, 2, changed ? static_cast<int>(this->_debounce.count()) : -1);
+        if (ready < 0 && errno == EINTR) {continue;}
+        if (ready < 0 || (descriptors[0].revents & (POLLERR | POLLNVAL))) {
+            this->_poll(changed);
+            return;
+        }
+        if (descriptors[1].revents != 0) {return;}
+        if (ready == 0) {
+            // Quiet for the debounce interval
+            changed = false;
+            this->_callback();
+            continue;
+        }
+
+        ssize_t length;
+        while ((length = ::read(this->_descriptor, buffer, sizeof(buffer))) > 0) {
+            for (char *cursor = buffer; cursor < buffer + length;) {
+                const struct inotify_event *event = reinterpret_cast<const struct inotify_event*>(cursor);
+                if ((event->mask & IN_Q_OVERFLOW) || (event->len > 0 && name == event->name)) {changed = true;}
+                cursor += sizeof(struct inotify_event) + event->len;
+            }
+        }
+    }
+}
+#elif defined(RCP_WATCH_KQUEUE)
+/**
+ * Watcher thread, kqueue on the directory and the file
+ * The file is reopened when it is deleted or renamed, or when the directory changes.
+ * Continues with "_poll" if waiting for events fails
+*/
+void FileWatcher::_run() {
+    const unsigned file_flags = NOTE_WRITE | NOTE_EXTEND | NOTE_ATTRIB | NOTE_DELETE | NOTE_RENAME;
+    int directory = open_event_only(directory_of(this->_path));
+    int file = open_event_only(this->_path);
+    if (directory >= 0) {add_vnode(this->_descriptor, directory, NOTE_WRITE);}
+    if (file >= 0) {add_vnode(this->_descriptor, file, file_flags);}
+    struct kevent wake;
+    EV_SET(&wake, this->_wake[0], EVFILT_READ, EV_ADD, 0, 0, nullptr);
+    ::kevent(this->_descriptor, &wake, 1, nullptr, 0, nullptr);
+
+    bool changed = false;
+    struct timespec timeout;
+    timeout.tv_sec = static_cast<time_t>(this->_debounce.count() / 1000);
+    timeout.tv_nsec = static_cast<long>((this->_debounce.count() % 1000) * 1000000);
+    struct kevent events[8];
+    bool failed = false;
+    while (!this->_stop) {
+        int count = ::kevent(this->_descriptor, nullptr, 0, events, 8, changed ? &timeout : nullptr);
+        if (count < 0) {
+            if (errno == EINTR) {continue;}
+            failed = true;
+            break;
+        }
+        if (count == 0) {
+            // Quiet for the debounce interval
+            changed = false;
+            this->_callback();
+            continue;
+        }
+
+        bool reopen = false;
+        for (int i = 0; i < count; i++) {
+            int descriptor = static_cast<int>(events[i].ident);
+            if (descriptor == this->_wake[0]) {
+                changed = false;
+                break;
+            }
+            changed = true;
+            if (descriptor == directory || (events[i].fflags & (NOTE_DELETE | NOTE_RENAME))) {reopen = true;}
+        }
+        if (reopen) {
+            if (file >= 0) {::close(file);}
+            file = open_event_only(this->_path);
+            if (file >= 0) {add_vnode(this->_descriptor, file, file_flags);}
+        }
+    }
+    if (file >= 0) {::close(file);}
+    if (directory >= 0) {::close(directory);}
+    if (failed) {this->_poll(changed);}
+}
+#else
+/**
+ * Watcher thread, see "_poll"
+*/
+void FileWatcher::_run() {
+    this->_poll(false);
+}
+#endif
+
+/**
+ * Poll the modification time and size of the file every debounce interval until "stop" is called.
+ * The watcher thread of platforms without inotify or kqueue, and the fallback when waiting for their events fails.
+ *
+ * @param changed a change was seen that has not been reported to the callback yet
+*/
+void FileWatcher::_poll(bool changed) {
+    auto stamp = [this]() {
+        std::error_code error;
+        auto time = std::filesystem::last_write_time(this->_path, error);
+        auto size = std::filesystem::file_size(this->_path, error);
+        return std::make_pair(time, size);
+    };
+    auto last = stamp();
+
+    std::unique_lock<std::mutex> lock(this->_mutex);
+    while (!this->_condition.wait_for(lock, this->_debounce, [this]() {return this->_stop.load();})) {
+        auto current = stamp();
+        if (current != last) {
+            last = current;
+            changed = true;
+        } else if (changed) {
+            changed = false;
+            lock.unlock();
+            this->_callback();
+            lock.lock();
+        }
+    }
+}
+
+}
@@ -0,0 +1,132 @@
+#include "mapped_file.hpp"
+
+#if defined(_WIN32)
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace rcp {
+
+/**
+ * Construct an empty mapping
+*/
+MappedFile::MappedFile() {
+    this->_data = nullptr;
+    this->_size = 0;
+    this->_open = false;
+}
+
+/**
+ * Destruct the mapping
+ * Unmaps the file if it is mapped
+*/
+MappedFile::~MappedFile() {
+    this->close();
+}
+
+/**
+ * Map a file into memory for reading.
+ * Any previous mapping held by this object is released first.
+ *
+ * @param path the file to map
+ *
+ * @return true if the file was mapped
+*/
+bool MappedFile::open(const std::string &path) {
+    this->close();
+
+#if defined(_WIN32)
+    // No mmap: fall back to reading the whole file into a single buffer
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {return false;}
+    size_t size = static_cast<size_t>(file.tellg());
+    char *buffer = nullptr;
+    if (size > 0) {
+        buffer = new char[size];
+        file.seekg(0);
+        if (!file.read(buffer, size)) {
+            delete[] buffer;
+            return false;
+        }
+    }
+    this->_data = buffer;
+    this->_size = size;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {return false;}
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+
+    size_t size = static_cast<size_t>(st.st_size);
+    void *addr = nullptr;
+    if (size > 0) {
+        addr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            ::close(fd);
+            return false;
+        }
+        // Recipes are parsed front to back exactly once
+        ::madvise(addr, size, MADV_SEQUENTIAL);
+    }
+    // The mapping keeps its own reference to the file
+    ::close(fd);
+
+    this->_data = static_cast<const char*>(addr);
+    this->_size = size;
+#endif
+    this->_open = true;
+    return true;
+}
+
+/**
+ * Release the mapping
+*/
+void MappedFile::close() {
+    if (this->_data != nullptr) {
+#if defined(_WIN32)
+        delete[] this->_data;
+#else
+        ::munmap(const_cast<char*>(this->_data), this->_size);
+#endif
+    }
+    this->_data = nullptr;
+    this->_size = 0;
+    this->_open = false;
+}
+
+/**
+ * Check if a file is mapped
+ *
+ * @return true if a file is mapped
+*/
+bool MappedFile::is_open() const {
+    return this->_open;
+}
+
+/**
+ * Get the start of the mapped file contents
+ *
+ * @return pointer to the first byte of the file, or nullptr if the file is empty
+*/
+const char* MappedFile::data() const {
+    return this->_data;
+}
+
+/**
+ * Get the size of the mapped file
+ *
+ * @return the file size in number of bytes
+*/
+size_t MappedFile::size() const {
+    return this->_size;
+}
+
+}
@@ -1,18 +1,196 @@
 #include "recipe.hpp"
+#include "checksum.hpp"
+#include "compression.hpp"
+#include "file_io.hpp"
+#include "file_watcher.hpp"
+#include "mapped_file.hpp"
+#include "recipe_format.hpp"
+#include "recipe_history.hpp"
+#include "recipe_source.hpp"
+#include "recipe_writer.hpp"
+#include "seqlock.hpp"
+#include "stats_probe.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
 
 namespace rcp {
 
+namespace {
+
+// Bytes read with the header from a source, enough for the whole index of most recipes
+constexpr uint64_t SOURCE_PREFETCH = 64 << 10;
+// Bytes of data blocks fetched from a source per read
+constexpr uint64_t SOURCE_BATCH_SIZE = 64 << 20;
+
+// Check the index of a v2 file (everything in front of the data blocks) against the trailer checksum
+bool verify_index(const format::Header &header, const char *index, const char *trailer_buffer) {
+    if (!(header.flags & format::HEADER_HAS_TRAILER)) {return true;}
+    format::Trailer trailer;
+    if (!format::decode_trailer(trailer_buffer, trailer)) {return false;}
+    return crc32c(0, index, header.data_offset) == trailer.index_checksum;
+}
+
+// Check a stored data block against its TOC entry checksum
+bool verify_entry(const format::TocEntry &entry, const char *data) {
+    if (!(entry.flags & format::ENTRY_HAS_CHECKSUM)) {return true;}
+    return crc32c(0, data, entry.stored_size) == entry.checksum;
+}
+
+// Check if a raw stored entry can be copied into a registered variable as is
+// Untyped variables and entries (type 0) only need a matching size
+bool entry_matches(const RecipeItem &item, const format::TocEntry &entry) {
+    return item.size == entry.size && (item.type == entry.type || item.type == 0 || entry.type == 0);
+}
+
+// Read a stored value straight into its destination in chunks of at most "chunk_size" bytes
+// Each chunk is checksummed while it is still in cache
+bool read_chunked(std::ifstream &file, char *destination, uint64_t size, size_t chunk_size, uint32_t &checksum) {
+    checksum = 0;
+    if (chunk_size == 0) {chunk_size = SIZE_MAX;}
+    for (uint64_t offset = 0; offset < size; offset += chunk_size) {
+        size_t length = static_cast<size_t>(std::min<uint64_t>(chunk_size, size - offset));
+        if (!file.read(destination + offset, length)) {return false;}
+        checksum = crc32c(checksum, destination + offset, length);
+    }
+    return true;
+}
+
+// Pass a stored value to a stream reader in chunks of at most "chunk_size" bytes, through one chunk buffer
+bool read_stream(std::ifstream &file, const RecipeStream &stream, uint64_t size, size_t chunk_size, uint32_t &checksum) {
+    checksum = 0;
+    if (chunk_size == 0) {chunk_size = SIZE_MAX;}
+    std::vector<char> buffer(static_cast<size_t>(std::min<uint64_t>(chunk_size, size)));
+    if (size == 0) {return stream.reader(buffer.data(), 0, 0, 0);}
+    for (uint64_t offset = 0; offset < size; offset += buffer.size()) {
+        size_t length = static_cast<size_t>(std::min<uint64_t>(buffer.size(), size - offset));
+        if (!file.read(buffer.data(), length)) {return false;}
+        checksum = crc32c(checksum, buffer.data(), length);
+        if (!stream.reader(buffer.data(), length, offset, size)) {return false;}
+    }
+    return true;
+}
+
+// Pass a stored value in memory to a stream reader in chunks of at most "chunk_size" bytes
+bool feed_stream(const RecipeStream &stream, const char *data, uint64_t size, size_t chunk_size) {
+    if (chunk_size == 0) {chunk_size = SIZE_MAX;}
+    if (size == 0) {return stream.reader(data, 0, 0, 0);}
+    for (uint64_t offset = 0; offset < size; offset += chunk_size) {
+        size_t length = static_cast<size_t>(std::min<uint64_t>(chunk_size, size - offset));
+        if (!stream.reader(data + offset, length, offset, size)) {return false;}
+    }
+    return true;
+}
+
+// Compare the checksum of a value read with "read_chunked" or "read_stream" to its TOC entry
+bool checksum_matches(const format::TocEntry &entry, uint32_t checksum) {
+    return !(entry.flags & format::ENTRY_HAS_CHECKSUM) || checksum == entry.checksum;
+}
+
+// Identify the stored content of an entry, a changed digest means the entry must be reloaded
+uint64_t entry_digest(const format::TocEntry &entry) {
+    uint64_t digest = detail::mix(detail::FNV_OFFSET, static_cast<uint64_t>(entry.checksum));
+    digest = detail::mix(digest, entry.size);
+    digest = detail::mix(digest, entry.stored_size);
+    digest = detail::mix(digest, static_cast<uint64_t>(entry.codec));
+    return detail::mix(digest, entry.type);
+}
+
+// Call function(record, data) for each valid record of a journal in append order
+// Returns the end of the valid records, 0 if the journal header is invalid
+template <typename Function>
+uint64_t scan_journal(const char *journal, size_t size, Function function) {
+    if (!format::decode_journal_header(journal, size)) {return 0;}
+    format::JournalRecord record;
+    uint64_t offset = format::JOURNAL_HEADER_SIZE;
+    while (format::decode_journal_record(journal + offset, size - offset, record)) {
+        const char *data = journal + offset + format::JOURNAL_RECORD_SIZE;
+        if (format::journal_checksum(record, data) != record.checksum) {break;}
+        function(record, data);
+        offset += format::JOURNAL_RECORD_SIZE + record.size;
+    }
+    return offset;
+}
+
+// Look up a key of a map ordered with std::less<>, inserting a default value if it is missing
+// Only allocates a key string on insertion
+template <typename Map>
+typename Map::mapped_type& find_or_insert(Map &map, std::string_view key) {
+    auto value = map.find(key);
+    if (value == map.end()) {value = map.emplace(key, typename Map::mapped_type()).first;}
+    return value->second;
+}
+
+// Assign a value to a key of a map ordered with std::less<>, or erase the key if the value is empty
+template <typename Map, typename Value>
+void assign_or_erase(Map &map, std::string_view key, Value value) {
+    auto existing = map.find(key);
+    if (value) {
+        if (existing != map.end()) {
+            existing->second = std::move(value);
+        } else {
+            map.emplace(key, std::move(value));
+        }
+    } else if (existing != map.end()) {
+        map.erase(existing);
+    }
+}
+
+// Run function(0) ... function(count - 1) on up to "threads" threads, the calling thread included
+template <typename Function>
+void parallel_for(unsigned threads, size_t count, Function function) {
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i = next++; i < count; i = next++) {function(i);}
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads && t < count; t++) {pool.emplace_back(worker);}
+    worker();
+    for (std::thread &thread: pool) {thread.join();}
+}
+
+}
+
 /**
  * Construct a Recipe
  * Recipe name is blank and must be set by the "set_name" method before the recipe can be initialized
+ * 
+ * @param resource the memory resource of the variable registry and of the buffers used by loads and saves
 */
-Recipe::Recipe():
-    _map()
+Recipe::Recipe(std::pmr::memory_resource *resource):
+    _resource(resource), _registry(resource), _layout_index(resource), _shadow(resource), _converters(resource),
+    _staged(resource), _staged_data(resource), _change_callbacks(resource), _loaded(resource), _journal_buffer(resource)
 {
     this->_folder = "";
     this->_name = "";
     this->_extension = ".rcp";
     this->_init = false;
+    this->_load_mode = LoadMode::Stream;
+    this->_file_format = FileFormat::V1;
+    this->_dirty_tracking = DirtyTracking::None;
+    this->_layout_valid = false;
+    this->_layout_size = 0;
+    this->_save_mode = SaveMode::Direct;
+    this->_sync_mode = SyncMode::Never;
+    this->_sync_parameter = 0;
+    this->_saves_since_sync = 0;
+    this->_chunk_size = 4 << 20;
+    this->_codec = Codec::None;
+    this->_compression_threshold = 4096;
+    this->_concurrency = Concurrency::None;
+    this->_watching = false;
+    this->_journal_mode = JournalMode::None;
+    this->_journal_limit = 16 << 20;
+    this->_journal_size = 0;
+    this->_observer = nullptr;
+    this->_source = nullptr;
+    this->_version = 0;
+    this->_snapshot_interval = 16;
+    this->_update_path();
 }
 
 /**
@@ -21,35 +199,64 @@ Recipe::Recipe():
  * @param name the recipe file name
  * @param folder the directory to store the recipe file
  * @param extension the recipe file extension
+ * @param resource the memory resource of the variable registry and of the buffers used by loads and saves
 */
-Recipe::Recipe(std::string name, std::string folder, std::string extension):
-    _map()
+Recipe::Recipe(std::string name, std::string folder, std::string extension, std::pmr::memory_resource *resource):
+    _resource(resource), _registry(resource), _layout_index(resource), _shadow(resource), _converters(resource),
+    _staged(resource), _staged_data(resource), _change_callbacks(resource), _loaded(resource), _journal_buffer(resource)
 {
-    this->_name = name;
-    this->_folder = folder;
-    this->_extension = extension;
+    this->_name = std::move(name);
+    this->_folder = std::move(folder);
+    this->_extension = std::move(extension);
     this->_init = false;
+    this->_load_mode = LoadMode::Stream;
+    this->_file_format = FileFormat::V1;
+    this->_dirty_tracking = DirtyTracking::None;
+    this->_layout_valid = false;
+    this->_layout_size = 0;
+    this->_save_mode = SaveMode::Direct;
+    this->_sync_mode = SyncMode::Never;
+    this->_sync_parameter = 0;
+    this->_saves_since_sync = 0;
+    this->_chunk_size = 4 << 20;
+    this->_codec = Codec::None;
+    this->_compression_threshold = 4096;
+    this->_concurrency = Concurrency::None;
+    this->_watching = false;
+    this->_journal_mode = JournalMode::None;
+    this->_journal_limit = 16 << 20;
+    this->_journal_size = 0;
+    this->_observer = nullptr;
+    this->_source = nullptr;
+    this->_version = 0;
+    this->_snapshot_interval = 16;
+    this->_update_path();
 }
 
 /**
  * Destruct the recipe
- * Delete dynamically allocated RecipeItem pointers
+ * Stops watching the recipe file and waits for pending asynchronous saves
 */
 Recipe::~Recipe() {
-    // Iterate all elements in the list
-    // delete the RecipeItem pointer for each element
-    for (auto p: this->_map) {delete p.second;}
+    this->stop_watch();
 }
 
 /**
  * Initialize the recipe.
  * Check if the file and target directory exists
  * Creates the directory and / or file if they dont.
+ * With a source set (see "set_source"), checks that the source holds a recipe file instead.
  * 
  * @return true if the initialization was successfull.
 */
 bool Recipe::init() {
+    TRC_SPAN("recipe", "Recipe::init");
     if (this->_name == "") {return false;}
+    if (this->_source != nullptr) {
+        uint64_t size;
+        this->_init = this->_source->size(size);
+        return this->_init;
+    }
 
     std::string path_string = this->get_path();
     if (std::filesystem::exists(path_string)) {
@@ -76,6 +283,9 @@ bool Recipe::init() {
 */
 void Recipe::stop() {
     this->_init = false;
+    this->_layout_valid = false;
+    this->_journal.reset();
+    this->_history.reset();
 }
 
 /**
@@ -89,14 +299,218 @@ void Recipe::stop() {
  * 
  * @return true if the variable was added to the recipe
 */
-bool Recipe::add_variable(std::string id, char *var, size_t size) {
-    if (this->_map.count(id) > 0) {return false;}
+bool Recipe::add_variable(std::string_view id, char *var, size_t size) {
+    return this->_add_variable(id, var, size, 0);
+}
+
+/**
+ * Adds a variable guarded by a SeqLock to the recipe.
+ * Other threads write the variable between "write_begin" and "write_end" of the lock.
+ * Loads assign the variable under the lock, saves in Concurrency::Concurrent mode and asynchronous saves copy it under the lock.
+ * Several variables may share one lock.
+ * The variable will only be added if the identifier "id" is not yet registered in the recipe.
+ * 
+ * @param id a unique identifier for the variable linked to this recipe
+ * @param var a char pointer to the variable
+ * @param size the size of the variable in number of bytes
+ * @param lock the lock guarding the variable, must outlive the registration
+ * 
+ * @return true if the variable was added to the recipe
+*/
+bool Recipe::add_variable(std::string_view id, char *var, size_t size, SeqLock &lock) {
+    return this->_add_variable(id, var, size, 0, &lock);
+}
+
+/**
+ * Adds a variable with a type fingerprint to the recipe.
+ * Used by the typed "add_variable".
+ * 
+ * @param id a unique identifier for the variable linked to this recipe
+ * @param var a char pointer to the variable
+ * @param size the size of the variable in number of bytes
+ * @param type the type fingerprint, 0 for untyped
+ * @param lock the lock guarding the variable, nullptr for unguarded
+ * 
+ * @return true if the variable was added to the recipe
+*/
+bool Recipe::_add_variable(std::string_view id, char *var, size_t size, uint64_t type, SeqLock *lock) {
+    std::unique_lock<std::mutex> guard = this->_lock();
+    RecipeItem *item = this->_registry.insert(id, var, size, type);
+    if (item == nullptr) {return false;}
+    item->lock = lock;
+    this->_registry_changed();
+    return true;
+}
+
+/**
+ * Lock the registry in Concurrency::Concurrent mode
+ * 
+ * @return a lock on the registry, or an empty lock in Concurrency::None mode
+*/
+std::unique_lock<std::mutex> Recipe::_lock() {
+    if (this->_concurrency == Concurrency::None) {return std::unique_lock<std::mutex>();}
+    return std::unique_lock<std::mutex>(this->_mutex);
+}
+
+/**
+ * Invalidate the saved layout and the published registry snapshot after the registry changed.
+ * Requires the registry lock.
+*/
+void Recipe::_registry_changed() {
+    this->_layout_valid = false;
+    if (this->_concurrency == Concurrency::Concurrent) {
+        std::atomic_store(&this->_published, std::shared_ptr<const RecipeRegistry>());
+    }
+}
+
+/**
+ * Get an immutable snapshot of the registry.
+ * The snapshot is copied on the first call after the registry changed, under the registry lock,
+ * later calls share it without locking.
+ * Writers never modify a published snapshot, so it stays valid while the registry changes.
+ * 
+ * @return the registry snapshot
+*/
+std::shared_ptr<const RecipeRegistry> Recipe::_acquire_registry() {
+    std::shared_ptr<const RecipeRegistry> registry = std::atomic_load(&this->_published);
+    if (registry) {return registry;}
+
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    registry = std::atomic_load(&this->_published);
+    if (!registry) {
+        registry = std::allocate_shared<RecipeRegistry>(std::pmr::polymorphic_allocator<RecipeRegistry>(this->_resource), this->_registry);
+        std::atomic_store(&this->_published, registry);
+    }
+    return registry;
+}
+
+/**
+ * Adds a streamed variable to the recipe.
+ * A streamed variable is not stored contiguously in memory, or is too large to hold twice.
+ * "save_recipe" calls the writer, which passes the value to a sink in pieces of any size,
+ * "load_recipe" and "load_variable" call the reader once per chunk of the stored value (see "set_chunk_size"),
+ * a value of a V2 file is read whole and checked against its checksum before the first call.
+ * The variable will only be added if the identifier "id" is not yet registered in the recipe.
+ * This will NOT modify the recipe file before a call to "save_recipe".
+ * 
+ * @param id a unique identifier for the variable linked to this recipe
+ * @param reader consumes the stored value on load
+ * @param writer produces the value on save
+ * 
+ * @return true if the variable was added to the recipe
+*/
+bool Recipe::add_stream_variable(std::string_view id, StreamReader reader, StreamWriter writer) {
+    if (!reader || !writer) {return false;}
+    std::unique_lock<std::mutex> lock = this->_lock();
+    if (this->_registry.insert_stream(id, std::move(reader), std::move(writer)) == nullptr) {return false;}
+    this->_registry_changed();
+    return true;
+}
+
+/**
+ * Set the converter of a variable.
+ * "load_recipe" and "load_variable" call the converter instead of skipping a stored value
+ * whose size or type fingerprint does not match the registered variable.
+ * The converter receives the stored bytes, their size and stored type fingerprint (0 if untyped),
+ * and returns true if it assigned the variable.
+ * 
+ * @param id the identifier of a variable registered in this recipe.
+ * @param converter the converter, or an empty function to remove it
+ * 
+ * @return true if the variable is registered.
+*/
+bool Recipe::set_converter(std::string_view id, Converter converter) {
+    std::unique_lock<std::mutex> lock = this->_lock();
+    if (this->_registry.find(id) == nullptr) {return false;}
+    assign_or_erase(this->_converters, id, std::move(converter));
+    return true;
+}
+
+/**
+ * Set the change callback of a variable.
+ * "reload_changed" calls the callback after it assigned a changed stored value to the variable,
+ * on the thread running the reload (the watcher thread, see "start_watch") and without holding any recipe lock.
+ * 
+ * @param id the identifier of a variable registered in this recipe.
+ * @param callback the callback, or an empty function to remove it
+ * 
+ * @return true if the variable is registered.
+*/
+bool Recipe::set_change_callback(std::string_view id, ChangeCallback callback) {
+    std::unique_lock<std::mutex> lock = this->_lock();
+    if (this->_registry.find(id) == nullptr) {return false;}
+    assign_or_erase(this->_change_callbacks, id, std::move(callback));
+    return true;
+}
+
+/**
+ * Pass a mismatching stored value to the converter of a variable.
+ * 
+ * @param id the identifier of the variable
+ * @param data the stored value
+ * @param size the stored value size
+ * @param type the stored type fingerprint
+ * 
+ * @return true if the converter assigned the variable
+*/
+bool Recipe::_convert(std::string_view id, const char *data, size_t size, uint64_t type) {
+    if (this->_converters.empty()) {return false;}
+    auto converter = this->_converters.find(id);
+    if (converter == this->_converters.end()) {return false;}
+    return converter->second(data, size, type);
+}
+
+/**
+ * Assign a stored V2 value to a registered variable.
+ * Values matching the variable are copied or decompressed straight into it.
+ * Values for streamed variables and values passed to a converter are decompressed whole first.
+ * 
+ * @param item the variable
+ * @param entry the TOC entry of the stored value
+ * @param stored the stored value, already checked against its checksum
+ * @param assigned receives whether the variable was assigned, optional
+ * 
+ * @return false if the stored value could not be decompressed or a stream reader failed
+*/
+bool Recipe::_apply_entry(RecipeItem &item, const format::TocEntry &entry, const char *stored, bool *assigned) {
+    bool ignored;
+    if (assigned == nullptr) {assigned = &ignored;}
+    *assigned = false;
 
-    RecipeItem *item = new RecipeItem;
-    item->ptr = var;
-    item->size = size;
+    const RecipeStream *stream = this->_registry.stream(item);
+    Codec codec = static_cast<Codec>(entry.codec);
+    if (stream == nullptr && entry_matches(item, entry)) {
+        SeqLockGuard guard(item.lock);
+        if (!decompress(codec, stored, entry.stored_size, item.ptr, item.size)) {return false;}
+        *assigned = true;
+        stats_entry();
+        return true;
+    }
+    if (stream == nullptr && this->_converters.find(this->_registry.id(item)) == this->_converters.end()) {
+        stats_skipped_mismatch();
+        return true;
+    }
 
-    this->_map.emplace(id, item);
+    std::pmr::vector<char> value(this->_resource);
+    const char *decoded = stored;
+    if (entry.codec != format::CODEC_RAW) {
+        value.resize(entry.size);
+        stats_allocation();
+        if (!decompress(codec, stored, entry.stored_size, value.data(), value.size())) {return false;}
+        decoded = value.data();
+    }
+    if (stream != nullptr) {
+        if (!feed_stream(*stream, decoded, entry.size, this->_chunk_size)) {return false;}
+        *assigned = true;
+        stats_entry();
+        return true;
+    }
+    *assigned = this->_convert(this->_registry.id(item), decoded, entry.size, entry.type);
+    if (*assigned) {
+        stats_entry();
+    } else {
+        stats_skipped_mismatch();
+    }
     return true;
 }
 
@@ -109,11 +523,42 @@ bool Recipe::add_variable(std::string id, char *var, size_t size) {
  * 
  * @return true if the variable was removed.
 */
-bool Recipe::remove_variable(std::string id) {
-    if (this->_map.count(id) == 0) {return false;}
-    RecipeItem *item = this->_map[id];
-    this->_map.erase(id);
-    delete item;
+bool Recipe::remove_variable(std::string_view id) {
+    std::unique_lock<std::mutex> lock = this->_lock();
+    if (!this->_registry.erase(id)) {return false;}
+    assign_or_erase(this->_converters, id, Converter());
+    assign_or_erase(this->_change_callbacks, id, ChangeCallback());
+    this->_registry_changed();
+    return true;
+}
+
+/**
+ * Reserve registry space for "count" variables with "id_bytes" id characters in total.
+ * Registering up to that many variables afterwards does not allocate,
+ * and the index buffer of full V2 saves is sized for them as well.
+ * 
+ * @param count the number of variables
+ * @param id_bytes the total length of their ids
+*/
+void Recipe::reserve(size_t count, size_t id_bytes) {
+    std::unique_lock<std::mutex> lock = this->_lock();
+    this->_registry.reserve(count, id_bytes);
+    this->_layout_index.reserve(format::align_up(format::HEADER_SIZE + count * format::TOC_ENTRY_SIZE + id_bytes));
+}
+
+/**
+ * Flag a variable as changed.
+ * With dirty tracking enabled, the next "save_recipe" rewrites this variable.
+ * 
+ * @param id the identifier of a variable registered in this recipe.
+ * 
+ * @return true if the variable was flagged.
+*/
+bool Recipe::mark_dirty(std::string_view id) {
+    std::unique_lock<std::mutex> lock = this->_lock();
+    RecipeItem *item = this->_registry.find(id);
+    if (item == nullptr) {return false;}
+    item->dirty = true;
     return true;
 }
 
@@ -123,148 +568,1925 @@ bool Recipe::remove_variable(std::string id) {
  * Application variables not present in the recipe file will not be modified.
  * Variables present in the recipe file, but not present in the application recipe will be skipped.
  * 
+ * The file is read according to the current load mode (see "set_load_mode"),
+ * or from the source if one is set (see "set_source").
+ * With JournalMode::Append the journal is replayed on top of the recipe file.
+ * In Concurrency::Concurrent mode the registry is locked for the whole load.
+ * 
  * @return true if the recipe values were written to application variables
 */
 bool Recipe::load_recipe() {
-    if (!this->_init) {return false;}
+    TRC_SPAN("recipe", "Recipe::load_recipe");
+    StatsScope scope(this->_observer, this->_name, RecipeOperation::Load);
+    if (!this->_init) {return scope.finish(false);}
+    std::unique_lock<std::mutex> lock = this->_lock();
+    return scope.finish(this->_load());
+}
 
-    std::ifstream file;
-    std::string id;
-    char character;
-    size_t size;
+/**
+ * Load the recipe file according to the current load mode, followed by the journal.
+ * Requires the registry lock.
+ * 
+ * @return true if the recipe values were written to application variables
+*/
+bool Recipe::_load() {
+    this->_load_error = LoadError();
+    if (this->_source != nullptr) {return this->_load_source() && this->_replay_journal();}
+    bool loaded;
+    switch (this->_load_mode) {
+        case LoadMode::Mapped:
+            loaded = this->_load_mapped();
+            break;
+        case LoadMode::Stream:
+        default:
+            loaded = this->_load_stream();
+            break;
+    }
+    return loaded && this->_replay_journal();
+}
 
-    file.open(this->get_path());
-    while (file.peek(), !file.eof()) {
-        size_t num_bytes = 0;
+/**
+ * Load the recipe file through std::ifstream.
+ * Values are read straight into the application variables, in chunks of at most the chunk size (see "set_chunk_size").
+ * Every length is checked against the rest of the file before anything is allocated or read,
+ * an invalid or truncated record aborts the load and is reported by "get_load_error", values read before it are kept.
+ * 
+ * @return true if the recipe values were written to application variables
+*/
+bool Recipe::_load_stream() {
+    std::ifstream file;
+    std::pmr::string id(this->_resource);
+    char length[format::V1_LENGTH_SIZE];
 
-        // Read ID
-        id = "";
-        file.read((char*)&size, sizeof(size));
-        for (size_t i = 0; i < size; i++) {
-            file.read(&character, 1);
-            id += character;
-        }
-        num_bytes += size;
+    file.open(this->get_path(), std::ios::binary);
+    if (!file.is_open()) {return this->_fail(LoadStatus::OpenFailed, 0);}
 
-        // Read data
-        file.read((char*)&size, sizeof(size));
-        char *data = new char[size];
-        file.read(data, size);
-        num_bytes += size;
+    // Dispatch on file format
+    char magic[sizeof(format::MAGIC)];
+    file.read(magic, sizeof(magic));
+    if (format::has_magic(magic, file.gcount())) {
+        return this->_load_stream_v2(file);
+    }
+    file.clear();
+    file.seekg(0, std::ios::end);
+    uint64_t file_size = static_cast<uint64_t>(file.tellg());
+    file.seekg(0);
+    stats_phase(RecipePhase::Copy);
 
-        // Check for padding
-        if (num_bytes % 2 != 0) {
-            file.read(&character, 1);
-        }
+    uint64_t offset = 0;
+    while (offset < file_size) {
+        uint64_t record = offset;
 
-        // Comare recipe variable to variable in memory
-        if (this->_map.count(id) == 0) {
-            delete[] data;
-            continue;
-        }
+        // Read ID
+        if (file_size - offset < format::V1_LENGTH_SIZE) {return this->_fail(LoadStatus::Truncated, offset);}
+        if (!file.read(length, sizeof(length))) {return this->_fail(LoadStatus::Truncated, offset);}
+        uint64_t id_length = format::decode_v1_length(length);
+        if (id_length > format::V1_MAX_ID_LENGTH) {return this->_fail(LoadStatus::Corrupt, offset);}
+        offset += format::V1_LENGTH_SIZE;
+        if (id_length > file_size - offset) {return this->_fail(LoadStatus::Truncated, record);}
+        id.resize(id_length);
+        if (!file.read(&id[0], id_length)) {return this->_fail(LoadStatus::Truncated, offset);}
+        offset += id_length;
 
-        RecipeItem *item = this->_map[id];
+        // Read data size
+        uint64_t size_offset = offset;
+        if (file_size - offset < format::V1_LENGTH_SIZE) {return this->_fail(LoadStatus::Truncated, offset);}
+        if (!file.read(length, sizeof(length))) {return this->_fail(LoadStatus::Truncated, offset);}
+        uint64_t size = format::decode_v1_length(length);
+        offset += format::V1_LENGTH_SIZE;
+        if (size > file_size - offset) {return this->_fail(LoadStatus::Truncated, size_offset);}
+        if (size > SIZE_MAX) {return this->_fail(LoadStatus::Corrupt, size_offset);}
+        stats_read(2 * format::V1_LENGTH_SIZE + id_length);
 
-        if (item->size != size) {
-            delete[] data;
-            continue;
+        // Read data straight into the matching variable, skip it otherwise
+        RecipeItem *item = this->_registry.find(id);
+        const RecipeStream *stream = item == nullptr ? nullptr : this->_registry.stream(*item);
+        uint32_t checksum;
+        if (stream != nullptr) {
+            if (!read_stream(file, *stream, size, this->_chunk_size, checksum)) {return this->_fail(LoadStatus::Rejected, offset);}
+            stats_read(size);
+            stats_allocation();
+            stats_entry();
+        } else if (item != nullptr && item->size == size) {
+            SeqLockGuard guard(item->lock);
+            if (!read_chunked(file, item->ptr, size, this->_chunk_size, checksum)) {return this->_fail(LoadStatus::Truncated, offset);}
+            stats_read(size);
+            stats_entry();
+        } else if (item != nullptr && !this->_converters.empty()) {
+            std::pmr::vector<char> data(static_cast<size_t>(size), this->_resource);
+            stats_allocation();
+            if (!file.read(data.data(), size)) {return this->_fail(LoadStatus::Truncated, offset);}
+            stats_read(size);
+            if (this->_convert(id, data.data(), data.size(), 0)) {
+                stats_entry();
+            } else {
+                stats_skipped_mismatch();
+            }
+        } else {
+            file.seekg(size, std::ios::cur);
+            if (item == nullptr) {
+                stats_skipped_unknown();
+            } else {
+                stats_skipped_mismatch();
+            }
         }
+        offset += size;
 
-        // Copy recipe data to memory
-        for (size_t i = 0; i < size; i++) {
-            item->ptr[i] = data[i];
+        // Skip padding, the last record may lack it
+        if ((id_length + size) % 2 != 0 && offset < file_size) {
+            file.seekg(1, std::ios::cur);
+            offset += 1;
         }
-
-        // Release temporary data array
-        delete[] data;
-    }   
-
+    }
 
     file.close();
     return true;
 }
 
 /**
- * Saves the application variable values to the recipe file.
- * This will overwrite any previous recipe.
- * If any varables were removed from the application recipe since the previous save, these will no longer be present in the new recipe file.
+ * Load the recipe file through a read-only memory mapping.
+ * Ids are compared and values are copied directly from the mapping,
+ * so no temporary buffer is allocated per record.
+ * Every length is checked against the rest of the mapping,
+ * an invalid or truncated record aborts the load and is reported by "get_load_error", values copied before it are kept.
  * 
- * @return true if the recipe was successfully saved.
+ * @return true if the recipe values were written to application variables
 */
-bool Recipe::save_recipe() {
-    if (!this->_init) {return false;}
-
-    std::ofstream file;
-    file.open(this->get_path());
-    char padding = 0;
-    for (auto var: this->_map) {
-        size_t id_size = var.first.length();
-        file.write((char*)&id_size, sizeof(id_size));
-        file.write((char*)&var.first.front(), id_size);
-        file.write((char*)&var.second->size, sizeof(var.second->size));
-        file.write(var.second->ptr, var.second->size);
-        size_t num_bytes = id_size + var.second->size;
-        if (num_bytes % 2 != 0) {file.write(&padding, 1);}
+bool Recipe::_load_mapped() {
+    MappedFile map;
+    if (!map.open(this->get_path())) {return this->_fail(LoadStatus::OpenFailed, 0);}
+    if (format::has_magic(map.data(), map.size())) {
+        return this->_load_mapped_v2(map.data(), map.size());
     }
-    file.close();
-    return true;    
+    return this->_load_mapped_v1(map.data(), map.size());
 }
 
 /**
- * Check if the recipe is initialized
+ * Load a v1 recipe file from memory.
+ * Every length is checked against the rest of the file,
+ * an invalid or truncated record aborts the load and is reported by "get_load_error", values copied before it are kept.
  * 
- * @return true if the recipe is initialized
+ * @param file the file contents
+ * @param file_size the file size
+ * 
+ * @return true if the recipe values were written to application variables
 */
-bool Recipe::is_init() {
-    return this->_init;
-}
+bool Recipe::_load_mapped_v1(const char *file, size_t file_size) {
+    stats_phase(RecipePhase::Copy);
 
+    uint64_t offset = 0;
+    while (offset < file_size) {
+        uint64_t record = offset;
 
-/**
- * Check the current recipe path
- * 
- * @return the current recipe path
-*/
-std::string Recipe::get_path() {
-    return this->_folder + this->_name + this->_extension;
+        // Read ID
+        if (file_size - offset < format::V1_LENGTH_SIZE) {return this->_fail(LoadStatus::Truncated, offset);}
+        uint64_t id_length = format::decode_v1_length(file + offset);
+        if (id_length > format::V1_MAX_ID_LENGTH) {return this->_fail(LoadStatus::Corrupt, offset);}
+        offset += format::V1_LENGTH_SIZE;
+        if (id_length > file_size - offset) {return this->_fail(LoadStatus::Truncated, record);}
+        std::string_view id(file + offset, id_length);
+        offset += id_length;
+
+        // Read data
+        uint64_t size_offset = offset;
+        if (file_size - offset < format::V1_LENGTH_SIZE) {return this->_fail(LoadStatus::Truncated, offset);}
+        uint64_t size = format::decode_v1_length(file + offset);
+        offset += format::V1_LENGTH_SIZE;
+        if (size > file_size - offset) {return this->_fail(LoadStatus::Truncated, size_offset);}
+        const char *data = file + offset;
+        offset += size;
+
+        // Skip padding, the last record may lack it
+        if ((id_length + size) % 2 != 0 && offset < file_size) {offset += 1;}
+
+        // Compare recipe variable to variable in memory
+        RecipeItem *item = this->_registry.find(id);
+        if (item == nullptr) {
+            stats_skipped_unknown();
+            continue;
+        }
+        stats_read(id_length + size);
+        const RecipeStream *stream = this->_registry.stream(*item);
+        if (stream != nullptr) {
+            if (!feed_stream(*stream, data, size, this->_chunk_size)) {return this->_fail(LoadStatus::Rejected, data - file);}
+            stats_entry();
+            continue;
+        }
+        if (item->size != size) {
+            if (this->_convert(id, data, size, 0)) {
+                stats_entry();
+            } else {
+                stats_skipped_mismatch();
+            }
+            continue;
+        }
+
+        // Copy recipe data to memory
+        SeqLockGuard guard(item->lock);
+        if (size > 0) {std::memcpy(item->ptr, data, size);}
+        stats_entry();
+    }
+
+    return true;
 }
 
 /**
- * Set the recipe file name
- * This will call the "stop" method and the recipe must be reinitialized before any new calls to "load_recipe" or "save_recipe" can be made.
+ * Load a v2 recipe file through std::ifstream.
+ * The index (header, table of contents and string table) is read in one piece and checked against the trailer,
+ * Values carrying a checksum are read into one reused buffer, in chunks of at most the chunk size,
+ * and checked before they are copied or decompressed into the application variables,
+ * so an entry failing its checksum aborts the load with the affected variable untouched.
+ * Raw values without a checksum are read straight into the application variables.
  * 
- * @param name the new file name
+ * @param file the open recipe file
+ * 
+ * @return true if the recipe values were written to application variables
 */
-void Recipe::set_name(std::string name) {
-    this->_name = name;
-    this->stop();
-}
+bool Recipe::_load_stream_v2(std::ifstream &file) {
+    stats_phase(RecipePhase::Parse);
+    format::Header header;
+    char header_buffer[format::HEADER_SIZE];
+    file.seekg(0, std::ios::end);
+    uint64_t file_size = static_cast<uint64_t>(file.tellg());
+    file.seekg(0);
+    if (!file.read(header_buffer, sizeof(header_buffer))) {return this->_fail(LoadStatus::Truncated, 0);}
+    if (!format::decode_header(header_buffer, sizeof(header_buffer), header)) {return this->_fail(LoadStatus::Corrupt, 0);}
+    if (!format::validate_header(header, file_size)) {return this->_fail(LoadStatus::Corrupt, 0);}
+
+    // Read and verify the index
+    std::pmr::vector<char> index(header.data_offset, this->_resource);
+    char trailer[format::TRAILER_SIZE];
+    stats_allocation();
+    file.seekg(0);
+    if (!file.read(index.data(), index.size())) {return this->_fail(LoadStatus::Truncated, 0);}
+    if (header.flags & format::HEADER_HAS_TRAILER) {
+        file.seekg(file_size - format::TRAILER_SIZE);
+        if (!file.read(trailer, sizeof(trailer))) {return this->_fail(LoadStatus::Truncated, file_size - format::TRAILER_SIZE);}
+    }
+    stats_read(index.size() + sizeof(trailer));
+    if (!verify_index(header, index.data(), trailer)) {return this->_fail(LoadStatus::Corrupt, 0);}
+    const char *strings = index.data() + header.strings_offset;
+    stats_phase(RecipePhase::Copy);
+
+    format::TocEntry entry;
+    std::pmr::vector<char> stored(this->_resource);
+    for (uint64_t i = 0; i < header.entry_count; i++) {
+        uint64_t entry_offset = header.toc_offset + i * format::TOC_ENTRY_SIZE;
+        format::decode_entry(index.data() + entry_offset, entry);
+        if (!format::validate_entry(entry, header)) {return this->_fail(LoadStatus::Corrupt, entry_offset);}
+
+        std::string_view id(strings + entry.id_offset, entry.id_length);
+        RecipeItem *item = this->_registry.find(id, entry.hash);
+        if (item == nullptr) {
+            stats_skipped_unknown();
+            continue;
+        }
+        const RecipeStream *stream = this->_registry.stream(*item);
+        bool matches = stream == nullptr && entry_matches(*item, entry);
+        if (stream == nullptr && !matches && this->_converters.empty()) {
+            stats_skipped_mismatch();
+            continue;
+        }
+
+        file.seekg(entry.offset);
+        stats_read(entry.stored_size);
+        uint32_t checksum;
+        if (entry.codec == format::CODEC_RAW && matches && !(entry.flags & format::ENTRY_HAS_CHECKSUM)) {
+            SeqLockGuard guard(item->lock);
+            if (!read_chunked(file, item->ptr, item->size, this->_chunk_size, checksum)) {return this->_fail(LoadStatus::Truncated, entry.offset);}
+            stats_entry();
+            continue;
+        }
 
+        // Checked values, compressed values and values passed to a converter or stream reader are read whole first
+        if (stored.capacity() < entry.stored_size) {stats_allocation();}
+        stored.resize(entry.stored_size);
+        if (!read_chunked(file, stored.data(), stored.size(), this->_chunk_size, checksum)) {return this->_fail(LoadStatus::Truncated, entry.offset);}
+        if (!checksum_matches(entry, checksum)) {return this->_fail(LoadStatus::Corrupt, entry.offset);}
+        if (!this->_apply_entry(*item, entry, stored.data())) {return this->_fail(LoadStatus::Rejected, entry.offset);}
+    }
+    return true;
+}
 
 /**
- * Set the recipe directory
- * This will call the "stop" method and the recipe must be reinitialized before any new calls to "load_recipe" or "save_recipe" can be made.
+ * Load a v2 recipe file from a memory mapping.
+ * Entries are checked against their checksum before they are copied or decompressed into the application variables.
  * 
- * @param folder the new driectory name
+ * @param data the mapped file
+ * @param size the mapped file size
+ * 
+ * @return true if the recipe values were written to application variables
 */
-void Recipe::set_folder(std::string folder) {
-    this->_folder = folder + ((folder != "" && folder.back() != '/') ? "/":"");
-    this->stop();
-}
+bool Recipe::_load_mapped_v2(const char *data, size_t size) {
+    stats_phase(RecipePhase::Parse);
+    format::Header header;
+    if (!format::decode_header(data, size, header)) {return this->_fail(LoadStatus::Truncated, 0);}
+    if (!format::validate_header(header, size)) {return this->_fail(LoadStatus::Corrupt, 0);}
+    if (!verify_index(header, data, data + size - format::TRAILER_SIZE)) {return this->_fail(LoadStatus::Corrupt, 0);}
+    stats_read(header.data_offset);
+    stats_phase(RecipePhase::Copy);
 
+    const char *strings = data + header.strings_offset;
+    format::TocEntry entry;
+    for (uint64_t i = 0; i < header.entry_count; i++) {
+        uint64_t entry_offset = header.toc_offset + i * format::TOC_ENTRY_SIZE;
+        format::decode_entry(data + entry_offset, entry);
+        if (!format::validate_entry(entry, header)) {return this->_fail(LoadStatus::Corrupt, entry_offset);}
+
+        std::string_view id(strings + entry.id_offset, entry.id_length);
+        RecipeItem *item = this->_registry.find(id, entry.hash);
+        if (item == nullptr) {
+            stats_skipped_unknown();
+            continue;
+        }
+        if (this->_registry.stream(*item) == nullptr && !entry_matches(*item, entry) && this->_converters.empty()) {
+            stats_skipped_mismatch();
+            continue;
+        }
+        stats_read(entry.stored_size);
+        if (!verify_entry(entry, data + entry.offset)) {return this->_fail(LoadStatus::Corrupt, entry.offset);}
+        if (!this->_apply_entry(*item, entry, data + entry.offset)) {return this->_fail(LoadStatus::Rejected, entry.offset);}
+    }
+    return true;
+}
 
 /**
- * Set the recipe extension
- * This will call the "stop" method and the recipe must be reinitialized before any new calls to "load_recipe" or "save_recipe" can be made.
+ * Load the recipe file from the source (see "set_source").
+ * A v2 file is read in three steps: the header together with the first part of the index and the trailer,
+ * the rest of the index if it is larger, then the data blocks of the registered variables.
+ * The index is checked against the trailer before any data block is fetched.
+ * Data blocks closer than "RecipeSource::gap" are merged into one range,
+ * the ranges are passed to the source in batches of at most 64 MiB, a single larger entry forms its own batch.
+ * Entries are checked against their checksum before they are copied or decompressed into the application variables,
+ * an entry failing its checksum aborts the load and values of earlier batches are kept.
+ * A v1 file is fetched whole.
+ * Requires the registry lock.
  * 
- * @param extension the new extension
+ * @param only the only variable to load, nullptr loads every registered variable
+ * 
+ * @return true if the recipe values were written to application variables,
+ *         with "only" set true if that variable was assigned
 */
-void Recipe::set_extension(std::string extension) {
-    this->_extension = ((extension != "" && extension.front() != '.') ? ".":"") + extension;
-    this->stop();
-}
+bool Recipe::_load_source(const RecipeItem *only) {
+    RecipeSource &source = *this->_source;
+    uint64_t file_size;
+    if (!source.size(file_size)) {return this->_fail(LoadStatus::OpenFailed, 0);}
+    const char *whole = source.data();
+    if (whole != nullptr && only == nullptr) {
+        if (format::has_magic(whole, file_size)) {return this->_load_mapped_v2(whole, file_size);}
+        return this->_load_mapped_v1(whole, file_size);
+    }
 
+    // Header, the first part of the index and the trailer in one read
+    stats_phase(RecipePhase::Parse);
+    std::pmr::vector<char> index(static_cast<size_t>(std::min(file_size, SOURCE_PREFETCH)), this->_resource);
+    char trailer_buffer[format::TRAILER_SIZE];
+    stats_allocation();
+    ReadRange head[2] = {
+        {0, index.size(), index.data()},
+        {file_size - format::TRAILER_SIZE, format::TRAILER_SIZE, trailer_buffer}
+    };
+    size_t head_count = file_size > index.size() && file_size - index.size() >= format::TRAILER_SIZE ? 2 : 1;
+    if (!source.read(head, head_count)) {return this->_fail(LoadStatus::OpenFailed, 0);}
+    stats_read(index.size() + (head_count - 1) * format::TRAILER_SIZE);
 
+    if (!format::has_magic(index.data(), index.size())) {
+        if (only != nullptr) {return false;}
+        size_t prefetched = index.size();
+        index.resize(static_cast<size_t>(file_size));
+        ReadRange rest = {prefetched, file_size - prefetched, index.data() + prefetched};
+        if (!source.read(&rest, 1)) {return this->_fail(LoadStatus::OpenFailed, prefetched);}
+        stats_read(rest.size);
+        return this->_load_mapped_v1(index.data(), index.size());
+    }
+    format::Header header;
+    if (!format::decode_header(index.data(), index.size(), header)) {return this->_fail(LoadStatus::Truncated, 0);}
+    if (!format::validate_header(header, file_size)) {return this->_fail(LoadStatus::Corrupt, 0);}
+    if (header.data_offset > index.size()) {
+        size_t prefetched = index.size();
+        index.resize(static_cast<size_t>(header.data_offset));
+        ReadRange rest = {prefetched, header.data_offset - prefetched, index.data() + prefetched};
+        if (!source.read(&rest, 1)) {return this->_fail(LoadStatus::OpenFailed, prefetched);}
+        stats_read(rest.size);
+    }
+    // Without a separate trailer read the whole file is in the prefetched index
+    const char *trailer = head_count == 2 ? trailer_buffer : index.data() + file_size - format::TRAILER_SIZE;
+    if (!verify_index(header, index.data(), trailer)) {return this->_fail(LoadStatus::Corrupt, 0);}
+    stats_phase(RecipePhase::Copy);
 
-}
+    // Select the entries of registered variables, in file order
+    struct Target {
+        format::TocEntry entry;
+        RecipeItem *item;
+        uint64_t position;
+    };
+    std::pmr::vector<Target> targets(this->_resource);
+    const char *strings = index.data() + header.strings_offset;
+    format::TocEntry entry;
+    for (uint64_t i = 0; i < header.entry_count; i++) {
+        uint64_t entry_offset = header.toc_offset + i * format::TOC_ENTRY_SIZE;
+        format::decode_entry(index.data() + entry_offset, entry);
+        if (!format::validate_entry(entry, header)) {return this->_fail(LoadStatus::Corrupt, entry_offset);}
 
+        std::string_view id(strings + entry.id_offset, entry.id_length);
+        RecipeItem *item = this->_registry.find(id, entry.hash);
+        if (only != nullptr && item != only) {continue;}
+        if (item == nullptr) {
+            stats_skipped_unknown();
+            continue;
+        }
+        if (this->_registry.stream(*item) == nullptr && !entry_matches(*item, entry) && this->_converters.empty()) {
+            stats_skipped_mismatch();
+            continue;
+        }
+        targets.push_back({entry, item, 0});
+    }
+    std::sort(targets.begin(), targets.end(), [](const Target &a, const Target &b) {return a.entry.offset < b.entry.offset;});
+
+    // Fetch and apply the data blocks batch by batch
+    std::pmr::vector<ReadRange> ranges(this->_resource);
+    std::pmr::vector<char> buffer(this->_resource);
+    uint64_t gap = source.gap();
+    bool assigned_any = false;
+    size_t first = 0;
+    while (first < targets.size()) {
+        ranges.clear();
+        uint64_t batch = 0;
+        uint64_t range_position = 0;
+        size_t last = first;
+        for (; last < targets.size(); last++) {
+            const format::TocEntry &next = targets[last].entry;
+            uint64_t end = ranges.empty() ? 0 : ranges.back().offset + ranges.back().size;
+            if (!ranges.empty() && next.offset >= end && next.offset - end <= gap) {
+                uint64_t grow = next.offset + next.stored_size - end;
+                if (batch + grow > SOURCE_BATCH_SIZE) {break;}
+                ranges.back().size += grow;
+                batch += grow;
+                targets[last].position = range_position + (next.offset - ranges.back().offset);
+                continue;
+            }
+            if (last > first && batch + next.stored_size > SOURCE_BATCH_SIZE) {break;}
+            range_position = batch;
+            ranges.push_back({next.offset, next.stored_size, nullptr});
+            batch += next.stored_size;
+            targets[last].position = range_position;
+        }
+
+        if (buffer.capacity() < batch) {stats_allocation();}
+        buffer.resize(static_cast<size_t>(batch));
+        uint64_t position = 0;
+        for (ReadRange &range: ranges) {
+            range.destination = buffer.data() + position;
+            position += range.size;
+        }
+        if (!source.read(ranges.data(), ranges.size())) {return this->_fail(LoadStatus::OpenFailed, ranges.front().offset);}
+        stats_read(batch);
+
+        for (size_t i = first; i < last; i++) {
+            const Target &target = targets[i];
+            const char *stored = buffer.data() + target.position;
+            if (!verify_entry(target.entry, stored)) {return this->_fail(LoadStatus::Corrupt, target.entry.offset);}
+            bool assigned;
+            if (!this->_apply_entry(*target.item, target.entry, stored, &assigned)) {
+                return this->_fail(LoadStatus::Rejected, target.entry.offset);
+            }
+            assigned_any = assigned_any || assigned;
+        }
+        first = last;
+    }
+    return only == nullptr || assigned_any;
+}
+
+/**
+ * Load the recipe file on several threads.
+ * Only accessible if the recipe has been initialized.
+ * The file is read through a memory mapping regardless of the load mode.
+ * All matching entries are checksummed in parallel first and copied in parallel afterwards,
+ * so a corrupted file leaves the application variables untouched.
+ * Compressed entries are checksummed and decompressed one entry per thread.
+ * A recipe without compressed entries or entries larger than the chunk size is checked and copied on the calling thread,
+ * handing many small values out to threads costs more than it saves.
+ * Streamed variables are passed to their reader on the calling thread, after the copy.
+ * A v1 file, or a recipe with a source (see "set_source"), is loaded as by "load_recipe()".
+ * The journal is replayed afterwards on the calling thread, see JournalMode.
+ * 
+ * @param policy the number of threads and the chunk size for large entries
+ * 
+ * @return true if the recipe values were written to application variables
+*/
+bool Recipe::load_recipe(const ParallelPolicy &policy) {
+    TRC_SPAN("recipe", "Recipe::load_recipe");
+    StatsScope scope(this->_observer, this->_name, RecipeOperation::Load);
+    if (!this->_init) {return scope.finish(false);}
+    std::unique_lock<std::mutex> lock = this->_lock();
+    return scope.finish(this->_load_parallel(policy));
+}
+
+/**
+ * Load a version of the recipe saved by "save_version".
+ * Only accessible if the recipe has been initialized.
+ * The values of the version are read from the history next to the recipe file, the recipe file and the journal are not read.
+ * Variables removed in the version, or not stored in it, keep their value.
+ * Each value is checked against its checksum before it is assigned, mismatching values are skipped as by "load_recipe()".
+ * An unknown version fails with LoadStatus::OpenFailed, see "get_load_error".
+ * Later calls to "save_version" save on top of the loaded version.
+ * 
+ * @param version a version number returned by "save_version" or listed by "get_versions"
+ * 
+ * @return true if the values of the version were written to application variables
+*/
+bool Recipe::load_version(uint64_t version) {
+    TRC_SPAN("recipe", "Recipe::load_version");
+    StatsScope scope(this->_observer, this->_name, RecipeOperation::Load);
+    if (!this->_init) {return scope.finish(false);}
+    std::lock_guard<std::mutex> history_lock(this->_save_mutex);
+    std::unique_lock<std::mutex> lock = this->_lock();
+    this->_load_error = LoadError();
+
+    stats_phase(RecipePhase::Open);
+    if (!this->_open_history() || !this->_history->contains(version)) {return scope.finish(this->_fail(LoadStatus::OpenFailed, 0));}
+    stats_phase(RecipePhase::Parse);
+    RecipeHistory::Manifest manifest(this->_resource);
+    stats_allocation();
+    if (!this->_history->resolve(version, manifest)) {return scope.finish(this->_fail(LoadStatus::Corrupt, 0));}
+
+    stats_phase(RecipePhase::Copy);
+    for (const auto &[id, stored]: manifest) {
+        if (stored.flags & format::HISTORY_ENTRY_REMOVED) {continue;}
+        RecipeItem *item = this->_registry.find(id);
+        if (item == nullptr) {
+            stats_skipped_unknown();
+            continue;
+        }
+        format::TocEntry entry = {
+            item->hash, stored.type, stored.blob, stored.size, stored.size, 0, stored.id_length,
+            format::CODEC_RAW, format::ENTRY_HAS_CHECKSUM, stored.checksum
+        };
+        if (this->_registry.stream(*item) == nullptr && !entry_matches(*item, entry) && this->_converters.empty()) {
+            stats_skipped_mismatch();
+            continue;
+        }
+        const char *data = this->_history->blob(stored);
+        if (data == nullptr) {return scope.finish(this->_fail(LoadStatus::Truncated, stored.blob));}
+        stats_read(stored.size);
+        if (!verify_entry(entry, data)) {return scope.finish(this->_fail(LoadStatus::Corrupt, stored.blob));}
+        if (!this->_apply_entry(*item, entry, data)) {return scope.finish(this->_fail(LoadStatus::Rejected, stored.blob));}
+    }
+    this->_version = version;
+    return scope.finish(true);
+}
+
+/**
+ * Load a V2 recipe file on several threads, see "load_recipe(ParallelPolicy)".
+ * Requires the registry lock.
+ * 
+ * @param policy the number of threads and the chunk size
+ * 
+ * @return true if the recipe values were written to application variables
+*/
+bool Recipe::_load_parallel(const ParallelPolicy &policy) {
+    this->_load_error = LoadError();
+    if (this->_source != nullptr) {return this->_load();}
+    MappedFile map;
+    if (!map.open(this->get_path())) {return this->_fail(LoadStatus::OpenFailed, 0);}
+    if (!format::has_magic(map.data(), map.size())) {return this->_load();}
+    stats_phase(RecipePhase::Parse);
+
+    const char *data = map.data();
+    format::Header header;
+    if (!format::decode_header(data, map.size(), header)) {return this->_fail(LoadStatus::Truncated, 0);}
+    if (!format::validate_header(header, map.size())) {return this->_fail(LoadStatus::Corrupt, 0);}
+    if (!verify_index(header, data, data + map.size() - format::TRAILER_SIZE)) {return this->_fail(LoadStatus::Corrupt, 0);}
+    stats_read(header.data_offset);
+
+    struct Target {
+        format::TocEntry entry;
+        RecipeItem *item;
+        size_t first_chunk;
+        size_t chunk_count;
+    };
+    struct Chunk {
+        const char *source;
+        char *destination;
+        size_t size;
+        uint32_t checksum;
+    };
+
+    // Split matching entries into chunks
+    size_t chunk_size = policy.chunk_size > 0 ? policy.chunk_size : SIZE_MAX;
+    bool split = false;
+    std::pmr::vector<Target> targets(this->_resource);
+    std::pmr::vector<Chunk> chunks(this->_resource);
+    std::pmr::vector<std::pair<format::TocEntry, RecipeItem*>> compressed(this->_resource);
+    std::pmr::vector<std::pair<format::TocEntry, RecipeItem*>> serial(this->_resource);
+    const char *strings = data + header.strings_offset;
+    format::TocEntry entry;
+    for (uint64_t i = 0; i < header.entry_count; i++) {
+        uint64_t entry_offset = header.toc_offset + i * format::TOC_ENTRY_SIZE;
+        format::decode_entry(data + entry_offset, entry);
+        if (!format::validate_entry(entry, header)) {return this->_fail(LoadStatus::Corrupt, entry_offset);}
+
+        std::string_view id(strings + entry.id_offset, entry.id_length);
+        RecipeItem *item = this->_registry.find(id, entry.hash);
+        if (item == nullptr) {
+            stats_skipped_unknown();
+            continue;
+        }
+        const RecipeStream *stream = this->_registry.stream(*item);
+        if (stream != nullptr || !entry_matches(*item, entry)) {
+            if (stream != nullptr || !this->_converters.empty()) {
+                serial.push_back({entry, item});
+                stats_read(entry.stored_size);
+            } else {
+                stats_skipped_mismatch();
+            }
+            continue;
+        }
+        stats_read(entry.stored_size);
+        if (entry.codec != format::CODEC_RAW) {
+            compressed.push_back({entry, item});
+            continue;
+        }
+
+        Target target{entry, item, chunks.size(), 0};
+        for (size_t offset = 0; offset < item->size; offset += chunk_size) {
+            size_t size = std::min(chunk_size, item->size - offset);
+            chunks.push_back({data + entry.offset + offset, item->ptr + offset, size, 0});
+            target.chunk_count++;
+        }
+        split = split || target.chunk_count > 1;
+        targets.push_back(target);
+    }
+
+    // Many small raw values are copied faster on the calling thread than handed out to threads
+    unsigned threads = policy.threads > 0 ? policy.threads : std::thread::hardware_concurrency();
+    if (threads == 0 || (!split && compressed.empty())) {threads = 1;}
+
+    // Verify, the checksums of split values are combined from their chunks
+    parallel_for(threads, chunks.size(), [&](size_t i) {
+        chunks[i].checksum = crc32c(0, chunks[i].source, chunks[i].size);
+    });
+    std::unique_ptr<Crc32cCombiner> combiner;
+    if (split) {combiner = std::make_unique<Crc32cCombiner>(chunk_size);}
+    for (Target &target: targets) {
+        if (!(target.entry.flags & format::ENTRY_HAS_CHECKSUM)) {continue;}
+        uint32_t checksum = target.chunk_count > 0 ? chunks[target.first_chunk].checksum : 0;
+        for (size_t i = target.first_chunk + 1; i < target.first_chunk + target.chunk_count; i++) {
+            checksum = chunks[i].size == chunk_size ? combiner->combine(checksum, chunks[i].checksum)
+                                                    : crc32c_combine(checksum, chunks[i].checksum, chunks[i].size);
+        }
+        if (checksum != target.entry.checksum) {return this->_fail(LoadStatus::Corrupt, target.entry.offset);}
+    }
+    std::pmr::vector<char> results(compressed.size(), this->_resource);
+    parallel_for(threads, compressed.size(), [&](size_t i) {
+        results[i] = verify_entry(compressed[i].first, data + compressed[i].first.offset);
+    });
+    for (size_t i = 0; i < results.size(); i++) {
+        if (!results[i]) {return this->_fail(LoadStatus::Corrupt, compressed[i].first.offset);}
+    }
+    for (const auto &value: serial) {
+        if (!verify_entry(value.first, data + value.first.offset)) {return this->_fail(LoadStatus::Corrupt, value.first.offset);}
+    }
+
+    // Copy and decompress, holding the locks of all guarded variables
+    stats_phase(RecipePhase::Copy);
+    std::pmr::vector<SeqLock*> locks(this->_resource);
+    for (const Target &target: targets) {locks.push_back(target.item->lock);}
+    for (const auto &value: compressed) {locks.push_back(value.second->lock);}
+    std::sort(locks.begin(), locks.end());
+    locks.erase(std::unique(locks.begin(), locks.end()), locks.end());
+    locks.erase(std::remove(locks.begin(), locks.end(), nullptr), locks.end());
+    for (SeqLock *guard: locks) {guard->write_begin();}
+    parallel_for(threads, chunks.size(), [&](size_t i) {
+        std::memcpy(chunks[i].destination, chunks[i].source, chunks[i].size);
+    });
+    parallel_for(threads, compressed.size(), [&](size_t i) {
+        const format::TocEntry &stored = compressed[i].first;
+        RecipeItem *item = compressed[i].second;
+        results[i] = decompress(static_cast<Codec>(stored.codec), data + stored.offset, stored.stored_size, item->ptr, item->size);
+    });
+    for (SeqLock *guard: locks) {guard->write_end();}
+    for (size_t i = 0; i < results.size(); i++) {
+        if (!results[i]) {return this->_fail(LoadStatus::Rejected, compressed[i].first.offset);}
+    }
+    stats_entry(targets.size() + compressed.size());
+    for (const auto &value: serial) {
+        if (!this->_apply_entry(*value.second, value.first, data + value.first.offset)) {
+            return this->_fail(LoadStatus::Rejected, value.first.offset);
+        }
+    }
+    return this->_replay_journal();
+}
+
+/**
+ * Load a single variable from the recipe file.
+ * The table of contents is binary searched, only the entry for "id" is read.
+ * The trailer magic is checked, but not the index checksum, which would require reading the whole index.
+ * Requires a v2 recipe file, save the recipe once to convert a v1 file.
+ * With a source set (see "set_source"), the whole index is fetched and checked, then only the entry for "id".
+ * With JournalMode::Append the journal records of the variable are replayed afterwards.
+ * 
+ * @param id the identifier of a variable registered in this recipe
+ * 
+ * @return true if the value was written to the application variable
+*/
+bool Recipe::load_variable(std::string_view id) {
+    TRC_SPAN("recipe", "Recipe::load_variable");
+    StatsScope scope(this->_observer, this->_name, RecipeOperation::LoadVariable);
+    if (!this->_init) {return scope.finish(false);}
+    std::unique_lock<std::mutex> lock = this->_lock();
+
+    RecipeItem *item = this->_registry.find(id);
+    if (item == nullptr) {return scope.finish(false);}
+    if (this->_source != nullptr) {
+        this->_load_error = LoadError();
+        return scope.finish(this->_load_source(item) && this->_replay_journal(item));
+    }
+    return scope.finish(this->_load_variable(item, id) && this->_replay_journal(item));
+}
+
+/**
+ * Load a single variable from the V2 recipe file, see "load_variable".
+ * Requires the registry lock.
+ * 
+ * @param item the variable
+ * @param id the identifier of the variable
+ * 
+ * @return true if the value was written to the application variable
+*/
+bool Recipe::_load_variable(RecipeItem *item, std::string_view id) {
+    std::ifstream file;
+    MappedFile map;
+    const char *data = nullptr;
+    uint64_t file_size = 0;
+    format::Header header;
+    format::Trailer trailer;
+    char header_buffer[format::HEADER_SIZE];
+    char trailer_buffer[format::TRAILER_SIZE];
+
+    // Read header and trailer
+    if (this->_load_mode == LoadMode::Mapped) {
+        if (!map.open(this->get_path())) {return false;}
+        data = map.data();
+        file_size = map.size();
+        stats_phase(RecipePhase::Parse);
+        if (!format::decode_header(data, file_size, header)) {return false;}
+        if (!format::validate_header(header, file_size)) {return false;}
+        if (header.flags & format::HEADER_HAS_TRAILER) {
+            std::memcpy(trailer_buffer, data + file_size - format::TRAILER_SIZE, format::TRAILER_SIZE);
+        }
+    } else {
+        file.open(this->get_path(), std::ios::binary);
+        file.seekg(0, std::ios::end);
+        file_size = static_cast<uint64_t>(file.tellg());
+        file.seekg(0);
+        stats_phase(RecipePhase::Parse);
+        if (!file.read(header_buffer, sizeof(header_buffer))) {return false;}
+        if (!format::decode_header(header_buffer, sizeof(header_buffer), header)) {return false;}
+        if (!format::validate_header(header, file_size)) {return false;}
+        if (header.flags & format::HEADER_HAS_TRAILER) {
+            file.seekg(file_size - format::TRAILER_SIZE);
+            if (!file.read(trailer_buffer, sizeof(trailer_buffer))) {return false;}
+        }
+    }
+    if ((header.flags & format::HEADER_HAS_TRAILER) && !format::decode_trailer(trailer_buffer, trailer)) {return false;}
+
+    // Read entry "index" from the TOC and its id from the string table
+    char entry_buffer[format::TOC_ENTRY_SIZE];
+    auto read_entry = [&](uint64_t index, format::TocEntry &entry) {
+        uint64_t offset = header.toc_offset + index * format::TOC_ENTRY_SIZE;
+        if (data != nullptr) {
+            format::decode_entry(data + offset, entry);
+            return true;
+        }
+        file.seekg(offset);
+        if (!file.read(entry_buffer, sizeof(entry_buffer))) {return false;}
+        format::decode_entry(entry_buffer, entry);
+        return true;
+    };
+    std::pmr::string id_buffer(this->_resource);
+    std::string_view entry_id;
+    auto read_id = [&](const format::TocEntry &entry) {
+        if (data != nullptr) {
+            entry_id = std::string_view(data + header.strings_offset + entry.id_offset, entry.id_length);
+            return true;
+        }
+        id_buffer.resize(entry.id_length);
+        file.seekg(header.strings_offset + entry.id_offset);
+        entry_id = id_buffer;
+        return static_cast<bool>(file.read(&id_buffer.front(), entry.id_length));
+    };
+
+    // Find the first entry with a matching hash
+    uint64_t hash = item->hash;
+    uint64_t low = 0;
+    uint64_t high = header.entry_count;
+    format::TocEntry entry;
+    while (low < high) {
+        uint64_t middle = low + (high - low) / 2;
+        if (!read_entry(middle, entry)) {return false;}
+        if (entry.hash < hash) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    // Walk entries sharing the hash until the id matches
+    for (uint64_t i = low; i < header.entry_count; i++) {
+        if (!read_entry(i, entry) || entry.hash != hash) {return false;}
+        if (!format::validate_entry(entry, header)) {return false;}
+        if (!read_id(entry) || entry_id != id) {continue;}
+        const RecipeStream *stream = this->_registry.stream(*item);
+        bool matches = stream == nullptr && entry_matches(*item, entry);
+        if (stream == nullptr && !matches && this->_converters.empty()) {
+            stats_skipped_mismatch();
+            return false;
+        }
+        stats_phase(RecipePhase::Copy);
+        stats_read(entry.stored_size);
+        bool assigned;
+        if (data != nullptr) {
+            if (!verify_entry(entry, data + entry.offset)) {return false;}
+            return this->_apply_entry(*item, entry, data + entry.offset, &assigned) && assigned;
+        }
+
+        file.seekg(entry.offset);
+        uint32_t checksum;
+        if (entry.codec == format::CODEC_RAW && matches && !(entry.flags & format::ENTRY_HAS_CHECKSUM)) {
+            SeqLockGuard guard(item->lock);
+            if (!read_chunked(file, item->ptr, item->size, this->_chunk_size, checksum)) {return false;}
+            stats_entry();
+            return true;
+        }
+        // Checked before the variable is assigned, as by "_load_stream_v2"
+        std::pmr::vector<char> stored(entry.stored_size, this->_resource);
+        stats_allocation();
+        if (!read_chunked(file, stored.data(), stored.size(), this->_chunk_size, checksum)) {return false;}
+        if (!checksum_matches(entry, checksum)) {return false;}
+        return this->_apply_entry(*item, entry, stored.data(), &assigned) && assigned;
+    }
+    return false;
+}
+
+/**
+ * Reload the entries of a V2 recipe file whose stored content changed since they were last loaded or saved.
+ * Changes are detected by comparing the checksum, sizes, codec and type of each TOC entry
+ * to the entry seen by the previous reload or save, unchanged entries are not read.
+ * The change callback of every assigned variable is called afterwards (see "set_change_callback").
+ * The first reload after "start_watch" only reloads entries changed since "start_watch".
+ * A file failing its index checksum, for instance one still being written, is left for the next reload.
+ * 
+ * @return true if all changed values were reloaded
+*/
+bool Recipe::reload_changed() {
+    StatsScope scope(this->_observer, this->_name, RecipeOperation::Reload);
+    if (!this->_init) {return false;}
+
+    std::pmr::vector<std::pair<ChangeCallback, std::pmr::string>> changed(this->_resource);
+    bool success = true;
+    {
+        std::unique_lock<std::mutex> lock = this->_lock();
+        MappedFile map;
+        if (!map.open(this->get_path())) {return false;}
+        const char *data = map.data();
+        format::Header header;
+        stats_phase(RecipePhase::Parse);
+        if (!format::has_magic(data, map.size())) {return false;}
+        if (!format::decode_header(data, map.size(), header)) {return false;}
+        if (!format::validate_header(header, map.size())) {return false;}
+        if (!verify_index(header, data, data + map.size() - format::TRAILER_SIZE)) {return false;}
+        stats_read(header.data_offset);
+        stats_phase(RecipePhase::Copy);
+
+        const char *strings = data + header.strings_offset;
+        format::TocEntry entry;
+        for (uint64_t i = 0; i < header.entry_count; i++) {
+            format::decode_entry(data + header.toc_offset + i * format::TOC_ENTRY_SIZE, entry);
+            if (!format::validate_entry(entry, header)) {
+                success = false;
+                break;
+            }
+
+            std::string_view id(strings + entry.id_offset, entry.id_length);
+            RecipeItem *item = this->_registry.find(id, entry.hash);
+            if (item == nullptr) {
+                stats_skipped_unknown();
+                continue;
+            }
+            uint64_t digest = entry_digest(entry);
+            uint64_t &loaded = find_or_insert(this->_loaded, id);
+            if (loaded == digest && (entry.flags & format::ENTRY_HAS_CHECKSUM)) {continue;}
+            stats_read(entry.stored_size);
+
+            bool assigned;
+            if (!verify_entry(entry, data + entry.offset) || !this->_apply_entry(*item, entry, data + entry.offset, &assigned)) {
+                success = false;
+                break;
+            }
+            loaded = digest;
+            if (!assigned) {continue;}
+            auto callback = this->_change_callbacks.find(id);
+            if (callback != this->_change_callbacks.end()) {changed.emplace_back(callback->second, id);}
+        }
+    }
+
+    for (const auto &value: changed) {value.first(value.second);}
+    return scope.finish(success);
+}
+
+/**
+ * Watch the recipe file and call "reload_changed" whenever it changes (see FileWatcher).
+ * Requires Concurrency::Concurrent, the reload runs on the watcher thread.
+ * The current file contents count as loaded, load the recipe before watching it.
+ * Saves of this recipe are recorded as well, so they do not reload the saved values.
+ * Change callbacks must not call "stop_watch".
+ * 
+ * @param debounce how long the file must be quiet after a change before it is reloaded
+ * 
+ * @return true if the watcher was started
+*/
+bool Recipe::start_watch(std::chrono::milliseconds debounce) {
+    if (!this->_init || this->_concurrency != Concurrency::Concurrent || this->_watcher) {return false;}
+
+    // Record the current file contents
+    this->_watching = true;
+    MappedFile map;
+    format::Header header;
+    if (map.open(this->get_path()) && format::decode_header(map.data(), map.size(), header) &&
+        format::validate_header(header, map.size())) {
+        this->_remember_index(std::pmr::vector<char>(map.data(), map.data() + header.data_offset, this->_resource));
+    }
+
+    this->_watcher = std::make_unique<FileWatcher>();
+    if (!this->_watcher->start(this->get_path(), [this]() {this->reload_changed();}, debounce)) {
+        this->stop_watch();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Stop watching the recipe file, blocks until a running reload has finished
+*/
+void Recipe::stop_watch() {
+    if (this->_watcher) {this->_watcher->stop();}
+    this->_watcher.reset();
+    this->_watching = false;
+    std::unique_lock<std::mutex> lock = this->_lock();
+    this->_loaded.clear();
+}
+
+/**
+ * Check if the recipe file is watched
+ * 
+ * @return true if "start_watch" succeeded and "stop_watch" was not called since
+*/
+bool Recipe::is_watching() {
+    return this->_watching;
+}
+
+/**
+ * Record the entries of a V2 index as loaded, so "reload_changed" skips them until they change.
+ * Does nothing unless the recipe file is watched.
+ * 
+ * @param index the header, TOC and string table of a V2 file
+*/
+void Recipe::_remember_index(const std::pmr::vector<char> &index) {
+    if (!this->_watching) {return;}
+    format::Header header;
+    if (!format::decode_header(index.data(), index.size(), header) || index.size() < header.data_offset) {return;}
+
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    const char *strings = index.data() + header.strings_offset;
+    format::TocEntry entry;
+    for (uint64_t i = 0; i < header.entry_count; i++) {
+        format::decode_entry(index.data() + header.toc_offset + i * format::TOC_ENTRY_SIZE, entry);
+        if (entry.id_offset + entry.id_length > header.data_offset - header.strings_offset) {return;}
+        find_or_insert(this->_loaded, std::string_view(strings + entry.id_offset, entry.id_length)) = entry_digest(entry);
+    }
+}
+
+/**
+ * Create the background writer of asynchronous saves
+ * 
+ * @return the writer, recording written files for "reload_changed"
+*/
+std::unique_ptr<AsyncWriter> Recipe::_make_writer() {
+    return std::make_unique<AsyncWriter>([this](const std::pmr::vector<char> &index) {this->_remember_index(index);});
+}
+
+/**
+ * Write the recipe as a V2 image embedded in a store file.
+ * Used by RecipeStore, the recipe file itself is not touched.
+ * 
+ * @param file the store file
+ * @param offset file offset of the image
+ * @param capacity the space available for the image, it is only written if it is sure to fit
+ * @param size receives the image size, 0 if the image might not fit
+ * 
+ * @return true if the image was written or did not fit, false if writing failed
+*/
+bool Recipe::_write_image(File &file, uint64_t offset, uint64_t capacity, uint64_t &size) {
+    SaveTarget target;
+    target.format = FileFormat::V2;
+    target.mode = SaveMode::Direct;
+    target.sync = false;
+    target.codec = this->_codec;
+    target.compression_threshold = this->_compression_threshold;
+    target.resource = this->_resource;
+
+    size = 0;
+    std::pmr::vector<char> index(this->_resource);
+    bool written;
+    if (this->_concurrency == Concurrency::Concurrent) {
+        std::lock_guard<std::mutex> lock(this->_save_mutex);
+        std::shared_ptr<const RecipeRegistry> registry = this->_acquire_registry();
+        if (!stage_values(*registry, this->_staged, this->_staged_data)) {return false;}
+        if (image_bound(this->_staged) > capacity) {return true;}
+        written = write_image(file, offset, this->_staged, target, index);
+    } else {
+        if (image_bound(this->_registry) > capacity) {return true;}
+        // Item offsets now describe the image
+        this->_layout_valid = false;
+        written = write_image(file, offset, this->_registry, target, index);
+    }
+
+    format::Header header;
+    if (!written || !format::decode_header(index.data(), index.size(), header)) {return false;}
+    size = header.file_size;
+    return true;
+}
+
+/**
+ * Load the recipe from a V2 image embedded in a store file.
+ * Used by RecipeStore.
+ * 
+ * @param data the image
+ * @param size the image size
+ * 
+ * @return true if the recipe values were written to application variables
+*/
+bool Recipe::_load_image(const char *data, size_t size) {
+    std::unique_lock<std::mutex> lock = this->_lock();
+    if (!format::has_magic(data, size)) {return false;}
+    return this->_load_mapped_v2(data, size);
+}
+
+/**
+ * Saves the application variable values to the recipe file.
+ * This will overwrite any previous recipe.
+ * If any varables were removed from the application recipe since the previous save, these will no longer be present in the new recipe file.
+ * 
+ * With SaveMode::Atomic the recipe is written to a temporary file which then replaces the recipe file,
+ * a crash during the save leaves the previous recipe intact.
+ * With dirty tracking, SaveMode::Direct and an unchanged V2 layout, only changed variables are written, in place.
+ * Recipes with streamed variables are always rewritten completely.
+ * The file is synced to the storage device according to the sync mode (see "set_sync_mode").
+ * Waits for pending asynchronous saves first, so an older snapshot never overwrites this save.
+ * In Concurrency::Concurrent mode the whole file is written from a copy of the variables (see "_save_concurrent").
+ * With JournalMode::Append the journal is truncated once the recipe file is written, its records are now part of the recipe file.
+ * 
+ * @return true if the recipe was successfully saved.
+*/
+bool Recipe::save_recipe() {
+    TRC_SPAN("recipe", "Recipe::save_recipe");
+    StatsScope scope(this->_observer, this->_name, RecipeOperation::Save);
+    if (!this->_init) {return false;}
+    if (this->_concurrency == Concurrency::Concurrent) {return scope.finish(this->_save_concurrent());}
+    if (this->_writer) {this->_writer->wait();}
+
+    if (this->_layout_valid) {
+        if (this->_save_dirty()) {return scope.finish(this->_reset_journal());}
+        // Fall back to a full rewrite
+        this->_layout_valid = false;
+    }
+
+    if (!write_recipe(this->_registry, this->_save_target(), this->_layout_index)) {return false;}
+
+    // Remember the layout for incremental saves
+    format::Header header;
+    if (this->_file_format == FileFormat::V2 && format::decode_header(this->_layout_index.data(), this->_layout_index.size(), header)) {
+        this->_layout_size = header.file_size;
+    }
+    size_t shadow_size = 0;
+    for (RecipeItem &item: this->_registry) {shadow_size += item.size;}
+    if (this->_dirty_tracking == DirtyTracking::Snapshot) {
+        this->_shadow.resize(shadow_size);
+    } else {
+        std::pmr::vector<char>(this->_resource).swap(this->_shadow);
+    }
+    shadow_size = 0;
+    for (RecipeItem &item: this->_registry) {
+        item.shadow_offset = shadow_size;
+        item.dirty = false;
+        this->_update_snapshot(&item);
+        shadow_size += item.size;
+    }
+
+    this->_layout_valid = this->_file_format == FileFormat::V2 &&
+                          this->_dirty_tracking != DirtyTracking::None &&
+                          this->_save_mode == SaveMode::Direct &&
+                          this->_registry.stream_count() == 0;
+    return scope.finish(this->_reset_journal());
+}
+
+/**
+ * Saves the application variable values to the recipe file on a background writer thread.
+ * The variable values are copied on the calling thread before this method returns,
+ * the application may modify its variables immediately afterwards.
+ * A save requested while a previous snapshot is still waiting to be written replaces that snapshot,
+ * both futures then report the result of the same write.
+ * Asynchronous saves always rewrite the whole file, use SaveMode::Atomic if the file may be loaded concurrently.
+ * With JournalMode::Append the recipe is saved on the calling thread, as by "save_recipe",
+ * since the journal may only be truncated after the recipe file holds every journaled value.
+ * 
+ * @return future result of the save, true if the recipe was successfully saved.
+*/
+std::shared_future<bool> Recipe::save_recipe_async() {
+    TRC_SPAN("recipe", "Recipe::save_recipe_async");
+    StatsScope scope(this->_observer, this->_name, RecipeOperation::SaveAsync);
+    if (!this->_init) {
+        std::promise<bool> promise;
+        promise.set_value(false);
+        return promise.get_future().share();
+    }
+    if (this->_journal_mode == JournalMode::Append) {
+        std::promise<bool> promise;
+        promise.set_value(this->save_recipe());
+        return promise.get_future().share();
+    }
+    // Only copying the snapshot is observed, the write on the background thread is not
+    scope.finish(true);
+    stats_phase(RecipePhase::Copy);
+    if (this->_concurrency == Concurrency::Concurrent) {
+        std::lock_guard<std::mutex> lock(this->_save_mutex);
+        if (!this->_writer) {this->_writer = this->_make_writer();}
+        std::shared_ptr<const RecipeRegistry> registry = this->_acquire_registry();
+        stats_entry(registry->size());
+        return this->_writer->submit(*registry, this->_save_target());
+    }
+    if (!this->_writer) {this->_writer = this->_make_writer();}
+    this->_layout_valid = false;
+    stats_entry(this->_registry.size());
+    return this->_writer->submit(this->_registry, this->_save_target());
+}
+
+/**
+ * Save the recipe in Concurrency::Concurrent mode.
+ * The variables of the current registry snapshot are copied into a reused staging area, guarded variables under their lock,
+ * and the staging area is written to the recipe file.
+ * Saves are serialized with each other, but do not hold the registry lock,
+ * so adding, removing and writing variables continues while the file is written.
+ * 
+ * @return true if the recipe was successfully saved.
+*/
+bool Recipe::_save_concurrent() {
+    std::lock_guard<std::mutex> lock(this->_save_mutex);
+    if (this->_writer) {this->_writer->wait();}
+
+    std::shared_ptr<const RecipeRegistry> registry = this->_acquire_registry();
+    if (!stage_values(*registry, this->_staged, this->_staged_data)) {return false;}
+    if (!write_recipe(this->_staged, this->_save_target(), this->_layout_index)) {return false;}
+    if (this->_file_format == FileFormat::V2) {this->_remember_index(this->_layout_index);}
+    return this->_reset_journal();
+}
+
+/**
+ * Save the application variable values as a new version in the history next to the recipe file.
+ * Only accessible if the recipe has been initialized.
+ * The recipe file and the journal are not touched, use "save_recipe" to update the file loaded by "load_recipe()".
+ * A version stores only the values that changed since the version it is saved on top of,
+ * the last version saved or loaded by this recipe, otherwise the newest version in the history.
+ * Stored values are shared by every version saving the same bytes.
+ * Every "snapshot_interval"-th version stores all values, see "set_snapshot_interval".
+ * The history is synced to the storage device according to the sync mode (see "set_sync_mode").
+ * Guarded variables are copied under their lock.
+ * 
+ * @return the new version number, 0 if the version could not be saved
+*/
+uint64_t Recipe::save_version() {
+    TRC_SPAN("recipe", "Recipe::save_version");
+    StatsScope scope(this->_observer, this->_name, RecipeOperation::Save);
+    if (!this->_init) {return 0;}
+    std::lock_guard<std::mutex> lock(this->_save_mutex);
+    stats_phase(RecipePhase::Open);
+    if (!this->_open_history()) {
+        scope.finish(false);
+        return 0;
+    }
+
+    stats_phase(RecipePhase::Copy);
+    bool staged;
+    if (this->_concurrency == Concurrency::Concurrent) {
+        staged = stage_values(*this->_acquire_registry(), this->_staged, this->_staged_data);
+    } else {
+        staged = stage_values(this->_registry, this->_staged, this->_staged_data);
+    }
+    if (!staged) {
+        scope.finish(false);
+        return 0;
+    }
+
+    uint64_t parent = this->_history->contains(this->_version) ? this->_version : this->_history->latest();
+    uint64_t version = this->_history->append(this->_staged, parent, this->_snapshot_interval, this->_sync_due());
+    if (version != 0) {this->_version = version;}
+    scope.finish(version != 0);
+    return version;
+}
+
+/**
+ * List the versions in the history, see "save_version"
+ * 
+ * @return every saved version, oldest first, empty if the recipe is not initialized or the history could not be opened
+*/
+std::vector<VersionInfo> Recipe::get_versions() {
+    if (!this->_init) {return std::vector<VersionInfo>();}
+    std::lock_guard<std::mutex> lock(this->_save_mutex);
+    if (!this->_open_history()) {return std::vector<VersionInfo>();}
+    return this->_history->versions();
+}
+
+/**
+ * Get the version last saved or loaded by this recipe
+ * 
+ * @return the version number, 0 if no version was saved or loaded since the recipe was constructed
+*/
+uint64_t Recipe::get_version() {
+    return this->_version;
+}
+
+/**
+ * Append the current value of one variable to the journal.
+ * Only accessible if the recipe has been initialized and JournalMode::Append is selected.
+ * Writes one record of the variable id hash, size and value, the recipe file is not touched.
+ * The record is synced to the storage device according to the sync mode (see "set_sync_mode").
+ * When the journal reaches the compaction size (see "set_journal_mode") the recipe is saved, which truncates the journal.
+ * Guarded variables are copied under their lock.
+ * 
+ * @param id the identifier of a variable registered in this recipe, streamed variables are not supported
+ * 
+ * @return true if the value was appended to the journal
+*/
+bool Recipe::journal_variable(std::string_view id) {
+    StatsScope scope(this->_observer, this->_name, RecipeOperation::Journal);
+    if (!this->_init || this->_journal_mode != JournalMode::Append) {return false;}
+    bool compact;
+    {
+        // Saves truncate the journal, so a record must not be appended between staging and truncating
+        std::unique_lock<std::mutex> save_lock(this->_save_mutex, std::defer_lock);
+        if (this->_concurrency == Concurrency::Concurrent) {save_lock.lock();}
+        std::unique_lock<std::mutex> lock = this->_lock();
+
+        // Records only carry the id hash, it must identify the variable
+        RecipeItem *item = this->_registry.find(id);
+        if (item == nullptr || this->_registry.stream(*item) != nullptr) {return false;}
+        if (this->_registry.find_hash(item->hash) != item) {return false;}
+        if (!this->_journal && !this->_open_journal()) {return false;}
+
+        stats_phase(RecipePhase::Copy);
+        format::JournalRecord record;
+        record.hash = item->hash;
+        record.size = item->size;
+        if (this->_journal_buffer.capacity() < format::JOURNAL_RECORD_SIZE + item->size) {stats_allocation();}
+        this->_journal_buffer.resize(format::JOURNAL_RECORD_SIZE + item->size);
+        char *data = this->_journal_buffer.data() + format::JOURNAL_RECORD_SIZE;
+        if (item->lock != nullptr) {
+            item->lock->read(data, item->ptr, item->size);
+        } else {
+            std::memcpy(data, item->ptr, item->size);
+        }
+        record.checksum = format::journal_checksum(record, data);
+        format::encode_journal_record(record, this->_journal_buffer.data());
+        stats_entry();
+
+        stats_phase(RecipePhase::Flush);
+        if (!this->_journal->write_at(this->_journal_size, this->_journal_buffer.data(), this->_journal_buffer.size())) {
+            // Drop the torn record when the journal is opened again
+            this->_journal.reset();
+            return false;
+        }
+        this->_journal_size += this->_journal_buffer.size();
+        if (this->_sync_due() && !this->_journal->sync()) {return false;}
+        compact = this->_journal_size >= this->_journal_limit;
+    }
+    if (compact) {return scope.finish(this->save_recipe());}
+    return scope.finish(true);
+}
+
+/**
+ * Describe the next save according to the current settings.
+ * Advances the sync policy by one save.
+ * 
+ * @return path, format, save mode and sync flag for the next save
+*/
+SaveTarget Recipe::_save_target() {
+    SaveTarget target;
+    target.path = std::pmr::string(this->get_path(), this->_resource);
+    target.format = this->_file_format;
+    target.mode = this->_save_mode;
+    target.sync = this->_sync_due();
+    target.codec = this->_codec;
+    target.compression_threshold = this->_compression_threshold;
+    target.resource = this->_resource;
+    return target;
+}
+
+/**
+ * Rewrite changed variables in place in a V2 recipe file.
+ * Each changed data block is written first, followed by its TOC entry and finally the trailer.
+ * Not crash-safe: an interrupted save leaves entries failing their checksum.
+ * Fails on a changed compressed entry, the caller falls back to a full rewrite.
+ * Requires the layout written by the previous full save.
+ * 
+ * @return true if all changed variables were written.
+*/
+bool Recipe::_save_dirty() {
+    File file;
+    uint64_t size;
+    if (!file.open(this->get_path())) {return false;}
+    if (!file.size(size) || size != this->_layout_size) {return false;}
+    stats_phase(RecipePhase::Copy);
+
+    bool snapshot = this->_dirty_tracking == DirtyTracking::Snapshot;
+    bool written = false;
+    for (RecipeItem *item = this->_registry.begin(); item != this->_registry.end(); item++) {
+        bool changed = item->dirty;
+        if (!changed && snapshot) {
+            changed = std::memcmp(this->_shadow.data() + item->shadow_offset, item->ptr, item->size) != 0;
+        }
+        if (!changed) {continue;}
+
+        // Compressed entries change their stored size, rewrite the whole file
+        format::TocEntry entry;
+        uint64_t entry_offset = format::HEADER_SIZE + item->toc_index * format::TOC_ENTRY_SIZE;
+        char *entry_buffer = this->_layout_index.data() + entry_offset;
+        format::decode_entry(entry_buffer, entry);
+        if (entry.codec != format::CODEC_RAW) {return false;}
+
+        // Data block
+        if (!file.write_at(item->offset, item->ptr, item->size)) {return false;}
+
+        // TOC entry
+        entry.checksum = crc32c(0, item->ptr, item->size);
+        format::encode_entry(entry, entry_buffer);
+        if (!file.write_at(entry_offset, entry_buffer, format::TOC_ENTRY_SIZE)) {return false;}
+
+        item->dirty = false;
+        this->_update_snapshot(item);
+        written = true;
+        stats_entry();
+    }
+
+    // Trailer
+    stats_phase(RecipePhase::Flush);
+    if (written) {
+        format::Trailer trailer;
+        char trailer_buffer[format::TRAILER_SIZE];
+        trailer.index_checksum = crc32c(0, this->_layout_index.data(), this->_layout_index.size());
+        format::encode_trailer(trailer, trailer_buffer);
+        if (!file.write_at(this->_layout_size - format::TRAILER_SIZE, trailer_buffer, sizeof(trailer_buffer))) {return false;}
+    }
+    if (written && this->_sync_due()) {return file.sync();}
+    return true;
+}
+
+/**
+ * Copy the current value of a variable into its region of the snapshot arena.
+ * Does nothing if snapshot tracking is disabled.
+ * 
+ * @param item the variable
+*/
+void Recipe::_update_snapshot(RecipeItem *item) {
+    if (this->_dirty_tracking != DirtyTracking::Snapshot || item->size == 0) {return;}
+    std::memcpy(this->_shadow.data() + item->shadow_offset, item->ptr, item->size);
+}
+
+/**
+ * Advance the sync policy by one save.
+ * 
+ * @return true if this save should be synced to the storage device
+*/
+bool Recipe::_sync_due() {
+    switch (this->_sync_mode) {
+        case SyncMode::EverySave:
+            return true;
+        case SyncMode::EveryN:
+            this->_saves_since_sync += 1;
+            if (this->_saves_since_sync < this->_sync_parameter) {return false;}
+            this->_saves_since_sync = 0;
+            return true;
+        case SyncMode::Interval: {
+            auto now = std::chrono::steady_clock::now();
+            if (now - this->_last_sync < std::chrono::milliseconds(this->_sync_parameter)) {return false;}
+            this->_last_sync = now;
+            return true;
+        }
+        case SyncMode::Never:
+        default:
+            return false;
+    }
+}
+
+/**
+ * Get the journal file path
+ * 
+ * @return the recipe path followed by ".journal"
+*/
+const std::string& Recipe::_journal_path() {
+    return this->_journal_file;
+}
+
+/**
+ * Open the journal for appending, creating it if it does not exist.
+ * A journal ending in a torn record is truncated behind its last valid record,
+ * a file without a valid journal header is replaced by an empty journal.
+ * 
+ * @return true if the journal was opened
+*/
+bool Recipe::_open_journal() {
+    const std::string &path = this->_journal_path();
+    std::unique_ptr<File> journal = std::make_unique<File>();
+    if (!journal->open(path, true)) {return false;}
+
+    uint64_t end;
+    {
+        MappedFile map;
+        if (!map.open(path)) {return false;}
+        end = scan_journal(map.data(), map.size(), [](const format::JournalRecord&, const char*) {});
+        if (end != 0 && end == map.size()) {
+            this->_journal = std::move(journal);
+            this->_journal_size = end;
+            return true;
+        }
+    }
+    if (end == 0) {
+        char header[format::JOURNAL_HEADER_SIZE];
+        format::encode_journal_header(header);
+        if (!journal->resize(0) || !journal->write_at(0, header, sizeof(header))) {return false;}
+        end = sizeof(header);
+    }
+    if (!journal->resize(end)) {return false;}
+    this->_journal = std::move(journal);
+    this->_journal_size = end;
+    return true;
+}
+
+/**
+ * Truncate the journal after a save, its records are part of the recipe file now.
+ * Does nothing unless JournalMode::Append is selected.
+ * A journal left behind by an earlier run is truncated as well.
+ * 
+ * @return true if the journal is empty
+*/
+bool Recipe::_reset_journal() {
+    if (this->_journal_mode != JournalMode::Append) {return true;}
+    if (!this->_journal && !this->_open_journal()) {return false;}
+    if (this->_journal_size == format::JOURNAL_HEADER_SIZE) {return true;}
+    if (!this->_journal->resize(format::JOURNAL_HEADER_SIZE)) {return false;}
+    this->_journal_size = format::JOURNAL_HEADER_SIZE;
+    return true;
+}
+
+/**
+ * Assign the values recorded in the journal to their variables, in append order.
+ * Does nothing unless JournalMode::Append is selected or if there is no journal.
+ * Records of unknown ids are skipped, records of a different size are passed to the converter of the variable.
+ * Replay stops at the first torn record.
+ * Requires the registry lock.
+ * 
+ * @param only replay the records of this variable only, nullptr for all variables
+ * 
+ * @return false if the journal exists but could not be read
+*/
+bool Recipe::_replay_journal(const RecipeItem *only) {
+    if (this->_journal_mode != JournalMode::Append) {return true;}
+    const std::string &path = this->_journal_path();
+    if (!std::filesystem::exists(path)) {return true;}
+
+    MappedFile map;
+    if (!map.open(path)) {return false;}
+    if (map.size() == 0) {return true;}
+    stats_read(map.size());
+    scan_journal(map.data(), map.size(), [&](const format::JournalRecord &record, const char *data) {
+        if (only != nullptr && record.hash != only->hash) {return;}
+        RecipeItem *item = this->_registry.find_hash(record.hash);
+        if (item == nullptr || this->_registry.stream(*item) != nullptr) {
+            stats_skipped_unknown();
+            return;
+        }
+        if (item->size == record.size) {
+            SeqLockGuard guard(item->lock);
+            std::memcpy(item->ptr, data, item->size);
+            stats_entry();
+            return;
+        }
+        if (this->_convert(this->_registry.id(*item), data, record.size, 0)) {
+            stats_entry();
+        } else {
+            stats_skipped_mismatch();
+        }
+    });
+    return true;
+}
+
+/**
+ * Open the history on first use, or again after it was closed by a failure, see recipe_history.hpp.
+ * Requires the save lock.
+ * 
+ * @return true if the history is open
+*/
+bool Recipe::_open_history() {
+    if (this->_history && this->_history->is_open()) {return true;}
+    std::unique_ptr<RecipeHistory> history = std::make_unique<RecipeHistory>(this->_resource);
+    if (!history->open(this->_history_file)) {return false;}
+    this->_history = std::move(history);
+    return true;
+}
+
+/**
+ * Record why a load failed
+ * 
+ * @param status the failure
+ * @param offset file offset of the record or field that failed
+ * 
+ * @return false
+*/
+bool Recipe::_fail(LoadStatus status, uint64_t offset) {
+    this->_load_error.status = status;
+    this->_load_error.offset = offset;
+    return false;
+}
+
+/**
+ * Rebuild the cached recipe, journal and history paths after the folder, name or extension changed
+*/
+void Recipe::_update_path() {
+    this->_path = this->_folder + this->_name + this->_extension;
+    this->_journal_file = this->_path + ".journal";
+    this->_history_file = this->_path + ".history";
+}
+
+/**
+ * Check if the recipe is initialized
+ * 
+ * @return true if the recipe is initialized
+*/
+bool Recipe::is_init() {
+    return this->_init;
+}
+
+
+/**
+ * Check the current recipe path
+ * The path is cached, the reference stays valid until the name, folder or extension is changed.
+ * 
+ * @return the current recipe path
+*/
+const std::string& Recipe::get_path() {
+    return this->_path;
+}
+
+/**
+ * Check the current recipe name
+ * 
+ * @return the current recipe file name
+*/
+std::string Recipe::get_name() {
+    return this->_name;
+}
+
+/**
+ * Set the recipe file name
+ * This will call the "stop" method and the recipe must be reinitialized before any new calls to "load_recipe" or "save_recipe" can be made.
+ * 
+ * @param name the new file name
+*/
+void Recipe::set_name(std::string name) {
+    this->_name = std::move(name);
+    this->_update_path();
+    this->stop();
+}
+
+
+/**
+ * Set the recipe directory
+ * This will call the "stop" method and the recipe must be reinitialized before any new calls to "load_recipe" or "save_recipe" can be made.
+ * 
+ * @param folder the new driectory name
+*/
+void Recipe::set_folder(std::string folder) {
+    this->_folder = folder + ((folder != "" && folder.back() != '/') ? "/":"");
+    this->_update_path();
+    this->stop();
+}
+
+
+/**
+ * Set the recipe extension
+ * This will call the "stop" method and the recipe must be reinitialized before any new calls to "load_recipe" or "save_recipe" can be made.
+ * 
+ * @param extension the new extension
+*/
+void Recipe::set_extension(std::string extension) {
+    this->_extension = ((extension != "" && extension.front() != '.') ? ".":"") + extension;
+    this->_update_path();
+    this->stop();
+}
+
+/**
+ * Check the current load mode
+ * 
+ * @return the strategy used by "load_recipe"
+*/
+LoadMode Recipe::get_load_mode() {
+    return this->_load_mode;
+}
+
+/**
+ * Set the load mode
+ * Selects how "load_recipe" reads the recipe file. Does not affect the file format.
+ * 
+ * @param mode the new load mode
+*/
+void Recipe::set_load_mode(LoadMode mode) {
+    this->_load_mode = mode;
+}
+
+/**
+ * Check the current file format
+ * 
+ * @return the format written by "save_recipe"
+*/
+FileFormat Recipe::get_file_format() {
+    return this->_file_format;
+}
+
+/**
+ * Set the file format
+ * Selects the format written by "save_recipe". "load_recipe" reads both formats regardless of this setting.
+ * 
+ * @param file_format the new file format
+*/
+void Recipe::set_file_format(FileFormat file_format) {
+    this->_file_format = file_format;
+    this->_layout_valid = false;
+}
+
+/**
+ * Check the current dirty tracking mode
+ * 
+ * @return the change detection used by "save_recipe"
+*/
+DirtyTracking Recipe::get_dirty_tracking() {
+    return this->_dirty_tracking;
+}
+
+/**
+ * Set the dirty tracking mode
+ * Takes effect after the next full save, which "save_recipe" performs automatically.
+ * 
+ * @param dirty_tracking the new dirty tracking mode
+*/
+void Recipe::set_dirty_tracking(DirtyTracking dirty_tracking) {
+    this->_dirty_tracking = dirty_tracking;
+    this->_layout_valid = false;
+}
+
+/**
+ * Check the current save mode
+ * 
+ * @return the strategy used by "save_recipe"
+*/
+SaveMode Recipe::get_save_mode() {
+    return this->_save_mode;
+}
+
+/**
+ * Set the save mode
+ * 
+ * @param save_mode the new save mode
+*/
+void Recipe::set_save_mode(SaveMode save_mode) {
+    this->_save_mode = save_mode;
+    this->_layout_valid = false;
+}
+
+/**
+ * Check the current sync mode
+ * 
+ * @return the sync mode used by "save_recipe"
+*/
+SyncMode Recipe::get_sync_mode() {
+    return this->_sync_mode;
+}
+
+/**
+ * Set the sync mode
+ * Selects which saves flush the recipe file to the storage device.
+ * Saves that are not synced are faster, but may be lost on power failure or a system crash.
+ * 
+ * @param sync_mode the new sync mode
+ * @param parameter number of saves for SyncMode::EveryN, milliseconds for SyncMode::Interval, ignored otherwise
+*/
+void Recipe::set_sync_mode(SyncMode sync_mode, uint64_t parameter) {
+    this->_sync_mode = sync_mode;
+    this->_sync_parameter = parameter;
+    this->_saves_since_sync = 0;
+    this->_last_sync = std::chrono::steady_clock::time_point();
+}
+
+/**
+ * Check the current chunk size
+ * 
+ * @return the largest number of bytes read at once
+*/
+size_t Recipe::get_chunk_size() {
+    return this->_chunk_size;
+}
+
+/**
+ * Set the chunk size
+ * Large values are read and checksummed in chunks of at most this many bytes (default: 4 MiB),
+ * streamed variables receive their stored value in chunks of this size.
+ * 
+ * @param chunk_size the new chunk size, 0 reads every value at once
+*/
+void Recipe::set_chunk_size(size_t chunk_size) {
+    this->_chunk_size = chunk_size;
+}
+
+/**
+ * Check the current compression codec
+ * 
+ * @return the codec used by "save_recipe" for V2 entries
+*/
+Codec Recipe::get_compression() {
+    return this->_codec;
+}
+
+/**
+ * Set the compression codec
+ * V2 entries of at least "threshold" bytes are stored compressed, if that makes them smaller.
+ * Smaller entries and streamed variables are stored raw.
+ * Compressed entries are rewritten by a full save instead of in place (see "set_dirty_tracking").
+ * 
+ * @param codec the new codec
+ * @param threshold the smallest entry size in bytes to compress
+ * 
+ * @return true if the codec is available
+*/
+bool Recipe::set_compression(Codec codec, size_t threshold) {
+    if (!codec_available(codec)) {return false;}
+    this->_codec = codec;
+    this->_compression_threshold = threshold;
+    this->_layout_valid = false;
+    return true;
+}
+
+/**
+ * Set the compression codec of one variable, overriding the codec of the recipe.
+ * The compression threshold still applies.
+ * 
+ * @param id the identifier of a variable registered in this recipe.
+ * @param codec the codec for this variable
+ * 
+ * @return true if the variable is registered and the codec is available
+*/
+bool Recipe::set_variable_compression(std::string_view id, Codec codec) {
+    std::unique_lock<std::mutex> lock = this->_lock();
+    RecipeItem *item = this->_registry.find(id);
+    if (item == nullptr || !codec_available(codec)) {return false;}
+    item->codec = static_cast<int8_t>(codec);
+    this->_registry_changed();
+    return true;
+}
+
+/**
+ * Get the thread safety mode
+ * 
+ * @return the thread safety mode
+*/
+Concurrency Recipe::get_concurrency() {
+    return this->_concurrency;
+}
+
+/**
+ * Set the thread safety mode (see Concurrency).
+ * Must be called before the recipe is shared between threads, as must all other setters.
+ * Concurrency::Concurrent disables incremental saves, every save rewrites the whole file.
+ * 
+ * @param concurrency the thread safety mode
+*/
+void Recipe::set_concurrency(Concurrency concurrency) {
+    this->_concurrency = concurrency;
+    this->_layout_valid = false;
+    std::atomic_store(&this->_published, std::shared_ptr<const RecipeRegistry>());
+}
+
+/**
+ * Get the journal mode
+ * 
+ * @return the journal mode
+*/
+JournalMode Recipe::get_journal_mode() {
+    return this->_journal_mode;
+}
+
+/**
+ * Set the journal mode (see JournalMode).
+ * The journal is closed, it is opened again by the next "journal_variable" or save.
+ * 
+ * @param journal_mode the journal mode
+ * @param compaction_size journal size in bytes at which "journal_variable" saves the recipe
+*/
+void Recipe::set_journal_mode(JournalMode journal_mode, uint64_t compaction_size) {
+    this->_journal_mode = journal_mode;
+    this->_journal_limit = compaction_size;
+    this->_journal.reset();
+}
+
+/**
+ * Get the snapshot interval
+ * 
+ * @return the longest chain of versions resolved by "load_version"
+*/
+size_t Recipe::get_snapshot_interval() {
+    return this->_snapshot_interval;
+}
+
+/**
+ * Set the snapshot interval (default: 16).
+ * "save_version" stores all values instead of the changed ones once the chain of versions since the last snapshot
+ * reaches this length, larger intervals save space and make loading old versions slower.
+ * 
+ * @param interval the longest chain of versions, 1 stores all values in every version
+*/
+void Recipe::set_snapshot_interval(size_t interval) {
+    this->_snapshot_interval = interval;
+}
+
+/**
+ * Get the memory resource of the registry and of the buffers used by loads and saves
+ * 
+ * @return the memory resource given to the constructor
+*/
+std::pmr::memory_resource* Recipe::get_memory_resource() {
+    return this->_resource;
+}
+
+/**
+ * Get the reason the last "load_recipe" failed.
+ * Offsets of a v1 file point at the record or length field that failed,
+ * offsets of a v2 file at the header (0), the failing TOC entry or the failing data block.
+ * 
+ * @return the status and file offset, LoadStatus::Ok if the last load succeeded
+*/
+LoadError Recipe::get_load_error() {
+    return this->_load_error;
+}
+
+/**
+ * Get the observer receiving the statistics of loads and saves
+ * 
+ * @return the observer, nullptr if none is set
+*/
+RecipeObserver* Recipe::get_observer() {
+    return this->_observer;
+}
+
+/**
+ * Set the observer receiving the statistics of loads and saves (see recipe_stats.hpp).
+ * The observer is not owned and must outlive the recipe or be reset to nullptr.
+ * Statistics are only collected if the library is built with RCP_STATS.
+ * 
+ * @param observer the observer, nullptr disables reporting
+*/
+void Recipe::set_observer(RecipeObserver *observer) {
+    this->_observer = observer;
+}
+
+/**
+ * Get the source the recipe file is loaded from
+ * 
+ * @return the source, nullptr if the recipe file is read from "get_path"
+*/
+RecipeSource* Recipe::get_source() {
+    return this->_source;
+}
+
+/**
+ * Set the source the recipe file is loaded from (see recipe_source.hpp).
+ * The source is not owned and must outlive the recipe or be reset to nullptr.
+ * "load_recipe" and "load_variable" read the source,
+ * saves, the journal, "reload_changed" and "start_watch" keep using the local file at "get_path".
+ * This will call the "stop" method and the recipe must be reinitialized.
+ * 
+ * @param source the source, nullptr reads the local file again
+*/
+void Recipe::set_source(RecipeSource *source) {
+    this->stop();
+    this->_source = source;
+}
+
+}
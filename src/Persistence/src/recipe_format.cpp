@@ -0,0 +1,569 @@
+#include "recipe_format.hpp"
+#include "checksum.hpp"
+
+#include <cstring>
+
+namespace rcp {
+namespace format {
+
+namespace {
+
+// Byte order independent little-endian accessors.
+// Compilers lower these to a plain load / store on little-endian hosts.
+template <typename T>
+void store_le(char *buffer, T value) {
+    for (size_t i = 0; i < sizeof(T); i++) {
+        buffer[i] = static_cast<char>((static_cast<uint64_t>(value) >> (8 * i)) & 0xFF);
+    }
+}
+
+template <typename T>
+T load_le(const char *buffer) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < sizeof(T); i++) {
+        value |= static_cast<uint64_t>(static_cast<unsigned char>(buffer[i])) << (8 * i);
+    }
+    return static_cast<T>(value);
+}
+
+}
+
+/**
+ * Hash a variable id (64 bit FNV-1a).
+ * The hash is part of the file format and must never change.
+ *
+ * @param id pointer to the id characters
+ * @param length number of characters in the id
+ *
+ * @return the id hash
+*/
+uint64_t hash_id(const char *id, size_t length) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= static_cast<unsigned char>(id[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * Round a value up to the next multiple of alignment
+ *
+ * @param value the value to round
+ * @param alignment a power of two
+ *
+ * @return the aligned value
+*/
+uint64_t align_up(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+/**
+ * Check if a buffer starts with the v2 magic
+ *
+ * @param buffer the first bytes of a file
+ * @param size number of bytes available in buffer
+ *
+ * @return true if the buffer starts with the v2 magic
+*/
+bool has_magic(const char *buffer, size_t size) {
+    return size >= sizeof(MAGIC) && std::memcmp(buffer, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+/**
+ * Write a header to HEADER_SIZE bytes of buffer, magic included
+ *
+ * @param header the header to write
+ * @param buffer destination, at least HEADER_SIZE bytes
+*/
+void encode_header(const Header &header, char *buffer) {
+    std::memset(buffer, 0, HEADER_SIZE);
+    std::memcpy(buffer, MAGIC, sizeof(MAGIC));
+    store_le(buffer + 8, header.version);
+    store_le(buffer + 12, header.flags);
+    store_le(buffer + 16, header.entry_count);
+    store_le(buffer + 24, header.toc_offset);
+    store_le(buffer + 32, header.strings_offset);
+    store_le(buffer + 40, header.strings_size);
+    store_le(buffer + 48, header.data_offset);
+    store_le(buffer + 56, header.file_size);
+}
+
+/**
+ * Read a header from a buffer
+ *
+ * @param buffer the first bytes of a file
+ * @param size number of bytes available in buffer
+ * @param header destination
+ *
+ * @return true if the buffer holds a v2 header of a supported version
+*/
+bool decode_header(const char *buffer, size_t size, Header &header) {
+    if (size < HEADER_SIZE || !has_magic(buffer, size)) {return false;}
+    header.version = load_le<uint32_t>(buffer + 8);
+    header.flags = load_le<uint32_t>(buffer + 12);
+    header.entry_count = load_le<uint64_t>(buffer + 16);
+    header.toc_offset = load_le<uint64_t>(buffer + 24);
+    header.strings_offset = load_le<uint64_t>(buffer + 32);
+    header.strings_size = load_le<uint64_t>(buffer + 40);
+    header.data_offset = load_le<uint64_t>(buffer + 48);
+    header.file_size = load_le<uint64_t>(buffer + 56);
+    return header.version == VERSION;
+}
+
+/**
+ * Check that the sections described by a header fit inside the file
+ *
+ * @param header a decoded header
+ * @param file_size the actual file size
+ *
+ * @return true if the header is consistent with the file
+*/
+bool validate_header(const Header &header, uint64_t file_size) {
+    if (header.file_size != file_size) {return false;}
+    if (header.toc_offset < HEADER_SIZE || header.toc_offset > file_size) {return false;}
+    if (header.entry_count > (file_size - header.toc_offset) / TOC_ENTRY_SIZE) {return false;}
+    if (header.strings_offset < header.toc_offset + header.entry_count * TOC_ENTRY_SIZE) {return false;}
+    if (header.strings_offset > file_size || header.strings_size > file_size - header.strings_offset) {return false;}
+    if (header.data_offset < header.strings_offset + header.strings_size || header.data_offset > file_size) {return false;}
+    if ((header.flags & HEADER_HAS_TRAILER) && file_size - header.data_offset < TRAILER_SIZE) {return false;}
+    return true;
+}
+
+/**
+ * Write a TOC entry to TOC_ENTRY_SIZE bytes of buffer
+ *
+ * @param entry the entry to write
+ * @param buffer destination, at least TOC_ENTRY_SIZE bytes
+*/
+void encode_entry(const TocEntry &entry, char *buffer) {
+    store_le(buffer, entry.hash);
+    store_le(buffer + 8, entry.type);
+    store_le(buffer + 16, entry.offset);
+    store_le(buffer + 24, entry.size);
+    store_le(buffer + 32, entry.stored_size);
+    store_le(buffer + 40, entry.id_offset);
+    store_le(buffer + 44, entry.id_length);
+    store_le(buffer + 46, entry.codec);
+    store_le(buffer + 47, entry.flags);
+    store_le(buffer + 48, entry.checksum);
+    store_le(buffer + 52, static_cast<uint32_t>(0));
+}
+
+/**
+ * Read a TOC entry from a buffer
+ *
+ * @param buffer source, at least TOC_ENTRY_SIZE bytes
+ * @param entry destination
+*/
+void decode_entry(const char *buffer, TocEntry &entry) {
+    entry.hash = load_le<uint64_t>(buffer);
+    entry.type = load_le<uint64_t>(buffer + 8);
+    entry.offset = load_le<uint64_t>(buffer + 16);
+    entry.size = load_le<uint64_t>(buffer + 24);
+    entry.stored_size = load_le<uint64_t>(buffer + 32);
+    entry.id_offset = load_le<uint32_t>(buffer + 40);
+    entry.id_length = load_le<uint16_t>(buffer + 44);
+    entry.codec = load_le<uint8_t>(buffer + 46);
+    entry.flags = load_le<uint8_t>(buffer + 47);
+    entry.checksum = load_le<uint32_t>(buffer + 48);
+}
+
+/**
+ * Check that the id and data block of an entry lie inside their sections and its sizes fit its codec
+ *
+ * @param entry a decoded entry
+ * @param header the validated header of the same file
+ *
+ * @return true if the entry can be safely read
+*/
+bool validate_entry(const TocEntry &entry, const Header &header) {
+    if (static_cast<uint64_t>(entry.id_offset) + entry.id_length > header.strings_size) {return false;}
+    uint64_t end = data_end(header);
+    if (entry.offset < header.data_offset || entry.offset > end) {return false;}
+    if (entry.stored_size > end - entry.offset) {return false;}
+    if (entry.codec == CODEC_RAW && entry.size != entry.stored_size) {return false;}
+    // No codec expands data more than deflate, about 1032 to 1
+    if (entry.codec != CODEC_RAW && entry.size / 1032 > entry.stored_size) {return false;}
+    return true;
+}
+
+/**
+ * Write a trailer to TRAILER_SIZE bytes of buffer, magic included
+ *
+ * @param trailer the trailer to write
+ * @param buffer destination, at least TRAILER_SIZE bytes
+*/
+void encode_trailer(const Trailer &trailer, char *buffer) {
+    store_le(buffer, trailer.index_checksum);
+    store_le(buffer + 4, static_cast<uint32_t>(0));
+    std::memcpy(buffer + 8, TRAILER_MAGIC, sizeof(TRAILER_MAGIC));
+}
+
+/**
+ * Read a trailer from a buffer
+ *
+ * @param buffer the last TRAILER_SIZE bytes of a file
+ * @param trailer destination
+ *
+ * @return true if the buffer holds a trailer
+*/
+bool decode_trailer(const char *buffer, Trailer &trailer) {
+    if (std::memcmp(buffer + 8, TRAILER_MAGIC, sizeof(TRAILER_MAGIC)) != 0) {return false;}
+    trailer.index_checksum = load_le<uint32_t>(buffer);
+    return true;
+}
+
+/**
+ * Get the end of the data block section
+ *
+ * @param header a validated header
+ *
+ * @return the file offset one past the last data byte
+*/
+uint64_t data_end(const Header &header) {
+    return header.file_size - ((header.flags & HEADER_HAS_TRAILER) ? TRAILER_SIZE : 0);
+}
+
+/**
+ * Order an id against a TOC entry, by hash first and id second
+ *
+ * @param hash hash of the id
+ * @param id pointer to the id characters
+ * @param length number of characters in the id
+ * @param entry the TOC entry to compare against
+ * @param strings the string table of the file holding entry
+ *
+ * @return negative, zero or positive if the id sorts before, equal to or after the entry
+*/
+int compare_entry(uint64_t hash, const char *id, size_t length, const TocEntry &entry, const char *strings) {
+    if (hash != entry.hash) {return hash < entry.hash ? -1 : 1;}
+    size_t common = length < entry.id_length ? length : entry.id_length;
+    int result = std::memcmp(id, strings + entry.id_offset, common);
+    if (result != 0) {return result;}
+    if (length == entry.id_length) {return 0;}
+    return length < entry.id_length ? -1 : 1;
+}
+
+
+/**
+ * Check if a buffer starts with the store magic
+ *
+ * @param buffer the first bytes of a file
+ * @param size number of bytes available in buffer
+ *
+ * @return true if the buffer starts with the store magic
+*/
+bool has_store_magic(const char *buffer, size_t size) {
+    return size >= sizeof(STORE_MAGIC) && std::memcmp(buffer, STORE_MAGIC, sizeof(STORE_MAGIC)) == 0;
+}
+
+/**
+ * Write a store header to STORE_HEADER_SIZE bytes of buffer, magic included
+ *
+ * @param header the header to write
+ * @param buffer destination, at least STORE_HEADER_SIZE bytes
+*/
+void encode_store_header(const StoreHeader &header, char *buffer) {
+    std::memset(buffer, 0, STORE_HEADER_SIZE);
+    std::memcpy(buffer, STORE_MAGIC, sizeof(STORE_MAGIC));
+    store_le(buffer + 8, header.version);
+    store_le(buffer + 12, header.flags);
+    store_le(buffer + 16, header.recipe_count);
+    store_le(buffer + 24, header.directory_offset);
+    store_le(buffer + 32, header.names_offset);
+    store_le(buffer + 40, header.names_size);
+    store_le(buffer + 48, header.data_offset);
+    store_le(buffer + 56, header.file_size);
+}
+
+/**
+ * Read a store header from a buffer
+ *
+ * @param buffer the first bytes of a file
+ * @param size number of bytes available in buffer
+ * @param header destination
+ *
+ * @return true if the buffer holds a store header of a supported version
+*/
+bool decode_store_header(const char *buffer, size_t size, StoreHeader &header) {
+    if (size < STORE_HEADER_SIZE || !has_store_magic(buffer, size)) {return false;}
+    header.version = load_le<uint32_t>(buffer + 8);
+    header.flags = load_le<uint32_t>(buffer + 12);
+    header.recipe_count = load_le<uint64_t>(buffer + 16);
+    header.directory_offset = load_le<uint64_t>(buffer + 24);
+    header.names_offset = load_le<uint64_t>(buffer + 32);
+    header.names_size = load_le<uint64_t>(buffer + 40);
+    header.data_offset = load_le<uint64_t>(buffer + 48);
+    header.file_size = load_le<uint64_t>(buffer + 56);
+    return header.version == STORE_VERSION;
+}
+
+/**
+ * Check that the sections described by a store header fit inside the file
+ *
+ * @param header a decoded store header
+ * @param file_size the actual file size
+ *
+ * @return true if the header is consistent with the file
+*/
+bool validate_store_header(const StoreHeader &header, uint64_t file_size) {
+    if (header.file_size != file_size || file_size < TRAILER_SIZE) {return false;}
+    if (header.directory_offset < STORE_HEADER_SIZE || header.directory_offset > file_size) {return false;}
+    if (header.recipe_count > (file_size - header.directory_offset) / STORE_ENTRY_SIZE) {return false;}
+    if (header.names_offset < header.directory_offset + header.recipe_count * STORE_ENTRY_SIZE) {return false;}
+    if (header.names_offset > file_size || header.names_size > file_size - header.names_offset) {return false;}
+    if (header.data_offset < header.names_offset + header.names_size || header.data_offset > file_size - TRAILER_SIZE) {return false;}
+    return true;
+}
+
+/**
+ * Write a directory entry to STORE_ENTRY_SIZE bytes of buffer
+ *
+ * @param entry the entry to write
+ * @param buffer destination, at least STORE_ENTRY_SIZE bytes
+*/
+void encode_store_entry(const StoreEntry &entry, char *buffer) {
+    store_le(buffer, entry.offset);
+    store_le(buffer + 8, entry.size);
+    store_le(buffer + 16, entry.capacity);
+    store_le(buffer + 24, entry.name_offset);
+    store_le(buffer + 28, entry.name_length);
+}
+
+/**
+ * Read a directory entry from a buffer
+ *
+ * @param buffer source, at least STORE_ENTRY_SIZE bytes
+ * @param entry destination
+*/
+void decode_store_entry(const char *buffer, StoreEntry &entry) {
+    entry.offset = load_le<uint64_t>(buffer);
+    entry.size = load_le<uint64_t>(buffer + 8);
+    entry.capacity = load_le<uint64_t>(buffer + 16);
+    entry.name_offset = load_le<uint32_t>(buffer + 24);
+    entry.name_length = load_le<uint32_t>(buffer + 28);
+}
+
+/**
+ * Check that the name and image of a directory entry lie inside their sections
+ *
+ * @param entry a decoded entry
+ * @param header the validated header of the same store
+ *
+ * @return true if the entry can be safely read
+*/
+bool validate_store_entry(const StoreEntry &entry, const StoreHeader &header) {
+    if (static_cast<uint64_t>(entry.name_offset) + entry.name_length > header.names_size) {return false;}
+    uint64_t end = header.file_size - TRAILER_SIZE;
+    if (entry.offset < header.data_offset || entry.offset > end) {return false;}
+    if (entry.capacity > end - entry.offset || entry.size > entry.capacity) {return false;}
+    return true;
+}
+
+/**
+ * Write a v1 length field
+ *
+ * @param length the id length or value size
+ * @param buffer destination, at least V1_LENGTH_SIZE bytes
+*/
+void encode_v1_length(uint64_t length, char *buffer) {
+    store_le(buffer, length);
+}
+
+/**
+ * Read a v1 length field
+ *
+ * @param buffer the field, at least V1_LENGTH_SIZE bytes
+ *
+ * @return the id length or value size
+*/
+uint64_t decode_v1_length(const char *buffer) {
+    return load_le<uint64_t>(buffer);
+}
+
+/**
+ * Write a journal header to JOURNAL_HEADER_SIZE bytes of buffer, magic included
+ *
+ * @param buffer destination, at least JOURNAL_HEADER_SIZE bytes
+*/
+void encode_journal_header(char *buffer) {
+    std::memset(buffer, 0, JOURNAL_HEADER_SIZE);
+    std::memcpy(buffer, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+    store_le(buffer + 8, JOURNAL_VERSION);
+}
+
+/**
+ * Check the header of a journal
+ *
+ * @param buffer the first bytes of a journal
+ * @param size number of bytes available in buffer
+ *
+ * @return true if the buffer holds a journal header of a supported version
+*/
+bool decode_journal_header(const char *buffer, size_t size) {
+    if (size < JOURNAL_HEADER_SIZE || std::memcmp(buffer, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0) {return false;}
+    return load_le<uint32_t>(buffer + 8) == JOURNAL_VERSION;
+}
+
+/**
+ * Compute the checksum of a journal record
+ *
+ * @param record the record, its checksum field is ignored
+ * @param data the "size" bytes of value data of the record
+ *
+ * @return the record checksum
+*/
+uint32_t journal_checksum(const JournalRecord &record, const char *data) {
+    char fields[16];
+    store_le(fields, record.hash);
+    store_le(fields + 8, record.size);
+    return crc32c(crc32c(0, fields, sizeof(fields)), data, record.size);
+}
+
+/**
+ * Write a journal record header to JOURNAL_RECORD_SIZE bytes of buffer
+ *
+ * @param record the record to write
+ * @param buffer destination, at least JOURNAL_RECORD_SIZE bytes
+*/
+void encode_journal_record(const JournalRecord &record, char *buffer) {
+    store_le(buffer, record.hash);
+    store_le(buffer + 8, record.size);
+    store_le(buffer + 16, record.checksum);
+    store_le(buffer + 20, static_cast<uint32_t>(0));
+}
+
+/**
+ * Read a journal record header from a buffer
+ *
+ * @param buffer the record header
+ * @param size number of bytes available from buffer to the end of the journal
+ * @param record destination
+ *
+ * @return true if the header and data of the record are inside the journal
+*/
+bool decode_journal_record(const char *buffer, size_t size, JournalRecord &record) {
+    if (size < JOURNAL_RECORD_SIZE) {return false;}
+    record.hash = load_le<uint64_t>(buffer);
+    record.size = load_le<uint64_t>(buffer + 8);
+    record.checksum = load_le<uint32_t>(buffer + 16);
+    return record.size <= size - JOURNAL_RECORD_SIZE;
+}
+
+/**
+ * Write a history header to HISTORY_HEADER_SIZE bytes of buffer, magic included
+ *
+ * @param buffer destination, at least HISTORY_HEADER_SIZE bytes
+*/
+void encode_history_header(char *buffer) {
+    std::memset(buffer, 0, HISTORY_HEADER_SIZE);
+    std::memcpy(buffer, HISTORY_MAGIC, sizeof(HISTORY_MAGIC));
+    store_le(buffer + 8, HISTORY_VERSION);
+}
+
+/**
+ * Check the header of a history
+ *
+ * @param buffer the first bytes of a history
+ * @param size number of bytes available in buffer
+ *
+ * @return true if the buffer holds a history header of a supported version
+*/
+bool decode_history_header(const char *buffer, size_t size) {
+    if (size < HISTORY_HEADER_SIZE || std::memcmp(buffer, HISTORY_MAGIC, sizeof(HISTORY_MAGIC)) != 0) {return false;}
+    return load_le<uint32_t>(buffer + 8) == HISTORY_VERSION;
+}
+
+/**
+ * Write a history record header to HISTORY_RECORD_SIZE bytes of buffer, header checksum included
+ *
+ * @param record the record to write
+ * @param buffer destination, at least HISTORY_RECORD_SIZE bytes
+*/
+void encode_history_record(const HistoryRecord &record, char *buffer) {
+    store_le(buffer, record.kind);
+    store_le(buffer + 4, record.flags);
+    store_le(buffer + 8, record.size);
+    store_le(buffer + 16, record.checksum);
+    store_le(buffer + 20, crc32c(0, buffer, 20));
+}
+
+/**
+ * Read a history record header from a buffer
+ *
+ * @param buffer the record header
+ * @param size number of bytes available from buffer to the end of the history
+ * @param record destination
+ *
+ * @return true if the header is intact and the data of the record is inside the history
+*/
+bool decode_history_record(const char *buffer, size_t size, HistoryRecord &record) {
+    if (size < HISTORY_RECORD_SIZE) {return false;}
+    if (crc32c(0, buffer, 20) != load_le<uint32_t>(buffer + 20)) {return false;}
+    record.kind = load_le<uint32_t>(buffer);
+    record.flags = load_le<uint32_t>(buffer + 4);
+    record.size = load_le<uint64_t>(buffer + 8);
+    record.checksum = load_le<uint32_t>(buffer + 16);
+    return record.size <= size - HISTORY_RECORD_SIZE;
+}
+
+/**
+ * Write a version header to HISTORY_VERSION_HEADER_SIZE bytes of buffer
+ *
+ * @param header the header to write
+ * @param buffer destination, at least HISTORY_VERSION_HEADER_SIZE bytes
+*/
+void encode_version_header(const VersionHeader &header, char *buffer) {
+    store_le(buffer, header.version);
+    store_le(buffer + 8, header.parent);
+    store_le(buffer + 16, header.time);
+    store_le(buffer + 24, header.entry_count);
+}
+
+/**
+ * Read a version header from HISTORY_VERSION_HEADER_SIZE bytes of buffer
+ *
+ * @param buffer the version header
+ * @param header destination
+*/
+void decode_version_header(const char *buffer, VersionHeader &header) {
+    header.version = load_le<uint64_t>(buffer);
+    header.parent = load_le<uint64_t>(buffer + 8);
+    header.time = load_le<int64_t>(buffer + 16);
+    header.entry_count = load_le<uint64_t>(buffer + 24);
+}
+
+/**
+ * Write a version entry to HISTORY_ENTRY_SIZE bytes of buffer, without its id
+ *
+ * @param entry the entry to write
+ * @param buffer destination, at least HISTORY_ENTRY_SIZE bytes
+*/
+void encode_history_entry(const HistoryEntry &entry, char *buffer) {
+    store_le(buffer, entry.blob);
+    store_le(buffer + 8, entry.size);
+    store_le(buffer + 16, entry.type);
+    store_le(buffer + 24, entry.checksum);
+    store_le(buffer + 28, entry.id_length);
+    store_le(buffer + 30, entry.flags);
+    store_le(buffer + 31, static_cast<uint8_t>(0));
+}
+
+/**
+ * Read a version entry from HISTORY_ENTRY_SIZE bytes of buffer
+ *
+ * @param buffer the entry
+ * @param entry destination
+*/
+void decode_history_entry(const char *buffer, HistoryEntry &entry) {
+    entry.blob = load_le<uint64_t>(buffer);
+    entry.size = load_le<uint64_t>(buffer + 8);
+    entry.type = load_le<uint64_t>(buffer + 16);
+    entry.checksum = load_le<uint32_t>(buffer + 24);
+    entry.id_length = load_le<uint16_t>(buffer + 28);
+    entry.flags = load_le<uint8_t>(buffer + 30);
+}
+
+}
+}
@@ -0,0 +1,377 @@
+#include "recipe_history.hpp"
+#include "checksum.hpp"
+#include "stats_probe.hpp"
+
+#include <chrono>
+#include <cstring>
+
+namespace rcp {
+
+/**
+ * Construct a closed history
+ *
+ * @param resource the memory resource of the version and blob indexes and of the buffers of appends
+*/
+RecipeHistory::RecipeHistory(std::pmr::memory_resource *resource):
+    _resource(resource), _versions(resource), _blobs(resource)
+{
+    this->_end = 0;
+}
+
+/**
+ * Open a history for reading and appending, creating it if it does not exist.
+ * A history ending in a torn record is truncated behind its last valid record,
+ * a file without a valid history header is replaced by an empty history.
+ *
+ * @param path the history file
+ *
+ * @return true if the history was opened
+*/
+bool RecipeHistory::open(const std::string &path) {
+    this->_close();
+    this->_path = path;
+    if (!this->_file.open(path, true)) {return false;}
+    if (!this->_map.open(path)) {
+        this->_file.close();
+        return false;
+    }
+
+    uint64_t end = this->_scan(this->_map.data(), this->_map.size());
+    uint64_t size = this->_map.size();
+    if (end == 0) {
+        char header[format::HISTORY_HEADER_SIZE];
+        format::encode_history_header(header);
+        this->_map.close();
+        if (!this->_file.resize(0) || !this->_file.write_at(0, header, sizeof(header))) {
+            this->_file.close();
+            return false;
+        }
+        end = sizeof(header);
+        size = end;
+    }
+    if (end != size) {
+        this->_map.close();
+        if (!this->_file.resize(end)) {
+            this->_file.close();
+            return false;
+        }
+    }
+    if (!this->_map.is_open() && !this->_map.open(path)) {
+        this->_file.close();
+        return false;
+    }
+    this->_end = end;
+    return true;
+}
+
+/**
+ * Check if the history is open
+ *
+ * @return true after "open" succeeded, false once the history was closed by a failed "append"
+*/
+bool RecipeHistory::is_open() const {
+    return this->_file.is_open() && this->_map.is_open();
+}
+
+/**
+ * Get the newest version
+ *
+ * @return the highest version number, 0 if the history holds no version
+*/
+uint64_t RecipeHistory::latest() const {
+    return this->_versions.empty() ? 0 : this->_versions.rbegin()->first;
+}
+
+/**
+ * Check if a version exists
+ *
+ * @param version the version number
+ *
+ * @return true if the history holds the version
+*/
+bool RecipeHistory::contains(uint64_t version) const {
+    return this->_versions.find(version) != this->_versions.end();
+}
+
+/**
+ * List the versions
+ *
+ * @return every version, oldest first
+*/
+std::vector<VersionInfo> RecipeHistory::versions() const {
+    std::vector<VersionInfo> versions;
+    versions.reserve(this->_versions.size());
+    for (const auto &[number, version]: this->_versions) {
+        VersionInfo info;
+        info.version = number;
+        info.parent = version.parent;
+        info.time = std::chrono::system_clock::time_point(
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(version.time)));
+        info.entries = version.entry_count;
+        info.snapshot = version.snapshot;
+        versions.push_back(info);
+    }
+    return versions;
+}
+
+/**
+ * Collect the entries of a version by walking its chain of parents up to the nearest snapshot.
+ * Each id keeps the entry of the newest version listing it, removed entries are kept flagged HISTORY_ENTRY_REMOVED.
+ *
+ * @param version the version number
+ * @param manifest receives the entries, cleared first
+ *
+ * @return false if the version does not exist or a version record of its chain is malformed
+*/
+bool RecipeHistory::resolve(uint64_t version, Manifest &manifest) const {
+    manifest.clear();
+    auto current = this->_versions.find(version);
+    if (current == this->_versions.end() || !this->is_open()) {return false;}
+    const char *data = this->_map.data();
+    uint64_t size = this->_map.size();
+
+    while (true) {
+        const Version &record = current->second;
+        if (data == nullptr || record.offset > size || record.size > size - record.offset) {return false;}
+        const char *entries = data + record.offset;
+        uint64_t position = format::HISTORY_VERSION_HEADER_SIZE;
+        format::HistoryEntry entry;
+        for (uint64_t i = 0; i < record.entry_count; i++) {
+            if (record.size - position < format::HISTORY_ENTRY_SIZE) {return false;}
+            format::decode_history_entry(entries + position, entry);
+            position += format::HISTORY_ENTRY_SIZE;
+            if (entry.id_length > record.size - position) {return false;}
+            std::string_view id(entries + position, entry.id_length);
+            position += entry.id_length;
+
+            bool removed = entry.flags & format::HISTORY_ENTRY_REMOVED;
+            if (!removed && (entry.blob > size || entry.size > size - entry.blob)) {return false;}
+            if (manifest.find(id) == manifest.end()) {manifest.emplace(std::pmr::string(id, this->_resource), entry);}
+        }
+        if (record.snapshot) {return true;}
+        current = this->_versions.find(record.parent);
+        if (current == this->_versions.end()) {return false;}
+    }
+}
+
+/**
+ * Get the stored value of an entry, not yet checked against its checksum
+ *
+ * @param entry an entry returned by "resolve"
+ *
+ * @return the "size" bytes of the value, nullptr if the entry is removed or lies outside the history
+*/
+const char* RecipeHistory::blob(const format::HistoryEntry &entry) const {
+    if ((entry.flags & format::HISTORY_ENTRY_REMOVED) || this->_map.data() == nullptr) {return nullptr;}
+    if (entry.blob > this->_map.size() || entry.size > this->_map.size() - entry.blob) {return nullptr;}
+    return this->_map.data() + entry.blob;
+}
+
+/**
+ * Append a version holding the staged values.
+ * Values equal to the entry of the parent are left out unless the version is a snapshot,
+ * changed values are stored as new blobs unless a blob with the same bytes exists,
+ * variables of the parent that are no longer staged are recorded as removed.
+ * A failed append truncates the history back to its previous end.
+ * If the grown file cannot be mapped again the history is closed and the append reports a failure,
+ * the appended version is found again by the next "open".
+ *
+ * @param staged the values, see "stage_values"
+ * @param parent the version the values are saved on top of, 0 for none
+ * @param snapshot_interval the longest chain of versions, every version is a snapshot if 1 or less
+ * @param sync flush the history to the storage device
+ *
+ * @return the new version number, 0 if the append failed or the history was closed
+*/
+uint64_t RecipeHistory::append(RecipeRegistry &staged, uint64_t parent, size_t snapshot_interval, bool sync) {
+    if (!this->is_open()) {return 0;}
+    Manifest base(this->_resource);
+    auto parent_version = this->_versions.find(parent);
+    if (parent != 0 && (parent_version == this->_versions.end() || !this->resolve(parent, base))) {return 0;}
+    bool snapshot = parent == 0 || parent_version->second.depth + 1 >= snapshot_interval;
+    uint64_t version = this->latest() + 1;
+
+    // Blobs written by this append, not yet in the mapping
+    struct Pending {
+        const char *data;
+        uint64_t size;
+        uint64_t blob;
+    };
+    std::pmr::unordered_multimap<uint32_t, Pending> pending(this->_resource);
+    std::pmr::vector<char> record(format::HISTORY_VERSION_HEADER_SIZE, this->_resource);
+    char header[format::HISTORY_RECORD_SIZE];
+    char entry_buffer[format::HISTORY_ENTRY_SIZE];
+    uint64_t entry_count = 0;
+    stats_allocation();
+
+    auto add_entry = [&](std::string_view id, const format::HistoryEntry &entry) {
+        format::encode_history_entry(entry, entry_buffer);
+        record.insert(record.end(), entry_buffer, entry_buffer + sizeof(entry_buffer));
+        record.insert(record.end(), id.begin(), id.end());
+        entry_count++;
+        stats_entry();
+    };
+
+    stats_phase(RecipePhase::Copy);
+    BufferedWriter writer(this->_file, this->_end, 1 << 20, this->_resource);
+    bool success = true;
+    for (RecipeItem &item: staged) {
+        std::string_view id = staged.id(item);
+        format::HistoryEntry entry = {0, item.size, item.type, crc32c(0, item.ptr, item.size), static_cast<uint16_t>(id.size()), 0};
+        auto known = base.find(id);
+        bool unchanged = known != base.end() && !(known->second.flags & format::HISTORY_ENTRY_REMOVED) &&
+                         known->second.size == entry.size && known->second.type == entry.type &&
+                         known->second.checksum == entry.checksum && this->_same(known->second, item.ptr);
+        if (unchanged && !snapshot) {continue;}
+
+        if (unchanged) {
+            entry.blob = known->second.blob;
+        } else {
+            entry.blob = this->_find_blob(item.ptr, item.size, entry.checksum);
+            auto candidates = pending.equal_range(entry.checksum);
+            for (auto candidate = candidates.first; entry.blob == 0 && candidate != candidates.second; candidate++) {
+                const Pending &blob = candidate->second;
+                if (blob.size == item.size && std::memcmp(blob.data, item.ptr, item.size) == 0) {entry.blob = blob.blob;}
+            }
+        }
+        if (entry.blob == 0) {
+            format::HistoryRecord blob = {format::HISTORY_KIND_BLOB, 0, item.size, entry.checksum};
+            format::encode_history_record(blob, header);
+            entry.blob = writer.offset() + format::HISTORY_RECORD_SIZE;
+            if (!writer.write(header, sizeof(header)) || !writer.write(item.ptr, item.size)) {
+                success = false;
+                break;
+            }
+            pending.emplace(entry.checksum, Pending{item.ptr, item.size, entry.blob});
+        }
+        add_entry(id, entry);
+    }
+    if (success && !snapshot) {
+        for (const auto &[id, entry]: base) {
+            if ((entry.flags & format::HISTORY_ENTRY_REMOVED) || staged.find(id) != nullptr) {continue;}
+            add_entry(id, {0, 0, 0, 0, static_cast<uint16_t>(id.size()), format::HISTORY_ENTRY_REMOVED});
+        }
+    }
+
+    // Version record, after the blobs it refers to
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    format::VersionHeader version_header = {
+        version, parent, std::chrono::duration_cast<std::chrono::nanoseconds>(now).count(), entry_count
+    };
+    format::encode_version_header(version_header, record.data());
+    format::HistoryRecord version_record = {
+        format::HISTORY_KIND_VERSION, snapshot ? format::HISTORY_SNAPSHOT : 0, record.size(), crc32c(0, record.data(), record.size())
+    };
+    format::encode_history_record(version_record, header);
+    uint64_t version_offset = writer.offset() + format::HISTORY_RECORD_SIZE;
+
+    stats_phase(RecipePhase::Flush);
+    success = success && writer.write(header, sizeof(header)) && writer.write(record.data(), record.size());
+    success = writer.flush() && success;
+    if (success && sync) {success = this->_file.sync();}
+    if (!success) {
+        this->_file.resize(this->_end);
+        return 0;
+    }
+
+    this->_end = writer.offset();
+    for (const auto &[checksum, blob]: pending) {this->_blobs.emplace(checksum, blob.blob);}
+    Version added = {
+        version_offset, record.size(), parent, version_header.time, entry_count,
+        snapshot ? 0 : parent_version->second.depth + 1, snapshot
+    };
+    this->_versions.emplace(version, added);
+    // Readers of the new records need a mapping of the grown file
+    if (!this->_map.open(this->_path)) {
+        this->_close();
+        return 0;
+    }
+    return version;
+}
+
+/**
+ * Close the file and the mapping and forget the indexed versions and blobs.
+ * Used by "open" and when the history can no longer be read.
+*/
+void RecipeHistory::_close() {
+    this->_file.close();
+    this->_map.close();
+    this->_versions.clear();
+    this->_blobs.clear();
+    this->_end = 0;
+}
+
+/**
+ * Index the records of a history
+ *
+ * @param data the history file
+ * @param size the file size
+ *
+ * @return the end of the last valid record, 0 if the file is not a history
+*/
+uint64_t RecipeHistory::_scan(const char *data, size_t size) {
+    if (!format::decode_history_header(data, size)) {return 0;}
+    uint64_t offset = format::HISTORY_HEADER_SIZE;
+    format::HistoryRecord record;
+    while (offset < size && format::decode_history_record(data + offset, size - offset, record)) {
+        uint64_t body = offset + format::HISTORY_RECORD_SIZE;
+        if (record.kind == format::HISTORY_KIND_BLOB) {
+            this->_blobs.emplace(record.checksum, body);
+        } else if (record.kind == format::HISTORY_KIND_VERSION) {
+            if (record.size < format::HISTORY_VERSION_HEADER_SIZE) {break;}
+            if (crc32c(0, data + body, record.size) != record.checksum) {break;}
+            format::VersionHeader header;
+            format::decode_version_header(data + body, header);
+            if (header.version <= this->latest()) {break;}
+
+            Version version = {body, record.size, header.parent, header.time, header.entry_count, 0, false};
+            version.snapshot = record.flags & format::HISTORY_SNAPSHOT;
+            if (!version.snapshot) {
+                auto parent = this->_versions.find(header.parent);
+                if (parent == this->_versions.end()) {break;}
+                version.depth = parent->second.depth + 1;
+            }
+            this->_versions.emplace(header.version, version);
+        }
+        // Records of unknown kinds are skipped
+        offset = body + record.size;
+    }
+    return offset;
+}
+
+/**
+ * Find a stored blob holding the given bytes
+ *
+ * @param data the bytes
+ * @param size number of bytes
+ * @param checksum the checksum of the bytes
+ *
+ * @return the offset of the blob data, 0 if no blob holds the bytes
+*/
+uint64_t RecipeHistory::_find_blob(const char *data, uint64_t size, uint32_t checksum) const {
+    auto candidates = this->_blobs.equal_range(checksum);
+    for (auto candidate = candidates.first; candidate != candidates.second; candidate++) {
+        format::HistoryRecord record;
+        uint64_t offset = candidate->second - format::HISTORY_RECORD_SIZE;
+        if (candidate->second > this->_map.size()) {continue;}
+        if (!format::decode_history_record(this->_map.data() + offset, this->_map.size() - offset, record)) {continue;}
+        if (record.size != size) {continue;}
+        if (size == 0 || std::memcmp(this->_map.data() + candidate->second, data, size) == 0) {return candidate->second;}
+    }
+    return 0;
+}
+
+/**
+ * Compare the stored value of an entry with the given bytes
+ *
+ * @param entry an entry of the history with a size equal to the number of bytes
+ * @param data the bytes
+ *
+ * @return true if the stored value holds the same bytes
+*/
+bool RecipeHistory::_same(const format::HistoryEntry &entry, const char *data) const {
+    const char *stored = this->blob(entry);
+    return stored != nullptr && (entry.size == 0 || std::memcmp(stored, data, entry.size) == 0);
+}
+
+}
@@ -0,0 +1,363 @@
+#include "recipe_registry.hpp"
+#include "recipe_format.hpp"
+
+#include <cstring>
+
+namespace rcp {
+
+namespace {
+
+constexpr uint32_t EMPTY = UINT32_MAX;
+constexpr size_t MIN_CAPACITY = 16;
+
+uint32_t tag_of(uint64_t hash) {
+    return static_cast<uint32_t>(hash >> 32);
+}
+
+}
+
+/**
+ * Construct an empty registry
+ *
+ * @param resource the memory resource of all registry storage
+*/
+RecipeRegistry::RecipeRegistry(std::pmr::memory_resource *resource):
+    _items(resource), _slots(resource), _ids(resource), _streams(resource)
+{
+    this->_garbage = 0;
+}
+
+/**
+ * Copy a registry, the copy allocates from the memory resource of "other"
+ *
+ * @param other the registry to copy
+*/
+RecipeRegistry::RecipeRegistry(const RecipeRegistry &other):
+    _items(other._items, other.resource()), _slots(other._slots, other.resource()),
+    _ids(other._ids, other.resource()), _streams(other._streams, other.resource())
+{
+    this->_garbage = other._garbage;
+}
+
+/**
+ * Add an item.
+ * The item will only be added if the id is not yet registered.
+ *
+ * @param id a unique identifier for the variable
+ * @param ptr a char pointer to the variable
+ * @param size the size of the variable in number of bytes
+ * @param type the type fingerprint of the variable, 0 for untyped
+ *
+ * @return the new item, or nullptr if the id is already registered
+*/
+RecipeItem* RecipeRegistry::insert(std::string_view id, char *ptr, size_t size, uint64_t type) {
+    if ((this->_items.size() + 1) * 2 > this->_slots.size()) {
+        size_t capacity = this->_slots.empty() ? MIN_CAPACITY : this->_slots.size() * 2;
+        this->_rehash(capacity);
+    }
+
+    uint64_t hash = format::hash_id(id.data(), id.length());
+    size_t position = this->_probe(id, hash);
+    if (this->_slots[position].index != EMPTY) {return nullptr;}
+
+    RecipeItem item{};
+    item.ptr = ptr;
+    item.size = size;
+    item.hash = hash;
+    item.type = type;
+    item.codec = -1;
+    item.id_offset = static_cast<uint32_t>(this->_ids.size());
+    item.id_length = static_cast<uint32_t>(id.length());
+    item.dirty = true;
+    this->_ids.insert(this->_ids.end(), id.begin(), id.end());
+
+    this->_slots[position] = {static_cast<uint32_t>(this->_items.size()), tag_of(hash)};
+    this->_items.push_back(item);
+    return &this->_items.back();
+}
+
+/**
+ * Add a streamed item.
+ * The item will only be added if the id is not yet registered.
+ *
+ * @param id a unique identifier for the variable
+ * @param reader consumes the stored value on load
+ * @param writer produces the value on save
+ *
+ * @return the new item, or nullptr if the id is already registered
+*/
+RecipeItem* RecipeRegistry::insert_stream(std::string_view id, StreamReader reader, StreamWriter writer) {
+    RecipeItem *item = this->insert(id, nullptr, 0);
+    if (item == nullptr) {return nullptr;}
+    this->_streams.push_back({std::move(reader), std::move(writer)});
+    item->stream = static_cast<uint32_t>(this->_streams.size());
+    return item;
+}
+
+/**
+ * Remove an item.
+ * The last item is moved into the freed position.
+ *
+ * @param id the identifier of the variable
+ *
+ * @return true if the item was removed
+*/
+bool RecipeRegistry::erase(std::string_view id) {
+    if (this->_items.empty()) {return false;}
+
+    uint64_t hash = format::hash_id(id.data(), id.length());
+    size_t position = this->_probe(id, hash);
+    uint32_t index = this->_slots[position].index;
+    if (index == EMPTY) {return false;}
+    this->_garbage += this->_items[index].id_length;
+
+    // Move the last stream into the freed stream position
+    uint32_t stream = this->_items[index].stream;
+    if (stream != 0) {
+        uint32_t last_stream = static_cast<uint32_t>(this->_streams.size());
+        if (stream != last_stream) {
+            for (RecipeItem &item: this->_items) {
+                if (item.stream == last_stream) {item.stream = stream;}
+            }
+            this->_streams[stream - 1] = std::move(this->_streams.back());
+        }
+        this->_streams.pop_back();
+    }
+
+    // Backward shift deletion keeps probe sequences intact without tombstones
+    size_t mask = this->_slots.size() - 1;
+    size_t hole = position;
+    size_t next = (hole + 1) & mask;
+    while (this->_slots[next].index != EMPTY) {
+        size_t home = this->_items[this->_slots[next].index].hash & mask;
+        bool movable = (hole <= next) ? (home <= hole || home > next) : (home <= hole && home > next);
+        if (movable) {
+            this->_slots[hole] = this->_slots[next];
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+    this->_slots[hole].index = EMPTY;
+
+    // Move the last item into the freed position
+    uint32_t last = static_cast<uint32_t>(this->_items.size() - 1);
+    if (index != last) {
+        RecipeItem &moved = this->_items[last];
+        size_t slot = moved.hash & mask;
+        while (this->_slots[slot].index != last) {slot = (slot + 1) & mask;}
+        this->_slots[slot].index = index;
+        this->_items[index] = moved;
+    }
+    this->_items.pop_back();
+
+    if (this->_garbage > MIN_CAPACITY && this->_garbage * 2 > this->_ids.size()) {
+        this->_compact();
+    }
+    return true;
+}
+
+/**
+ * Find an item
+ *
+ * @param id the identifier of the variable
+ *
+ * @return the item, or nullptr if the id is not registered
+*/
+RecipeItem* RecipeRegistry::find(std::string_view id) {
+    return this->find(id, format::hash_id(id.data(), id.length()));
+}
+
+/**
+ * Find an item by a precomputed id hash
+ *
+ * @param id the identifier of the variable
+ * @param hash the id hash, see "format::hash_id"
+ *
+ * @return the item, or nullptr if the id is not registered
+*/
+RecipeItem* RecipeRegistry::find(std::string_view id, uint64_t hash) {
+    if (this->_items.empty()) {return nullptr;}
+    uint32_t index = this->_slots[this->_probe(id, hash)].index;
+    return index == EMPTY ? nullptr : &this->_items[index];
+}
+
+/**
+ * Find an item by its id hash alone
+ * Used where only the hash of an id is stored, see the recipe journal.
+ *
+ * @param hash the id hash, see "format::hash_id"
+ *
+ * @return the item, or nullptr if no id or more than one id has this hash
+*/
+RecipeItem* RecipeRegistry::find_hash(uint64_t hash) {
+    if (this->_items.empty()) {return nullptr;}
+    size_t mask = this->_slots.size() - 1;
+    uint32_t tag = tag_of(hash);
+    RecipeItem *found = nullptr;
+    for (size_t position = hash & mask; this->_slots[position].index != EMPTY; position = (position + 1) & mask) {
+        const Slot &slot = this->_slots[position];
+        if (slot.tag != tag || this->_items[slot.index].hash != hash) {continue;}
+        if (found != nullptr) {return nullptr;}
+        found = &this->_items[slot.index];
+    }
+    return found;
+}
+
+/**
+ * Preallocate storage
+ *
+ * @param count number of items
+ * @param id_bytes total number of id characters
+*/
+void RecipeRegistry::reserve(size_t count, size_t id_bytes) {
+    this->_items.reserve(count);
+    this->_ids.reserve(id_bytes);
+    size_t capacity = this->_slots.empty() ? MIN_CAPACITY : this->_slots.size();
+    while (count * 2 > capacity) {capacity *= 2;}
+    if (capacity > this->_slots.size()) {this->_rehash(capacity);}
+}
+
+/**
+ * Remove all items
+*/
+void RecipeRegistry::clear() {
+    this->_items.clear();
+    this->_ids.clear();
+    this->_streams.clear();
+    for (Slot &slot: this->_slots) {slot.index = EMPTY;}
+    this->_garbage = 0;
+}
+
+/**
+ * Get the id of an item
+ *
+ * @param item an item of this registry
+ *
+ * @return view of the id, valid until the registry is modified
+*/
+std::string_view RecipeRegistry::id(const RecipeItem &item) const {
+    return std::string_view(this->_ids.data() + item.id_offset, item.id_length);
+}
+
+/**
+ * Get the callbacks of a streamed item
+ *
+ * @param item an item of this registry
+ *
+ * @return the callbacks, or nullptr if the item is not streamed
+*/
+const RecipeStream* RecipeRegistry::stream(const RecipeItem &item) const {
+    return item.stream == 0 ? nullptr : &this->_streams[item.stream - 1];
+}
+
+/**
+ * Get the number of streamed items
+ *
+ * @return the number of streamed items
+*/
+size_t RecipeRegistry::stream_count() const {
+    return this->_streams.size();
+}
+
+/**
+ * Get the number of items
+ *
+ * @return the number of items
+*/
+size_t RecipeRegistry::size() const {
+    return this->_items.size();
+}
+
+/**
+ * Check if the registry is empty
+ *
+ * @return true if there are no items
+*/
+bool RecipeRegistry::empty() const {
+    return this->_items.empty();
+}
+
+/**
+ * Get the memory resource of the registry storage
+ *
+ * @return the memory resource
+*/
+std::pmr::memory_resource* RecipeRegistry::resource() const {
+    return this->_items.get_allocator().resource();
+}
+
+/**
+ * Iterate items in registration order, with removed items replaced by the last item
+*/
+RecipeItem* RecipeRegistry::begin() {
+    return this->_items.data();
+}
+
+RecipeItem* RecipeRegistry::end() {
+    return this->_items.data() + this->_items.size();
+}
+
+const RecipeItem* RecipeRegistry::begin() const {
+    return this->_items.data();
+}
+
+const RecipeItem* RecipeRegistry::end() const {
+    return this->_items.data() + this->_items.size();
+}
+
+/**
+ * Find the slot holding an id, or the empty slot where it would be inserted
+ *
+ * @param id the identifier
+ * @param hash the id hash
+ *
+ * @return the slot position
+*/
+size_t RecipeRegistry::_probe(std::string_view id, uint64_t hash) const {
+    size_t mask = this->_slots.size() - 1;
+    uint32_t tag = tag_of(hash);
+    size_t position = hash & mask;
+    while (true) {
+        const Slot &slot = this->_slots[position];
+        if (slot.index == EMPTY) {return position;}
+        if (slot.tag == tag) {
+            const RecipeItem &item = this->_items[slot.index];
+            if (item.id_length == id.length() && std::memcmp(this->_ids.data() + item.id_offset, id.data(), id.length()) == 0) {
+                return position;
+            }
+        }
+        position = (position + 1) & mask;
+    }
+}
+
+/**
+ * Rebuild the index with a new capacity
+ *
+ * @param capacity the new number of slots, a power of two
+*/
+void RecipeRegistry::_rehash(size_t capacity) {
+    this->_slots.assign(capacity, Slot{EMPTY, 0});
+    size_t mask = capacity - 1;
+    for (uint32_t i = 0; i < this->_items.size(); i++) {
+        size_t position = this->_items[i].hash & mask;
+        while (this->_slots[position].index != EMPTY) {position = (position + 1) & mask;}
+        this->_slots[position] = {i, tag_of(this->_items[i].hash)};
+    }
+}
+
+/**
+ * Drop the ids of removed items from the string arena
+*/
+void RecipeRegistry::_compact() {
+    std::pmr::vector<char> ids(this->resource());
+    ids.reserve(this->_ids.size() - this->_garbage);
+    for (RecipeItem &item: this->_items) {
+        uint32_t offset = static_cast<uint32_t>(ids.size());
+        ids.insert(ids.end(), this->_ids.begin() + item.id_offset, this->_ids.begin() + item.id_offset + item.id_length);
+        item.id_offset = offset;
+    }
+    this->_ids.swap(ids);
+    this->_garbage = 0;
+}
+
+}
@@ -0,0 +1,377 @@
+#include "recipe_source.hpp"
+
+#include <cstring>
+
+#ifdef RCP_HAVE_CURL
+#include <cstdlib>
+#include <curl/curl.h>
+#endif
+
+namespace rcp {
+
+namespace {
+
+#ifdef RCP_HAVE_CURL
+
+// Requests of one "read" in flight at a time, curl queues them on at most "connections" connections
+constexpr size_t MAX_IN_FLIGHT = 64;
+// Attempts per range, object stores answer an occasional request with a transient error
+constexpr int MAX_ATTEMPTS = 3;
+
+// One range request
+struct Transfer {
+    CURL *easy = nullptr;
+    ReadRange range = {0, 0, nullptr};
+    uint64_t received = 0;
+    int attempts = 0;
+    bool overflow = false;
+    std::string range_header;
+    uint64_t total = 0;
+};
+
+// curl_global_init is not thread safe, run it once before the first handle is created
+void global_init() {
+    static const CURLcode result = curl_global_init(CURL_GLOBAL_DEFAULT);
+    (void)result;
+}
+
+size_t write_body(char *data, size_t, size_t size, void *user) {
+    Transfer &transfer = *static_cast<Transfer*>(user);
+    if (size > transfer.range.size - transfer.received) {
+        transfer.overflow = true;
+        return 0;
+    }
+    std::memcpy(transfer.range.destination + transfer.received, data, size);
+    transfer.received += size;
+    return size;
+}
+
+// Pick the file size out of "Content-Range: bytes 0-0/1234"
+size_t read_header(char *data, size_t, size_t size, void *user) {
+    Transfer &transfer = *static_cast<Transfer*>(user);
+    constexpr char NAME[] = "content-range:";
+    constexpr size_t LENGTH = sizeof(NAME) - 1;
+    if (size > LENGTH) {
+        bool matches = true;
+        for (size_t i = 0; i < LENGTH && matches; i++) {
+            char c = data[i];
+            if (c >= 'A' && c <= 'Z') {c = static_cast<char>(c - 'A' + 'a');}
+            matches = c == NAME[i];
+        }
+        const char *slash = matches ? static_cast<const char*>(std::memchr(data, '/', size)) : nullptr;
+        if (slash != nullptr && slash + 1 < data + size && slash[1] >= '0' && slash[1] <= '9') {
+            transfer.total = std::strtoull(slash + 1, nullptr, 10);
+        }
+    }
+    return size;
+}
+
+#endif
+
+}
+
+/**
+ * Construct a source reading a local file
+ *
+ * @param path the recipe file
+*/
+FileSource::FileSource(std::string path) {
+    this->_path = std::move(path);
+}
+
+/**
+ * Get the size of the recipe file
+ *
+ * @param size receives the size in number of bytes
+ *
+ * @return false if the file could not be opened
+*/
+bool FileSource::size(uint64_t &size) {
+    return this->_open() && this->_file.size(size);
+}
+
+/**
+ * Read byte ranges of the recipe file, one positioned read per range
+ *
+ * @param ranges the ranges
+ * @param count number of ranges
+ *
+ * @return true if every range was read completely
+*/
+bool FileSource::read(const ReadRange *ranges, size_t count) {
+    if (!this->_open()) {return false;}
+    for (size_t i = 0; i < count; i++) {
+        if (!this->_file.read_at(ranges[i].offset, ranges[i].destination, static_cast<size_t>(ranges[i].size))) {return false;}
+    }
+    return true;
+}
+
+/**
+ * Open the file on first use, the descriptor is kept for later loads
+ *
+ * @return true if the file is open
+*/
+bool FileSource::_open() {
+    return this->_file.is_open() || this->_file.open_read(this->_path);
+}
+
+/**
+ * Construct a source mapping a local file
+ *
+ * @param path the recipe file
+*/
+MappedSource::MappedSource(std::string path) {
+    this->_path = std::move(path);
+}
+
+/**
+ * Map the recipe file and get its size.
+ * Every call maps the file again, so a load sees the current file.
+ *
+ * @param size receives the size in number of bytes
+ *
+ * @return false if the file could not be mapped
+*/
+bool MappedSource::size(uint64_t &size) {
+    if (!this->_map.open(this->_path)) {return false;}
+    size = this->_map.size();
+    return true;
+}
+
+/**
+ * Copy byte ranges out of the mapping, see "size"
+ *
+ * @param ranges the ranges
+ * @param count number of ranges
+ *
+ * @return true if every range lies inside the mapping
+*/
+bool MappedSource::read(const ReadRange *ranges, size_t count) {
+    if (!this->_map.is_open()) {return false;}
+    for (size_t i = 0; i < count; i++) {
+        if (ranges[i].offset > this->_map.size() || ranges[i].size > this->_map.size() - ranges[i].offset) {return false;}
+        if (ranges[i].size > 0) {std::memcpy(ranges[i].destination, this->_map.data() + ranges[i].offset, ranges[i].size);}
+    }
+    return true;
+}
+
+/**
+ * Get the mapping made by the last "size" call
+ *
+ * @return the mapped file, nullptr if it is not mapped
+*/
+const char* MappedSource::data() {
+    return this->_map.is_open() ? this->_map.data() : nullptr;
+}
+
+/**
+ * Construct a source reading a recipe file over HTTP
+ *
+ * @param url the URL of the recipe file, the server must support range requests
+ * @param connections the maximum number of parallel connections to the server
+*/
+HttpSource::HttpSource(std::string url, unsigned connections) {
+    this->_url = std::move(url);
+    this->_connections = connections > 0 ? connections : 1;
+    this->_timeout = 30000;
+    this->_gap = 256 << 10;
+    this->_multi = nullptr;
+#ifdef RCP_HAVE_CURL
+    global_init();
+    CURLM *multi = curl_multi_init();
+    if (multi != nullptr) {
+        curl_multi_setopt(multi, CURLMOPT_PIPELINING, static_cast<long>(CURLPIPE_MULTIPLEX));
+        curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, static_cast<long>(this->_connections));
+    }
+    this->_multi = multi;
+#endif
+}
+
+/**
+ * Destruct the source
+ * Closes the connections kept open between reads
+*/
+HttpSource::~HttpSource() {
+#ifdef RCP_HAVE_CURL
+    if (this->_multi != nullptr) {curl_multi_cleanup(static_cast<CURLM*>(this->_multi));}
+#endif
+}
+
+/**
+ * Add a header to every request, for instance "Authorization: Bearer ..."
+ *
+ * @param header the header line without line break
+*/
+void HttpSource::add_header(std::string header) {
+    this->_headers.push_back(std::move(header));
+}
+
+/**
+ * Set the timeout of a single request (default: 30 s)
+ *
+ * @param milliseconds the timeout, 0 waits forever
+*/
+void HttpSource::set_timeout(long milliseconds) {
+    this->_timeout = milliseconds;
+}
+
+/**
+ * Set the largest gap between two ranges the Recipe reads over to save a request (default: 256 KiB)
+ *
+ * @param gap the gap in number of bytes
+*/
+void HttpSource::set_gap(uint64_t gap) {
+    this->_gap = gap;
+}
+
+/**
+ * Get the size of the recipe file through a request for its first byte.
+ * A GET for one byte works with URLs presigned for GET, where a HEAD request would be rejected.
+ *
+ * @param size receives the size in number of bytes, from the Content-Range of the response
+ *
+ * @return false if the request failed or the server does not support range requests
+*/
+bool HttpSource::size(uint64_t &size) {
+    char byte;
+    ReadRange range = {0, 1, &byte};
+    uint64_t total = 0;
+    if (!this->_perform(&range, 1, &total) || total == 0) {return false;}
+    size = total;
+    return true;
+}
+
+/**
+ * Read byte ranges of the recipe file, one range request per range, in parallel
+ *
+ * @param ranges the ranges
+ * @param count number of ranges
+ *
+ * @return true if every range was read completely
+*/
+bool HttpSource::read(const ReadRange *ranges, size_t count) {
+    return this->_perform(ranges, count, nullptr);
+}
+
+/**
+ * Get the largest gap between two ranges worth reading over, see "set_gap"
+ *
+ * @return the gap in number of bytes
+*/
+uint64_t HttpSource::gap() const {
+    return this->_gap;
+}
+
+/**
+ * Run range requests on the multi handle until all finished
+ *
+ * @param ranges the ranges, empty ranges are skipped
+ * @param count number of ranges
+ * @param total receives the file size from the Content-Range of the first range, optional
+ *
+ * @return true if every range was read completely
+*/
+bool HttpSource::_perform(const ReadRange *ranges, size_t count, uint64_t *total) {
+#ifdef RCP_HAVE_CURL
+    CURLM *multi = static_cast<CURLM*>(this->_multi);
+    if (multi == nullptr) {return false;}
+
+    curl_slist *headers = nullptr;
+    for (const std::string &header: this->_headers) {
+        curl_slist *appended = curl_slist_append(headers, header.c_str());
+        if (appended == nullptr) {
+            curl_slist_free_all(headers);
+            return false;
+        }
+        headers = appended;
+    }
+
+    std::vector<Transfer> transfers;
+    transfers.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        if (ranges[i].size == 0) {continue;}
+        Transfer transfer;
+        transfer.range = ranges[i];
+        transfer.range_header = std::to_string(ranges[i].offset) + "-" + std::to_string(ranges[i].offset + ranges[i].size - 1);
+        transfers.push_back(std::move(transfer));
+    }
+
+    auto start = [&](Transfer &transfer) {
+        if (transfer.easy == nullptr) {
+            transfer.easy = curl_easy_init();
+            if (transfer.easy == nullptr) {return false;}
+        } else {
+            curl_easy_reset(transfer.easy);
+        }
+        CURL *easy = transfer.easy;
+        transfer.received = 0;
+        transfer.overflow = false;
+        transfer.attempts++;
+        curl_easy_setopt(easy, CURLOPT_URL, this->_url.c_str());
+        curl_easy_setopt(easy, CURLOPT_RANGE, transfer.range_header.c_str());
+        curl_easy_setopt(easy, CURLOPT_HTTPHEADER, headers);
+        curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, write_body);
+        curl_easy_setopt(easy, CURLOPT_WRITEDATA, &transfer);
+        if (total != nullptr) {
+            curl_easy_setopt(easy, CURLOPT_HEADERFUNCTION, read_header);
+            curl_easy_setopt(easy, CURLOPT_HEADERDATA, &transfer);
+        }
+        curl_easy_setopt(easy, CURLOPT_PRIVATE, &transfer);
+        curl_easy_setopt(easy, CURLOPT_FOLLOWLOCATION, 1L);
+        curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+        curl_easy_setopt(easy, CURLOPT_PIPEWAIT, 1L);
+        curl_easy_setopt(easy, CURLOPT_TIMEOUT_MS, this->_timeout);
+        return curl_multi_add_handle(multi, easy) == CURLM_OK;
+    };
+
+    bool success = true;
+    size_t next = 0;
+    size_t running = 0;
+    while (success && (next < transfers.size() || running > 0)) {
+        while (success && next < transfers.size() && running < MAX_IN_FLIGHT) {
+            success = start(transfers[next]);
+            next++;
+            running++;
+        }
+        int active = 0;
+        if (curl_multi_perform(multi, &active) != CURLM_OK) {success = false;}
+
+        int queued = 0;
+        while (CURLMsg *message = curl_multi_info_read(multi, &queued)) {
+            if (message->msg != CURLMSG_DONE) {continue;}
+            Transfer *transfer = nullptr;
+            curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, reinterpret_cast<char**>(&transfer));
+            long status = 0;
+            curl_easy_getinfo(message->easy_handle, CURLINFO_RESPONSE_CODE, &status);
+            curl_multi_remove_handle(multi, message->easy_handle);
+            running--;
+            bool complete = message->data.result == CURLE_OK && status == 206 && transfer->received == transfer->range.size;
+            if (complete) {continue;}
+            // Retry transient failures, a wrong status or an oversized body will not go away
+            bool transient = !transfer->overflow && (message->data.result != CURLE_OK || status == 429 || status >= 500);
+            if (transient && transfer->attempts < MAX_ATTEMPTS && start(*transfer)) {
+                running++;
+            } else {
+                success = false;
+            }
+        }
+        if (success && running > 0 && curl_multi_poll(multi, nullptr, 0, 1000, nullptr) != CURLM_OK) {success = false;}
+    }
+
+    if (success && total != nullptr && !transfers.empty()) {*total = transfers.front().total;}
+    for (Transfer &transfer: transfers) {
+        if (transfer.easy == nullptr) {continue;}
+        curl_multi_remove_handle(multi, transfer.easy);
+        curl_easy_cleanup(transfer.easy);
+    }
+    curl_slist_free_all(headers);
+    return success;
+#else
+    (void)ranges;
+    (void)count;
+    (void)total;
+    return false;
+#endif
+}
+
+}
@@ -0,0 +1,414 @@
+#include "recipe_stats.hpp"
+#include "stats_probe.hpp"
+
+#include <sstream>
+#include <vector>
+
+namespace rcp {
+
+namespace {
+
+constexpr RecipeOperation OPERATIONS[] = {
+    RecipeOperation::Load,
+    RecipeOperation::LoadVariable,
+    RecipeOperation::Reload,
+    RecipeOperation::Save,
+    RecipeOperation::SaveAsync,
+    RecipeOperation::Journal
+};
+
+constexpr RecipePhase PHASES[] = {RecipePhase::Open, RecipePhase::Parse, RecipePhase::Copy, RecipePhase::Flush};
+
+// Escape a Prometheus label value
+std::string label_value(std::string_view value) {
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (char c: value) {
+        if (c == '\\' || c == '"') {
+            escaped += '\\';
+            escaped += c;
+        } else if (c == '\n') {
+            escaped += "\\n";
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+#ifdef RCP_STATS
+thread_local StatsScope *current_scope = nullptr;
+#endif
+
+}
+
+/**
+ * Get the time spent in one phase
+ *
+ * @param phase the phase
+ *
+ * @return the duration of the phase
+*/
+std::chrono::nanoseconds RecipeStats::duration(RecipePhase phase) const {
+    return this->durations[static_cast<size_t>(phase)];
+}
+
+/**
+ * Get the label of an operation
+ *
+ * @param operation the operation
+ *
+ * @return the lower case operation name, for instance "load_variable"
+*/
+const char* operation_name(RecipeOperation operation) {
+    switch (operation) {
+        case RecipeOperation::Load: return "load";
+        case RecipeOperation::LoadVariable: return "load_variable";
+        case RecipeOperation::Reload: return "reload";
+        case RecipeOperation::Save: return "save";
+        case RecipeOperation::SaveAsync: return "save_async";
+        case RecipeOperation::Journal: return "journal";
+    }
+    return "unknown";
+}
+
+/**
+ * Get the label of a phase
+ *
+ * @param phase the phase
+ *
+ * @return the lower case phase name, for instance "parse"
+*/
+const char* phase_name(RecipePhase phase) {
+    switch (phase) {
+        case RecipePhase::Open: return "open";
+        case RecipePhase::Parse: return "parse";
+        case RecipePhase::Copy: return "copy";
+        case RecipePhase::Flush: return "flush";
+    }
+    return "unknown";
+}
+
+/**
+ * Construct empty metrics
+*/
+RecipeMetrics::RecipeMetrics() {}
+
+/**
+ * Construct zero sums of every operation
+*/
+RecipeMetrics::Totals::Totals() {
+    for (size_t i = 0; i < OPERATION_COUNT; i++) {this->stats[i].operation = OPERATIONS[i];}
+}
+
+/**
+ * Add the sums of another recipe
+ *
+ * @param other the sums to add
+*/
+void RecipeMetrics::Totals::add(const Totals &other) {
+    for (size_t i = 0; i < OPERATION_COUNT; i++) {
+        RecipeStats &totals = this->stats[i];
+        const RecipeStats &stats = other.stats[i];
+        totals.bytes_read += stats.bytes_read;
+        totals.bytes_written += stats.bytes_written;
+        totals.entries += stats.entries;
+        totals.skipped_unknown += stats.skipped_unknown;
+        totals.skipped_mismatch += stats.skipped_mismatch;
+        totals.allocations += stats.allocations;
+        for (size_t j = 0; j < RECIPE_PHASE_COUNT; j++) {totals.durations[j] += stats.durations[j];}
+        totals.total += stats.total;
+        this->counts[i] += other.counts[i];
+        this->failures[i] += other.failures[i];
+    }
+}
+
+/**
+ * Add the statistics of one operation to the sums of its recipe
+ *
+ * @param recipe the name of the recipe
+ * @param stats the statistics of the operation
+*/
+void RecipeMetrics::record(std::string_view recipe, const RecipeStats &stats) {
+    size_t operation = static_cast<size_t>(stats.operation);
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    auto found = this->_recipes.find(recipe);
+    if (found == this->_recipes.end()) {found = this->_recipes.emplace(std::string(recipe), Totals()).first;}
+    Totals &sums = found->second;
+    RecipeStats &totals = sums.stats[operation];
+    totals.bytes_read += stats.bytes_read;
+    totals.bytes_written += stats.bytes_written;
+    totals.entries += stats.entries;
+    totals.skipped_unknown += stats.skipped_unknown;
+    totals.skipped_mismatch += stats.skipped_mismatch;
+    totals.allocations += stats.allocations;
+    for (size_t i = 0; i < RECIPE_PHASE_COUNT; i++) {totals.durations[i] += stats.durations[i];}
+    totals.total += stats.total;
+    sums.counts[operation] += 1;
+    if (!stats.success) {sums.failures[operation] += 1;}
+}
+
+/**
+ * List the observed recipes
+ *
+ * @return the names of the recipes with at least one recorded operation, sorted
+*/
+std::vector<std::string> RecipeMetrics::recipes() const {
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    std::vector<std::string> names;
+    names.reserve(this->_recipes.size());
+    for (const auto &[name, totals]: this->_recipes) {names.push_back(name);}
+    return names;
+}
+
+/**
+ * Sum the statistics of one recipe or of all recipes
+ *
+ * @param recipe the name of the recipe, ignored if "all"
+ * @param all sum every recipe
+ *
+ * @return the sums, zero for a recipe without recorded operations
+*/
+RecipeMetrics::Totals RecipeMetrics::_sum(std::string_view recipe, bool all) const {
+    Totals sums;
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    if (all) {
+        for (const auto &[name, totals]: this->_recipes) {sums.add(totals);}
+    } else {
+        auto found = this->_recipes.find(recipe);
+        if (found != this->_recipes.end()) {sums.add(found->second);}
+    }
+    return sums;
+}
+
+/**
+ * Get the summed statistics of an operation over all recipes
+ *
+ * @param operation the operation
+ *
+ * @return the sums of all recorded operations, "success" is true if none failed
+*/
+RecipeStats RecipeMetrics::get_totals(RecipeOperation operation) const {
+    Totals sums = this->_sum("", true);
+    RecipeStats totals = sums.stats[static_cast<size_t>(operation)];
+    totals.success = sums.failures[static_cast<size_t>(operation)] == 0;
+    return totals;
+}
+
+/**
+ * Get the summed statistics of an operation of one recipe
+ *
+ * @param recipe the name of the recipe
+ * @param operation the operation
+ *
+ * @return the sums of the recorded operations of the recipe, "success" is true if none failed
+*/
+RecipeStats RecipeMetrics::get_totals(std::string_view recipe, RecipeOperation operation) const {
+    Totals sums = this->_sum(recipe, false);
+    RecipeStats totals = sums.stats[static_cast<size_t>(operation)];
+    totals.success = sums.failures[static_cast<size_t>(operation)] == 0;
+    return totals;
+}
+
+/**
+ * Get the number of recorded operations over all recipes
+ *
+ * @param operation the operation
+ *
+ * @return the number of recorded operations
+*/
+uint64_t RecipeMetrics::get_count(RecipeOperation operation) const {
+    return this->_sum("", true).counts[static_cast<size_t>(operation)];
+}
+
+/**
+ * Get the number of recorded operations of one recipe
+ *
+ * @param recipe the name of the recipe
+ * @param operation the operation
+ *
+ * @return the number of recorded operations of the recipe
+*/
+uint64_t RecipeMetrics::get_count(std::string_view recipe, RecipeOperation operation) const {
+    return this->_sum(recipe, false).counts[static_cast<size_t>(operation)];
+}
+
+/**
+ * Get the number of failed operations over all recipes
+ *
+ * @param operation the operation
+ *
+ * @return the number of recorded operations that failed
+*/
+uint64_t RecipeMetrics::get_failures(RecipeOperation operation) const {
+    return this->_sum("", true).failures[static_cast<size_t>(operation)];
+}
+
+/**
+ * Get the number of failed operations of one recipe
+ *
+ * @param recipe the name of the recipe
+ * @param operation the operation
+ *
+ * @return the number of recorded operations of the recipe that failed
+*/
+uint64_t RecipeMetrics::get_failures(std::string_view recipe, RecipeOperation operation) const {
+    return this->_sum(recipe, false).failures[static_cast<size_t>(operation)];
+}
+
+/**
+ * Clear all sums and forget the observed recipes
+*/
+void RecipeMetrics::reset() {
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    this->_recipes.clear();
+}
+
+/**
+ * Pass every summed value to an exporter, for instance to update OpenTelemetry counters.
+ * Values are passed in a fixed order: per recipe, sorted by name, and per operation
+ * the counts, byte and entry counters and the phase durations in seconds.
+ *
+ * @param exporter receives the values
+*/
+void RecipeMetrics::export_metrics(const Exporter &exporter) const {
+    std::map<std::string, Totals, std::less<>> recipes;
+    {
+        std::lock_guard<std::mutex> lock(this->_mutex);
+        recipes = this->_recipes;
+    }
+
+    for (const auto &[recipe, sums]: recipes) {
+        for (size_t i = 0; i < OPERATION_COUNT; i++) {
+            std::string_view operation = operation_name(OPERATIONS[i]);
+            const RecipeStats &stats = sums.stats[i];
+            exporter("operations", recipe, operation, "", static_cast<double>(sums.counts[i]));
+            exporter("failures", recipe, operation, "", static_cast<double>(sums.failures[i]));
+            exporter("bytes_read", recipe, operation, "", static_cast<double>(stats.bytes_read));
+            exporter("bytes_written", recipe, operation, "", static_cast<double>(stats.bytes_written));
+            exporter("entries", recipe, operation, "", static_cast<double>(stats.entries));
+            exporter("skipped_unknown", recipe, operation, "", static_cast<double>(stats.skipped_unknown));
+            exporter("skipped_mismatch", recipe, operation, "", static_cast<double>(stats.skipped_mismatch));
+            exporter("allocations", recipe, operation, "", static_cast<double>(stats.allocations));
+            for (RecipePhase phase: PHASES) {
+                exporter("duration_seconds", recipe, operation, phase_name(phase),
+                         std::chrono::duration<double>(stats.duration(phase)).count());
+            }
+            exporter("duration_seconds", recipe, operation, "total", std::chrono::duration<double>(stats.total).count());
+        }
+    }
+}
+
+/**
+ * Format the summed values in the Prometheus text exposition format.
+ * Every value is a counter named "<prefix>_<name>_total" with a "recipe" and an "operation" label,
+ * durations carry a "phase" label as well.
+ *
+ * @param prefix the metric name prefix
+ *
+ * @return the metrics text, ready to be served on a /metrics endpoint
+*/
+std::string RecipeMetrics::prometheus(std::string_view prefix) const {
+    // Samples of one metric must be adjacent, collect them per metric in first seen order
+    std::vector<std::string> names;
+    std::map<std::string, std::ostringstream> samples;
+    this->export_metrics([&](std::string_view name, std::string_view recipe, std::string_view operation,
+                             std::string_view phase, double value) {
+        std::string metric = std::string(prefix) + "_" + std::string(name) + "_total";
+        auto sample = samples.find(metric);
+        if (sample == samples.end()) {
+            names.push_back(metric);
+            sample = samples.emplace(metric, std::ostringstream()).first;
+        }
+        sample->second << metric << "{recipe=\"" << label_value(recipe) << "\",operation=\"" << operation << "\"";
+        if (!phase.empty()) {sample->second << ",phase=\"" << phase << "\"";}
+        sample->second << "} " << value << "\n";
+    });
+
+    std::string text;
+    for (const std::string &name: names) {
+        text += "# TYPE " + name + " counter\n";
+        text += samples[name].str();
+    }
+    return text;
+}
+
+#ifdef RCP_STATS
+
+/**
+ * Start collecting the statistics of one operation on the current thread.
+ * Does nothing without observer.
+ *
+ * @param observer receives the statistics when the scope is destroyed, may be nullptr
+ * @param recipe the name of the recipe, must outlive the scope
+ * @param operation the operation
+*/
+StatsScope::StatsScope(RecipeObserver *observer, std::string_view recipe, RecipeOperation operation) {
+    this->_observer = observer;
+    this->_recipe = recipe;
+    this->_stats.operation = operation;
+    this->_previous = current_scope;
+    this->_phase = RecipePhase::Open;
+    if (observer == nullptr) {return;}
+    this->_start = std::chrono::steady_clock::now();
+    this->_phase_start = this->_start;
+    current_scope = this;
+}
+
+/**
+ * Report the statistics to the observer
+*/
+StatsScope::~StatsScope() {
+    if (this->_observer == nullptr) {return;}
+    auto now = std::chrono::steady_clock::now();
+    this->_stats.durations[static_cast<size_t>(this->_phase)] += now - this->_phase_start;
+    this->_stats.total = now - this->_start;
+    current_scope = this->_previous;
+    this->_observer->record(this->_recipe, this->_stats);
+}
+
+/**
+ * Set the result of the operation
+ *
+ * @param success true if the operation succeeded
+ *
+ * @return "success"
+*/
+bool StatsScope::finish(bool success) {
+    this->_stats.success = success;
+    return success;
+}
+
+/**
+ * Get the innermost scope of the current thread
+ *
+ * @return the scope, nullptr if no operation with an observer runs on this thread
+*/
+StatsScope* StatsScope::current() {
+    return current_scope;
+}
+
+/**
+ * Get the statistics collected so far
+ *
+ * @return the statistics
+*/
+RecipeStats& StatsScope::stats() {
+    return this->_stats;
+}
+
+/**
+ * End the current phase and start another, the time until the next phase change is added to "phase".
+ *
+ * @param phase the phase starting now
+*/
+void StatsScope::phase(RecipePhase phase) {
+    auto now = std::chrono::steady_clock::now();
+    this->_stats.durations[static_cast<size_t>(this->_phase)] += now - this->_phase_start;
+    this->_phase = phase;
+    this->_phase_start = now;
+}
+
+#endif
+
+}
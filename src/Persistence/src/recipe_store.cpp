@@ -0,0 +1,372 @@
+#include "recipe_store.hpp"
+#include "checksum.hpp"
+#include "file_io.hpp"
+#include "mapped_file.hpp"
+#include "recipe_format.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+
+namespace rcp {
+
+namespace {
+
+// Check the index of a store (everything in front of the images) against the trailer checksum
+bool verify_store(const format::StoreHeader &header, const char *data) {
+    format::Trailer trailer;
+    if (!format::decode_trailer(data + header.file_size - format::TRAILER_SIZE, trailer)) {return false;}
+    return crc32c(0, data, header.data_offset) == trailer.index_checksum;
+}
+
+// Binary search the directory of a store for a recipe name
+bool find_entry(const char *index, const format::StoreHeader &header, std::string_view name,
+                format::StoreEntry &entry, uint64_t &position) {
+    const char *names = index + header.names_offset;
+    uint64_t low = 0;
+    uint64_t high = header.recipe_count;
+    while (low < high) {
+        uint64_t middle = low + (high - low) / 2;
+        format::decode_store_entry(index + header.directory_offset + middle * format::STORE_ENTRY_SIZE, entry);
+        if (!format::validate_store_entry(entry, header)) {return false;}
+        int order = std::string_view(names + entry.name_offset, entry.name_length).compare(name);
+        if (order == 0) {
+            position = middle;
+            return true;
+        }
+        if (order < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return false;
+}
+
+// Write the trailer of a store index
+bool write_trailer(File &file, const std::vector<char> &index, uint64_t file_size) {
+    format::Trailer trailer;
+    char trailer_buffer[format::TRAILER_SIZE];
+    trailer.index_checksum = crc32c(0, index.data(), index.size());
+    format::encode_trailer(trailer, trailer_buffer);
+    return file.write_at(file_size - format::TRAILER_SIZE, trailer_buffer, sizeof(trailer_buffer));
+}
+
+}
+
+/**
+ * Construct a RecipeStore
+ * The path is blank and must be set by the "set_path" method before the store can be initialized
+*/
+RecipeStore::RecipeStore() {
+    this->_path = "";
+    this->_init = false;
+    this->_save_mode = SaveMode::Direct;
+    this->_file_size = 0;
+}
+
+/**
+ * Construct a RecipeStore
+ *
+ * @param path the store file path
+*/
+RecipeStore::RecipeStore(std::string path) {
+    this->_path = path;
+    this->_init = false;
+    this->_save_mode = SaveMode::Direct;
+    this->_file_size = 0;
+}
+
+/**
+ * Initialize the store.
+ * Creates the store file and its directory if they do not exist.
+ *
+ * @return true if the initialization was successfull.
+*/
+bool RecipeStore::init() {
+    if (this->_path == "") {return false;}
+    if (std::filesystem::exists(this->_path)) {
+        this->_init = true;
+        return true;
+    }
+    try {
+        std::filesystem::path path(this->_path);
+        if (path.has_parent_path()) {std::filesystem::create_directories(path.parent_path());}
+        std::ofstream file(path);
+        file.close();
+        this->_init = true;
+    }
+    catch(const std::filesystem::filesystem_error& err) {
+        this->_init = false;
+    }
+    return this->_init;
+}
+
+/**
+ * Reset the initialized flag.
+ * Will block the load and save methods until "init" is called again.
+*/
+void RecipeStore::stop() {
+    this->_init = false;
+    this->_forget();
+}
+
+/**
+ * Adds a recipe to the store, identified by its current name.
+ * The recipe must outlive its membership in the store.
+ *
+ * @param recipe the recipe
+ *
+ * @return true if the recipe was added, false if it has no name or the name is already added
+*/
+bool RecipeStore::add_recipe(Recipe &recipe) {
+    std::string name = recipe.get_name();
+    if (name == "") {return false;}
+    return this->_recipes.emplace(name, &recipe).second;
+}
+
+/**
+ * Removes a recipe from the store.
+ * This will NOT modify the store file before a call to "save_recipes".
+ *
+ * @param name the name the recipe was added with
+ *
+ * @return true if the recipe was removed
+*/
+bool RecipeStore::remove_recipe(std::string name) {
+    return this->_recipes.erase(name) > 0;
+}
+
+/**
+ * Load every added recipe from the store file.
+ * The store file is opened and mapped once, each recipe is loaded from its image as by LoadMode::Mapped.
+ * Recipes missing from the store are not modified, recipes in the store that were not added are skipped.
+ *
+ * @return true if all recipes found in the store were loaded
+*/
+bool RecipeStore::load_recipes() {
+    if (!this->_init) {return false;}
+
+    MappedFile map;
+    if (!map.open(this->_path)) {return false;}
+    if (map.size() == 0) {
+        // Created by "init", nothing saved yet
+        this->_forget();
+        return true;
+    }
+    const char *data = map.data();
+    format::StoreHeader header;
+    if (!format::decode_store_header(data, map.size(), header)) {return false;}
+    if (!format::validate_store_header(header, map.size())) {return false;}
+    if (!verify_store(header, data)) {return false;}
+    this->_index.assign(data, data + header.data_offset);
+    this->_file_size = header.file_size;
+
+    bool success = true;
+    const char *names = data + header.names_offset;
+    format::StoreEntry entry;
+    for (uint64_t i = 0; i < header.recipe_count; i++) {
+        format::decode_store_entry(data + header.directory_offset + i * format::STORE_ENTRY_SIZE, entry);
+        if (!format::validate_store_entry(entry, header)) {return false;}
+        auto recipe = this->_recipes.find(std::string(names + entry.name_offset, entry.name_length));
+        if (recipe == this->_recipes.end()) {continue;}
+        success = recipe->second->_load_image(data + entry.offset, entry.size) && success;
+    }
+    return success;
+}
+
+/**
+ * Load a single recipe from the store file.
+ *
+ * @param name the name the recipe was added with
+ *
+ * @return true if the recipe was found in the store and loaded
+*/
+bool RecipeStore::load_recipe(std::string name) {
+    if (!this->_init) {return false;}
+    auto recipe = this->_recipes.find(name);
+    if (recipe == this->_recipes.end()) {return false;}
+
+    MappedFile map;
+    if (!map.open(this->_path)) {return false;}
+    const char *data = map.data();
+    format::StoreHeader header;
+    if (!format::decode_store_header(data, map.size(), header)) {return false;}
+    if (!format::validate_store_header(header, map.size())) {return false;}
+    if (!verify_store(header, data)) {return false;}
+    this->_index.assign(data, data + header.data_offset);
+    this->_file_size = header.file_size;
+
+    format::StoreEntry entry;
+    uint64_t position;
+    if (!find_entry(data, header, name, entry, position)) {return false;}
+    return recipe->second->_load_image(data + entry.offset, entry.size);
+}
+
+/**
+ * Save every added recipe to the store file.
+ * This will overwrite the store, recipes that are no longer added are dropped.
+ * The recipes are written back to back through one open file.
+ * With SaveMode::Atomic the store is written to a temporary file which then replaces the store file.
+ *
+ * @return true if the store was successfully saved.
+*/
+bool RecipeStore::save_recipes() {
+    if (!this->_init) {return false;}
+    this->_forget();
+
+    bool atomic = this->_save_mode == SaveMode::Atomic;
+    std::string path = atomic ? this->_path + ".tmp" : this->_path;
+    File file;
+    if (!file.open(path, true, true)) {return false;}
+
+    format::StoreHeader header;
+    header.version = format::STORE_VERSION;
+    header.flags = 0;
+    header.recipe_count = this->_recipes.size();
+    header.directory_offset = format::STORE_HEADER_SIZE;
+    header.names_offset = header.directory_offset + header.recipe_count * format::STORE_ENTRY_SIZE;
+    header.names_size = 0;
+    for (const auto &recipe: this->_recipes) {header.names_size += recipe.first.length();}
+    header.data_offset = format::align_up(header.names_offset + header.names_size);
+
+    // Write images and build header, directory and name table
+    std::vector<char> index(header.data_offset, 0);
+    char *names = index.data() + header.names_offset;
+    uint64_t offset = header.data_offset;
+    uint64_t name_offset = 0;
+    uint64_t i = 0;
+    bool success = true;
+    for (const auto &recipe: this->_recipes) {
+        format::StoreEntry entry;
+        if (!recipe.second->_write_image(file, offset, UINT64_MAX, entry.size) || entry.size == 0) {
+            success = false;
+            break;
+        }
+        entry.offset = offset;
+        entry.capacity = format::align_up(entry.size);
+        entry.name_offset = static_cast<uint32_t>(name_offset);
+        entry.name_length = static_cast<uint32_t>(recipe.first.length());
+        format::encode_store_entry(entry, index.data() + header.directory_offset + i * format::STORE_ENTRY_SIZE);
+        std::memcpy(names + name_offset, recipe.first.data(), entry.name_length);
+        name_offset += entry.name_length;
+        offset += entry.capacity;
+        i++;
+    }
+    header.file_size = offset + format::TRAILER_SIZE;
+    format::encode_store_header(header, index.data());
+    success = success && write_trailer(file, index, header.file_size) && file.write_at(0, index.data(), index.size());
+    file.close();
+
+    if (atomic && (!success || !rename_file(path, this->_path))) {
+        std::error_code error;
+        std::filesystem::remove(path, error);
+        return false;
+    }
+    if (!success) {return false;}
+    this->_index = std::move(index);
+    this->_file_size = header.file_size;
+    return true;
+}
+
+/**
+ * Save a single recipe to the store file.
+ * The recipe image is rewritten in place, followed by its directory entry and the trailer.
+ * Not crash-safe: an interrupted save leaves an image failing its checksums.
+ * The whole store is rewritten instead (see "save_recipes") with SaveMode::Atomic,
+ * if the recipe is not in the store yet, if the recipe might not fit its slot
+ * or if the store file changed since it was last loaded or saved.
+ *
+ * @param name the name the recipe was added with
+ *
+ * @return true if the recipe was successfully saved.
+*/
+bool RecipeStore::save_recipe(std::string name) {
+    if (!this->_init) {return false;}
+    auto recipe = this->_recipes.find(name);
+    if (recipe == this->_recipes.end()) {return false;}
+
+    format::StoreHeader header;
+    format::StoreEntry entry;
+    uint64_t position;
+    if (this->_save_mode == SaveMode::Atomic || this->_index.empty() ||
+        !format::decode_store_header(this->_index.data(), this->_index.size(), header) ||
+        !find_entry(this->_index.data(), header, name, entry, position)) {
+        return this->save_recipes();
+    }
+
+    uint64_t image_size = 0;
+    {
+        File file;
+        uint64_t size;
+        if (file.open(this->_path) && file.size(size) && size == this->_file_size) {
+            if (!recipe->second->_write_image(file, entry.offset, entry.capacity, image_size)) {return false;}
+            if (image_size > 0) {
+                entry.size = image_size;
+                uint64_t entry_offset = header.directory_offset + position * format::STORE_ENTRY_SIZE;
+                format::encode_store_entry(entry, this->_index.data() + entry_offset);
+                if (!file.write_at(entry_offset, this->_index.data() + entry_offset, format::STORE_ENTRY_SIZE)) {return false;}
+                return write_trailer(file, this->_index, this->_file_size);
+            }
+        }
+    }
+    return this->save_recipes();
+}
+
+/**
+ * Check if the store is initialized
+ *
+ * @return true if the store is initialized
+*/
+bool RecipeStore::is_init() {
+    return this->_init;
+}
+
+/**
+ * Check the current store path
+ *
+ * @return the current store path
+*/
+std::string RecipeStore::get_path() {
+    return this->_path;
+}
+
+/**
+ * Set the store file path
+ * This will call the "stop" method and the store must be reinitialized.
+ *
+ * @param path the new store path
+*/
+void RecipeStore::set_path(std::string path) {
+    this->stop();
+    this->_path = path;
+}
+
+/**
+ * Check how the store file is replaced
+ *
+ * @return the current save mode
+*/
+SaveMode RecipeStore::get_save_mode() {
+    return this->_save_mode;
+}
+
+/**
+ * Set how "save_recipes" replaces the store file (see SaveMode)
+ *
+ * @param save_mode the new save mode
+*/
+void RecipeStore::set_save_mode(SaveMode save_mode) {
+    this->_save_mode = save_mode;
+}
+
+/**
+ * Drop the index of the last loaded or saved store file
+*/
+void RecipeStore::_forget() {
+    std::vector<char>().swap(this->_index);
+    this->_file_size = 0;
+}
+
+}
@@ -0,0 +1,414 @@
+#include "recipe_writer.hpp"
+#include "checksum.hpp"
+#include "compression.hpp"
+#include "file_io.hpp"
+#include "recipe_format.hpp"
+#include "seqlock.hpp"
+#include "stats_probe.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+namespace rcp {
+
+namespace {
+
+/**
+ * Write a streamed value.
+ *
+ * @param writer the destination
+ * @param stream the callbacks of the streamed variable
+ * @param size receives the number of bytes written
+ * @param checksum receives the checksum of the bytes written
+ *
+ * @return true if the value was written.
+*/
+bool write_stream(BufferedWriter &writer, const RecipeStream &stream, uint64_t &size, uint32_t &checksum) {
+    size = 0;
+    checksum = 0;
+    StreamSink sink = [&](const char *data, size_t length) {
+        size += length;
+        checksum = crc32c(checksum, data, length);
+        return writer.write(data, length);
+    };
+    return stream.writer(sink);
+}
+
+/**
+ * Write the registry in the sequential v1 format.
+ * Lengths are written as fixed size little-endian fields (see recipe_format.hpp), ids longer than V1_MAX_ID_LENGTH are rejected.
+ *
+ * @param file the destination file, empty
+ * @param registry the variables to write
+ *
+ * @return true if the recipe was successfully written.
+*/
+bool write_v1(File &file, RecipeRegistry &registry) {
+    BufferedWriter writer(file, 0);
+    char padding = 0;
+    char length[format::V1_LENGTH_SIZE];
+    for (RecipeItem &item: registry) {
+        std::string_view id = registry.id(item);
+        uint64_t id_size = id.length();
+        if (id_size > format::V1_MAX_ID_LENGTH) {return false;}
+        format::encode_v1_length(id_size, length);
+        writer.write(length, sizeof(length));
+        writer.write(id.data(), id_size);
+
+        uint64_t size = item.size;
+        const RecipeStream *stream = registry.stream(item);
+        if (stream == nullptr) {
+            format::encode_v1_length(size, length);
+            writer.write(length, sizeof(length));
+            writer.write(item.ptr, size);
+        } else {
+            // The size precedes the value, patch it once the value is written
+            uint64_t size_offset = writer.offset();
+            uint32_t checksum;
+            writer.write(length, sizeof(length));
+            if (!write_stream(writer, *stream, size, checksum) || !writer.flush()) {return false;}
+            format::encode_v1_length(size, length);
+            if (!file.write_at(size_offset, length, sizeof(length))) {return false;}
+        }
+        uint64_t num_bytes = id_size + size;
+        if (num_bytes % 2 != 0) {writer.write(&padding, 1);}
+        stats_entry();
+    }
+    stats_phase(RecipePhase::Flush);
+    return writer.flush();
+}
+
+/**
+ * Write the registry in the indexed v2 format.
+ * Entries are sorted by id hash so "load_variable" can binary search the table of contents.
+ * Data blocks are written first and the index last, so a partially written file never has a valid header.
+ * The data block offset and TOC position of every entry is stored in its RecipeItem.
+ * Entries are compressed if that makes them smaller, streamed entries are stored raw.
+ *
+ * Offsets inside the file are relative to "base", so the file may be embedded in a larger file.
+ *
+ * @param file the destination file, empty from "base" on
+ * @param base file offset of the first byte written
+ * @param registry the variables to write
+ * @param target the codec and compression threshold
+ * @param index receives the header, TOC and string table written to the file
+ *
+ * @return true if the recipe was successfully written.
+*/
+bool write_v2(File &file, uint64_t base, RecipeRegistry &registry, const SaveTarget &target, std::pmr::vector<char> &index) {
+    struct Pending {
+        uint64_t hash;
+        std::string_view id;
+        RecipeItem *item;
+    };
+
+    // Order entries by (hash, id)
+    std::pmr::vector<Pending> order(target.resource);
+    order.reserve(registry.size());
+    stats_allocation();
+    uint64_t strings_size = 0;
+    for (RecipeItem &item: registry) {
+        std::string_view id = registry.id(item);
+        if (id.length() > UINT16_MAX) {return false;}
+        order.push_back({item.hash, id, &item});
+        strings_size += id.length();
+    }
+    std::sort(order.begin(), order.end(), [](const Pending &a, const Pending &b) {
+        return a.hash != b.hash ? a.hash < b.hash : a.id < b.id;
+    });
+
+    format::Header header;
+    header.version = format::VERSION;
+    header.flags = format::HEADER_HAS_TRAILER;
+    header.entry_count = order.size();
+    header.toc_offset = format::HEADER_SIZE;
+    header.strings_offset = header.toc_offset + order.size() * format::TOC_ENTRY_SIZE;
+    header.strings_size = strings_size;
+    header.data_offset = format::align_up(header.strings_offset + strings_size);
+
+    // Write data blocks and build header, TOC and string table
+    if (index.capacity() < header.data_offset) {stats_allocation();}
+    index.assign(header.data_offset, 0);
+    char *strings = index.data() + header.strings_offset;
+    uint64_t id_offset = 0;
+    std::pmr::vector<char> compressed(target.resource);
+    BufferedWriter writer(file, base + header.data_offset, 1 << 20, target.resource);
+    for (size_t i = 0; i < order.size(); i++) {
+        RecipeItem *item = order[i].item;
+        format::TocEntry entry;
+        entry.hash = order[i].hash;
+        entry.type = item->type;
+        entry.offset = writer.offset() - base;
+        entry.id_offset = static_cast<uint32_t>(id_offset);
+        entry.id_length = static_cast<uint16_t>(order[i].id.length());
+        entry.codec = format::CODEC_RAW;
+        entry.flags = format::ENTRY_HAS_CHECKSUM;
+        const RecipeStream *stream = registry.stream(*item);
+        if (stream == nullptr) {
+            const char *stored = item->ptr;
+            entry.size = item->size;
+            entry.stored_size = item->size;
+
+            Codec codec = item->codec < 0 ? target.codec : static_cast<Codec>(item->codec);
+            if (codec != Codec::None && item->size >= target.compression_threshold && item->size > 1) {
+                if (compressed.size() < item->size) {
+                    compressed.resize(item->size);
+                    stats_allocation();
+                }
+                size_t size = compress(codec, item->ptr, item->size, compressed.data(), item->size - 1, target.resource);
+                if (size > 0) {
+                    stored = compressed.data();
+                    entry.stored_size = size;
+                    entry.codec = static_cast<uint8_t>(codec);
+                }
+            }
+
+            entry.checksum = crc32c(0, stored, entry.stored_size);
+            if (!writer.write(stored, entry.stored_size)) {return false;}
+        } else {
+            if (!write_stream(writer, *stream, entry.size, entry.checksum)) {return false;}
+            entry.stored_size = entry.size;
+        }
+        if (!writer.pad(format::align_up(entry.stored_size) - entry.stored_size)) {return false;}
+
+        format::encode_entry(entry, index.data() + header.toc_offset + i * format::TOC_ENTRY_SIZE);
+        std::memcpy(strings + id_offset, order[i].id.data(), entry.id_length);
+        id_offset += entry.id_length;
+
+        item->offset = entry.offset;
+        item->toc_index = i;
+        stats_entry();
+    }
+    stats_phase(RecipePhase::Flush);
+    header.file_size = writer.offset() - base + format::TRAILER_SIZE;
+    format::encode_header(header, index.data());
+
+    format::Trailer trailer;
+    char trailer_buffer[format::TRAILER_SIZE];
+    trailer.index_checksum = crc32c(0, index.data(), index.size());
+    format::encode_trailer(trailer, trailer_buffer);
+    if (!writer.write(trailer_buffer, sizeof(trailer_buffer)) || !writer.flush()) {return false;}
+    return file.write_at(base, index.data(), index.size());
+}
+
+}
+
+/**
+ * Write a complete recipe file.
+ * With SaveMode::Atomic the file is written next to the target path and renamed over it.
+ *
+ * @param registry the variables to write
+ * @param target the destination path, format, save mode and whether to sync
+ * @param index receives the header, TOC and string table of a v2 file
+ *
+ * @return true if the recipe was successfully written.
+*/
+bool write_recipe(RecipeRegistry &registry, const SaveTarget &target, std::pmr::vector<char> &index) {
+    TRC_SPAN("recipe", "write_recipe");
+    bool atomic = target.mode == SaveMode::Atomic;
+    std::pmr::string path(target.path, target.resource);
+    if (atomic) {path += ".tmp";}
+
+    File file;
+    if (!file.open(path.c_str(), true, true)) {return false;}
+    stats_phase(RecipePhase::Copy);
+    bool success = target.format == FileFormat::V1 ? write_v1(file, registry) : write_v2(file, 0, registry, target, index);
+    if (success && target.sync) {success = file.sync();}
+    file.close();
+
+    if (atomic) {
+        if (!success || !rename_file(path.c_str(), target.path.c_str())) {
+            std::error_code error;
+            std::filesystem::remove(path, error);
+            return false;
+        }
+        if (target.sync) {sync_directory(std::filesystem::path(target.path).parent_path().string());}
+    }
+    return success;
+}
+
+/**
+ * Write the registry as a v2 recipe file embedded in a larger file.
+ * Used by the RecipeStore class.
+ *
+ * @param file the destination file
+ * @param offset file offset of the embedded recipe file
+ * @param registry the variables to write
+ * @param target the codec and compression threshold, the path and save mode are ignored
+ * @param index receives the header, TOC and string table of the embedded file
+ *
+ * @return true if the recipe was successfully written.
+*/
+bool write_image(File &file, uint64_t offset, RecipeRegistry &registry, const SaveTarget &target, std::pmr::vector<char> &index) {
+    return write_v2(file, offset, registry, target, index);
+}
+
+/**
+ * Get the largest size "write_image" may produce for a registry, streamed values are unbounded.
+ * Compression never grows an entry.
+ *
+ * @param registry the variables to write
+ *
+ * @return the largest embedded file size, UINT64_MAX if the registry has streamed variables
+*/
+uint64_t image_bound(const RecipeRegistry &registry) {
+    uint64_t strings_size = 0;
+    uint64_t data_size = 0;
+    for (const RecipeItem &item: registry) {
+        if (registry.stream(item) != nullptr) {return UINT64_MAX;}
+        strings_size += registry.id(item).length();
+        data_size += format::align_up(item.size);
+    }
+    uint64_t data_offset = format::align_up(format::HEADER_SIZE + registry.size() * format::TOC_ENTRY_SIZE + strings_size);
+    return data_offset + data_size + format::TRAILER_SIZE;
+}
+
+/**
+ * Copy variable values into a private registry.
+ * Staged items point into the data buffer, streamed values are collected into it by calling their writer
+ * and staged as plain items.
+ * Variables with a SeqLock are copied consistently while other threads keep writing them.
+ *
+ * @param registry the variables to copy
+ * @param staged receives the copied variables
+ * @param data receives the copied values
+ *
+ * @return true if all values were copied, false if a stream writer failed
+*/
+bool stage_values(const RecipeRegistry &registry, RecipeRegistry &staged, std::pmr::vector<char> &data) {
+    staged = registry;
+    size_t size = 0;
+    for (const RecipeItem &item: registry) {size += item.size;}
+    data.clear();
+    if (data.capacity() < size) {stats_allocation();}
+    data.reserve(size);
+
+    bool valid = true;
+    std::pmr::vector<size_t> offsets(staged.resource());
+    offsets.reserve(registry.size());
+    for (RecipeItem &item: staged) {
+        offsets.push_back(data.size());
+        const RecipeStream *stream = registry.stream(item);
+        if (stream == nullptr) {
+            if (item.lock == nullptr) {
+                data.insert(data.end(), item.ptr, item.ptr + item.size);
+            } else {
+                data.resize(data.size() + item.size);
+                item.lock->read(data.data() + offsets.back(), item.ptr, item.size);
+            }
+            item.lock = nullptr;
+            continue;
+        }
+        StreamSink sink = [&data](const char *value, size_t length) {
+            data.insert(data.end(), value, value + length);
+            return true;
+        };
+        valid = valid && stream->writer(sink);
+        item.size = data.size() - offsets.back();
+        item.stream = 0;
+    }
+    for (size_t i = 0; i < offsets.size(); i++) {
+        RecipeItem &item = *(staged.begin() + i);
+        item.ptr = data.data() + offsets[i];
+    }
+    return valid;
+}
+
+/**
+ * Construct an idle writer
+ * The writer thread is started by the first "submit"
+ *
+ * @param written called with the index of every V2 file written, optional
+*/
+AsyncWriter::AsyncWriter(WrittenCallback written) {
+    this->_pending = nullptr;
+    this->_active = nullptr;
+    this->_stop = false;
+    this->_written = std::move(written);
+}
+
+/**
+ * Destruct the writer
+ * Finishes all pending writes and stops the writer thread
+*/
+AsyncWriter::~AsyncWriter() {
+    {
+        std::lock_guard<std::mutex> lock(this->_mutex);
+        this->_stop = true;
+    }
+    this->_condition.notify_all();
+    if (this->_thread.joinable()) {this->_thread.join();}
+}
+
+/**
+ * Snapshot the registered variables and queue them for writing.
+ * Only the copy into the staging area happens on the calling thread.
+ *
+ * @param registry the variables to write
+ * @param target the destination path, format, save mode and whether to sync
+ *
+ * @return the result of the write that will include this snapshot
+*/
+std::shared_future<bool> AsyncWriter::submit(const RecipeRegistry &registry, const SaveTarget &target) {
+    std::unique_lock<std::mutex> lock(this->_mutex);
+    if (!this->_thread.joinable()) {
+        this->_thread = std::thread(&AsyncWriter::_run, this);
+    }
+
+    Staging *staging = this->_pending;
+    bool sync = target.sync;
+    if (staging == nullptr) {
+        // Use the staging area that is not being written
+        staging = (this->_active == &this->_buffers[0]) ? &this->_buffers[1] : &this->_buffers[0];
+        staging->promise = std::promise<bool>();
+        staging->future = staging->promise.get_future().share();
+        this->_pending = staging;
+    } else {
+        // Coalesce with the waiting snapshot
+        sync = sync || staging->target.sync;
+    }
+
+    staging->valid = stage_values(registry, staging->registry, staging->data);
+    staging->target = target;
+    staging->target.sync = sync;
+
+    std::shared_future<bool> future = staging->future;
+    lock.unlock();
+    this->_condition.notify_all();
+    return future;
+}
+
+/**
+ * Block until all submitted snapshots are written
+*/
+void AsyncWriter::wait() {
+    std::unique_lock<std::mutex> lock(this->_mutex);
+    this->_condition.wait(lock, [this]() {return this->_pending == nullptr && this->_active == nullptr;});
+}
+
+/**
+ * Writer thread
+*/
+void AsyncWriter::_run() {
+    std::unique_lock<std::mutex> lock(this->_mutex);
+    while (true) {
+        this->_condition.wait(lock, [this]() {return this->_stop || this->_pending != nullptr;});
+        if (this->_pending == nullptr) {return;}
+
+        this->_active = this->_pending;
+        this->_pending = nullptr;
+        lock.unlock();
+
+        bool success = this->_active->valid && write_recipe(this->_active->registry, this->_active->target, this->_index);
+        if (success && this->_written && this->_active->target.format == FileFormat::V2) {this->_written(this->_index);}
+        this->_active->promise.set_value(success);
+
+        lock.lock();
+        this->_active = nullptr;
+        this->_condition.notify_all();
+    }
+}
+
+}
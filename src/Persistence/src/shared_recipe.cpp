@@ -0,0 +1,353 @@
+#include "shared_recipe.hpp"
+#include "recipe_format.hpp"
+
+#include <atomic>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace rcp {
+
+namespace {
+
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t) && std::atomic<uint64_t>::is_always_lock_free,
+              "Shared segment counters must be lock-free in every process");
+
+// "begin", "generation" and the image sizes are shared with other processes, always access them atomically
+std::atomic<uint64_t>& counter(const char *data, size_t offset) {
+    return *reinterpret_cast<std::atomic<uint64_t>*>(const_cast<char*>(data) + offset);
+}
+
+uint64_t read_u64(const char *data, size_t offset) {
+    uint64_t value;
+    std::memcpy(&value, data + offset, sizeof(value));
+    return value;
+}
+
+bool valid_segment(const char *data, size_t size) {
+    if (size < format::SHARED_HEADER_SIZE) {return false;}
+    if (std::memcmp(data, format::SHARED_MAGIC, sizeof(format::SHARED_MAGIC)) != 0) {return false;}
+    uint32_t version;
+    std::memcpy(&version, data + sizeof(format::SHARED_MAGIC), sizeof(version));
+    if (version != format::SHARED_VERSION) {return false;}
+    uint64_t capacity = read_u64(data, format::SHARED_CAPACITY_OFFSET);
+    return capacity <= (size - format::SHARED_HEADER_SIZE) / format::SHARED_SLOT_COUNT;
+}
+
+}
+
+/**
+ * Construct a detached shared recipe without name
+*/
+SharedRecipe::SharedRecipe() {
+    this->_name = "";
+    this->_data = nullptr;
+    this->_size = 0;
+    this->_publisher = false;
+}
+
+/**
+ * Construct a detached shared recipe
+ *
+ * @param name the name of the shared memory segment, starting with '/'
+*/
+SharedRecipe::SharedRecipe(std::string name) {
+    this->_name = name;
+    this->_data = nullptr;
+    this->_size = 0;
+    this->_publisher = false;
+}
+
+/**
+ * Destruct the shared recipe
+ * Unmaps the segment, the segment itself is kept (see "remove")
+*/
+SharedRecipe::~SharedRecipe() {
+    this->detach();
+}
+
+/**
+ * Create the segment, or open it if it exists, and map it for publishing.
+ * An existing segment with the same capacity keeps its published image and generation,
+ * so readers stay attached across a restart of the publisher.
+ * Any other existing segment is reset, readers must attach again.
+ *
+ * @param capacity the space for one image in number of bytes, at least the size of a V2 file of the recipe
+ *
+ * @return true if the segment was mapped for publishing
+*/
+bool SharedRecipe::create(uint64_t capacity) {
+    this->detach();
+    capacity = format::align_up(capacity);
+    uint64_t size = format::SHARED_HEADER_SIZE + format::SHARED_SLOT_COUNT * capacity;
+
+    if (!this->_file.open_shared(this->_name, true)) {return false;}
+    uint64_t existing = 0;
+    if (!this->_file.size(existing) || (existing != size && !this->_file.resize(size))) {
+        this->_file.close();
+        return false;
+    }
+    void *addr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, this->_file.descriptor(), 0);
+    if (addr == MAP_FAILED) {
+        this->_file.close();
+        return false;
+    }
+    this->_data = static_cast<char*>(addr);
+    this->_size = size;
+    this->_publisher = true;
+
+    if (existing == size && valid_segment(this->_data, this->_size) && read_u64(this->_data, format::SHARED_CAPACITY_OFFSET) == capacity) {
+        return true;
+    }
+    std::memset(this->_data, 0, format::SHARED_HEADER_SIZE);
+    std::memcpy(this->_data, format::SHARED_MAGIC, sizeof(format::SHARED_MAGIC));
+    std::memcpy(this->_data + sizeof(format::SHARED_MAGIC), &format::SHARED_VERSION, sizeof(format::SHARED_VERSION));
+    std::memcpy(this->_data + format::SHARED_CAPACITY_OFFSET, &capacity, sizeof(capacity));
+    return true;
+}
+
+/**
+ * Map an existing segment for reading
+ *
+ * @return true if the segment was mapped
+*/
+bool SharedRecipe::attach() {
+    this->detach();
+    int fd = ::shm_open(this->_name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {return false;}
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || static_cast<uint64_t>(st.st_size) < format::SHARED_HEADER_SIZE) {
+        ::close(fd);
+        return false;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    void *addr = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping keeps its own reference to the segment
+    ::close(fd);
+    if (addr == MAP_FAILED) {return false;}
+
+    if (!valid_segment(static_cast<const char*>(addr), size)) {
+        ::munmap(addr, size);
+        return false;
+    }
+    this->_data = static_cast<char*>(addr);
+    this->_size = size;
+    return true;
+}
+
+/**
+ * Unmap the segment
+*/
+void SharedRecipe::detach() {
+    if (this->_data != nullptr) {::munmap(this->_data, this->_size);}
+    this->_file.close();
+    this->_data = nullptr;
+    this->_size = 0;
+    this->_publisher = false;
+}
+
+/**
+ * Remove the segment name, attached processes keep their mapping
+ *
+ * @return true if the segment was removed
+*/
+bool SharedRecipe::remove() {
+    return ::shm_unlink(this->_name.c_str()) == 0;
+}
+
+/**
+ * Copy the recipe into the segment as the next generation.
+ * The image is written to the slot not holding the published image, then published by incrementing the generation.
+ * Only available after "create".
+ *
+ * @param recipe the recipe, with the values to publish in its variables
+ *
+ * @return true if the image was published, false if writing failed or the image might not fit the capacity
+*/
+bool SharedRecipe::publish(Recipe &recipe) {
+    if (!this->_publisher) {return false;}
+    uint64_t capacity = this->get_capacity();
+    uint64_t next = counter(this->_data, format::SHARED_GENERATION_OFFSET).load(std::memory_order_relaxed) + 1;
+    uint64_t slot = next % format::SHARED_SLOT_COUNT;
+
+    // Views of generation next - 2 live in the slot about to be written
+    counter(this->_data, format::SHARED_BEGIN_OFFSET).store(next, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    uint64_t size = 0;
+    uint64_t offset = format::SHARED_HEADER_SIZE + slot * capacity;
+    if (!recipe._write_image(this->_file, offset, capacity, size) || size == 0) {return false;}
+
+    counter(this->_data, format::SHARED_SIZE_OFFSET + slot * sizeof(uint64_t)).store(size, std::memory_order_relaxed);
+    counter(this->_data, format::SHARED_GENERATION_OFFSET).store(next, std::memory_order_release);
+    return true;
+}
+
+/**
+ * Get the generation of the published image.
+ * A single atomic load, cheap enough to poll.
+ *
+ * @return the generation, 0 if nothing was published or the segment is not mapped
+*/
+uint64_t SharedRecipe::generation() const {
+    if (this->_data == nullptr) {return 0;}
+    return counter(this->_data, format::SHARED_GENERATION_OFFSET).load(std::memory_order_acquire);
+}
+
+/**
+ * Look a value up in the published image
+ *
+ * @param id the identifier of the value
+ *
+ * @return a view of the stored value, with a null data pointer if the id is not published or its entry is compressed
+*/
+SharedView SharedRecipe::find(std::string_view id) const {
+    while (true) {
+        uint64_t generation = this->generation();
+        if (generation == 0) {return SharedView();}
+        SharedView view = this->_find(generation, id);
+        // The table of contents may have been overwritten while it was searched
+        view.generation = generation;
+        if (this->valid(view)) {return view.data != nullptr ? view : SharedView();}
+    }
+}
+
+/**
+ * Check if a view is still intact
+ *
+ * @param view a view returned by "find"
+ *
+ * @return false once the slot of the view is being overwritten
+*/
+bool SharedRecipe::valid(const SharedView &view) const {
+    if (this->_data == nullptr || view.generation == 0) {return false;}
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return this->_begin() < view.generation + format::SHARED_SLOT_COUNT;
+}
+
+/**
+ * Copy every published value into the variables of a recipe, consistent with one generation.
+ * Retries with the next generation if the image was overwritten during the copy.
+ *
+ * @param recipe the recipe
+ *
+ * @return true if the values were written to the application variables
+*/
+bool SharedRecipe::load(Recipe &recipe) const {
+    while (true) {
+        uint64_t generation = this->generation();
+        if (generation == 0) {return false;}
+        uint64_t slot = generation % format::SHARED_SLOT_COUNT;
+        uint64_t size = counter(this->_data, format::SHARED_SIZE_OFFSET + slot * sizeof(uint64_t)).load(std::memory_order_relaxed);
+        uint64_t capacity = this->get_capacity();
+        if (size > capacity) {size = capacity;}
+        const char *image = this->_data + format::SHARED_HEADER_SIZE + slot * capacity;
+        bool success = recipe._load_image(image, size);
+        SharedView view;
+        view.generation = generation;
+        if (this->valid(view)) {return success;}
+    }
+}
+
+/**
+ * Check if the segment is mapped
+ *
+ * @return true after "create" or "attach" succeeded
+*/
+bool SharedRecipe::is_attached() const {
+    return this->_data != nullptr;
+}
+
+/**
+ * Check if the segment is mapped for publishing
+ *
+ * @return true after "create" succeeded
+*/
+bool SharedRecipe::is_publisher() const {
+    return this->_publisher;
+}
+
+/**
+ * Get the space for one image
+ *
+ * @return the capacity of a slot in number of bytes, 0 if the segment is not mapped
+*/
+uint64_t SharedRecipe::get_capacity() const {
+    if (this->_data == nullptr) {return 0;}
+    return read_u64(this->_data, format::SHARED_CAPACITY_OFFSET);
+}
+
+/**
+ * Get the name of the segment
+ *
+ * @return the name
+*/
+const std::string& SharedRecipe::get_name() const {
+    return this->_name;
+}
+
+/**
+ * Set the name of the segment, takes effect on the next "create" or "attach"
+ *
+ * @param name the name, starting with '/'
+*/
+void SharedRecipe::set_name(std::string name) {
+    this->_name = name;
+}
+
+/**
+ * Binary search the table of contents of one generation
+ *
+ * @param generation the generation
+ * @param id the identifier of the value
+ *
+ * @return a view of the stored value, with a null data pointer if it was not found
+*/
+SharedView SharedRecipe::_find(uint64_t generation, std::string_view id) const {
+    uint64_t capacity = this->get_capacity();
+    uint64_t slot = generation % format::SHARED_SLOT_COUNT;
+    uint64_t size = counter(this->_data, format::SHARED_SIZE_OFFSET + slot * sizeof(uint64_t)).load(std::memory_order_relaxed);
+    const char *image = this->_data + format::SHARED_HEADER_SIZE + slot * capacity;
+
+    format::Header header;
+    if (size > capacity || !format::decode_header(image, size, header) || !format::validate_header(header, size)) {
+        return SharedView();
+    }
+    const char *strings = image + header.strings_offset;
+    uint64_t hash = format::hash_id(id.data(), id.size());
+    uint64_t low = 0;
+    uint64_t high = header.entry_count;
+    format::TocEntry entry;
+    while (low < high) {
+        uint64_t middle = low + (high - low) / 2;
+        format::decode_entry(image + header.toc_offset + middle * format::TOC_ENTRY_SIZE, entry);
+        if (!format::validate_entry(entry, header)) {return SharedView();}
+        int order = format::compare_entry(hash, id.data(), id.size(), entry, strings);
+        if (order == 0) {
+            if (entry.codec != format::CODEC_RAW) {return SharedView();}
+            SharedView view;
+            view.data = image + entry.offset;
+            view.size = entry.size;
+            view.type = entry.type;
+            return view;
+        } else if (order < 0) {
+            high = middle;
+        } else {
+            low = middle + 1;
+        }
+    }
+    return SharedView();
+}
+
+/**
+ * Get the generation of the image being written
+ *
+ * @return the generation last started by "publish"
+*/
+uint64_t SharedRecipe::_begin() const {
+    return counter(this->_data, format::SHARED_BEGIN_OFFSET).load(std::memory_order_relaxed);
+}
+
+}
@@ -0,0 +1,217 @@
+#include "static_recipe.hpp"
+#include "checksum.hpp"
+#include "compression.hpp"
+#include "file_io.hpp"
+#include "mapped_file.hpp"
+#include "recipe_format.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace rcp {
+namespace detail {
+
+namespace {
+
+// Offset of the checksum field in an encoded TOC entry, see format::encode_entry
+constexpr size_t ENTRY_CHECKSUM_OFFSET = 48;
+
+// Check if a file has exactly the index of a schema, ignoring the entry checksums
+bool same_layout(const StaticView &view, const char *data, size_t size) {
+    if (size != view.file_size) {return false;}
+    uint64_t toc_end = format::HEADER_SIZE + view.count * format::TOC_ENTRY_SIZE;
+    if (std::memcmp(data, view.index, format::HEADER_SIZE) != 0) {return false;}
+    for (uint64_t offset = format::HEADER_SIZE; offset < toc_end; offset += format::TOC_ENTRY_SIZE) {
+        if (std::memcmp(data + offset, view.index + offset, ENTRY_CHECKSUM_OFFSET) != 0) {return false;}
+        uint64_t rest = ENTRY_CHECKSUM_OFFSET + sizeof(uint32_t);
+        if (std::memcmp(data + offset + rest, view.index + offset + rest, format::TOC_ENTRY_SIZE - rest) != 0) {return false;}
+    }
+    return std::memcmp(data + toc_end, view.index + toc_end, view.data_offset - toc_end) == 0;
+}
+
+// Load a file with a different layout entry by entry.
+// Every matching value is checked and decoded into a scratch buffer before the first one is assigned.
+bool load_entries(const StaticView &view, char *values, const char *data, const format::Header &header) {
+    struct Decoded {
+        const SchemaField *field;
+        size_t offset;
+    };
+    std::vector<Decoded> decoded;
+    std::vector<char> scratch;
+
+    const char *strings = data + header.strings_offset;
+    format::TocEntry entry;
+    for (uint64_t i = 0; i < header.entry_count; i++) {
+        format::decode_entry(data + header.toc_offset + i * format::TOC_ENTRY_SIZE, entry);
+        if (!format::validate_entry(entry, header)) {return false;}
+
+        size_t position = view.find(std::string_view(strings + entry.id_offset, entry.id_length), entry.hash);
+        if (position == view.count) {continue;}
+        const SchemaField &field = view.fields[position];
+        if (field.size != entry.size || (field.type != entry.type && entry.type != 0)) {continue;}
+
+        const char *stored = data + entry.offset;
+        if ((entry.flags & format::ENTRY_HAS_CHECKSUM) && crc32c(0, stored, entry.stored_size) != entry.checksum) {return false;}
+        size_t offset = scratch.size();
+        scratch.resize(offset + field.size);
+        if (!decompress(static_cast<Codec>(entry.codec), stored, entry.stored_size, scratch.data() + offset, field.size)) {return false;}
+        decoded.push_back({&field, offset});
+    }
+    for (const Decoded &value: decoded) {
+        std::memcpy(values + value.field->offset, scratch.data() + value.offset, value.field->size);
+    }
+    return true;
+}
+
+}
+
+/**
+ * Load a recipe file into a schema struct.
+ * A file with the layout of the schema is checked and copied at the offsets fixed at compile time,
+ * any other V2 file is loaded entry by entry.
+ *
+ * @param view the layout of the schema
+ * @param values the schema struct
+ * @param path the recipe file
+ *
+ * @return true if the recipe values were written to the schema struct
+*/
+bool load_static(const StaticView &view, char *values, const std::string &path) {
+    MappedFile map;
+    if (!map.open(path)) {return false;}
+    const char *data = map.data();
+    format::Header header;
+    if (!format::decode_header(data, map.size(), header)) {return false;}
+    if (!format::validate_header(header, map.size())) {return false;}
+    if (header.flags & format::HEADER_HAS_TRAILER) {
+        format::Trailer trailer;
+        if (!format::decode_trailer(data + map.size() - format::TRAILER_SIZE, trailer)) {return false;}
+        if (crc32c(0, data, header.data_offset) != trailer.index_checksum) {return false;}
+    }
+    if (!same_layout(view, data, map.size())) {return load_entries(view, values, data, header);}
+
+    // Verify every value before the first one is copied
+    for (size_t i = 0; i < view.count; i++) {
+        const StaticEntry &entry = view.entries[i];
+        format::TocEntry stored;
+        format::decode_entry(data + format::HEADER_SIZE + i * format::TOC_ENTRY_SIZE, stored);
+        if (crc32c(0, data + entry.offset, stored.size) != stored.checksum) {return false;}
+    }
+    for (size_t i = 0; i < view.count; i++) {
+        const StaticEntry &entry = view.entries[i];
+        const SchemaField &field = view.fields[entry.field];
+        std::memcpy(values + field.offset, data + entry.offset, field.size);
+    }
+    return true;
+}
+
+/**
+ * Save a schema struct to a recipe file.
+ * The values are copied into the file image at the offsets fixed at compile time,
+ * the entry checksums and the trailer are filled in and the image is written at once.
+ *
+ * @param view the layout of the schema
+ * @param values the schema struct
+ * @param image the reused file image, allocated by the first save
+ * @param path the recipe file
+ * @param mode with SaveMode::Atomic the image is written next to the recipe file and renamed over it
+ * @param sync flush the file, and after a rename its directory, to the storage device
+ *
+ * @return true if the recipe was successfully saved.
+*/
+bool save_static(const StaticView &view, const char *values, std::vector<char> &image, const std::string &path,
+                 SaveMode mode, bool sync) {
+    if (image.size() != view.file_size) {
+        image.assign(view.file_size, 0);
+        std::memcpy(image.data(), view.index, view.data_offset);
+    }
+
+    format::TocEntry entry;
+    for (size_t i = 0; i < view.count; i++) {
+        const StaticEntry &layout = view.entries[i];
+        const SchemaField &field = view.fields[layout.field];
+        char *entry_buffer = image.data() + format::HEADER_SIZE + i * format::TOC_ENTRY_SIZE;
+        std::memcpy(image.data() + layout.offset, values + field.offset, field.size);
+        format::decode_entry(entry_buffer, entry);
+        entry.checksum = crc32c(0, image.data() + layout.offset, field.size);
+        format::encode_entry(entry, entry_buffer);
+    }
+    format::Trailer trailer;
+    trailer.index_checksum = crc32c(0, image.data(), view.data_offset);
+    format::encode_trailer(trailer, image.data() + view.file_size - format::TRAILER_SIZE);
+
+    bool atomic = mode == SaveMode::Atomic;
+    std::string target = atomic ? path + ".tmp" : path;
+    File file;
+    if (!file.open(target, true, true)) {return false;}
+    bool success = file.write_at(0, image.data(), image.size());
+    if (success && sync) {success = file.sync();}
+    file.close();
+    if (atomic) {
+        if (!success || !rename_file(target, path)) {
+            std::error_code error;
+            std::filesystem::remove(target, error);
+            return false;
+        }
+        if (sync) {sync_directory(std::filesystem::path(path).parent_path().string());}
+    }
+    return success;
+}
+
+/**
+ * Advance a sync policy by one save, see Recipe::set_sync_mode
+ *
+ * @param mode the sync mode
+ * @param parameter number of saves for SyncMode::EveryN, milliseconds for SyncMode::Interval
+ * @param saves saves since the last flush, updated
+ * @param last_sync time of the last flush, updated
+ *
+ * @return true if this save should be synced to the storage device
+*/
+bool static_sync_due(SyncMode mode, uint64_t parameter, uint64_t &saves, std::chrono::steady_clock::time_point &last_sync) {
+    switch (mode) {
+        case SyncMode::EverySave:
+            return true;
+        case SyncMode::EveryN:
+            saves += 1;
+            if (saves < parameter) {return false;}
+            saves = 0;
+            return true;
+        case SyncMode::Interval: {
+            auto now = std::chrono::steady_clock::now();
+            if (now - last_sync < std::chrono::milliseconds(parameter)) {return false;}
+            last_sync = now;
+            return true;
+        }
+        case SyncMode::Never:
+        default:
+            return false;
+    }
+}
+
+/**
+ * Create a recipe file and its directory if they do not exist
+ *
+ * @param path the recipe file
+ *
+ * @return true if the file exists
+*/
+bool create_static(const std::string &path) {
+    if (path == "") {return false;}
+    if (std::filesystem::exists(path)) {return true;}
+    try {
+        std::filesystem::path file_path(path);
+        if (file_path.has_parent_path()) {std::filesystem::create_directories(file_path.parent_path());}
+        std::ofstream file(file_path);
+        file.close();
+    }
+    catch(const std::filesystem::filesystem_error& err) {
+        return false;
+    }
+    return true;
+}
+
+}
+}
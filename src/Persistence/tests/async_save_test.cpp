@@ -0,0 +1,121 @@
+#include <array>
+#include <future>
+
+#include "recipe.hpp"
+#include "test_util.hpp"
+
+// Asynchronous saves: the values are copied when the save is requested, writes are coalesced and ordered with saves
+
+struct Values {
+    int32_t sequence = 0;
+    std::array<uint64_t, 4096> block = {};
+};
+
+void fill(Values &values, int32_t sequence) {
+    values.sequence = sequence;
+    for (size_t i = 0; i < values.block.size(); i++) {values.block[i] = static_cast<uint64_t>(sequence) * 1000003 + i;}
+}
+
+void add_values(rcp::Recipe &recipe, Values &values) {
+    recipe.add_variable("sequence", values.sequence);
+    recipe.add_variable("block", values.block);
+}
+
+// Load the recipe file, the sequence number of the saved values or -1
+int32_t load_sequence(const std::string &folder) {
+    Values loaded;
+    rcp::Recipe recipe("recipe", folder);
+    add_values(recipe, loaded);
+    if (!recipe.init() || !recipe.load_recipe()) {return -1;}
+    Values expected;
+    fill(expected, loaded.sequence);
+    return loaded.block == expected.block ? loaded.sequence : -1;
+}
+
+bool test_snapshot() {
+    for (rcp::FileFormat format: {rcp::FileFormat::V1, rcp::FileFormat::V2}) {
+        std::string folder = test_folder("async_snapshot");
+        Values values;
+        rcp::Recipe recipe("recipe", folder);
+        add_values(recipe, values);
+        recipe.set_file_format(format);
+        CHECK(recipe.init());
+
+        fill(values, 1);
+        std::shared_future<bool> saved = recipe.save_recipe_async();
+        // The application may change its variables right away, the save writes the values of the request
+        fill(values, 2);
+        CHECK(saved.get());
+        CHECK(load_sequence(folder) == 1);
+    }
+    return true;
+}
+
+bool test_coalesced() {
+    std::string folder = test_folder("async_coalesced");
+    Values values;
+    rcp::Recipe recipe("recipe", folder);
+    add_values(recipe, values);
+    recipe.set_save_mode(rcp::SaveMode::Atomic);
+    CHECK(recipe.init());
+
+    // Requests waiting behind a running write replace each other, every future reports success
+    std::vector<std::shared_future<bool>> saves;
+    for (int32_t sequence = 1; sequence <= 50; sequence++) {
+        fill(values, sequence);
+        saves.push_back(recipe.save_recipe_async());
+    }
+    for (std::shared_future<bool> &save: saves) {CHECK(save.get());}
+    CHECK(load_sequence(folder) == 50);
+    return true;
+}
+
+bool test_ordered_with_save() {
+    std::string folder = test_folder("async_ordered");
+    Values values;
+    rcp::Recipe recipe("recipe", folder);
+    add_values(recipe, values);
+    CHECK(recipe.init());
+
+    // A synchronous save waits for pending asynchronous saves, an older snapshot never overwrites it
+    for (int32_t round = 0; round < 20; round++) {
+        fill(values, 2 * round + 1);
+        std::shared_future<bool> saved = recipe.save_recipe_async();
+        fill(values, 2 * round + 2);
+        CHECK(recipe.save_recipe());
+        CHECK(saved.wait_for(std::chrono::seconds(0)) == std::future_status::ready && saved.get());
+        CHECK(load_sequence(folder) == 2 * round + 2);
+    }
+    return true;
+}
+
+bool test_concurrent() {
+    std::string folder = test_folder("async_concurrent");
+    Values values;
+    rcp::Recipe recipe("recipe", folder);
+    recipe.set_concurrency(rcp::Concurrency::Concurrent);
+    add_values(recipe, values);
+    CHECK(recipe.init());
+    fill(values, 3);
+    CHECK(recipe.save_recipe_async().get());
+    CHECK(load_sequence(folder) == 3);
+    return true;
+}
+
+bool test_not_initialized() {
+    Values values;
+    rcp::Recipe recipe("recipe", test_folder("async_not_initialized"));
+    add_values(recipe, values);
+    CHECK(!recipe.save_recipe_async().get());
+    return true;
+}
+
+int main() {
+    return run_tests({
+        {"snapshot", test_snapshot},
+        {"coalesced", test_coalesced},
+        {"ordered_with_save", test_ordered_with_save},
+        {"concurrent", test_concurrent},
+        {"not_initialized", test_not_initialized},
+    });
+}
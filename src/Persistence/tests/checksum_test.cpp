@@ -0,0 +1,93 @@
+#include <cstring>
+#include <random>
+
+#include "checksum.hpp"
+#include "test_util.hpp"
+
+// CRC-32C of the hardware and portable implementations, incremental checksums and combining
+
+std::vector<char> random_bytes(size_t size, unsigned seed) {
+    std::mt19937 generator(seed);
+    std::vector<char> data(size);
+    for (char &byte: data) {byte = static_cast<char>(generator() & 0xFF);}
+    return data;
+}
+
+bool test_known_values() {
+    const char *digits = "123456789";
+    CHECK(rcp::crc32c(0, digits, std::strlen(digits)) == 0xE3069283);
+    CHECK(rcp::crc32c_portable(0, digits, std::strlen(digits)) == 0xE3069283);
+    CHECK(rcp::crc32c(0, nullptr, 0) == 0);
+    std::vector<char> zeros(32, 0);
+    CHECK(rcp::crc32c(0, zeros.data(), zeros.size()) == 0x8A9136AA);
+    return true;
+}
+
+bool test_implementations_agree() {
+    // Sizes around the lane threshold and unaligned starts exercise every kernel path
+    std::vector<char> data = random_bytes(3 * 4096 * 2 + 64, 1);
+    for (size_t size: {0, 1, 7, 8, 9, 63, 4095, 4096, 3 * 4096 - 1, 3 * 4096, 3 * 4096 + 1, 6 * 4096 + 13}) {
+        for (size_t start = 0; start < 8; start++) {
+            CHECK(rcp::crc32c(0, data.data() + start, size) == rcp::crc32c_portable(0, data.data() + start, size));
+        }
+    }
+    CHECK(rcp::crc32c_implementation() != nullptr);
+    return true;
+}
+
+bool test_incremental() {
+    std::vector<char> data = random_bytes(100000, 2);
+    uint32_t whole = rcp::crc32c(0, data.data(), data.size());
+    for (size_t split: {0, 1, 4096, 12289, 99999, 100000}) {
+        uint32_t crc = rcp::crc32c(0, data.data(), split);
+        CHECK(rcp::crc32c(crc, data.data() + split, data.size() - split) == whole);
+    }
+    return true;
+}
+
+bool test_combine() {
+    std::vector<char> data = random_bytes(70000, 3);
+    uint32_t whole = rcp::crc32c(0, data.data(), data.size());
+    for (size_t split: {0, 1, 4096, 65536, 69999, 70000}) {
+        uint32_t first = rcp::crc32c(0, data.data(), split);
+        uint32_t second = rcp::crc32c(0, data.data() + split, data.size() - split);
+        CHECK(rcp::crc32c_combine(first, second, data.size() - split) == whole);
+        rcp::Crc32cCombiner combiner(data.size() - split);
+        CHECK(combiner.size() == data.size() - split);
+        CHECK(combiner.combine(first, second) == whole);
+    }
+
+    // Fixed-size chunks combined in order, as the parallel load does
+    size_t chunk = 4096;
+    rcp::Crc32cCombiner combiner(chunk);
+    uint32_t crc = rcp::crc32c(0, data.data(), chunk);
+    size_t offset = chunk;
+    for (; offset + chunk <= data.size(); offset += chunk) {
+        crc = combiner.combine(crc, rcp::crc32c(0, data.data() + offset, chunk));
+    }
+    crc = rcp::crc32c_combine(crc, rcp::crc32c(0, data.data() + offset, data.size() - offset), data.size() - offset);
+    CHECK(crc == whole);
+    return true;
+}
+
+bool test_detects_changes() {
+    std::vector<char> data = random_bytes(10000, 4);
+    uint32_t crc = rcp::crc32c(0, data.data(), data.size());
+    for (size_t offset: {0, 1, 5000, 9999}) {
+        std::vector<char> changed = data;
+        changed[offset] = static_cast<char>(changed[offset] ^ 0x01);
+        CHECK(rcp::crc32c(0, changed.data(), changed.size()) != crc);
+    }
+    CHECK(rcp::crc32c(0, data.data(), data.size() - 1) != crc);
+    return true;
+}
+
+int main() {
+    return run_tests({
+        {"known_values", test_known_values},
+        {"implementations_agree", test_implementations_agree},
+        {"incremental", test_incremental},
+        {"combine", test_combine},
+        {"detects_changes", test_detects_changes},
+    });
+}
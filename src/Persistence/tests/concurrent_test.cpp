@@ -0,0 +1,178 @@
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+#include "recipe.hpp"
+#include "test_util.hpp"
+
+// Concurrency::Concurrent: saves copy guarded variables consistently while other threads write them,
+// and work on registry snapshots while other threads add and remove variables
+
+// Every word holds the same value, a torn copy mixes two values
+struct Block {
+    std::array<uint64_t, 512> words = {};
+};
+
+bool consistent(const Block &block) {
+    for (uint64_t word: block.words) {
+        if (word != block.words[0]) {return false;}
+    }
+    return true;
+}
+
+Block make_block(uint64_t value) {
+    Block block;
+    block.words.fill(value);
+    return block;
+}
+
+// Load "guarded" and "locked" from a recipe file
+bool load_blocks(const std::string &folder, Block &guarded, Block &locked) {
+    rcp::Recipe recipe("recipe", folder);
+    recipe.add_variable("guarded", guarded);
+    recipe.add_variable("locked", locked);
+    return recipe.init() && recipe.load_recipe();
+}
+
+bool test_seqlock_saves() {
+    for (rcp::FileFormat format: {rcp::FileFormat::V1, rcp::FileFormat::V2}) {
+        std::string folder = test_folder("concurrent_seqlock");
+        rcp::Guarded<Block> guarded;
+        Block locked;
+        rcp::SeqLock lock;
+        rcp::Recipe recipe("recipe", folder);
+        recipe.set_concurrency(rcp::Concurrency::Concurrent);
+        recipe.set_file_format(format);
+        CHECK(recipe.add_variable("guarded", guarded));
+        CHECK(recipe.add_variable("locked", reinterpret_cast<char*>(&locked), sizeof(locked), lock));
+        CHECK(recipe.init());
+
+        // Writers keep updating both blocks while the main thread saves
+        std::atomic<bool> stop(false);
+        std::thread guarded_writer([&]() {
+            for (uint64_t value = 1; !stop.load(); value++) {
+                guarded.store(make_block(value));
+                std::this_thread::sleep_for(std::chrono::microseconds(10));
+            }
+        });
+        std::thread locked_writer([&]() {
+            for (uint64_t value = 1; !stop.load(); value++) {
+                {
+                    rcp::SeqLockGuard guard(&lock);
+                    locked.words.fill(value);
+                }
+                std::this_thread::sleep_for(std::chrono::microseconds(10));
+            }
+        });
+
+        bool success = true;
+        for (int save = 0; save < 20 && success; save++) {
+            Block guarded_loaded;
+            Block locked_loaded;
+            success = recipe.save_recipe() && load_blocks(folder, guarded_loaded, locked_loaded) &&
+                      consistent(guarded_loaded) && consistent(locked_loaded);
+        }
+        stop = true;
+        guarded_writer.join();
+        locked_writer.join();
+        CHECK(success);
+    }
+    return true;
+}
+
+bool test_registry_snapshots() {
+    std::string folder = test_folder("concurrent_registry");
+    int64_t fixed = 99;
+    std::array<int32_t, 64> values = {};
+    for (size_t i = 0; i < values.size(); i++) {values[i] = static_cast<int32_t>(i * 3);}
+    rcp::Recipe recipe("recipe", folder);
+    recipe.set_concurrency(rcp::Concurrency::Concurrent);
+    recipe.set_file_format(rcp::FileFormat::V2);
+    CHECK(recipe.add_variable("fixed", fixed));
+    CHECK(recipe.init());
+
+    // One thread keeps adding and removing variables, saves never block it and always see a whole registry
+    std::atomic<bool> stop(false);
+    std::atomic<bool> registered(true);
+    std::thread registrar([&]() {
+        while (!stop.load()) {
+            for (size_t i = 0; i < values.size(); i++) {
+                registered = recipe.add_variable("value_" + std::to_string(i), values[i]) && registered;
+                std::this_thread::sleep_for(std::chrono::microseconds(10));
+            }
+            for (size_t i = 0; i < values.size(); i++) {
+                registered = recipe.remove_variable("value_" + std::to_string(i)) && registered;
+                std::this_thread::sleep_for(std::chrono::microseconds(10));
+            }
+        }
+    });
+    bool success = true;
+    for (int save = 0; save < 20 && success; save++) {
+        int64_t loaded = 0;
+        rcp::Recipe reader("recipe", folder);
+        reader.add_variable("fixed", loaded);
+        success = recipe.save_recipe() && reader.init() && reader.load_recipe() && loaded == 99;
+    }
+    stop = true;
+    registrar.join();
+    CHECK(success);
+    CHECK(registered);
+
+    // After the registrar stopped every value is removed again, a save writes only "fixed"
+    CHECK(recipe.add_variable("value_7", values[7]));
+    CHECK(recipe.save_recipe());
+    int64_t loaded_fixed = 0;
+    std::array<int32_t, 64> loaded = {};
+    rcp::Recipe reader("recipe", folder);
+    reader.add_variable("fixed", loaded_fixed);
+    for (size_t i = 0; i < loaded.size(); i++) {reader.add_variable("value_" + std::to_string(i), loaded[i]);}
+    CHECK(reader.init() && reader.load_recipe());
+    CHECK(loaded_fixed == 99);
+    for (size_t i = 0; i < loaded.size(); i++) {CHECK(loaded[i] == (i == 7 ? values[7] : 0));}
+    return true;
+}
+
+bool test_load_while_writing() {
+    std::string folder = test_folder("concurrent_load");
+    {
+        Block block = make_block(5);
+        rcp::Recipe recipe("recipe", folder);
+        recipe.add_variable("guarded", block);
+        CHECK(recipe.init() && recipe.save_recipe());
+    }
+
+    // Loads assign guarded variables under their lock, readers never see half a load
+    rcp::Guarded<Block> guarded(make_block(1));
+    rcp::Recipe recipe("recipe", folder);
+    recipe.set_concurrency(rcp::Concurrency::Concurrent);
+    CHECK(recipe.add_variable("guarded", guarded));
+    CHECK(recipe.init());
+    std::atomic<bool> stop(false);
+    std::atomic<bool> torn(false);
+    std::thread reader([&]() {
+        while (!stop.load()) {
+            if (!consistent(guarded.load())) {torn = true;}
+            std::this_thread::sleep_for(std::chrono::microseconds(10));
+        }
+    });
+    bool success = true;
+    for (int load = 0; load < 200 && success; load++) {
+        guarded.store(make_block(1));
+        success = recipe.load_recipe() && guarded.load().words[0] == 5;
+    }
+    stop = true;
+    reader.join();
+    CHECK(success);
+    CHECK(!torn);
+    return true;
+}
+
+int main() {
+    return run_tests({
+        {"seqlock_saves", test_seqlock_saves},
+        {"registry_snapshots", test_registry_snapshots},
+        {"load_while_writing", test_load_while_writing},
+    });
+}
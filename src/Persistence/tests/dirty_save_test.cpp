@@ -0,0 +1,176 @@
+#include <array>
+
+#include "recipe.hpp"
+#include "test_util.hpp"
+
+// Dirty tracked saves: changed variables are rewritten in place, anything else falls back to a full rewrite.
+// An in-place save leaves the bytes of unchanged entries alone, so a byte flipped in an unchanged entry
+// survives it and only a full rewrite repairs it.
+
+struct Values {
+    int32_t speed = 0;
+    std::array<double, 16> gains = {};
+    uint64_t counter = 0;
+};
+
+Values example_values() {
+    Values values;
+    values.speed = 1500;
+    for (size_t i = 0; i < values.gains.size(); i++) {values.gains[i] = 0.25 * static_cast<double>(i + 1);}
+    values.counter = 0xFEDCBA9876543210ULL;
+    return values;
+}
+
+void add_values(rcp::Recipe &recipe, Values &values) {
+    recipe.add_variable("speed", values.speed);
+    recipe.add_variable("gains", values.gains);
+    recipe.add_variable("counter", values.counter);
+}
+
+// Load every variable of the recipe file, the result of "load_recipe"
+bool load_values(const std::string &folder, Values &values) {
+    rcp::Recipe recipe("recipe", folder);
+    add_values(recipe, values);
+    return recipe.init() && recipe.load_recipe();
+}
+
+// Load a single variable of the recipe file
+bool load_single(const std::string &folder, const std::string &id, Values &values) {
+    rcp::Recipe recipe("recipe", folder);
+    add_values(recipe, values);
+    return recipe.init() && recipe.load_variable(id);
+}
+
+// A recipe saved once as V2 with the example values
+struct Fixture {
+    std::string folder;
+    std::string path;
+    Values values = example_values();
+    rcp::Recipe recipe;
+
+    Fixture(const std::string &name, rcp::DirtyTracking tracking): folder(test_folder(name)), path(folder + "recipe.rcp"),
+                                                                   recipe("recipe", folder) {
+        add_values(this->recipe, this->values);
+        this->recipe.set_file_format(rcp::FileFormat::V2);
+        this->recipe.set_dirty_tracking(tracking);
+    }
+
+    // Flip a byte of the stored gains, which the tests never change
+    bool damage_gains() {
+        return flip_byte(this->path, find_value(this->path, this->values.gains[5]));
+    }
+};
+
+bool test_explicit() {
+    Fixture fixture("dirty_explicit", rcp::DirtyTracking::Explicit);
+    CHECK(fixture.recipe.init() && fixture.recipe.save_recipe());
+    size_t size = read_file(fixture.path).size();
+    CHECK(fixture.damage_gains());
+
+    fixture.values.speed = 1750;
+    CHECK(fixture.recipe.mark_dirty("speed"));
+    CHECK(!fixture.recipe.mark_dirty("missing"));
+    CHECK(fixture.recipe.save_recipe());
+    CHECK(read_file(fixture.path).size() == size);
+
+    // Only "speed" was written: its entry checksum and the index checksum were updated, the damaged gains are untouched
+    Values loaded;
+    CHECK(load_single(fixture.folder, "speed", loaded));
+    CHECK(loaded.speed == 1750);
+    CHECK(load_single(fixture.folder, "counter", loaded));
+    CHECK(loaded.counter == fixture.values.counter);
+    CHECK(!load_single(fixture.folder, "gains", loaded));
+
+    // A change that was not flagged is not saved
+    fixture.values.counter = 7;
+    CHECK(fixture.recipe.save_recipe());
+    CHECK(load_single(fixture.folder, "counter", loaded));
+    CHECK(loaded.counter == example_values().counter);
+    return true;
+}
+
+bool test_snapshot() {
+    Fixture fixture("dirty_snapshot", rcp::DirtyTracking::Snapshot);
+    CHECK(fixture.recipe.init() && fixture.recipe.save_recipe());
+    CHECK(fixture.damage_gains());
+
+    // Changed bytes are detected without flagging
+    fixture.values.counter = 42;
+    CHECK(fixture.recipe.save_recipe());
+    Values loaded;
+    CHECK(load_single(fixture.folder, "counter", loaded));
+    CHECK(loaded.counter == 42);
+    CHECK(load_single(fixture.folder, "speed", loaded));
+    CHECK(loaded.speed == fixture.values.speed);
+    CHECK(!load_single(fixture.folder, "gains", loaded));
+
+    // Saves without changes keep the file as it is
+    std::vector<char> before = read_file(fixture.path);
+    CHECK(fixture.recipe.save_recipe());
+    CHECK(read_file(fixture.path) == before);
+    return true;
+}
+
+bool test_changed_layout() {
+    Fixture fixture("dirty_layout", rcp::DirtyTracking::Snapshot);
+    CHECK(fixture.recipe.init() && fixture.recipe.save_recipe());
+    CHECK(fixture.damage_gains());
+
+    // A variable added since the previous save needs a full rewrite, which also repairs the gains
+    int16_t added = 12;
+    CHECK(fixture.recipe.add_variable("added", added));
+    fixture.values.speed = 900;
+    CHECK(fixture.recipe.save_recipe());
+
+    Values loaded;
+    int16_t added_loaded = 0;
+    rcp::Recipe recipe("recipe", fixture.folder);
+    add_values(recipe, loaded);
+    recipe.add_variable("added", added_loaded);
+    CHECK(recipe.init() && recipe.load_recipe());
+    CHECK(loaded.speed == 900 && loaded.gains == fixture.values.gains && added_loaded == 12);
+
+    // A removed variable as well
+    CHECK(fixture.damage_gains());
+    CHECK(fixture.recipe.remove_variable("added"));
+    CHECK(fixture.recipe.save_recipe());
+    CHECK(load_values(fixture.folder, loaded));
+    CHECK(loaded.gains == fixture.values.gains);
+    return true;
+}
+
+bool test_full_rewrites() {
+    // V1 files, atomic saves and files changed on disk since the previous save are always rewritten completely
+    for (int variant = 0; variant < 3; variant++) {
+        Fixture fixture("dirty_full_" + std::to_string(variant), rcp::DirtyTracking::Explicit);
+        if (variant == 0) {fixture.recipe.set_file_format(rcp::FileFormat::V1);}
+        if (variant == 1) {fixture.recipe.set_save_mode(rcp::SaveMode::Atomic);}
+        CHECK(fixture.recipe.init() && fixture.recipe.save_recipe());
+
+        Values stored = fixture.values;
+        fixture.values.speed = 333;
+        fixture.values.counter = 5;
+        CHECK(fixture.recipe.mark_dirty("speed"));
+        if (variant == 2) {
+            std::vector<char> data = read_file(fixture.path);
+            data.push_back(0);
+            CHECK(write_file(fixture.path, data));
+        }
+        CHECK(fixture.recipe.save_recipe());
+
+        // The unflagged counter is written too
+        Values loaded;
+        CHECK(load_values(fixture.folder, loaded));
+        CHECK(loaded.speed == 333 && loaded.counter == 5 && loaded.gains == stored.gains);
+    }
+    return true;
+}
+
+int main() {
+    return run_tests({
+        {"explicit", test_explicit},
+        {"snapshot", test_snapshot},
+        {"changed_layout", test_changed_layout},
+        {"full_rewrites", test_full_rewrites},
+    });
+}
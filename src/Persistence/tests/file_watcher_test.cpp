@@ -0,0 +1,212 @@
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+#include "file_watcher.hpp"
+#include "recipe.hpp"
+#include "test_util.hpp"
+
+// File watching: direct writes, atomic replacements and files created later are reported after the debounce interval,
+// the polling fallback keeps reporting changes once the event queue fails, and a watched recipe reloads changed entries
+
+// Wait up to five seconds for "condition"
+template <typename Condition>
+bool wait_for(Condition condition) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!condition()) {
+        if (std::chrono::steady_clock::now() > deadline) {return false;}
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return true;
+}
+
+// A watcher counting its callbacks
+struct Watched {
+    std::atomic<int> calls{0};
+    rcp::FileWatcher watcher;
+
+    bool start(const std::string &path) {
+        return this->watcher.start(path, [this]() {this->calls++;}, std::chrono::milliseconds(20));
+    }
+
+    // Wait for a callback after "before" callbacks
+    bool changed_since(int before) {
+        return wait_for([&]() {return this->calls.load() > before;});
+    }
+};
+
+bool test_changes() {
+    std::string folder = test_folder("watcher_changes");
+    std::string path = folder + "watched.rcp";
+    CHECK(write_file(path, {'a'}));
+    Watched watched;
+    CHECK(!watched.watcher.start(path, rcp::FileWatcher::Callback()));
+    CHECK(watched.start(path));
+    CHECK(watched.watcher.is_running());
+    CHECK(!watched.start(path));
+
+    // Written in place
+    int calls = watched.calls;
+    CHECK(write_file(path, {'a', 'b'}));
+    CHECK(watched.changed_since(calls));
+
+    // Replaced by a rename, as by SaveMode::Atomic
+    CHECK(write_file(folder + "watched.tmp", {'c', 'd', 'e'}));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    calls = watched.calls;
+    std::filesystem::rename(folder + "watched.tmp", path);
+    CHECK(watched.changed_since(calls));
+
+    // Other files of the directory are ignored
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    calls = watched.calls;
+    CHECK(write_file(folder + "other.rcp", {'x'}));
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    CHECK(watched.calls == calls);
+
+    watched.watcher.stop();
+    CHECK(!watched.watcher.is_running());
+    CHECK(write_file(path, {'f'}));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    CHECK(watched.calls == calls);
+    return true;
+}
+
+bool test_created_later() {
+    std::string folder = test_folder("watcher_created");
+    std::string path = folder + "watched.rcp";
+    Watched watched;
+    CHECK(watched.start(path));
+    CHECK(write_file(path, {'a'}));
+    CHECK(watched.changed_since(0));
+    return true;
+}
+
+bool test_debounce() {
+    std::string folder = test_folder("watcher_debounce");
+    std::string path = folder + "watched.rcp";
+    CHECK(write_file(path, {}));
+    std::atomic<int> calls{0};
+    rcp::FileWatcher watcher;
+    CHECK(watcher.start(path, [&]() {calls++;}, std::chrono::milliseconds(300)));
+
+    // A burst of writes closer together than the debounce interval is reported once
+    std::vector<char> data;
+    for (int write = 0; write < 10; write++) {
+        data.push_back('a');
+        CHECK(write_file(path, data));
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    CHECK(wait_for([&]() {return calls.load() >= 1;}));
+    std::this_thread::sleep_for(std::chrono::milliseconds(400));
+    CHECK(calls == 1);
+    return true;
+}
+
+bool test_polling_fallback() {
+#if defined(__linux__)
+    std::string folder = test_folder("watcher_fallback");
+    std::string path = folder + "watched.rcp";
+    CHECK(write_file(path, {'a'}));
+    Watched watched;
+    CHECK(watched.start(path));
+
+    // Replace the inotify descriptor of the watcher by the write end of a pipe without reader, polling it fails with POLLERR
+    int inotify = -1;
+    for (const auto &entry: std::filesystem::directory_iterator("/proc/self/fd")) {
+        std::error_code error;
+        if (std::filesystem::read_symlink(entry.path(), error).string() == "anon_inode:inotify") {
+            inotify = std::stoi(entry.path().filename().string());
+        }
+    }
+    CHECK(inotify >= 0);
+    int broken[2];
+    CHECK(::pipe(broken) == 0);
+    ::close(broken[0]);
+    CHECK(::dup2(broken[1], inotify) == inotify);
+    ::close(broken[1]);
+
+    // A poll already waiting keeps the old descriptor, an event of another file wakes it up so the next one fails.
+    // Then changes are found by polling the modification time and size.
+    CHECK(write_file(folder + "other.rcp", {'x'}));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    CHECK(watched.watcher.is_running());
+    int calls = watched.calls;
+    CHECK(write_file(path, {'a', 'b'}));
+    CHECK(watched.changed_since(calls));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    calls = watched.calls;
+    CHECK(write_file(path, {'a', 'b', 'c'}));
+    CHECK(watched.changed_since(calls));
+    watched.watcher.stop();
+#endif
+    return true;
+}
+
+bool test_recipe_watch() {
+    std::string folder = test_folder("watcher_recipe");
+    int32_t speed = 100;
+    double gain = 0.5;
+    rcp::Recipe writer("recipe", folder);
+    writer.set_file_format(rcp::FileFormat::V2);
+    writer.add_variable("speed", speed);
+    writer.add_variable("gain", gain);
+    CHECK(writer.init() && writer.save_recipe());
+
+    rcp::Guarded<int32_t> watched_speed;
+    rcp::Guarded<double> watched_gain;
+    std::mutex mutex;
+    std::vector<std::string> changes;
+    rcp::Recipe recipe("recipe", folder);
+    recipe.set_concurrency(rcp::Concurrency::Concurrent);
+    recipe.add_variable("speed", watched_speed);
+    recipe.add_variable("gain", watched_gain);
+    for (const char *id: {"speed", "gain"}) {
+        CHECK(recipe.set_change_callback(id, [&](std::string_view changed) {
+            std::lock_guard<std::mutex> lock(mutex);
+            changes.push_back(std::string(changed));
+        }));
+    }
+    CHECK(recipe.init() && recipe.load_recipe());
+    CHECK(recipe.start_watch(std::chrono::milliseconds(20)));
+    CHECK(recipe.is_watching());
+
+    // Another process saves a new speed, only the changed entry is reloaded
+    speed = 250;
+    CHECK(writer.save_recipe());
+    CHECK(wait_for([&]() {return watched_speed.load() == 250;}));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        CHECK(changes == std::vector<std::string>{"speed"});
+    }
+    CHECK(watched_gain.load() == 0.5);
+
+    recipe.stop_watch();
+    CHECK(!recipe.is_watching());
+    speed = 300;
+    CHECK(writer.save_recipe());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    CHECK(watched_speed.load() == 250);
+
+    // Watching requires Concurrency::Concurrent
+    rcp::Recipe plain("recipe", folder);
+    CHECK(plain.init());
+    CHECK(!plain.start_watch());
+    return true;
+}
+
+int main() {
+    return run_tests({
+        {"changes", test_changes},
+        {"created_later", test_created_later},
+        {"debounce", test_debounce},
+        {"polling_fallback", test_polling_fallback},
+        {"recipe_watch", test_recipe_watch},
+    });
+}
@@ -0,0 +1,152 @@
+#include "recipe.hpp"
+#include "recipe_format.hpp"
+#include "test_util.hpp"
+
+// JournalMode::Append: journaled updates are replayed on top of the recipe file, a torn append ends the journal,
+// saves compact the journal into the recipe file
+
+constexpr uint64_t RECORD_SIZE = rcp::format::JOURNAL_RECORD_SIZE + sizeof(uint64_t);
+
+struct Values {
+    int32_t speed = 0;
+    uint64_t counter = 0;
+};
+
+void add_values(rcp::Recipe &recipe, Values &values) {
+    recipe.add_variable("speed", values.speed);
+    recipe.add_variable("counter", values.counter);
+}
+
+// A journaling recipe whose V2 file holds speed 1500 and counter 1
+struct Fixture {
+    std::string folder;
+    std::string journal;
+    Values values;
+    rcp::Recipe recipe;
+
+    Fixture(const std::string &name, uint64_t compaction_size=16 << 20): folder(test_folder(name)),
+                                                                         journal(folder + "recipe.rcp.journal"),
+                                                                         recipe("recipe", folder) {
+        add_values(this->recipe, this->values);
+        this->recipe.set_file_format(rcp::FileFormat::V2);
+        this->recipe.set_journal_mode(rcp::JournalMode::Append, compaction_size);
+    }
+
+    bool init() {
+        this->values.speed = 1500;
+        this->values.counter = 1;
+        return this->recipe.init() && this->recipe.save_recipe();
+    }
+
+    // Journal the counter values first to last
+    bool journal_counter(uint64_t first, uint64_t last) {
+        for (uint64_t counter = first; counter <= last; counter++) {
+            this->values.counter = counter;
+            if (!this->recipe.journal_variable("counter")) {return false;}
+        }
+        return true;
+    }
+};
+
+// Load the recipe file of "folder" and replay its journal unless "mode" is JournalMode::None
+bool load_values(const std::string &folder, Values &values, rcp::JournalMode mode=rcp::JournalMode::Append) {
+    rcp::Recipe recipe("recipe", folder);
+    add_values(recipe, values);
+    recipe.set_journal_mode(mode);
+    return recipe.init() && recipe.load_recipe();
+}
+
+bool test_replay() {
+    Fixture fixture("journal_replay");
+    CHECK(!fixture.recipe.journal_variable("counter"));
+    CHECK(fixture.init());
+    CHECK(fixture.journal_counter(2, 100));
+    CHECK(!fixture.recipe.journal_variable("missing"));
+
+    // One record per update, the recipe file is untouched
+    CHECK(read_file(fixture.journal).size() == rcp::format::JOURNAL_HEADER_SIZE + 99 * RECORD_SIZE);
+    Values loaded;
+    CHECK(load_values(fixture.folder, loaded, rcp::JournalMode::None));
+    CHECK(loaded.speed == 1500 && loaded.counter == 1);
+    CHECK(load_values(fixture.folder, loaded));
+    CHECK(loaded.speed == 1500 && loaded.counter == 100);
+
+    // Loading a single variable replays its own records only
+    Values single;
+    rcp::Recipe recipe("recipe", fixture.folder);
+    add_values(recipe, single);
+    recipe.set_journal_mode(rcp::JournalMode::Append);
+    CHECK(recipe.init() && recipe.load_variable("counter"));
+    CHECK(single.speed == 0 && single.counter == 100);
+
+    // Without JournalMode::Append there is nothing to append to
+    rcp::Recipe plain("recipe", fixture.folder);
+    add_values(plain, single);
+    CHECK(plain.init());
+    CHECK(!plain.journal_variable("counter"));
+    return true;
+}
+
+bool test_torn_record() {
+    Fixture fixture("journal_torn");
+    CHECK(fixture.init());
+    CHECK(fixture.journal_counter(2, 10));
+    uint64_t size = read_file(fixture.journal).size();
+
+    // A crash in the middle of the last append leaves part of its record, replay ends before it
+    CHECK(truncate_file(fixture.journal, size - 3));
+    Values loaded;
+    CHECK(load_values(fixture.folder, loaded));
+    CHECK(loaded.counter == 9);
+
+    // A record failing its checksum as well
+    CHECK(flip_byte(fixture.journal, size - RECORD_SIZE - 1));
+    CHECK(load_values(fixture.folder, loaded));
+    CHECK(loaded.counter == 8);
+
+    // A recipe opening the journal again drops the rest and appends behind the last valid record
+    Values values;
+    rcp::Recipe reopened("recipe", fixture.folder);
+    add_values(reopened, values);
+    reopened.set_journal_mode(rcp::JournalMode::Append);
+    CHECK(reopened.init());
+    values.counter = 20;
+    CHECK(reopened.journal_variable("counter"));
+    CHECK(read_file(fixture.journal).size() == rcp::format::JOURNAL_HEADER_SIZE + 8 * RECORD_SIZE);
+    CHECK(load_values(fixture.folder, loaded));
+    CHECK(loaded.counter == 20);
+    return true;
+}
+
+bool test_compaction() {
+    Fixture fixture("journal_compaction");
+    CHECK(fixture.init());
+    CHECK(fixture.journal_counter(2, 50));
+    fixture.values.speed = 1750;
+
+    // A save writes every value to the recipe file and empties the journal
+    CHECK(fixture.recipe.save_recipe());
+    CHECK(read_file(fixture.journal).size() == rcp::format::JOURNAL_HEADER_SIZE);
+    Values loaded;
+    CHECK(load_values(fixture.folder, loaded, rcp::JournalMode::None));
+    CHECK(loaded.speed == 1750 && loaded.counter == 50);
+
+    // Reaching the compaction size saves the recipe
+    Fixture limited("journal_limit", rcp::format::JOURNAL_HEADER_SIZE + 10 * RECORD_SIZE);
+    CHECK(limited.init());
+    CHECK(limited.journal_counter(2, 10));
+    CHECK(read_file(limited.journal).size() == rcp::format::JOURNAL_HEADER_SIZE + 9 * RECORD_SIZE);
+    CHECK(limited.journal_counter(11, 11));
+    CHECK(read_file(limited.journal).size() == rcp::format::JOURNAL_HEADER_SIZE);
+    CHECK(load_values(limited.folder, loaded, rcp::JournalMode::None));
+    CHECK(loaded.counter == 11);
+    return true;
+}
+
+int main() {
+    return run_tests({
+        {"replay", test_replay},
+        {"torn_record", test_torn_record},
+        {"compaction", test_compaction},
+    });
+}
@@ -0,0 +1,150 @@
+#include "recipe.hpp"
+#include "test_util.hpp"
+
+// The parallel load: entries split into chunks, checksums combined per chunk, V1 files, corrupted and truncated files
+
+constexpr size_t CHUNK_SIZE = 4096;
+
+struct Values {
+    std::vector<uint32_t> large = std::vector<uint32_t>(64 * 1024 + 7, 0);
+    std::vector<char> exact = std::vector<char>(4 * CHUNK_SIZE, 0);
+    int64_t small = 0;
+    std::vector<char> empty;
+};
+
+Values example_values() {
+    Values values;
+    for (size_t i = 0; i < values.large.size(); i++) {values.large[i] = static_cast<uint32_t>(i * 2654435761u);}
+    for (size_t i = 0; i < values.exact.size(); i++) {values.exact[i] = static_cast<char>(i * 31 + 7);}
+    values.small = -42;
+    return values;
+}
+
+void add_values(rcp::Recipe &recipe, Values &values) {
+    recipe.add_variable("large", reinterpret_cast<char*>(values.large.data()), values.large.size() * sizeof(uint32_t));
+    recipe.add_variable("exact", values.exact.data(), values.exact.size());
+    recipe.add_variable("small", values.small);
+    recipe.add_variable("empty", values.empty.data(), 0);
+}
+
+bool save_example(const std::string &folder) {
+    Values values = example_values();
+    rcp::Recipe recipe("recipe", folder);
+    add_values(recipe, values);
+    recipe.set_file_format(rcp::FileFormat::V2);
+    return recipe.init() && recipe.save_recipe();
+}
+
+bool load_example(const std::string &folder, unsigned threads, Values &values, rcp::LoadError &error) {
+    rcp::Recipe recipe("recipe", folder);
+    add_values(recipe, values);
+    if (!recipe.init()) {return false;}
+    rcp::ParallelPolicy policy;
+    policy.threads = threads;
+    policy.chunk_size = CHUNK_SIZE;
+    bool success = recipe.load_recipe(policy);
+    error = recipe.get_load_error();
+    return success;
+}
+
+bool test_round_trip() {
+    std::string folder = test_folder("parallel_round_trip");
+    CHECK(save_example(folder));
+    Values expected = example_values();
+    for (unsigned threads: {0u, 1u, 2u, 3u, 8u}) {
+        Values loaded;
+        rcp::LoadError error;
+        CHECK(load_example(folder, threads, loaded, error));
+        CHECK(error.status == rcp::LoadStatus::Ok);
+        CHECK(loaded.large == expected.large);
+        CHECK(loaded.exact == expected.exact);
+        CHECK(loaded.small == expected.small);
+    }
+    return true;
+}
+
+bool test_v1_fallback() {
+    // V1 files have no index to split, they are loaded sequentially
+    std::string folder = test_folder("parallel_v1");
+    Values values = example_values();
+    rcp::Recipe recipe("recipe", folder);
+    add_values(recipe, values);
+    recipe.set_file_format(rcp::FileFormat::V1);
+    CHECK(recipe.init() && recipe.save_recipe());
+
+    Values loaded;
+    rcp::LoadError error;
+    CHECK(load_example(folder, 4, loaded, error));
+    CHECK(loaded.large == values.large);
+    CHECK(loaded.exact == values.exact);
+    CHECK(loaded.small == values.small);
+    return true;
+}
+
+bool test_compressed_round_trip() {
+    std::string folder = test_folder("parallel_compressed");
+    Values values = example_values();
+    rcp::Recipe recipe("recipe", folder);
+    add_values(recipe, values);
+    recipe.set_file_format(rcp::FileFormat::V2);
+    if (!recipe.set_compression(rcp::Codec::Deflate, 1024)) {return true;}
+    CHECK(recipe.init() && recipe.save_recipe());
+
+    Values loaded;
+    rcp::LoadError error;
+    CHECK(load_example(folder, 4, loaded, error));
+    CHECK(loaded.large == values.large);
+    CHECK(loaded.exact == values.exact);
+    CHECK(loaded.small == values.small);
+    return true;
+}
+
+bool test_corrupted_chunk() {
+    std::string folder = test_folder("parallel_corrupted");
+    std::string path = folder + "recipe.rcp";
+    Values expected = example_values();
+
+    // The first chunk, a chunk in the middle and the tail chunk of the split entry
+    CHECK(save_example(folder));
+    uint64_t start = find_value(path, expected.large[1]) - sizeof(uint32_t);
+    uint64_t size = expected.large.size() * sizeof(uint32_t);
+    for (uint64_t offset: {start, start + size / 2, start + size - 1}) {
+        CHECK(save_example(folder));
+        CHECK(flip_byte(path, offset));
+        for (unsigned threads: {1u, 4u}) {
+            Values loaded;
+            rcp::LoadError error;
+            CHECK(!load_example(folder, threads, loaded, error));
+            CHECK(error.status == rcp::LoadStatus::Corrupt);
+            // Chunks are only copied into the variable after the whole entry passed its checksum
+            CHECK(loaded.large == std::vector<uint32_t>(expected.large.size(), 0));
+        }
+    }
+    return true;
+}
+
+bool test_truncated() {
+    std::string folder = test_folder("parallel_truncated");
+    std::string path = folder + "recipe.rcp";
+    CHECK(save_example(folder));
+    std::vector<char> original = read_file(path);
+    // Shortest last, an empty file is a recipe that was never saved and loads without values
+    for (size_t size: {original.size() - 1, original.size() - 17, original.size() / 2, size_t(100), size_t(10)}) {
+        CHECK(truncate_file(path, size));
+        Values loaded;
+        rcp::LoadError error;
+        CHECK(!load_example(folder, 4, loaded, error));
+        CHECK(error.status != rcp::LoadStatus::Ok);
+    }
+    return true;
+}
+
+int main() {
+    return run_tests({
+        {"round_trip", test_round_trip},
+        {"v1_fallback", test_v1_fallback},
+        {"compressed_round_trip", test_compressed_round_trip},
+        {"corrupted_chunk", test_corrupted_chunk},
+        {"truncated", test_truncated},
+    });
+}
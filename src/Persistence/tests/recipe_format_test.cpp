@@ -0,0 +1,291 @@
+#include <array>
+#include <cstring>
+
+#include "recipe.hpp"
+#include "recipe_format.hpp"
+#include "test_util.hpp"
+
+// Round trips of the V1, V2 and compressed recipe files, single variable loads and loads of corrupted and truncated V2 files
+
+struct Values {
+    int32_t integer = 0;
+    double real = 0.0;
+    std::array<float, 4> vector = {};
+    uint64_t counter = 0;
+    std::vector<uint16_t> samples = std::vector<uint16_t>(20000, 0);
+};
+
+Values example_values() {
+    Values values;
+    values.integer = -1234567;
+    values.real = 3.14159;
+    values.vector = {1.0f, 2.5f, -3.0f, 4.25f};
+    values.counter = 0x0123456789ABCDEFULL;
+    for (size_t i = 0; i < values.samples.size(); i++) {values.samples[i] = static_cast<uint16_t>(i % 97);}
+    return values;
+}
+
+bool same(const Values &a, const Values &b) {
+    return a.integer == b.integer && a.real == b.real && a.vector == b.vector && a.counter == b.counter && a.samples == b.samples;
+}
+
+void add_values(rcp::Recipe &recipe, Values &values) {
+    recipe.add_variable("integer", values.integer);
+    recipe.add_variable("real", values.real);
+    recipe.add_variable("vector", values.vector);
+    recipe.add_variable("counter", values.counter);
+    recipe.add_variable("samples", reinterpret_cast<char*>(values.samples.data()), values.samples.size() * sizeof(uint16_t));
+}
+
+// Save the example values to "name" in "folder"
+bool save_example(const std::string &folder, const std::string &name, rcp::FileFormat format, rcp::Codec codec=rcp::Codec::None) {
+    Values values = example_values();
+    rcp::Recipe recipe(name, folder);
+    add_values(recipe, values);
+    recipe.set_file_format(format);
+    if (codec != rcp::Codec::None && !recipe.set_compression(codec, 1024)) {return false;}
+    return recipe.init() && recipe.save_recipe();
+}
+
+// Load "name" from "folder" into "values", returns the load result and its error
+bool load_example(const std::string &folder, const std::string &name, rcp::LoadMode mode, Values &values, rcp::LoadError &error) {
+    rcp::Recipe recipe(name, folder);
+    add_values(recipe, values);
+    recipe.set_load_mode(mode);
+    if (!recipe.init()) {return false;}
+    bool success = recipe.load_recipe();
+    error = recipe.get_load_error();
+    return success;
+}
+
+bool load_example(const std::string &folder, const std::string &name, rcp::LoadMode mode, Values &values) {
+    rcp::LoadError error;
+    return load_example(folder, name, mode, values, error);
+}
+
+bool test_v2_round_trip() {
+    std::string folder = test_folder("format_v2");
+    CHECK(save_example(folder, "recipe", rcp::FileFormat::V2));
+    std::vector<char> data = read_file(folder + "recipe.rcp");
+    CHECK(data.size() > rcp::format::HEADER_SIZE);
+    CHECK(std::memcmp(data.data(), rcp::format::MAGIC, sizeof(rcp::format::MAGIC)) == 0);
+    for (rcp::LoadMode mode: {rcp::LoadMode::Stream, rcp::LoadMode::Mapped}) {
+        Values loaded;
+        CHECK(load_example(folder, "recipe", mode, loaded));
+        CHECK(same(loaded, example_values()));
+    }
+    return true;
+}
+
+bool test_v1_round_trip() {
+    std::string folder = test_folder("format_v1");
+    CHECK(save_example(folder, "recipe", rcp::FileFormat::V1));
+    for (rcp::LoadMode mode: {rcp::LoadMode::Stream, rcp::LoadMode::Mapped}) {
+        Values loaded;
+        CHECK(load_example(folder, "recipe", mode, loaded));
+        CHECK(same(loaded, example_values()));
+    }
+    return true;
+}
+
+bool test_default_format() {
+    std::string folder = test_folder("format_default");
+    Values values = example_values();
+    rcp::Recipe recipe("recipe", folder);
+    add_values(recipe, values);
+    CHECK(recipe.get_file_format() == rcp::FileFormat::V1);
+    CHECK(recipe.init() && recipe.save_recipe());
+
+    // Without opting in to V2 the file stays readable by readers that only know V1
+    std::vector<char> data = read_file(folder + "recipe.rcp");
+    rcp::format::Header header;
+    CHECK(!data.empty());
+    CHECK(!rcp::format::decode_header(data.data(), data.size(), header));
+    Values loaded;
+    CHECK(load_example(folder, "recipe", rcp::LoadMode::Stream, loaded));
+    CHECK(same(loaded, values));
+    return true;
+}
+
+bool test_compressed_round_trip() {
+    std::string folder = test_folder("format_compressed");
+    CHECK(save_example(folder, "raw", rcp::FileFormat::V2));
+    size_t raw_size = read_file(folder + "raw.rcp").size();
+    for (rcp::Codec codec: {rcp::Codec::LZ4, rcp::Codec::Deflate}) {
+        rcp::Recipe probe;
+        if (!probe.set_compression(codec)) {continue;}
+        CHECK(save_example(folder, "recipe", rcp::FileFormat::V2, codec));
+        // The repeating samples compress well
+        CHECK(read_file(folder + "recipe.rcp").size() < raw_size);
+        for (rcp::LoadMode mode: {rcp::LoadMode::Stream, rcp::LoadMode::Mapped}) {
+            Values loaded;
+            CHECK(load_example(folder, "recipe", mode, loaded));
+            CHECK(same(loaded, example_values()));
+
+            rcp::Recipe single("recipe", folder);
+            Values values;
+            add_values(single, values);
+            single.set_load_mode(mode);
+            CHECK(single.init() && single.load_variable("samples"));
+            CHECK(values.samples == example_values().samples);
+        }
+    }
+    return true;
+}
+
+bool test_load_variable() {
+    std::string folder = test_folder("format_variable");
+    CHECK(save_example(folder, "recipe", rcp::FileFormat::V2));
+    for (rcp::LoadMode mode: {rcp::LoadMode::Stream, rcp::LoadMode::Mapped}) {
+        Values loaded;
+        rcp::Recipe recipe("recipe", folder);
+        add_values(recipe, loaded);
+        recipe.set_load_mode(mode);
+        CHECK(recipe.init());
+        CHECK(recipe.load_variable("real"));
+        CHECK(loaded.real == example_values().real);
+        CHECK(loaded.integer == 0);
+        CHECK(!recipe.load_variable("missing"));
+    }
+    return true;
+}
+
+bool test_empty_value() {
+    // A zero-size variable has no bytes to copy, its pointer may be null
+    std::string folder = test_folder("format_empty_value");
+    int32_t value = 17;
+    rcp::Recipe recipe("recipe", folder);
+    recipe.add_variable("empty", nullptr, 0);
+    recipe.add_variable("value", value);
+    CHECK(recipe.init());
+    for (rcp::FileFormat format: {rcp::FileFormat::V1, rcp::FileFormat::V2}) {
+        recipe.set_file_format(format);
+        CHECK(recipe.save_recipe());
+        for (rcp::LoadMode mode: {rcp::LoadMode::Stream, rcp::LoadMode::Mapped}) {
+            int32_t loaded = 0;
+            rcp::Recipe other("recipe", folder);
+            other.add_variable("empty", nullptr, 0);
+            other.add_variable("value", loaded);
+            other.set_load_mode(mode);
+            CHECK(other.init() && other.load_recipe());
+            CHECK(loaded == 17);
+        }
+    }
+    return true;
+}
+
+bool test_atomic_save() {
+    std::string folder = test_folder("format_atomic");
+    Values values = example_values();
+    rcp::Recipe recipe("recipe", folder);
+    add_values(recipe, values);
+    recipe.set_file_format(rcp::FileFormat::V2);
+    recipe.set_save_mode(rcp::SaveMode::Atomic);
+    recipe.set_sync_mode(rcp::SyncMode::EveryN, 2);
+    CHECK(recipe.init());
+    for (int32_t save = 0; save < 3; save++) {
+        values.integer = save;
+        CHECK(recipe.save_recipe());
+        Values loaded;
+        CHECK(load_example(folder, "recipe", rcp::LoadMode::Mapped, loaded));
+        CHECK(loaded.integer == save && loaded.samples == values.samples);
+    }
+
+    // The temporary file was renamed over the recipe file
+    size_t files = 0;
+    for (const auto &entry: std::filesystem::directory_iterator(folder)) {
+        CHECK(entry.path().filename() == "recipe.rcp");
+        files++;
+    }
+    CHECK(files == 1);
+    return true;
+}
+
+bool test_corrupted_value() {
+    std::string folder = test_folder("format_corrupted_value");
+    std::string path = folder + "recipe.rcp";
+    Values expected = example_values();
+    for (rcp::LoadMode mode: {rcp::LoadMode::Stream, rcp::LoadMode::Mapped}) {
+        CHECK(save_example(folder, "recipe", rcp::FileFormat::V2));
+        CHECK(flip_byte(path, find_value(path, expected.real)));
+        Values loaded;
+        loaded.real = -1.0;
+        rcp::LoadError error;
+        CHECK(!load_example(folder, "recipe", mode, loaded, error));
+        CHECK(error.status == rcp::LoadStatus::Corrupt);
+        // A value failing its checksum is never written to its variable
+        CHECK(loaded.real == -1.0);
+
+        rcp::Recipe recipe("recipe", folder);
+        Values single;
+        single.real = -1.0;
+        add_values(recipe, single);
+        recipe.set_load_mode(mode);
+        CHECK(recipe.init());
+        CHECK(!recipe.load_variable("real"));
+        CHECK(single.real == -1.0);
+    }
+    return true;
+}
+
+bool test_corrupted_index() {
+    std::string folder = test_folder("format_corrupted_index");
+    std::string path = folder + "recipe.rcp";
+    CHECK(save_example(folder, "recipe", rcp::FileFormat::V2));
+
+    // Every byte of the header and the table of contents is covered by the index checksum
+    for (uint64_t offset = 0; offset < rcp::format::HEADER_SIZE + 5 * rcp::format::TOC_ENTRY_SIZE; offset += 7) {
+        CHECK(flip_byte(path, offset));
+        for (rcp::LoadMode mode: {rcp::LoadMode::Stream, rcp::LoadMode::Mapped}) {
+            Values loaded;
+            rcp::LoadError error;
+            CHECK(!load_example(folder, "recipe", mode, loaded, error));
+            CHECK(error.status != rcp::LoadStatus::Ok);
+            CHECK(loaded.integer == 0 && loaded.real == 0.0 && loaded.counter == 0);
+        }
+        CHECK(flip_byte(path, offset));
+    }
+    return true;
+}
+
+bool test_truncated() {
+    std::string folder = test_folder("format_truncated");
+    std::string path = folder + "recipe.rcp";
+    CHECK(save_example(folder, "recipe", rcp::FileFormat::V2));
+    std::vector<char> original = read_file(path);
+
+    // Every size cutting the header or the first TOC entry, then sizes cutting the rest of the index and the data blocks
+    std::vector<size_t> sizes;
+    size_t first_entry_end = rcp::format::HEADER_SIZE + rcp::format::TOC_ENTRY_SIZE;
+    size_t index_end = rcp::format::HEADER_SIZE + 5 * rcp::format::TOC_ENTRY_SIZE + 64;
+    for (size_t size = 1; size < first_entry_end; size++) {sizes.push_back(size);}
+    for (size_t size = first_entry_end; size < index_end; size += 7) {sizes.push_back(size);}
+    for (size_t size = index_end; size < original.size(); size += 997) {sizes.push_back(size);}
+    sizes.push_back(original.size() - 1);
+    // Shortest last, so every size is cut from the previous one
+    for (auto size = sizes.rbegin(); size != sizes.rend(); size++) {
+        CHECK(truncate_file(path, *size));
+        for (rcp::LoadMode mode: {rcp::LoadMode::Stream, rcp::LoadMode::Mapped}) {
+            Values loaded;
+            rcp::LoadError error;
+            CHECK(!load_example(folder, "recipe", mode, loaded, error));
+            CHECK(error.status == rcp::LoadStatus::Truncated || error.status == rcp::LoadStatus::Corrupt);
+        }
+    }
+    return true;
+}
+
+int main() {
+    return run_tests({
+        {"v2_round_trip", test_v2_round_trip},
+        {"v1_round_trip", test_v1_round_trip},
+        {"default_format", test_default_format},
+        {"compressed_round_trip", test_compressed_round_trip},
+        {"load_variable", test_load_variable},
+        {"empty_value", test_empty_value},
+        {"atomic_save", test_atomic_save},
+        {"corrupted_value", test_corrupted_value},
+        {"corrupted_index", test_corrupted_index},
+        {"truncated", test_truncated},
+    });
+}
@@ -0,0 +1,172 @@
+#include <array>
+
+#include "recipe.hpp"
+#include "test_util.hpp"
+
+// Versions saved to the history: restoring, delta chains and snapshots, corrupted and torn histories
+
+struct Values {
+    int32_t speed = 0;
+    std::array<double, 3> gains = {};
+    std::array<char, 1000> table = {};
+};
+
+// Values of the n-th saved version, only "speed" changes every version
+Values version_values(int version) {
+    Values values;
+    values.speed = 100 * version;
+    values.gains = {1.0, 0.5, version % 3 == 0 ? 0.25 : 0.125};
+    for (size_t i = 0; i < values.table.size(); i++) {values.table[i] = static_cast<char>(i + (version > 5 ? 1 : 0));}
+    return values;
+}
+
+bool same(const Values &a, const Values &b) {
+    return a.speed == b.speed && a.gains == b.gains && a.table == b.table;
+}
+
+void add_values(rcp::Recipe &recipe, Values &values) {
+    recipe.add_variable("speed", values.speed);
+    recipe.add_variable("gains", values.gains);
+    recipe.add_variable("table", values.table);
+}
+
+// Save versions 1 to "count" of "version_values"
+bool save_versions(const std::string &folder, int count, size_t snapshot_interval) {
+    Values values;
+    rcp::Recipe recipe("recipe", folder);
+    add_values(recipe, values);
+    recipe.set_snapshot_interval(snapshot_interval);
+    if (!recipe.init()) {return false;}
+    for (int version = 1; version <= count; version++) {
+        values = version_values(version);
+        if (recipe.save_version() != static_cast<uint64_t>(version)) {return false;}
+    }
+    return true;
+}
+
+bool load_version(const std::string &folder, uint64_t version, Values &values) {
+    rcp::Recipe recipe("recipe", folder);
+    add_values(recipe, values);
+    return recipe.init() && recipe.load_version(version);
+}
+
+bool test_round_trip() {
+    for (size_t interval: {size_t(1), size_t(4), size_t(100)}) {
+        std::string folder = test_folder("history_round_trip_" + std::to_string(interval));
+        CHECK(save_versions(folder, 12, interval));
+        for (int version = 1; version <= 12; version++) {
+            Values loaded;
+            CHECK(load_version(folder, version, loaded));
+            CHECK(same(loaded, version_values(version)));
+        }
+        Values loaded;
+        CHECK(!load_version(folder, 13, loaded));
+        CHECK(!load_version(folder, 0, loaded));
+    }
+    return true;
+}
+
+bool test_versions() {
+    std::string folder = test_folder("history_versions");
+    CHECK(save_versions(folder, 9, 4));
+    Values values;
+    rcp::Recipe recipe("recipe", folder);
+    add_values(recipe, values);
+    recipe.set_snapshot_interval(4);
+    CHECK(recipe.init());
+    std::vector<rcp::VersionInfo> versions = recipe.get_versions();
+    CHECK(versions.size() == 9);
+    CHECK(versions[0].version == 1 && versions[0].parent == 0 && versions[0].snapshot);
+    CHECK(versions[0].entries == 3);
+    // Later versions store only the changed values
+    CHECK(versions[1].parent == 1 && !versions[1].snapshot);
+    CHECK(versions[1].entries == 1);
+    CHECK(versions[4].snapshot);
+
+    // A version saved after loading an older one is saved on top of it
+    CHECK(recipe.load_version(3));
+    CHECK(recipe.get_version() == 3);
+    values.speed = 7;
+    uint64_t branch = recipe.save_version();
+    CHECK(branch == 10);
+    CHECK(recipe.get_versions().back().parent == 3);
+    Values loaded;
+    CHECK(load_version(folder, branch, loaded));
+    Values expected = version_values(3);
+    expected.speed = 7;
+    CHECK(same(loaded, expected));
+    return true;
+}
+
+bool test_corrupted() {
+    std::string folder = test_folder("history_corrupted");
+    std::string path = folder + "recipe.rcp.history";
+    CHECK(save_versions(folder, 3, 100));
+    Values first = version_values(1);
+    CHECK(flip_byte(path, find_value(path, first.gains)));
+
+    // Every version sharing the corrupted value fails its checksum, the value is never assigned
+    for (uint64_t version: {1, 2}) {
+        Values loaded;
+        rcp::Recipe recipe("recipe", folder);
+        add_values(recipe, loaded);
+        CHECK(recipe.init());
+        CHECK(!recipe.load_version(version));
+        CHECK(recipe.get_load_error().status == rcp::LoadStatus::Corrupt);
+        CHECK(loaded.gains == Values().gains);
+    }
+
+    // Version 3 stores its own gains
+    Values loaded;
+    CHECK(load_version(folder, 3, loaded));
+    CHECK(same(loaded, version_values(3)));
+    return true;
+}
+
+bool test_torn() {
+    std::string folder = test_folder("history_torn");
+    std::string path = folder + "recipe.rcp.history";
+    CHECK(save_versions(folder, 3, 100));
+    std::vector<char> three = read_file(path);
+    std::string shorter = test_folder("history_torn_two");
+    CHECK(save_versions(shorter, 2, 100));
+    size_t two = read_file(shorter + "recipe.rcp.history").size();
+    CHECK(two < three.size());
+
+    // A history torn inside the last version keeps the versions before it
+    for (size_t size = two + 1; size < three.size(); size += 17) {
+        CHECK(write_file(path, three));
+        CHECK(truncate_file(path, size));
+        Values values;
+        rcp::Recipe recipe("recipe", folder);
+        add_values(recipe, values);
+        CHECK(recipe.init());
+        CHECK(recipe.get_versions().size() == 2);
+        CHECK(recipe.load_version(2));
+        CHECK(same(values, version_values(2)));
+        CHECK(!recipe.load_version(3));
+
+        // The torn tail was cut off, the next version is appended behind version 2
+        values = version_values(3);
+        CHECK(recipe.save_version() == 3);
+    }
+
+    // A file without a valid history header is replaced by an empty history
+    CHECK(write_file(path, std::vector<char>(three.begin(), three.begin() + 5)));
+    Values values;
+    rcp::Recipe recipe("recipe", folder);
+    add_values(recipe, values);
+    CHECK(recipe.init());
+    CHECK(recipe.get_versions().empty());
+    CHECK(recipe.save_version() == 1);
+    return true;
+}
+
+int main() {
+    return run_tests({
+        {"round_trip", test_round_trip},
+        {"versions", test_versions},
+        {"corrupted", test_corrupted},
+        {"torn", test_torn},
+    });
+}
@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <array>
+
+#include "recipe.hpp"
+#include "recipe_source.hpp"
+#include "test_util.hpp"
+
+// Recipe sources: loads through FileSource and MappedSource, only the data blocks of registered variables are fetched,
+// and blocks closer than the gap of the source are merged into one range
+
+using Block = std::array<uint64_t, 64>;
+constexpr size_t BLOCK_COUNT = 5;
+
+Block make_block(size_t index) {
+    Block block;
+    for (size_t i = 0; i < block.size(); i++) {block[i] = (index + 1) * 0x0101010101010101ULL + i;}
+    return block;
+}
+
+// A FileSource recording the ranges of every read, with a configurable gap
+class RecordingSource : public rcp::FileSource {
+    public:
+        std::vector<std::vector<rcp::ReadRange>> reads;
+        uint64_t merge_gap = 0;
+
+        RecordingSource(std::string path): rcp::FileSource(path) {}
+
+        bool read(const rcp::ReadRange *ranges, size_t count) override {
+            this->reads.emplace_back(ranges, ranges + count);
+            return rcp::FileSource::read(ranges, count);
+        }
+
+        uint64_t gap() const override {
+            return this->merge_gap;
+        }
+};
+
+// A V2 recipe of BLOCK_COUNT blocks, "ids" receives the block ids in file order
+bool save_blocks(const std::string &folder, std::vector<std::string> &ids) {
+    std::vector<Block> blocks(BLOCK_COUNT);
+    rcp::Recipe recipe("recipe", folder);
+    recipe.set_file_format(rcp::FileFormat::V2);
+    for (size_t i = 0; i < BLOCK_COUNT; i++) {
+        blocks[i] = make_block(i);
+        recipe.add_variable("block_" + std::to_string(i), blocks[i]);
+    }
+    if (!recipe.init() || !recipe.save_recipe()) {return false;}
+
+    std::vector<std::pair<uint64_t, std::string>> offsets;
+    for (size_t i = 0; i < BLOCK_COUNT; i++) {
+        offsets.emplace_back(find_value(folder + "recipe.rcp", blocks[i]), "block_" + std::to_string(i));
+    }
+    std::sort(offsets.begin(), offsets.end());
+    ids.clear();
+    for (const auto &offset: offsets) {ids.push_back(offset.second);}
+    return true;
+}
+
+bool test_round_trip() {
+    std::string folder = test_folder("source_round_trip");
+    std::vector<std::string> ids;
+    CHECK(save_blocks(folder, ids));
+    rcp::FileSource file_source(folder + "recipe.rcp");
+    rcp::MappedSource mapped_source(folder + "recipe.rcp");
+    for (rcp::RecipeSource *source: {static_cast<rcp::RecipeSource*>(&file_source), static_cast<rcp::RecipeSource*>(&mapped_source)}) {
+        // The recipe name and folder point elsewhere, values come from the source only
+        std::vector<Block> blocks(BLOCK_COUNT);
+        rcp::Recipe recipe("elsewhere", test_folder("source_round_trip_empty"));
+        for (size_t i = 0; i < BLOCK_COUNT; i++) {recipe.add_variable("block_" + std::to_string(i), blocks[i]);}
+        recipe.set_source(source);
+        CHECK(recipe.init() && recipe.load_recipe());
+        for (size_t i = 0; i < BLOCK_COUNT; i++) {CHECK(blocks[i] == make_block(i));}
+
+        std::fill(blocks.begin(), blocks.end(), Block());
+        CHECK(recipe.load_variable("block_3"));
+        CHECK(blocks[3] == make_block(3) && blocks[2] == Block());
+    }
+
+    // A missing file fails "init"
+    rcp::FileSource missing(folder + "missing.rcp");
+    rcp::Recipe recipe("recipe", folder);
+    recipe.set_source(&missing);
+    CHECK(!recipe.init());
+    return true;
+}
+
+bool test_registered_only() {
+    std::string folder = test_folder("source_registered");
+    std::vector<std::string> ids;
+    CHECK(save_blocks(folder, ids));
+
+    // Register the first, third and fifth block in file order, the others lie between them
+    for (uint64_t gap: {uint64_t(0), uint64_t(sizeof(Block) - 1), uint64_t(sizeof(Block))}) {
+        RecordingSource source(folder + "recipe.rcp");
+        source.merge_gap = gap;
+        std::vector<Block> blocks(BLOCK_COUNT);
+        rcp::Recipe recipe("recipe", folder);
+        for (size_t i = 0; i < BLOCK_COUNT; i += 2) {recipe.add_variable(ids[i], blocks[i]);}
+        recipe.set_source(&source);
+        CHECK(recipe.init() && recipe.load_recipe());
+        for (size_t i = 0; i < BLOCK_COUNT; i++) {
+            size_t index = static_cast<size_t>(std::stoul(ids[i].substr(6)));
+            CHECK(blocks[i] == (i % 2 == 0 ? make_block(index) : Block()));
+        }
+
+        // The header and index first, then the data blocks in one read
+        CHECK(source.reads.size() == 2);
+        const std::vector<rcp::ReadRange> &data = source.reads.back();
+        if (gap < sizeof(Block)) {
+            CHECK(data.size() == 3);
+            for (const rcp::ReadRange &range: data) {CHECK(range.size == sizeof(Block));}
+        } else {
+            // Reading over the skipped blocks saves two requests
+            CHECK(data.size() == 1);
+            CHECK(data[0].size == BLOCK_COUNT * sizeof(Block));
+        }
+    }
+    return true;
+}
+
+bool test_corrupted() {
+    std::string folder = test_folder("source_corrupted");
+    std::vector<std::string> ids;
+    CHECK(save_blocks(folder, ids));
+    Block damaged = make_block(2);
+    uint64_t offset = find_value(folder + "recipe.rcp", damaged);
+    CHECK(flip_byte(folder + "recipe.rcp", offset + 3));
+
+    RecordingSource source(folder + "recipe.rcp");
+    std::vector<Block> blocks(BLOCK_COUNT);
+    rcp::Recipe recipe("recipe", folder);
+    for (size_t i = 0; i < BLOCK_COUNT; i++) {recipe.add_variable("block_" + std::to_string(i), blocks[i]);}
+    recipe.set_source(&source);
+    CHECK(recipe.init());
+    CHECK(!recipe.load_recipe());
+    CHECK(recipe.get_load_error().status == rcp::LoadStatus::Corrupt);
+    CHECK(recipe.get_load_error().offset == offset);
+    CHECK(blocks[2] == Block());
+
+    // The other blocks are still fetched one by one
+    CHECK(recipe.load_variable(ids[0] == "block_2" ? ids[1] : ids[0]));
+    return true;
+}
+
+int main() {
+    return run_tests({
+        {"round_trip", test_round_trip},
+        {"registered_only", test_registered_only},
+        {"corrupted", test_corrupted},
+    });
+}
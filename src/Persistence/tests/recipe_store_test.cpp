@@ -0,0 +1,151 @@
+#include <array>
+#include <memory>
+
+#include "recipe.hpp"
+#include "recipe_store.hpp"
+#include "test_util.hpp"
+
+// Round trips of recipes kept in one store file, in-place saves, corrupted and truncated stores
+
+struct Axis {
+    double position = 0.0;
+    std::array<int32_t, 8> limits = {};
+};
+
+Axis example_axis(int seed) {
+    Axis axis;
+    axis.position = 0.5 * seed;
+    for (size_t i = 0; i < axis.limits.size(); i++) {axis.limits[i] = static_cast<int32_t>(seed * 100 + i);}
+    return axis;
+}
+
+bool same(const Axis &a, const Axis &b) {
+    return a.position == b.position && a.limits == b.limits;
+}
+
+// A recipe per axis, named "axis_<index>"
+struct Fixture {
+    std::vector<Axis> axes;
+    std::vector<std::unique_ptr<rcp::Recipe>> recipes;
+    rcp::RecipeStore store;
+
+    Fixture(const std::string &path, size_t count): axes(count), store(path) {
+        for (size_t i = 0; i < count; i++) {
+            recipes.push_back(std::make_unique<rcp::Recipe>("axis_" + std::to_string(i)));
+            recipes[i]->add_variable("position", axes[i].position);
+            recipes[i]->add_variable("limits", axes[i].limits);
+            store.add_recipe(*recipes[i]);
+        }
+    }
+};
+
+bool save_example(const std::string &path, size_t count) {
+    Fixture fixture(path, count);
+    for (size_t i = 0; i < count; i++) {fixture.axes[i] = example_axis(static_cast<int>(i + 1));}
+    return fixture.store.init() && fixture.store.save_recipes();
+}
+
+bool test_round_trip() {
+    std::string path = test_folder("store_round_trip") + "axes.rcps";
+    CHECK(save_example(path, 5));
+
+    Fixture fixture(path, 5);
+    CHECK(fixture.store.init());
+    CHECK(fixture.store.load_recipes());
+    for (size_t i = 0; i < 5; i++) {CHECK(same(fixture.axes[i], example_axis(static_cast<int>(i + 1))));}
+
+    Fixture single(path, 5);
+    CHECK(single.store.init());
+    CHECK(single.store.load_recipe("axis_3"));
+    CHECK(same(single.axes[3], example_axis(4)));
+    CHECK(same(single.axes[2], Axis()));
+    CHECK(!single.store.load_recipe("axis_9"));
+    return true;
+}
+
+bool test_save_single() {
+    std::string path = test_folder("store_save_single") + "axes.rcps";
+    CHECK(save_example(path, 3));
+    for (rcp::SaveMode mode: {rcp::SaveMode::Direct, rcp::SaveMode::Atomic}) {
+        Fixture fixture(path, 3);
+        fixture.store.set_save_mode(mode);
+        CHECK(fixture.store.init());
+        CHECK(fixture.store.load_recipes());
+        fixture.axes[1] = example_axis(mode == rcp::SaveMode::Direct ? 20 : 30);
+        CHECK(fixture.store.save_recipe("axis_1"));
+
+        Fixture loaded(path, 3);
+        CHECK(loaded.store.init());
+        CHECK(loaded.store.load_recipes());
+        CHECK(same(loaded.axes[0], example_axis(1)));
+        CHECK(same(loaded.axes[1], fixture.axes[1]));
+        CHECK(same(loaded.axes[2], example_axis(3)));
+    }
+    return true;
+}
+
+bool test_dropped_recipe() {
+    std::string path = test_folder("store_dropped") + "axes.rcps";
+    CHECK(save_example(path, 3));
+    {
+        Fixture fixture(path, 3);
+        CHECK(fixture.store.init());
+        CHECK(fixture.store.load_recipes());
+        CHECK(fixture.store.remove_recipe("axis_2"));
+        CHECK(fixture.store.save_recipes());
+    }
+    Fixture loaded(path, 3);
+    CHECK(loaded.store.init());
+    CHECK(loaded.store.load_recipe("axis_0"));
+    CHECK(!loaded.store.load_recipe("axis_2"));
+    CHECK(same(loaded.axes[2], Axis()));
+    return true;
+}
+
+bool test_corrupted() {
+    std::string path = test_folder("store_corrupted") + "axes.rcps";
+    Axis expected = example_axis(2);
+    CHECK(save_example(path, 3));
+    CHECK(flip_byte(path, find_value(path, expected.limits[3])));
+
+    Fixture fixture(path, 3);
+    CHECK(fixture.store.init());
+    CHECK(!fixture.store.load_recipe("axis_1"));
+    CHECK(fixture.axes[1].limits == Axis().limits);
+    CHECK(fixture.store.load_recipe("axis_0"));
+    CHECK(same(fixture.axes[0], example_axis(1)));
+
+    // The store header and directory
+    for (uint64_t offset: {0, 8, 20, 64, 70}) {
+        CHECK(save_example(path, 3));
+        CHECK(flip_byte(path, offset));
+        Fixture damaged(path, 3);
+        CHECK(damaged.store.init());
+        CHECK(!damaged.store.load_recipes());
+    }
+    return true;
+}
+
+bool test_truncated() {
+    std::string path = test_folder("store_truncated") + "axes.rcps";
+    CHECK(save_example(path, 3));
+    std::vector<char> original = read_file(path);
+    // Shortest last, so every size is cut from the previous one
+    for (size_t size = original.size() - 1; size > 0; size -= std::min<size_t>(size, 13)) {
+        CHECK(truncate_file(path, size));
+        Fixture fixture(path, 3);
+        CHECK(fixture.store.init());
+        CHECK(!fixture.store.load_recipe("axis_2"));
+    }
+    return true;
+}
+
+int main() {
+    return run_tests({
+        {"round_trip", test_round_trip},
+        {"save_single", test_save_single},
+        {"dropped_recipe", test_dropped_recipe},
+        {"corrupted", test_corrupted},
+        {"truncated", test_truncated},
+    });
+}
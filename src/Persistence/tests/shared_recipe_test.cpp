@@ -0,0 +1,210 @@
+#include <array>
+#include <atomic>
+#include <thread>
+
+#include <unistd.h>
+
+#include "compression.hpp"
+#include "shared_recipe.hpp"
+#include "test_util.hpp"
+
+// SharedRecipe: publishing into a shared memory segment, looking values up in place, the lifetime of views
+// across generations, and whole-recipe loads racing a publisher
+
+// Segment name unique to this process
+std::string segment_name(const std::string &name) {
+    return "/rcp_test_" + std::to_string(::getpid()) + "_" + name;
+}
+
+// Every word holds the same value, a torn copy mixes two generations
+struct Block {
+    std::array<uint64_t, 256> words = {};
+};
+
+bool consistent(const Block &block) {
+    for (uint64_t word: block.words) {
+        if (word != block.words[0]) {return false;}
+    }
+    return true;
+}
+
+struct Values {
+    int32_t speed = 0;
+    double gain = 0.0;
+    Block block;
+};
+
+void add_values(rcp::Recipe &recipe, Values &values) {
+    recipe.add_variable("speed", values.speed);
+    recipe.add_variable("gain", values.gain);
+    recipe.add_variable("block", values.block);
+}
+
+// A publishing recipe and a reader attached to the same segment
+struct Fixture {
+    Values values;
+    rcp::Recipe recipe;
+    rcp::SharedRecipe publisher;
+    rcp::SharedRecipe reader;
+
+    Fixture(const std::string &name): recipe("shared", test_folder(name)), publisher(segment_name(name)),
+                                      reader(segment_name(name)) {
+        add_values(this->recipe, this->values);
+    }
+
+    ~Fixture() {
+        this->publisher.remove();
+    }
+
+    bool publish(int32_t speed) {
+        this->values.speed = speed;
+        this->values.gain = speed / 4.0;
+        this->values.block.words.fill(static_cast<uint64_t>(speed));
+        return this->publisher.publish(this->recipe);
+    }
+};
+
+bool test_publish_find() {
+    Fixture fixture("publish_find");
+    CHECK(!fixture.reader.attach());
+    CHECK(fixture.recipe.init());
+    CHECK(fixture.publisher.create(16 << 10));
+    CHECK(fixture.publisher.is_publisher() && fixture.publisher.get_capacity() >= (16 << 10));
+    CHECK(fixture.reader.attach());
+    CHECK(fixture.reader.is_attached() && !fixture.reader.is_publisher());
+    CHECK(fixture.reader.generation() == 0);
+    CHECK(fixture.reader.find("speed").data == nullptr);
+
+    CHECK(fixture.publish(1500));
+    CHECK(fixture.reader.generation() == 1);
+    rcp::SharedView view = fixture.reader.find("speed");
+    CHECK(view.data != nullptr && view.size == sizeof(int32_t) && view.generation == 1);
+    CHECK(view.type == rcp::type_fingerprint<int32_t>());
+    CHECK(fixture.reader.valid(view));
+    CHECK(fixture.reader.find("missing").data == nullptr);
+
+    // Reads check the size and type of the stored value
+    int32_t speed = 0;
+    double gain = 0.0;
+    float wrong_type = 0.0f;
+    CHECK(fixture.reader.read("speed", speed) && speed == 1500);
+    CHECK(fixture.reader.read("gain", gain) && gain == 375.0);
+    CHECK(!fixture.reader.read("speed", wrong_type));
+    CHECK(!fixture.reader.read("gain", speed));
+
+    Values loaded;
+    rcp::Recipe recipe("shared", test_folder("publish_find_reader"));
+    add_values(recipe, loaded);
+    CHECK(recipe.init() && fixture.reader.load(recipe));
+    CHECK(loaded.speed == 1500 && loaded.gain == 375.0 && loaded.block.words[7] == 1500);
+
+    // Only the publisher writes
+    CHECK(!fixture.reader.publish(fixture.recipe));
+    fixture.reader.detach();
+    CHECK(!fixture.reader.is_attached() && fixture.reader.generation() == 0);
+    return true;
+}
+
+bool test_view_lifetime() {
+    Fixture fixture("view_lifetime");
+    CHECK(fixture.recipe.init());
+    CHECK(fixture.publisher.create(16 << 10));
+    CHECK(fixture.reader.attach());
+    CHECK(fixture.publish(1));
+    rcp::SharedView view = fixture.reader.find("block");
+
+    // The next generation goes to the other slot, the view stays intact until the one after starts
+    CHECK(fixture.publish(2));
+    CHECK(fixture.reader.valid(view));
+    CHECK(reinterpret_cast<const Block*>(view.data)->words[0] == 1);
+    CHECK(fixture.publish(3));
+    CHECK(!fixture.reader.valid(view));
+    CHECK(fixture.reader.valid(fixture.reader.find("block")));
+
+    // A publisher restarting with the same capacity keeps the generation, another capacity resets the segment
+    rcp::SharedRecipe restarted(fixture.publisher.get_name());
+    CHECK(restarted.create(16 << 10));
+    CHECK(restarted.generation() == 3);
+    CHECK(restarted.create(32 << 10));
+    CHECK(restarted.generation() == 0);
+    return true;
+}
+
+bool test_capacity() {
+    Fixture fixture("capacity");
+    CHECK(fixture.recipe.init());
+    // Too small for the block
+    CHECK(fixture.publisher.create(512));
+    CHECK(fixture.reader.attach());
+    CHECK(!fixture.publish(1));
+    CHECK(fixture.reader.generation() == 0);
+    return true;
+}
+
+bool test_compressed() {
+    for (rcp::Codec codec: {rcp::Codec::LZ4, rcp::Codec::Deflate}) {
+        if (!rcp::codec_available(codec)) {continue;}
+        Fixture fixture("compressed");
+        CHECK(fixture.recipe.set_compression(codec, 256));
+        CHECK(fixture.recipe.init());
+        CHECK(fixture.publisher.create(16 << 10));
+        CHECK(fixture.reader.attach());
+        CHECK(fixture.publish(42));
+
+        // The compressed block cannot be viewed in place, loading decompresses it
+        CHECK(fixture.reader.find("block").data == nullptr);
+        CHECK(fixture.reader.find("speed").data != nullptr);
+        Values loaded;
+        rcp::Recipe recipe("shared", test_folder("compressed_reader"));
+        add_values(recipe, loaded);
+        CHECK(recipe.init() && fixture.reader.load(recipe));
+        CHECK(loaded.block.words[0] == 42 && consistent(loaded.block));
+    }
+    return true;
+}
+
+bool test_load_during_publish() {
+    Fixture fixture("load_during_publish");
+    CHECK(fixture.recipe.init());
+    CHECK(fixture.publisher.create(16 << 10));
+    CHECK(fixture.reader.attach());
+    CHECK(fixture.publish(1));
+
+    // Loads and reads racing the publisher always see one whole generation
+    std::atomic<bool> stop(false);
+    std::atomic<bool> published(true);
+    std::thread writer([&]() {
+        for (int32_t speed = 2; !stop.load(); speed++) {
+            if (!fixture.publish(speed)) {published = false;}
+        }
+    });
+    Values loaded;
+    rcp::Recipe recipe("shared", test_folder("load_during_publish_reader"));
+    add_values(recipe, loaded);
+    CHECK(recipe.init());
+    bool success = true;
+    uint64_t previous = 0;
+    for (int load = 0; load < 500 && success; load++) {
+        Block block;
+        success = fixture.reader.load(recipe) && consistent(loaded.block) &&
+                  loaded.block.words[0] == static_cast<uint64_t>(loaded.speed) &&
+                  fixture.reader.read("block", block) && consistent(block) &&
+                  block.words[0] >= previous;
+        previous = block.words[0];
+    }
+    stop = true;
+    writer.join();
+    CHECK(success);
+    CHECK(published);
+    return true;
+}
+
+int main() {
+    return run_tests({
+        {"publish_find", test_publish_find},
+        {"view_lifetime", test_view_lifetime},
+        {"capacity", test_capacity},
+        {"compressed", test_compressed},
+        {"load_during_publish", test_load_during_publish},
+    });
+}
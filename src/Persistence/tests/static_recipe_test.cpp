@@ -0,0 +1,160 @@
+#include "motor.hpp"
+#include "recipe.hpp"
+#include "test_util.hpp"
+
+// StaticRecipe: the file of a schema is the V2 file of a dynamic Recipe with the same variables,
+// files with another layout are loaded entry by entry through the perfect hash of the schema ids
+
+struct AxisConfig {
+    double position;
+    int64_t counter;
+    uint8_t flags[5];
+};
+
+RCP_SCHEMA(AxisConfig, RCP_SCHEMA_FIELD(position), RCP_SCHEMA_FIELD_ID(counter, "axis counter"), RCP_SCHEMA_FIELD(flags))
+
+using AxisLayout = rcp::StaticLayout<AxisConfig>;
+static_assert(AxisLayout::count == 3);
+static_assert(AxisLayout::index_of("position") == 0);
+static_assert(AxisLayout::index_of("axis counter") == 1);
+static_assert(AxisLayout::index_of("flags") == 2);
+static_assert(AxisLayout::index_of("counter") == AxisLayout::count);
+
+MotorConfig example_motor() {
+    MotorConfig config{};
+    config.speed = 1500;
+    config.gain = 0.75;
+    config.pid[0] = 1.0f;
+    config.pid[1] = 0.1f;
+    config.pid[2] = 0.01f;
+    config.enabled = true;
+    return config;
+}
+
+bool same(const MotorConfig &a, const MotorConfig &b) {
+    return a.speed == b.speed && a.gain == b.gain && a.pid[0] == b.pid[0] && a.pid[1] == b.pid[1] &&
+           a.pid[2] == b.pid[2] && a.enabled == b.enabled;
+}
+
+// A dynamic recipe with the variables of MotorConfig, "motor enabled" is the id of "enabled" in the schema file
+void add_motor(rcp::Recipe &recipe, MotorConfig &config) {
+    recipe.set_file_format(rcp::FileFormat::V2);
+    recipe.add_variable("speed", config.speed);
+    recipe.add_variable("gain", config.gain);
+    recipe.add_variable("pid", config.pid);
+    recipe.add_variable("motor enabled", config.enabled);
+}
+
+bool test_same_file() {
+    std::string folder = test_folder("static_same_file");
+    MotorConfig config = example_motor();
+    rcp::StaticRecipe<MotorConfig> static_recipe(config, "static", folder);
+    CHECK(static_recipe.init() && static_recipe.save_recipe());
+
+    rcp::Recipe recipe("dynamic", folder);
+    add_motor(recipe, config);
+    CHECK(recipe.init() && recipe.save_recipe());
+    CHECK(read_file(folder + "static.rcp") == read_file(folder + "dynamic.rcp"));
+
+    // Saves reuse the file image
+    config.speed = 1750;
+    CHECK(static_recipe.save_recipe());
+    MotorConfig loaded{};
+    rcp::StaticRecipe<MotorConfig> reader(loaded, "static", folder);
+    CHECK(reader.init() && reader.load_recipe());
+    CHECK(loaded.speed == 1750);
+    return true;
+}
+
+bool test_dynamic_round_trip() {
+    for (rcp::SaveMode mode: {rcp::SaveMode::Direct, rcp::SaveMode::Atomic}) {
+        std::string folder = test_folder("static_round_trip");
+        MotorConfig config = example_motor();
+        rcp::StaticRecipe<MotorConfig> static_recipe(config, "motor", folder);
+        static_recipe.set_save_mode(mode);
+        static_recipe.set_sync_mode(rcp::SyncMode::EveryN, 2);
+        CHECK(static_recipe.init() && static_recipe.save_recipe());
+
+        // Written by StaticRecipe, loaded by Recipe in both load modes
+        for (rcp::LoadMode load_mode: {rcp::LoadMode::Stream, rcp::LoadMode::Mapped}) {
+            MotorConfig loaded{};
+            rcp::Recipe recipe("motor", folder);
+            add_motor(recipe, loaded);
+            recipe.set_load_mode(load_mode);
+            CHECK(recipe.init() && recipe.load_recipe());
+            CHECK(same(loaded, config));
+        }
+
+        // Written by Recipe, loaded by StaticRecipe
+        MotorConfig changed = example_motor();
+        changed.gain = -2.5;
+        changed.pid[1] = 0.5f;
+        rcp::Recipe recipe("motor", folder);
+        add_motor(recipe, changed);
+        CHECK(recipe.init() && recipe.save_recipe());
+        CHECK(static_recipe.load_recipe());
+        CHECK(same(config, changed));
+    }
+    return true;
+}
+
+bool test_other_layout() {
+    std::string folder = test_folder("static_other_layout");
+    AxisConfig expected{};
+    expected.position = 12.5;
+    expected.counter = -4;
+    uint8_t flags[4] = {1, 2, 3, 4};
+    int32_t extra = 77;
+
+    // More variables than the schema, one with the wrong size, in another order
+    rcp::Recipe recipe("axis", folder);
+    recipe.set_file_format(rcp::FileFormat::V2);
+    recipe.add_variable("flags", flags);
+    recipe.add_variable("extra", extra);
+    recipe.add_variable("axis counter", expected.counter);
+    recipe.add_variable("position", expected.position);
+    CHECK(recipe.init() && recipe.save_recipe());
+
+    AxisConfig config{};
+    config.flags[0] = 9;
+    rcp::StaticRecipe<AxisConfig> static_recipe(config, "axis", folder);
+    CHECK(static_recipe.init() && static_recipe.load_recipe());
+    CHECK(config.position == 12.5 && config.counter == -4);
+    CHECK(config.flags[0] == 9 && config.flags[1] == 0);
+    return true;
+}
+
+bool test_rejected() {
+    std::string folder = test_folder("static_rejected");
+    MotorConfig config = example_motor();
+    rcp::StaticRecipe<MotorConfig> static_recipe(config, "motor", folder);
+    CHECK(!static_recipe.save_recipe());
+    CHECK(!static_recipe.load_recipe());
+    CHECK(static_recipe.init() && static_recipe.save_recipe());
+
+    // A damaged value fails its checksum before any field is written
+    CHECK(flip_byte(static_recipe.get_path(), find_value(static_recipe.get_path(), config.gain)));
+    MotorConfig loaded{};
+    rcp::StaticRecipe<MotorConfig> reader(loaded, "motor", folder);
+    CHECK(reader.init());
+    CHECK(!reader.load_recipe());
+    CHECK(same(loaded, MotorConfig{}));
+
+    // V1 files are not read
+    rcp::Recipe recipe("motor", folder);
+    add_motor(recipe, config);
+    recipe.set_file_format(rcp::FileFormat::V1);
+    CHECK(recipe.init() && recipe.save_recipe());
+    CHECK(!reader.load_recipe());
+    CHECK(same(loaded, MotorConfig{}));
+    return true;
+}
+
+int main() {
+    return run_tests({
+        {"same_file", test_same_file},
+        {"dynamic_round_trip", test_dynamic_round_trip},
+        {"other_layout", test_other_layout},
+        {"rejected", test_rejected},
+    });
+}
@@ -0,0 +1,92 @@
+#ifndef RCP_TEST_UTIL_HPP
+#define RCP_TEST_UTIL_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Minimal test harness for the ctest targets of the apptools libraries.
+// A test is a function returning true on success, CHECK reports the failing condition and fails the test.
+
+#define CHECK(condition)                                                                        \
+    do {                                                                                        \
+        if (!(condition)) {                                                                     \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #condition << std::endl; \
+            return false;                                                                       \
+        }                                                                                       \
+    } while (false)
+
+using Test = std::pair<const char*, std::function<bool()>>;
+
+// Run every test and print its result, the return value is the exit code of the test executable
+inline int run_tests(const std::vector<Test> &tests) {
+    int failed = 0;
+    for (const Test &test: tests) {
+        bool success = test.second();
+        std::cout << (success ? "[ ok ] " : "[fail] ") << test.first << std::endl;
+        if (!success) {failed++;}
+    }
+    std::cout << tests.size() - failed << "/" << tests.size() << " tests passed" << std::endl;
+    return failed == 0 ? 0 : 1;
+}
+
+// Empty directory for the files of one test executable, below the temporary directory
+inline std::string test_folder(const std::string &name) {
+    std::filesystem::path folder = std::filesystem::temp_directory_path() / "rcp_tests" / name;
+    std::error_code error;
+    std::filesystem::remove_all(folder, error);
+    std::filesystem::create_directories(folder);
+    return folder.string() + "/";
+}
+
+inline std::vector<char> read_file(const std::string &path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+inline bool write_file(const std::string &path, const std::vector<char> &data) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(data.data(), static_cast<std::streamsize>(data.size()));
+    return file.good();
+}
+
+// Cut a file to its first "size" bytes
+inline bool truncate_file(const std::string &path, uint64_t size) {
+    std::error_code error;
+    std::filesystem::resize_file(path, size, error);
+    return !error;
+}
+
+// Invert the bits of one byte of a file, in place
+inline bool flip_byte(const std::string &path, uint64_t offset) {
+    std::error_code error;
+    if (offset >= std::filesystem::file_size(path, error) || error) {return false;}
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    char byte = 0;
+    file.seekg(static_cast<std::streamoff>(offset));
+    file.read(&byte, 1);
+    byte = static_cast<char>(~byte);
+    file.seekp(static_cast<std::streamoff>(offset));
+    file.write(&byte, 1);
+    return file.good();
+}
+
+// Offset of the first occurrence of the bytes of a value in a file, the file size if it is not found
+template <typename T>
+uint64_t find_value(const std::string &path, const T &value) {
+    std::vector<char> data = read_file(path);
+    const char *bytes = reinterpret_cast<const char*>(&value);
+    for (uint64_t offset = 0; offset + sizeof(T) <= data.size(); offset++) {
+        if (std::equal(bytes, bytes + sizeof(T), data.data() + offset)) {return offset;}
+    }
+    return data.size();
+}
+
+#endif
@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "clparser.hpp"
+#include "recipe.hpp"
+#include "trace.hpp"
+
+// Replays startup workloads of the CLI and Persistence libraries and reports their latency.
+// Built with APPTOOLS_TRACE, the spans of every run are written to a Chrome trace file.
+
+void print_help() {
+    std::string str = "";
+    str += "Usage: apptools_profile [opts].\n";
+    str += "    -h: Display this message.\n";
+    str += "    -a <arguments>: Number of arguments of the parsed command line (default: 100000).\n";
+    str += "    -n <variables>: Number of recipe variables (default: 100000).\n";
+    str += "    -r <repeats>: Runs per workload (default: 5).\n";
+    str += "    -d <folder>: Folder of the recipe file (default: the temporary directory).\n";
+    str += "    -o <trace_file>: Chrome trace output (default: apptools_profile.json in the recipe folder).\n";
+    std::cout << str << std::endl;
+}
+
+// Run a workload "repeats" times and print the fastest and the median run
+void measure(const char *name, int repeats, const std::function<bool()> &workload) {
+    std::vector<double> runs;
+    bool success = true;
+    for (int i = 0; i < repeats; i++) {
+        TRC_SPAN("profile", name);
+        auto start = std::chrono::steady_clock::now();
+        success = workload() && success;
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        runs.push_back(elapsed.count());
+    }
+    std::sort(runs.begin(), runs.end());
+    std::cout << std::left << std::setw(32) << name << std::right << std::fixed << std::setprecision(3)
+              << std::setw(12) << runs.front() << std::setw(12) << runs[runs.size() / 2]
+              << (success ? "" : "   failed") << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    trc::start();
+
+    CLInfo info;
+    CLParser parser(0, "ha:n:r:d:o:");
+    parser.parse(argc, argv, info);
+    if (!info.success) {
+        std::cout << info.info << std::endl;
+        print_help();
+        return -1;
+    }
+    if (parser.get_opt("-h")) {
+        print_help();
+        return 0;
+    }
+    int num_arguments = std::max(parser.get_kwarg<int>("-a", 100000), 1);
+    int num_variables = std::max(parser.get_kwarg<int>("-n", 100000), 1);
+    int repeats = std::max(parser.get_kwarg<int>("-r", 5), 1);
+    std::string folder = parser.get_kwarg<std::string>("-d", std::filesystem::temp_directory_path().string());
+    if (!folder.empty() && folder.back() != '/') {folder += '/';}
+    std::string trace_file = parser.get_kwarg<std::string>("-o", folder + "apptools_profile.json");
+
+    std::cout << std::left << std::setw(32) << "workload" << std::right
+              << std::setw(12) << "min ms" << std::setw(12) << "median ms" << std::endl;
+
+    // Large command line: positional arguments followed by options and keyword arguments
+    std::vector<std::string> tokens;
+    tokens.push_back("apptools_profile");
+    for (int i = 0; i < num_arguments; i++) {tokens.push_back("/data/input/file_" + std::to_string(i) + ".dat");}
+    for (const char *token: {"-v", "-q", "-j", "16", "-o", "/data/output", "-m", "release"}) {tokens.push_back(token);}
+    std::vector<char*> command_argv;
+    std::string command_line;
+    for (std::string &token: tokens) {
+        command_argv.push_back(token.data());
+        command_line += token;
+        command_line += ' ';
+    }
+    CLParser command_parser(num_arguments, "vqj:o:m:");
+    measure("CLParser::parse(argv)", repeats, [&]() {
+        CLInfo result;
+        command_parser.parse(static_cast<int>(command_argv.size()), command_argv.data(), result);
+        return result.success && command_parser.get_kwarg<int>("-j", 0) == 16;
+    });
+    measure("CLParser::parse(string)", repeats, [&]() {
+        CLInfo result;
+        command_parser.parse(command_line, result);
+        return result.success;
+    });
+
+    // Large recipe: a mix of integers, floating-point values and small arrays
+    size_t count = static_cast<size_t>(num_variables);
+    std::vector<int32_t> integers(count / 2);
+    std::vector<double> doubles(count / 4);
+    std::vector<std::array<float, 4>> vectors(count - integers.size() - doubles.size());
+    for (size_t i = 0; i < integers.size(); i++) {integers[i] = static_cast<int32_t>(i);}
+    for (size_t i = 0; i < doubles.size(); i++) {doubles[i] = 0.5 * static_cast<double>(i);}
+    for (size_t i = 0; i < vectors.size(); i++) {vectors[i] = {1.0f, 2.0f, 3.0f, static_cast<float>(i)};}
+
+    std::unique_ptr<rcp::Recipe> recipe;
+    measure("Recipe::add_variable", repeats, [&]() {
+        recipe = std::make_unique<rcp::Recipe>("apptools_profile", folder);
+        recipe->set_file_format(rcp::FileFormat::V2);
+        recipe->reserve(count, count * 24);
+        bool success = true;
+        for (size_t i = 0; i < integers.size(); i++) {
+            success = recipe->add_variable("axis_" + std::to_string(i % 64) + ".limit_" + std::to_string(i), integers[i]) && success;
+        }
+        for (size_t i = 0; i < doubles.size(); i++) {
+            success = recipe->add_variable("axis_" + std::to_string(i % 64) + ".gain_" + std::to_string(i), doubles[i]) && success;
+        }
+        for (size_t i = 0; i < vectors.size(); i++) {
+            success = recipe->add_variable("axis_" + std::to_string(i % 64) + ".pose_" + std::to_string(i), vectors[i]) && success;
+        }
+        return success;
+    });
+    measure("Recipe::init", repeats, [&]() {return recipe->init();});
+    measure("Recipe::save_recipe", repeats, [&]() {return recipe->save_recipe();});
+    measure("Recipe::load_recipe(stream)", repeats, [&]() {return recipe->load_recipe();});
+    recipe->set_load_mode(rcp::LoadMode::Mapped);
+    measure("Recipe::load_recipe(mapped)", repeats, [&]() {return recipe->load_recipe();});
+    measure("Recipe::load_recipe(parallel)", repeats, [&]() {return recipe->load_recipe(rcp::ParallelPolicy());});
+
+    // Incremental saves after changing one percent of the values
+    recipe->set_dirty_tracking(rcp::DirtyTracking::Snapshot);
+    bool saved = recipe->save_recipe();
+    measure("Recipe::save_recipe(dirty)", repeats, [&]() {
+        for (size_t i = 0; i < integers.size(); i += 100) {integers[i] += 1;}
+        return saved && recipe->save_recipe();
+    });
+
+    std::string recipe_path = recipe->get_path();
+    recipe.reset();
+    std::error_code error;
+    std::filesystem::remove(recipe_path, error);
+
+    trc::stop();
+    if (!trc::TRACE_ENABLED) {
+        std::cout << "Tracing disabled, configure with -DAPPTOOLS_TRACE=ON to write a trace." << std::endl;
+    } else if (trc::write_chrome_trace(trace_file)) {
+        std::cout << "Trace: " << trace_file << " (" << trc::events().size() << " spans)" << std::endl;
+    } else {
+        std::cout << "Could not write the trace to " << trace_file << std::endl;
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,113 @@
+#ifndef TRC_TRACE_HPP
+#define TRC_TRACE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace trc {
+
+/**
+ * Opt-in tracing of scoped spans, exported as Chrome trace JSON.
+ *
+ * --------------------------------------------
+ * Usage description:
+ * --------------------------------------------
+ * Configure the build with -DAPPTOOLS_TRACE=ON to compile the spans of the libraries in.
+ * Call "start" to begin recording and "write_chrome_trace" to export the recorded spans.
+ * The file opens in chrome://tracing, https://ui.perfetto.dev or speedscope,
+ * which draw the nested spans of each thread as a flame graph.
+ *
+ * Place TRC_SPAN("category", "name") at the top of a scope to record one span from there to the end of the scope:
+ *     void load() {
+ *         TRC_SPAN("app", "load");
+ *         ...
+ *     }
+ * The libraries record CLParser::parse, Recipe::init and the loads and saves of a Recipe.
+ *
+ * --------------------------------------------
+ * Notes:
+ * --------------------------------------------
+ * Without APPTOOLS_TRACE TRC_SPAN expands to nothing, "start" does nothing and nothing is exported.
+ * While not recording, a span costs one relaxed atomic load.
+ * While recording, a span reads the clock twice and appends one event to a buffer of the current thread, without locking.
+ * Names and categories are not copied, pass string literals or strings that outlive the export.
+ * Every thread keeps its buffer until the process exits, so spans of finished threads are exported too.
+*/
+
+#ifdef APPTOOLS_TRACE
+constexpr bool TRACE_ENABLED = true;
+#else
+constexpr bool TRACE_ENABLED = false;
+#endif
+
+/**
+ * One recorded span.
+ * "start" is in nanoseconds since the first span or "start" call of the process, "duration" in nanoseconds.
+ * "thread" numbers the recording threads from 1 in the order of their first span.
+*/
+struct TraceEvent {
+    const char *name;
+    const char *category;
+    uint64_t start;
+    uint64_t duration;
+    uint32_t thread;
+};
+
+void start();
+void stop();
+bool is_recording();
+std::vector<TraceEvent> events();
+bool write_chrome_trace(const std::string &path);
+
+namespace detail {
+
+extern std::atomic<bool> recording;
+
+uint64_t now();
+void record(const char *name, const char *category, uint64_t start, uint64_t end);
+
+}
+
+#ifdef APPTOOLS_TRACE
+
+/**
+ * Records the time from its construction to its destruction as one span, see TRC_SPAN.
+ * Spans constructed while not recording are not recorded.
+*/
+class Span {
+    public:
+        Span(const char *category, const char *name) {
+            this->_name = name;
+            this->_category = category;
+            this->_recording = detail::recording.load(std::memory_order_relaxed);
+            this->_start = this->_recording ? detail::now() : 0;
+        }
+
+        ~Span() {
+            if (this->_recording) {detail::record(this->_name, this->_category, this->_start, detail::now());}
+        }
+
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+    private:
+        const char *_name;
+        const char *_category;
+        uint64_t _start;
+        bool _recording;
+};
+
+#define TRC_CONCAT_IMPL(a, b) a##b
+#define TRC_CONCAT(a, b) TRC_CONCAT_IMPL(a, b)
+#define TRC_SPAN(category, name) ::trc::Span TRC_CONCAT(trc_span_, __LINE__)(category, name)
+
+#else
+
+#define TRC_SPAN(category, name) static_cast<void>(0)
+
+#endif
+
+}
+
+#endif
@@ -0,0 +1,208 @@
+#include "trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+
+namespace trc {
+
+namespace detail {
+
+std::atomic<bool> recording(false);
+
+}
+
+namespace {
+
+// Events per chunk of a thread buffer, a chunk is about 160 KiB
+constexpr size_t CHUNK_EVENTS = 4096;
+
+// Fixed block of events, only the owning thread writes, exports read up to "count"
+struct Chunk {
+    TraceEvent events[CHUNK_EVENTS];
+    std::atomic<size_t> count{0};
+    std::atomic<Chunk*> next{nullptr};
+};
+
+// Events of one thread, a list of chunks that only grows
+struct ThreadBuffer {
+    uint32_t thread;
+    Chunk *head;
+    Chunk *tail;
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    uint32_t next_thread = 1;
+    std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+};
+
+// Never destroyed, threads may still record while static objects are destroyed at exit
+Registry& registry() {
+    static Registry *registry = new Registry();
+    return *registry;
+}
+
+ThreadBuffer* thread_buffer() {
+    thread_local ThreadBuffer *buffer = nullptr;
+    if (buffer != nullptr) {return buffer;}
+    Registry &shared = registry();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    std::unique_ptr<ThreadBuffer> created(new ThreadBuffer{shared.next_thread++, new Chunk(), nullptr});
+    created->tail = created->head;
+    buffer = created.get();
+    shared.buffers.push_back(std::move(created));
+    return buffer;
+}
+
+void write_string(std::ofstream &file, const char *text) {
+    file << '"';
+    for (const char *c = text; c != nullptr && *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') {
+            file << '\\' << *c;
+        } else if (static_cast<unsigned char>(*c) < 0x20) {
+            constexpr char HEX[] = "0123456789abcdef";
+            file << "\\u00" << HEX[(*c >> 4) & 0xF] << HEX[*c & 0xF];
+        } else {
+            file << *c;
+        }
+    }
+    file << '"';
+}
+
+// Chrome trace times are in microseconds, keep the nanoseconds as three decimals
+void write_microseconds(std::ofstream &file, uint64_t nanoseconds) {
+    char decimals[4] = {
+        static_cast<char>('0' + nanoseconds / 100 % 10), static_cast<char>('0' + nanoseconds / 10 % 10),
+        static_cast<char>('0' + nanoseconds % 10), '\0'
+    };
+    file << nanoseconds / 1000 << '.' << decimals;
+}
+
+}
+
+/**
+ * Start recording spans, see TRC_SPAN.
+ * Spans recorded before an earlier "stop" are kept.
+ * Does nothing without APPTOOLS_TRACE.
+*/
+void start() {
+    if (!TRACE_ENABLED) {return;}
+    registry();
+    detail::recording.store(true, std::memory_order_relaxed);
+}
+
+/**
+ * Stop recording spans.
+ * Spans that are open keep recording until they end.
+*/
+void stop() {
+    detail::recording.store(false, std::memory_order_relaxed);
+}
+
+/**
+ * Check if spans are recorded
+ *
+ * @return true between "start" and "stop"
+*/
+bool is_recording() {
+    return detail::recording.load(std::memory_order_relaxed);
+}
+
+/**
+ * Copy the recorded spans.
+ * Safe to call while other threads record, their spans ending during the copy may be missing.
+ *
+ * @return the spans ordered by thread and start time
+*/
+std::vector<TraceEvent> events() {
+    std::vector<TraceEvent> events;
+    Registry &shared = registry();
+    {
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        for (const std::unique_ptr<ThreadBuffer> &buffer: shared.buffers) {
+            for (const Chunk *chunk = buffer->head; chunk != nullptr; chunk = chunk->next.load(std::memory_order_acquire)) {
+                size_t count = chunk->count.load(std::memory_order_acquire);
+                events.insert(events.end(), chunk->events, chunk->events + count);
+            }
+        }
+    }
+    std::sort(events.begin(), events.end(), [](const TraceEvent &a, const TraceEvent &b) {
+        return a.thread != b.thread ? a.thread < b.thread : a.start < b.start;
+    });
+    return events;
+}
+
+/**
+ * Write the recorded spans as a Chrome trace file, one complete ("X") event per span.
+ * Spans of one thread share a "tid", all spans use "pid" 1.
+ *
+ * @param path the trace file, overwritten
+ *
+ * @return false if the file could not be written or the library was built without APPTOOLS_TRACE
+*/
+bool write_chrome_trace(const std::string &path) {
+    if (!TRACE_ENABLED) {return false;}
+    std::vector<TraceEvent> recorded = events();
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {return false;}
+
+    file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    for (size_t i = 0; i < recorded.size(); i++) {
+        const TraceEvent &event = recorded[i];
+        file << (i == 0 ? "\n" : ",\n") << "{\"name\":";
+        write_string(file, event.name);
+        file << ",\"cat\":";
+        write_string(file, event.category);
+        file << ",\"ph\":\"X\",\"ts\":";
+        write_microseconds(file, event.start);
+        file << ",\"dur\":";
+        write_microseconds(file, event.duration);
+        file << ",\"pid\":1,\"tid\":" << event.thread << '}';
+    }
+    file << "\n]}\n";
+    file.flush();
+    return file.good();
+}
+
+namespace detail {
+
+/**
+ * Get the time of a span boundary
+ *
+ * @return nanoseconds since the tracing clock origin
+*/
+uint64_t now() {
+    auto elapsed = std::chrono::steady_clock::now() - registry().origin;
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
+
+/**
+ * Append a span to the buffer of the current thread
+ *
+ * @param name the span name
+ * @param category the span category
+ * @param start the start time, see "now"
+ * @param end the end time, see "now"
+*/
+void record(const char *name, const char *category, uint64_t start, uint64_t end) {
+    ThreadBuffer *buffer = thread_buffer();
+    Chunk *chunk = buffer->tail;
+    size_t count = chunk->count.load(std::memory_order_relaxed);
+    if (count == CHUNK_EVENTS) {
+        Chunk *next = new Chunk();
+        chunk->next.store(next, std::memory_order_release);
+        buffer->tail = next;
+        chunk = next;
+        count = 0;
+    }
+    chunk->events[count] = TraceEvent{name, category, start, end - start, buffer->thread};
+    chunk->count.store(count + 1, std::memory_order_release);
+}
+
+}
+
+}